@@ -0,0 +1,79 @@
+// AllocatorBenchmark.cpp : Throughput of scenario computations with heap-allocated and arena-allocated scratch matrices.
+
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+#include "MatrixX.h"
+
+namespace
+{
+	/// <summary>
+	/// One scenario of a batch: shift a curve, discount it and aggregate. Every step allocates a scratch matrix.
+	/// </summary>
+	template<typename Matrix>
+	double scenario(const MatrixXd& curve, const Matrix& discount, double shift)
+	{
+		Matrix shocked{ curve + shift * curve };
+		Matrix pv{ discount * shocked };
+		Matrix spread{ pv - shocked };
+		return spread.sum();
+	}
+
+	/// <summary>
+	/// Scenarios per second on ``threads`` threads, each running ``perThread`` scenarios.
+	/// ``arena`` opens an ``ArenaScope`` around every scenario.
+	/// </summary>
+	template<typename Matrix>
+	double throughput(int threads, int perThread, int n, bool arena)
+	{
+		MatrixXd curve{ n, n };
+		MatrixXd discount{ n, n };
+		fillRandom(curve.data(), curve.data() + curve.size(), 1);
+		fillRandom(discount.data(), discount.data() + discount.size(), 2);
+
+		std::vector<double> results(threads);
+		const double time{ bestOf(3, [&] {
+			std::vector<std::thread> workers;
+			for (int t{}; t < threads; ++t)
+				workers.emplace_back([&, t] {
+					const Matrix localDiscount{ discount };
+					double total{};
+					for (int s{}; s < perThread; ++s)
+					{
+						if (arena)
+						{
+							ArenaScope scope;
+							total += scenario<Matrix>(curve, localDiscount, 1e-4 * s);
+						}
+						else
+							total += scenario<Matrix>(curve, localDiscount, 1e-4 * s);
+					}
+					results[t] = total;
+				});
+			for (std::thread& worker : workers)
+				worker.join();
+		}) };
+		return threads * perThread / time;
+	}
+}
+
+void runAllocatorBenchmark()
+{
+	// Scenario matrices are small, so the products stay on their own thread.
+	setThreadCount(1);
+	std::printf("%6s %8s %14s %14s %14s   (scenarios per second)\n", "n", "threads", "malloc", "aligned", "arena");
+	for (int n : { 8, 32 })
+	{
+		const int perThread{ n <= 8 ? 200000 : 20000 };
+		for (int threads : { 1, 2, 4, 8 })
+		{
+			const double heap{ throughput<MatrixX<double, std::allocator<double>>>(threads, perThread, n, false) };
+			const double aligned{ throughput<MatrixXd>(threads, perThread, n, false) };
+			const double arena{ throughput<MatrixX<double, ArenaAllocator<double>>>(threads, perThread, n, true) };
+			std::printf("%6d %8d %14.0f %14.0f %14.0f\n", n, threads, heap, aligned, arena);
+		}
+	}
+	setThreadCount(0);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef Benchmark_H
+#define Benchmark_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+/// Benchmark harness.
+//
+/// Every benchmark suite is a free function ``runXxxBenchmark()`` declared here, defined in its own
+/// translation unit and registered in the table in main.cpp. The suites print plain-text tables to
+/// stdout, so that runs on different machines can be diffed.
+
+/// <summary>
+/// Run ``f`` ``repetitions`` times and return the fastest wall-clock time, in seconds.
+/// </summary>
+/// <typeparam name="F"></typeparam>
+/// <param name="repetitions"></param>
+/// <param name="f"></param>
+/// <returns></returns>
+template<typename F>
+double bestOf(int repetitions, F&& f)
+{
+	double best{ 1e300 };
+	for (int r{}; r < repetitions; ++r)
+	{
+		const auto start{ std::chrono::steady_clock::now() };
+		f();
+		const auto stop{ std::chrono::steady_clock::now() };
+		best = std::min(best, std::chrono::duration<double>(stop - start).count());
+	}
+	return best;
+}
+
+/// <summary>
+/// Fill a range with uniformly distributed values in [-1, 1) from a fixed seed.
+/// </summary>
+template<typename Iterator>
+void fillRandom(Iterator first, Iterator last, unsigned seed = 42)
+{
+	std::mt19937 generator{ seed };
+	std::uniform_real_distribution<double> distribution{ -1.0, 1.0 };
+	for (; first != last; ++first)
+		*first = static_cast<typename std::iterator_traits<Iterator>::value_type>(distribution(generator));
+}
+
+// Benchmark suites
+void runGemmBenchmark();
+void runSimdBenchmark();
+void runScalingBenchmark();
+void runTransposeBenchmark();
+void runViewBenchmark();
+void runAllocatorBenchmark();
+void runFixedSizeBenchmark();
+void runLUBenchmark();
+void runCholeskyBenchmark();
+void runIterativeBenchmark();
+void runSparseBenchmark();
+void runTridiagonalBenchmark();
+void runEigenBenchmark();
+void runQRBenchmark();
+void runMatrixBatchBenchmark();
+void runMixedPrecisionBenchmark();
+void runMatrixIOBenchmark();
+void runCalendarBenchmark();
+
+#endif // !Benchmark_H
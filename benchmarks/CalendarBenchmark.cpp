@@ -0,0 +1,277 @@
+// CalendarBenchmark.cpp : Holiday calendar lookups.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "Benchmark.h"
+#include "HolidayCalendar.h"
+
+namespace
+{
+	/// <summary>
+	/// Random dates between 1990 and 2060, the range of the cashflows of a typical book.
+	/// </summary>
+	std::vector<date> randomDates(int n)
+	{
+		std::mt19937 generator{ 7 };
+		const date first{ 1990, 1, 1 };
+		std::uniform_int_distribution<int> offset{ 0, static_cast<int>((date{ 2060, 12, 31 } - first).days()) };
+		std::vector<date> dates;
+		dates.reserve(n);
+		for (int i{}; i < n; ++i)
+			dates.push_back(first + days(offset(generator)));
+		return dates;
+	}
+
+	/// <summary>
+	/// The lookup before the business day bitmap: a weekend test, then a scan of the unsorted holidays.
+	/// </summary>
+	bool scanIsHoliday(const std::vector<date>& holidays, const date& d)
+	{
+		if (d.day_of_week() == Saturday || d.day_of_week() == Sunday)
+			return true;
+		return std::find(holidays.begin(), holidays.end(), d) != holidays.end();
+	}
+
+	/// <summary>
+	/// isHoliday on the London calendar: 10^8 lookups through the bitmap, against the scan of the holidays
+	/// (timed on fewer lookups and scaled to 10^8).
+	/// </summary>
+	void runLookups()
+	{
+		const HolidayCalendar london{ HolidayCalendarId::GBLO };
+		const std::vector<date> holidays{ london.getHolidays() };
+		const std::vector<date> dates{ randomDates(1 << 20) };
+		const long long lookups{ 100000000 };
+		const int scanned{ 100000 };
+
+		std::printf("isHoliday, GBLO (%zu holidays)\n", holidays.size());
+		std::printf("%-12s %14s %14s %14s\n", "lookup", "lookups", "ns/lookup", "s per 10^8");
+
+		long long count{};
+		const double scan{ bestOf(3, [&] {
+			count = 0;
+			for (int i{}; i < scanned; ++i)
+				count += scanIsHoliday(holidays, dates[i]);
+		}) };
+		std::printf("%-12s %14d %14.2f %14.3f\n", "scan", scanned, scan / scanned * 1e9, scan / scanned * lookups);
+
+		long long bitmapCount{};
+		const double bitmap{ bestOf(3, [&] {
+			bitmapCount = 0;
+			for (long long i{}; i < lookups; ++i)
+				bitmapCount += london.isHoliday(dates[i & (dates.size() - 1)]);
+		}) };
+		std::printf("%-12s %14lld %14.2f %14.3f\n", "bitmap", lookups, bitmap / lookups * 1e9, bitmap);
+		std::printf("speedup %.0fx (%lld holidays in the scanned dates, %lld in all)\n", scan / scanned * lookups / bitmap, count, bitmapCount);
+	}
+
+	/// <summary>
+	/// Business day arithmetic on the London calendar: counts between two dates and moves by a number of
+	/// business days, through the cumulative index and by stepping day by day with isHoliday.
+	/// </summary>
+	void runArithmetic()
+	{
+		const HolidayCalendar london{ HolidayCalendarId::GBLO };
+		const std::vector<date> dates{ randomDates(1 << 16) };
+		const int n{ static_cast<int>(dates.size()) };
+		const int lookups{ 10000000 };
+
+		std::printf("business day arithmetic, GBLO\n");
+		std::printf("%-28s %14s %14s\n", "operation", "ns (stepping)", "ns (index)");
+
+		// Accrual periods of about three months, and settlement lags of two business days.
+		long long checksum{};
+		const double countStepped{ bestOf(3, [&] {
+			for (int i{}; i < n; ++i)
+				for (date d{ dates[i] }; d < dates[i] + days(91); d += days(1))
+					checksum += london.isBusinessDay(d);
+		}) / n };
+		const double countIndexed{ bestOf(3, [&] {
+			for (int i{}; i < lookups; ++i)
+				checksum += london.businessDaysBetween(dates[i & (n - 1)], dates[i & (n - 1)] + days(91));
+		}) / lookups };
+		std::printf("%-28s %14.2f %14.2f\n", "businessDaysBetween, 91 days", countStepped * 1e9, countIndexed * 1e9);
+
+		const double addStepped{ bestOf(3, [&] {
+			for (int i{}; i < n; ++i)
+			{
+				date d{ dates[i] };
+				for (int k{}; k < 2; ++k)
+					for (d += days(1); london.isHoliday(d); d += days(1)) {}
+				checksum += d.day();
+			}
+		}) / n };
+		const double addIndexed{ bestOf(3, [&] {
+			for (int i{}; i < lookups; ++i)
+				checksum += london.addBusinessDays(dates[i & (n - 1)], 2).day();
+		}) / lookups };
+		std::printf("%-28s %14.2f %14.2f\n", "addBusinessDays, 2", addStepped * 1e9, addIndexed * 1e9);
+
+		const double yearStepped{ bestOf(3, [&] {
+			for (int i{}; i < n; ++i)
+			{
+				date d{ dates[i] };
+				for (int k{}; k < 252; ++k)
+					for (d += days(1); london.isHoliday(d); d += days(1)) {}
+				checksum += d.day();
+			}
+		}) / n };
+		const double yearIndexed{ bestOf(3, [&] {
+			for (int i{}; i < lookups; ++i)
+				checksum += london.addBusinessDays(dates[i & (n - 1)], 252).day();
+		}) / lookups };
+		std::printf("%-28s %14.2f %14.2f\n", "addBusinessDays, 252", yearStepped * 1e9, yearIndexed * 1e9);
+		std::printf("(checksum %lld)\n", checksum);
+	}
+
+	/// <summary>
+	/// isBusinessDay for GBLO+NYSE trades: two lookups, one in each calendar, against one lookup in the joint
+	/// calendar, whose bitmap is merged when it is built.
+	/// </summary>
+	void runJointLookups()
+	{
+		const HolidayCalendar london{ HolidayCalendarId::GBLO };
+		const HolidayCalendar newYork{ { date{ 2024, 1, 15 }, date{ 2024, 7, 4 }, date{ 2024, 11, 28 } }, Saturday, Sunday, HolidayCalendarId::NYSE };
+		const std::vector<date> dates{ randomDates(1 << 20) };
+		const long long lookups{ 100000000 };
+
+		std::printf("isBusinessDay, GBLO+NYSE\n");
+		std::printf("%-22s %14s %14s\n", "lookup", "ms", "ns/lookup");
+		const auto report{ [lookups](const char* lookup, double time) {
+			std::printf("%-22s %14.2f %14.2f\n", lookup, time * 1e3, time / lookups * 1e9);
+		} };
+
+		long long count{};
+		report("GBLO alone", bestOf(3, [&] {
+			for (long long i{}; i < lookups; ++i)
+				count += london.isBusinessDay(dates[i & (dates.size() - 1)]);
+		}));
+		report("GBLO and NYSE", bestOf(3, [&] {
+			for (long long i{}; i < lookups; ++i)
+			{
+				const date& d{ dates[i & (dates.size() - 1)] };
+				count += london.isBusinessDay(d) && newYork.isBusinessDay(d);
+			}
+		}));
+		HolidayCalendar joint;
+		const double build{ bestOf(3, [&] { joint = london + newYork; }) };
+		report("GBLO+NYSE", bestOf(3, [&] {
+			for (long long i{}; i < lookups; ++i)
+				count += joint.isBusinessDay(dates[i & (dates.size() - 1)]);
+		}));
+		std::printf("(%s built in %.1f us, checksum %lld)\n", joint.getName().c_str(), build * 1e6, count);
+	}
+
+	/// <summary>
+	/// Calendars for a service that needs one per request: building the calendar every time, copying a
+	/// prototype, and asking the registry, by identifier and by name, from one thread and from all of them.
+	/// The first use of the registry builds the calendar, and is timed once.
+	/// </summary>
+	void runRegistry()
+	{
+		const std::vector<date> dates{ randomDates(1 << 16) };
+		const int n{ static_cast<int>(dates.size()) };
+		const int built{ 1000 };
+		const int requests{ 10000000 };
+
+		std::printf("calendar per request, GBLO\n");
+		std::printf("%-28s %14s\n", "calendar", "ns/request");
+		const auto report{ [](const char* calendar, double time, int count) {
+			std::printf("%-28s %14.1f\n", calendar, time / count * 1e9);
+		} };
+
+		report("registry, first use", bestOf(1, [] { holidayCalendar(HolidayCalendarId::GBLO); }), 1);
+		report("registry, first joint use", bestOf(1, [] { holidayCalendar("GBLO+NYSE"); }), 1);
+
+		long long count{};
+		report("constructor", bestOf(3, [&] {
+			for (int i{}; i < built; ++i)
+				count += HolidayCalendar{ HolidayCalendarId::GBLO }.isHoliday(dates[i & (n - 1)]);
+		}), built);
+		const HolidayCalendar prototype{ HolidayCalendarId::GBLO };
+		report("copy", bestOf(3, [&] {
+			for (int i{}; i < built; ++i)
+				count += HolidayCalendar{ prototype }.isHoliday(dates[i & (n - 1)]);
+		}), built);
+		report("registry, by identifier", bestOf(3, [&] {
+			for (int i{}; i < requests; ++i)
+				count += holidayCalendar(HolidayCalendarId::GBLO)->isHoliday(dates[i & (n - 1)]);
+		}), requests);
+		report("registry, handle copy", bestOf(3, [&] {
+			for (int i{}; i < requests; ++i)
+			{
+				const HolidayCalendarHandle calendar{ holidayCalendar(HolidayCalendarId::GBLO) };
+				count += calendar->isHoliday(dates[i & (n - 1)]);
+			}
+		}), requests);
+		report("registry, by name", bestOf(3, [&] {
+			for (int i{}; i < requests; ++i)
+				count += holidayCalendar("GBLO+NYSE")->isHoliday(dates[i & (n - 1)]);
+		}), requests);
+
+		// Every thread asks for the calendar by name: the reads share the map, and never wait for each other.
+		std::atomic<long long> shared{};
+		report("registry, by name, threads", bestOf(3, [&] {
+			parallelFor(0, requests, 1 << 16, [&](int first, int last) {
+				long long local{};
+				for (int i{ first }; i < last; ++i)
+					local += holidayCalendar("GBLO+NYSE")->isHoliday(dates[i & (n - 1)]);
+				shared += local;
+			});
+		}), requests);
+		std::printf("(%d threads, checksum %lld)\n", threadCount(), count + shared);
+	}
+
+	/// <summary>
+	/// Modified following adjustment of the cashflow dates of a portfolio of 500,000 trades with 20 dates each:
+	/// stepping through the days of every date, calling adjust for every date, and the bulk overloads.
+	/// </summary>
+	void runBulkAdjustment()
+	{
+		const HolidayCalendar london{ HolidayCalendarId::GBLO };
+		const BusinessDayConventions convention{ "Modified Following" };
+		const std::vector<date> dates{ randomDates(500000 * 20) };
+		std::vector<std::uint32_t> dayNumbers(dates.size());
+		for (std::size_t i{}; i < dates.size(); ++i)
+			dayNumbers[i] = dates[i].day_number();
+		std::vector<date> adjusted(dates.size());
+		std::vector<std::uint32_t> adjustedNumbers(dates.size());
+		const int n{ static_cast<int>(dates.size()) };
+
+		std::printf("modified following, GBLO, %d dates\n", n);
+		std::printf("%-22s %12s %12s\n", "method", "ms", "ns/date");
+		const auto report{ [n](const char* method, double time) {
+			std::printf("%-22s %12.2f %12.2f\n", method, time * 1e3, time / n * 1e9);
+		} };
+
+		report("stepping", bestOf(3, [&] {
+			for (int i{}; i < n; ++i)
+			{
+				date d{ dates[i] };
+				while (london.isHoliday(d))
+					d += days(1);
+				if (d.month() != dates[i].month())
+					for (d = dates[i]; london.isHoliday(d); d -= days(1)) {}
+				adjusted[i] = d;
+			}
+		}));
+		report("adjust per date", bestOf(3, [&] {
+			for (int i{}; i < n; ++i)
+				adjusted[i] = london.adjust(dates[i], convention);
+		}));
+		report("bulk, dates", bestOf(3, [&] { london.adjust(dates.data(), adjusted.data(), n, convention); }));
+		report("bulk, day numbers", bestOf(3, [&] { london.adjust(dayNumbers.data(), adjustedNumbers.data(), n, convention); }));
+	}
+}
+
+void runCalendarBenchmark()
+{
+	runLookups();
+	runArithmetic();
+	runJointLookups();
+	runBulkAdjustment();
+	runRegistry();
+}
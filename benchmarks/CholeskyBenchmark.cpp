@@ -0,0 +1,79 @@
+// CholeskyBenchmark.cpp : Blocked Cholesky factorizations, and correlated normal draws per path against in batches.
+
+#include <cstdio>
+#include <vector>
+#include "Benchmark.h"
+#include "Cholesky.h"
+#include "LU.h"
+
+namespace
+{
+	/// <summary>
+	/// A random n x n correlation-like matrix, symmetric and positive definite.
+	/// </summary>
+	MatrixXd randomCorrelation(int n, unsigned seed)
+	{
+		MatrixXd b{ n, n };
+		fillRandom(b.data(), b.data() + b.size(), seed);
+		MatrixXd a{ b * b.transpose() };
+		for (int i{}; i < n; ++i)
+			a(i, i) += n;
+		return a;
+	}
+
+	void factorization()
+	{
+		std::printf("%6s %12s %12s %12s   (GFLOP/s, n^3/3 flops)\n", "n", "LLT", "LDLT", "LU / 2");
+		for (int n{ 128 }; n <= 2048; n *= 2)
+		{
+			const MatrixXd a{ randomCorrelation(n, 1) };
+			const double flops{ n * static_cast<double>(n) * n / 3.0 };
+			const int repetitions{ static_cast<int>(std::max(1.0, std::min(10.0, 1e9 / flops))) };
+
+			LLTDecomposition<double> llt;
+			LDLTDecomposition<double> ldlt;
+			LUDecomposition<double> lu;
+			const double lltTime{ bestOf(repetitions, [&] { llt.compute(a); }) };
+			const double ldltTime{ bestOf(repetitions, [&] { ldlt.compute(a); }) };
+			const double luTime{ bestOf(repetitions, [&] { lu.compute(a); }) };
+			std::printf("%6d %12.2f %12.2f %12.2f\n", n, flops / lltTime * 1e-9, flops / ldltTime * 1e-9, flops / luTime * 1e-9);
+		}
+	}
+
+	void draws()
+	{
+		std::printf("\n%8s %8s %16s %16s %9s   (draws per second)\n", "factors", "paths", "per path", "batched", "speedup");
+		for (int n : { 16, 64, 256 })
+		{
+			const int paths{ n <= 64 ? 1 << 16 : 1 << 13 };
+			const CholeskyFactor<double> c{ randomCorrelation(n, 2) };
+			MatrixXd z{ paths, n };
+			fillRandom(z.data(), z.data() + z.size(), 3);
+			double checksum{};
+
+			// One matrix-vector product per path, as a Monte Carlo engine would do without batching.
+			MatrixXd draw{ n, 1 };
+			MatrixXd correlated{ n, 1 };
+			const double perPathTime{ bestOf(3, [&] {
+				for (int p{}; p < paths; ++p)
+				{
+					std::copy(z.data() + p * n, z.data() + (p + 1) * n, draw.data());
+					correlated = c.matrixL() * draw;
+					checksum += correlated(n - 1, 0);
+				}
+			}) };
+
+			MatrixXd x;
+			const double batchedTime{ bestOf(3, [&] { c.apply(z, x); checksum += x(paths - 1, n - 1); }) };
+			std::printf("%8d %8d %16.0f %16.0f %8.1fx\n", n, paths, paths / perPathTime, paths / batchedTime, perPathTime / batchedTime);
+			if (checksum != checksum)
+				std::printf("NaN in result\n");
+		}
+	}
+}
+
+void runCholeskyBenchmark()
+{
+	factorization();
+	draws();
+}
@@ -0,0 +1,46 @@
+// EigenBenchmark.cpp : Symmetric eigendecompositions of covariance matrices, complete and for the largest eigenpairs.
+
+#include <cmath>
+#include <cstdio>
+#include "Benchmark.h"
+#include "SymmetricEigenSolver.h"
+
+namespace
+{
+	/// <summary>
+	/// The covariance of n points of a yield curve with exponentially decaying correlation, plus noise.
+	/// </summary>
+	MatrixXd curveCovariance(int n)
+	{
+		MatrixXd noise{ n, n };
+		fillRandom(noise.data(), noise.data() + noise.size(), 5);
+		MatrixXd c{ n, n };
+		for (int i{}; i < n; ++i)
+			for (int j{}; j <= i; ++j)
+			{
+				const double ti{ 30.0 * i / n };
+				const double tj{ 30.0 * j / n };
+				const double value{ 0.01 * (1 + 0.02 * ti) * (1 + 0.02 * tj) * std::exp(-std::abs(ti - tj) / 8)
+					+ 1e-6 * (noise.coeff(i, j) + noise.coeff(j, i)) };
+				c.coeffRef(i * n + j) = value;
+				c.coeffRef(j * n + i) = value;
+			}
+		return c;
+	}
+}
+
+void runEigenBenchmark()
+{
+	std::printf("%6s %14s %14s %14s %14s   (seconds)\n", "n", "eigenvalues", "all vectors", "largest 3", "largest 10");
+	for (int n : { 100, 250, 500, 1000, 2000 })
+	{
+		const MatrixXd covariance{ curveCovariance(n) };
+		const int repetitions{ n <= 500 ? 3 : 1 };
+		SymmetricEigenSolver<double> solver;
+		const double valuesTime{ bestOf(repetitions, [&] { solver.compute(covariance, false); }) };
+		const double vectorsTime{ bestOf(repetitions, [&] { solver.compute(covariance); }) };
+		const double top3Time{ bestOf(repetitions, [&] { solver.computeLargest(covariance, 3); }) };
+		const double top10Time{ bestOf(repetitions, [&] { solver.computeLargest(covariance, 10); }) };
+		std::printf("%6d %14.4f %14.4f %14.4f %14.4f\n", n, valuesTime, vectorsTime, top3Time, top10Time);
+	}
+}
@@ -0,0 +1,75 @@
+// FixedSizeBenchmark.cpp : Small per-path transforms with compile-time sized matrices, against dynamic-size ones.
+
+#include <cstdio>
+#include <vector>
+#include "Benchmark.h"
+#include "Matrix.h"
+#include "MatrixX.h"
+
+namespace
+{
+	constexpr int transforms{ 1 << 16 };
+
+	void report(const char* operation, int n, double dynamicTime, double fixedTime)
+	{
+		const double scale{ 1e9 / transforms };
+		if (dynamicTime > 0)
+			std::printf("%-14s %3dx%-3d %12.2f %12.2f %9.2fx\n", operation, n, n, dynamicTime * scale, fixedTime * scale, dynamicTime / fixedTime);
+		else
+			std::printf("%-14s %3dx%-3d %12s %12.2f\n", operation, n, n, "-", fixedTime * scale);
+	}
+
+	/// <summary>
+	/// A batch of random, diagonally dominant (hence invertible) n x n transforms and n-vectors.
+	/// </summary>
+	template<int n>
+	void run()
+	{
+		using Fixed = Matrix<double, n, n>;
+		using Column = Matrix<double, n, 1>;
+		std::vector<Fixed> a(transforms);
+		std::vector<Column> x(transforms);
+		std::vector<MatrixXd> dynamicA(transforms, MatrixXd{ n, n });
+		std::vector<MatrixXd> dynamicX(transforms, MatrixXd{ n, 1 });
+		for (int t{}; t < transforms; ++t)
+		{
+			fillRandom(a[t].data(), a[t].data() + n * n, t);
+			fillRandom(x[t].data(), x[t].data() + n, t + 1);
+			for (int i{}; i < n; ++i)
+				a[t](i, i) += n;
+			std::copy(a[t].data(), a[t].data() + n * n, dynamicA[t].data());
+			std::copy(x[t].data(), x[t].data() + n, dynamicX[t].data());
+		}
+
+		std::vector<Fixed> fixedResult(transforms);
+		std::vector<Column> fixedVector(transforms);
+		MatrixXd dynamicResult{ n, n };
+		MatrixXd dynamicVector{ n, 1 };
+		double checksum{};
+
+		report("multiply", n,
+			bestOf(5, [&] { for (int t{ 1 }; t < transforms; ++t) { dynamicResult = dynamicA[t] * dynamicA[t - 1]; checksum += dynamicResult(0, 0); } }),
+			bestOf(5, [&] { for (int t{ 1 }; t < transforms; ++t) fixedResult[t] = a[t] * a[t - 1]; }));
+		report("matrix-vector", n,
+			bestOf(5, [&] { for (int t{}; t < transforms; ++t) { dynamicVector = dynamicA[t] * dynamicX[t]; checksum += dynamicVector(0, 0); } }),
+			bestOf(5, [&] { for (int t{}; t < transforms; ++t) fixedVector[t] = a[t] * x[t]; }));
+		report("determinant", n, 0,
+			bestOf(5, [&] { for (int t{}; t < transforms; ++t) checksum += a[t].determinant(); }));
+		report("inverse", n, 0,
+			bestOf(5, [&] { for (int t{}; t < transforms; ++t) fixedResult[t] = a[t].inverse(); }));
+
+		for (int t{}; t < transforms; ++t)
+			checksum += fixedResult[t](0, 0) + fixedVector[t](0, 0);
+		if (checksum != checksum)
+			std::printf("NaN in result\n");
+	}
+}
+
+void runFixedSizeBenchmark()
+{
+	// Transforms this small never reach the thread pool.
+	std::printf("%-14s %7s %12s %12s %10s   (ns per transform)\n", "operation", "n", "MatrixX", "Matrix", "speedup");
+	run<2>();
+	run<3>();
+	run<4>();
+}
@@ -0,0 +1,125 @@
+// GemmBenchmark.cpp : Throughput of MatrixX operator* against the original triple loop, and of its
+// micro-kernels at every SIMD tier.
+
+#include <cstdio>
+#include "Benchmark.h"
+#include "MatrixX.h"
+#include "Simd.h"
+
+namespace
+{
+	const char* levelName(SimdLevel level)
+	{
+		switch (level)
+		{
+		case SimdLevel::SSE2:
+			return "SSE2";
+		case SimdLevel::AVX2:
+			return "AVX2";
+		case SimdLevel::AVX512:
+			return "AVX-512";
+		default:
+			return "scalar";
+		}
+	}
+
+	/// <summary>
+	/// The original implementation of operator*: an i-k-j loop through the bounds-checked accessor.
+	/// </summary>
+	template<typename scalarType>
+	MatrixX<scalarType> naiveProduct(const MatrixX<scalarType>& A, const MatrixX<scalarType>& B)
+	{
+		MatrixX<scalarType> result{ A.rows(), B.cols() };
+		for (int i{}; i < A.rows(); ++i)
+		{
+			for (int k{}; k < B.cols(); ++k)
+			{
+				scalarType sum{};
+				for (int j{}; j < A.cols(); ++j)
+					sum += A(i, j) * B(j, k);
+				result(i, k) = sum;
+			}
+		}
+		return result;
+	}
+
+	template<typename scalarType>
+	void runFor(const char* typeName)
+	{
+		std::printf("%-8s %6s %14s %14s %9s\n", typeName, "n", "naive GFLOP/s", "gemm GFLOP/s", "speedup");
+		for (int n{ 8 }; n <= 4096; n *= 2)
+		{
+			MatrixX<scalarType> a{ n, n };
+			MatrixX<scalarType> b{ n, n };
+			fillRandom(a.data(), a.data() + a.size(), 1);
+			fillRandom(b.data(), b.data() + b.size(), 2);
+
+			const double flops{ 2.0 * n * n * n };
+			const int repetitions{ static_cast<int>(std::max(1.0, std::min(20.0, 2e9 / flops))) };
+			scalarType checksum{};
+
+			const double gemmTime{ bestOf(repetitions, [&] { checksum += (a * b)(0, 0); }) };
+			double naiveTime{ 0 };
+			if (n <= 1024)
+				naiveTime = bestOf(repetitions, [&] { checksum += naiveProduct(a, b)(0, 0); });
+
+			if (naiveTime > 0)
+				std::printf("%-8s %6d %14.2f %14.2f %8.1fx\n", "", n, flops / naiveTime * 1e-9, flops / gemmTime * 1e-9, naiveTime / gemmTime);
+			else
+				std::printf("%-8s %6d %14s %14.2f %9s\n", "", n, "-", flops / gemmTime * 1e-9, "-");
+			if (checksum != checksum)
+				std::printf("NaN in result\n");
+		}
+	}
+
+	/// <summary>
+	/// Single-threaded product at every tier supported by this machine, so that the rows compare the
+	/// micro-kernels rather than the thread pool.
+	/// </summary>
+	template<typename scalarType>
+	void runTiersFor(const char* typeName)
+	{
+		const SimdLevel levels[]{ SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+		std::printf("%-8s %6s %10s %10s %10s %10s   (GFLOP/s, 1 thread)\n", typeName, "n", "scalar", "SSE2", "AVX2", "AVX-512");
+		for (int n : { 256, 1024 })
+		{
+			MatrixX<scalarType> a{ n, n };
+			MatrixX<scalarType> b{ n, n };
+			fillRandom(a.data(), a.data() + a.size(), 1);
+			fillRandom(b.data(), b.data() + b.size(), 2);
+
+			const double flops{ 2.0 * n * n * n };
+			const int repetitions{ static_cast<int>(std::max(1.0, std::min(20.0, 2e9 / flops))) };
+			scalarType checksum{};
+
+			std::printf("%-8s %6d", "", n);
+			for (SimdLevel level : levels)
+			{
+				if (level > maxSimdLevel())
+				{
+					std::printf(" %10s", "-");
+					continue;
+				}
+				setSimdLevel(level);
+				const double time{ bestOf(repetitions, [&] { checksum += (a * b)(0, 0); }) };
+				std::printf(" %10.2f", flops / time * 1e-9);
+			}
+			std::printf("\n");
+			if (checksum != checksum)
+				std::printf("NaN in result\n");
+		}
+		setSimdLevel(maxSimdLevel());
+	}
+}
+
+void runGemmBenchmark()
+{
+	runFor<double>("double");
+	runFor<float>("float");
+
+	std::printf("\nWidest instruction set on this machine: %s\n", levelName(maxSimdLevel()));
+	setThreadCount(1);
+	runTiersFor<double>("double");
+	runTiersFor<float>("float");
+	setThreadCount(0);
+}
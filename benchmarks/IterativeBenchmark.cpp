@@ -0,0 +1,114 @@
+// IterativeBenchmark.cpp : Iterative solvers on matrix-free finite-difference grids, against a dense LU solve.
+
+#include <cstdio>
+#include <vector>
+#include "Benchmark.h"
+#include "IterativeSolvers.h"
+#include "LU.h"
+
+namespace
+{
+	/// <summary>
+	/// The 5-point Laplacian of a k x k grid with Dirichlet boundaries, applied without forming the matrix.
+	/// </summary>
+	struct Poisson
+	{
+		int k;
+
+		void operator()(const double* u, double* y) const
+		{
+			for (int i{}; i < k; ++i)
+				for (int j{}; j < k; ++j)
+				{
+					const int p{ i * k + j };
+					y[p] = 4 * u[p] - (j > 0 ? u[p - 1] : 0.0) - (j + 1 < k ? u[p + 1] : 0.0)
+						- (i > 0 ? u[p - k] : 0.0) - (i + 1 < k ? u[p + k] : 0.0);
+				}
+		}
+	};
+
+	void matrixFree()
+	{
+		std::printf("%6s %9s %8s %12s %14s %8s %12s %14s   (CG and GMRES(30), tolerance 1e-8)\n",
+			"grid", "unknowns", "CG its", "CG ms", "ns/unknown/it", "GMRES its", "GMRES ms", "ns/unknown/it");
+		for (int k : { 32, 64, 128 })
+		{
+			const int n{ k * k };
+			const Poisson a{ k };
+			MatrixXd b{ n, 1 };
+			fillRandom(b.data(), b.data() + b.size(), 1);
+			IterativeSolverSettings<double> settings;
+			settings.tolerance = 1e-8;
+			settings.maxIterations = 20000;
+			ConjugateGradientSolver<double> cg{ settings };
+			GMRESSolver<double> gmres{ settings };
+			MatrixXd x{ n, 1 };
+
+			IterativeSolverResult<double> cgResult{};
+			const double cgTime{ bestOf(3, [&] {
+				std::fill(x.data(), x.data() + n, 0.0);
+				cgResult = cg.solve(a, b, x);
+			}) };
+			IterativeSolverResult<double> gmresResult{};
+			const double gmresTime{ bestOf(3, [&] {
+				std::fill(x.data(), x.data() + n, 0.0);
+				gmresResult = gmres.solve(a, b, x);
+			}) };
+			std::printf("%3dx%-3d %9d %8d %12.2f %14.2f %8d %12.2f %14.2f\n", k, k, n,
+				cgResult.iterations, cgTime * 1e3, cgTime * 1e9 / n / cgResult.iterations,
+				gmresResult.iterations, gmresTime * 1e3, gmresTime * 1e9 / n / gmresResult.iterations);
+		}
+	}
+
+	void againstDense()
+	{
+		std::printf("\n%6s %9s %12s %12s %12s %12s %12s   (ms per solve, tolerance 1e-8)\n",
+			"grid", "unknowns", "dense LU", "SOR 1.9", "CG", "CG + IC(0)", "CG dense");
+		for (int k : { 16, 32, 48 })
+		{
+			const int n{ k * k };
+			const Poisson poisson{ k };
+			MatrixXd a{ n, n };
+			std::vector<double> unit(n);
+			std::vector<double> column(n);
+			for (int q{}; q < n; ++q)
+			{
+				unit[q] = 1;
+				poisson(unit.data(), column.data());
+				unit[q] = 0;
+				for (int p{}; p < n; ++p)
+					a(p, q) = column[p];
+			}
+			MatrixXd b{ n, 1 };
+			fillRandom(b.data(), b.data() + b.size(), 2);
+			IterativeSolverSettings<double> settings;
+			settings.tolerance = 1e-8;
+			settings.maxIterations = 20000;
+			settings.omega = 1.9;
+			GaussSeidelSolver<double> sor{ settings };
+			ConjugateGradientSolver<double> cg{ settings };
+			const IncompleteCholeskyPreconditioner<double> ic{ a };
+			MatrixXd x{ n, 1 };
+			auto solveFromZero{ [&](auto&& solve) {
+				return bestOf(3, [&] {
+					std::fill(x.data(), x.data() + n, 0.0);
+					solve();
+				});
+			} };
+
+			const double luTime{ bestOf(3, [&] { x = LUDecomposition<double>{ a }.solve(b); }) };
+			const double sorTime{ solveFromZero([&] { sor.solve(a, b, x); }) };
+			const double cgTime{ solveFromZero([&] { cg.solve(poisson, b, x); }) };
+			const double icTime{ solveFromZero([&] { cg.solve(poisson, b, x, ic); }) };
+			const double denseTime{ solveFromZero([&] { cg.solve(a, b, x); }) };
+			std::printf("%3dx%-3d %9d %12.2f %12.2f %12.2f %12.2f %12.2f\n", k, k, n,
+				luTime * 1e3, sorTime * 1e3, cgTime * 1e3, icTime * 1e3, denseTime * 1e3);
+		}
+	}
+}
+
+void runIterativeBenchmark()
+{
+	matrixFree();
+	againstDense();
+}
@@ -0,0 +1,79 @@
+// LUBenchmark.cpp : Blocked LU factorization against unblocked elimination, and solve throughput of a reused factorization.
+
+#include <cstdio>
+#include <vector>
+#include "Benchmark.h"
+#include "LU.h"
+
+namespace
+{
+	/// <summary>
+	/// A random, diagonally dominant n x n matrix.
+	/// </summary>
+	template<typename scalarType>
+	MatrixX<scalarType> randomSystem(int n, unsigned seed)
+	{
+		MatrixX<scalarType> a{ n, n };
+		fillRandom(a.data(), a.data() + a.size(), seed);
+		for (int i{}; i < n; ++i)
+			a(i, i) += static_cast<scalarType>(n);
+		return a;
+	}
+
+	template<typename scalarType>
+	void factorization(const char* typeName)
+	{
+		std::printf("%-8s %6s %16s %16s %9s\n", typeName, "n", "unblocked GF/s", "blocked GF/s", "speedup");
+		for (int n{ 128 }; n <= 2048; n *= 2)
+		{
+			const MatrixX<scalarType> a{ randomSystem<scalarType>(n, 1) };
+			const double flops{ 2.0 / 3.0 * n * n * n };
+			const int repetitions{ static_cast<int>(std::max(1.0, std::min(10.0, 1e9 / flops))) };
+
+			// Unblocked: the whole matrix as a single panel, i.e. rank-1 updates over the full trailing matrix.
+			MatrixX<scalarType> work{ a };
+			std::vector<int> pivots(n);
+			const double unblockedTime{ bestOf(repetitions, [&] {
+				std::copy(a.data(), a.data() + a.size(), work.data());
+				internal::luPanel(n, 0, n, work.data(), n, pivots.data());
+			}) };
+
+			LUDecomposition<scalarType> lu;
+			const double blockedTime{ bestOf(repetitions, [&] { lu.compute(a); }) };
+			std::printf("%-8s %6d %16.2f %16.2f %8.1fx\n", "", n, flops / unblockedTime * 1e-9, flops / blockedTime * 1e-9, unblockedTime / blockedTime);
+		}
+	}
+
+	void solves()
+	{
+		const int n{ 512 };
+		const int k{ 256 };
+		const MatrixXd a{ randomSystem<double>(n, 3) };
+		MatrixXd b{ n, k };
+		fillRandom(b.data(), b.data() + b.size(), 4);
+		std::vector<MatrixXd> columns(k, MatrixXd{ n, 1 });
+		for (int j{}; j < k; ++j)
+			for (int i{}; i < n; ++i)
+				columns[j](i, 0) = b(i, j);
+		double checksum{};
+
+		const double refactorTime{ bestOf(1, [&] { for (const MatrixXd& column : columns) checksum += solve(a, column)(0, 0); }) };
+		const LUDecomposition<double> lu{ a };
+		const double reuseTime{ bestOf(3, [&] { for (const MatrixXd& column : columns) checksum += lu.solve(column)(0, 0); }) };
+		const double blockTime{ bestOf(3, [&] { checksum += lu.solve(b)(0, 0); }) };
+
+		std::printf("\n%d right-hand sides, n = %d (solves per second)\n", k, n);
+		std::printf("%-32s %12.0f\n", "factor per solve", k / refactorTime);
+		std::printf("%-32s %12.0f\n", "factor once, one column at a time", k / reuseTime);
+		std::printf("%-32s %12.0f\n", "factor once, all columns at once", k / blockTime);
+		if (checksum != checksum)
+			std::printf("NaN in result\n");
+	}
+}
+
+void runLUBenchmark()
+{
+	factorization<double>("double");
+	factorization<float>("float");
+	solves();
+}
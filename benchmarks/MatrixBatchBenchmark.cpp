@@ -0,0 +1,93 @@
+// MatrixBatchBenchmark.cpp : Batched small-matrix operations against a loop over fixed-size matrices.
+
+#include <cstdio>
+#include <vector>
+#include "Benchmark.h"
+#include "Matrix.h"
+#include "MatrixBatch.h"
+
+namespace
+{
+	constexpr int paths{ 1 << 14 };
+
+	void report(const char* operation, int n, double loopTime, double batchTime)
+	{
+		const double scale{ 1e9 / paths };
+		if (loopTime > 0)
+			std::printf("%-14s %3dx%-3d %12.2f %12.2f %9.2fx\n", operation, n, n, loopTime * scale, batchTime * scale, loopTime / batchTime);
+		else
+			std::printf("%-14s %3dx%-3d %12s %12.2f\n", operation, n, n, "-", batchTime * scale);
+	}
+
+	/// <summary>
+	/// One random, diagonally dominant n x n matrix and n-vector per path, as an array of ``Matrix`` and as a
+	/// batch. The closed-form determinant and inverse of ``Matrix`` stop at 4x4, so larger sizes time the
+	/// batch alone for these.
+	/// </summary>
+	template<int n>
+	void run()
+	{
+		using Fixed = Matrix<double, n, n>;
+		using Column = Matrix<double, n, 1>;
+		std::vector<Fixed> a(paths);
+		std::vector<Column> x(paths);
+		MatrixBatch<double, n, n> batchA{ paths };
+		MatrixBatch<double, n, 1> batchX{ paths };
+		for (int t{}; t < paths; ++t)
+		{
+			fillRandom(a[t].data(), a[t].data() + n * n, t);
+			fillRandom(x[t].data(), x[t].data() + n, t + 1);
+			for (int i{}; i < n; ++i)
+				a[t](i, i) += n;
+			batchA.setMatrix(t, a[t]);
+			batchX.setMatrix(t, x[t]);
+		}
+
+		std::vector<Fixed> result(paths);
+		std::vector<Column> vector(paths);
+		std::vector<double> det(paths);
+		MatrixBatch<double, n, n> batchResult{ paths };
+		MatrixBatch<double, n, 1> batchVector{ paths };
+
+		report("multiply", n,
+			bestOf(20, [&] { for (int t{}; t < paths; ++t) result[t] = a[t] * a[t]; }),
+			bestOf(20, [&] { multiply(batchA, batchA, batchResult); }));
+		report("matrix-vector", n,
+			bestOf(20, [&] { for (int t{}; t < paths; ++t) vector[t] = a[t] * x[t]; }),
+			bestOf(20, [&] { multiply(batchA, batchX, batchVector); }));
+		if constexpr (n <= 4)
+		{
+			report("determinant", n,
+				bestOf(20, [&] { for (int t{}; t < paths; ++t) det[t] = a[t].determinant(); }),
+				bestOf(20, [&] { determinant(batchA, det.data()); }));
+			report("inverse", n,
+				bestOf(20, [&] { for (int t{}; t < paths; ++t) result[t] = a[t].inverse(); }),
+				bestOf(20, [&] { inverse(batchA, batchResult); }));
+			report("solve", n,
+				bestOf(20, [&] { for (int t{}; t < paths; ++t) vector[t] = a[t].inverse() * x[t]; }),
+				bestOf(20, [&] { solve(batchA, batchX, batchVector); }));
+		}
+		else
+		{
+			report("determinant", n, 0, bestOf(20, [&] { determinant(batchA, det.data()); }));
+			report("inverse", n, 0, bestOf(20, [&] { inverse(batchA, batchResult); }));
+			report("solve", n, 0, bestOf(20, [&] { solve(batchA, batchX, batchVector); }));
+		}
+
+		double checksum{};
+		for (int t{}; t < paths; ++t)
+			checksum += result[t](0, 0) + vector[t](0, 0) + det[t] + batchResult.coeff(t, 0, 0) + batchVector.coeff(t, 0, 0);
+		if (checksum != checksum)
+			std::printf("NaN in result\n");
+	}
+}
+
+void runMatrixBatchBenchmark()
+{
+	std::printf("%-14s %7s %12s %12s %10s   (ns per matrix)\n", "operation", "n", "Matrix loop", "MatrixBatch", "speedup");
+	run<2>();
+	run<3>();
+	run<4>();
+	run<6>();
+	run<8>();
+}
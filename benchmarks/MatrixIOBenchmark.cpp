@@ -0,0 +1,55 @@
+// MatrixIOBenchmark.cpp : Binary files, memory-mapped matrices and .npy files.
+
+#include <cstdio>
+#include "Benchmark.h"
+#include "MatrixX.h"
+#include "MatrixIO.h"
+
+namespace
+{
+	/// <summary>
+	/// Writing and reading an n x n matrix of doubles. Opening a mapped matrix only reads its header; the first
+	/// pass over its coefficients then reads them from the page cache.
+	/// </summary>
+	void runFiles(int n)
+	{
+		MatrixXd a{ n, n };
+		fillRandom(a.data(), a.data() + a.size());
+		const double megabytes{ static_cast<double>(a.size()) * sizeof(double) / (1 << 20) };
+		const char* path{ "MatrixIOBenchmark.mlm" };
+		const char* npyPath{ "MatrixIOBenchmark.npy" };
+
+		std::printf("%d x %d doubles (%.0f MB)\n", n, n, megabytes);
+		std::printf("%-22s %12s %12s\n", "operation", "ms", "MB/s");
+		const auto report{ [megabytes](const char* operation, double time) {
+			std::printf("%-22s %12.3f %12.0f\n", operation, time * 1e3, megabytes / time);
+		} };
+
+		report("save", bestOf(3, [&] { save(path, a); }));
+		MatrixXd loaded;
+		report("load", bestOf(3, [&] { loaded = load<double>(path); }));
+		const double open{ bestOf(10, [&] { MappedMatrix<double> mapped{ path }; }) };
+		std::printf("%-22s %12.3f %12s\n", "map (open only)", open * 1e3, "-");
+		double sum{};
+		bool valid{};
+		report("map and sum", bestOf(3, [&] {
+			MappedMatrix<double> mapped{ path };
+			sum = 0.0;
+			for (int k{}; k < mapped.size(); ++k)
+				sum += mapped.coeff(k);
+		}));
+		report("map and verify", bestOf(3, [&] { MappedMatrix<double> mapped{ path }; valid = mapped.verify(); }));
+		report("saveNpy", bestOf(3, [&] { saveNpy(npyPath, a); }));
+		report("loadNpy", bestOf(3, [&] { loaded = loadNpy<double>(npyPath); }));
+		std::printf("(sum of the coefficients %g, checksum %s)\n", sum, valid ? "valid" : "invalid");
+
+		std::remove(path);
+		std::remove(npyPath);
+	}
+}
+
+void runMatrixIOBenchmark()
+{
+	runFiles(1024);
+	runFiles(4096);
+}
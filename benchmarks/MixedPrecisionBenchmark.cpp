@@ -0,0 +1,117 @@
+// MixedPrecisionBenchmark.cpp : Narrow storage with wide accumulation: speed against accuracy.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "Benchmark.h"
+#include "MatrixX.h"
+#include "MixedPrecision.h"
+
+namespace
+{
+	/// <summary>
+	/// The largest absolute difference between y and reference, relative to the largest coefficient of reference.
+	/// </summary>
+	template<typename T>
+	double relativeError(const MatrixX<T>& y, const MatrixXd& reference)
+	{
+		double error{};
+		double scale{};
+		for (int k{}; k < reference.size(); ++k)
+		{
+			error = std::max(error, std::abs(static_cast<double>(y.coeff(k)) - reference.coeff(k)));
+			scale = std::max(scale, std::abs(reference.coeff(k)));
+		}
+		return error / scale;
+	}
+
+	/// <summary>
+	/// One line of the report: the time of a product, the bandwidth or rate it reaches, and its errors. The
+	/// storage error is that of the whole computation against the product of the original double matrices;
+	/// the accumulation error is that against the exact product of the stored, rounded coefficients.
+	/// </summary>
+	template<typename T>
+	void report(const char* storage, const char* accumulator, double time, double rate, const MatrixX<T>& y,
+		const MatrixXd& reference, const MatrixXd& exactStored)
+	{
+		std::printf("%-9s %-11s %10.3f %10.2f %14.2e %14.2e\n", storage, accumulator, time * 1e3, rate,
+			relativeError(y, reference), relativeError(y, exactStored));
+	}
+
+	/// <summary>
+	/// Products of a large factor matrix with a vector, which are limited by memory bandwidth: storing the matrix
+	/// in fewer bits makes them faster.
+	/// </summary>
+	void runMatrixVector(int m, int n)
+	{
+		MatrixXd a{ m, n };
+		MatrixXd x{ n, 1 };
+		fillRandom(a.data(), a.data() + a.size(), 1);
+		fillRandom(x.data(), x.data() + x.size(), 2);
+		const MatrixXf af{ a };
+		const MatrixXf xf{ x };
+		const MatrixX<half> ah{ a };
+		const MatrixX<bfloat16> ab{ a };
+		const MatrixXd reference{ multiply<double>(a, x) };
+
+		std::printf("matrix-vector %d x %d\n", m, n);
+		std::printf("%-9s %-11s %10s %10s %14s %14s\n", "storage", "accumulator", "ms", "GB/s", "error", "accumulation");
+		const auto bandwidth{ [&](double time, std::size_t bytes) { return static_cast<double>(bytes) * m * n / time * 1e-9; } };
+		MatrixXd yd;
+		MatrixXf yf;
+
+		double time{ bestOf(10, [&] { yd = multiply<double>(a, x); }) };
+		report("double", "double", time, bandwidth(time, sizeof(double)), yd, reference, reference);
+		const MatrixXd exactFloat{ multiply<double>(MatrixXd{ af }, MatrixXd{ xf }) };
+		time = bestOf(10, [&] { yd = multiply<double>(af, xf); });
+		report("float", "double", time, bandwidth(time, sizeof(float)), yd, reference, exactFloat);
+		time = bestOf(10, [&] { yf = multiply<float>(af, xf); });
+		report("float", "float", time, bandwidth(time, sizeof(float)), yf, reference, exactFloat);
+		const MatrixXd exactHalf{ multiply<double>(MatrixXd{ ah }, MatrixXd{ xf }) };
+		time = bestOf(10, [&] { yf = multiply<float>(ah, xf); });
+		report("half", "float", time, bandwidth(time, sizeof(half)), yf, reference, exactHalf);
+		const MatrixXd exactBFloat16{ multiply<double>(MatrixXd{ ab }, MatrixXd{ xf }) };
+		time = bestOf(10, [&] { yf = multiply<float>(ab, xf); });
+		report("bfloat16", "float", time, bandwidth(time, sizeof(bfloat16)), yf, reference, exactBFloat16);
+	}
+
+	/// <summary>
+	/// Matrix products, which are limited by arithmetic: wide accumulation costs the rate of the wider type, and
+	/// narrow storage only saves memory.
+	/// </summary>
+	void runMatrixMatrix(int n)
+	{
+		MatrixXd a{ n, n };
+		MatrixXd b{ n, n };
+		fillRandom(a.data(), a.data() + a.size(), 3);
+		fillRandom(b.data(), b.data() + b.size(), 4);
+		const MatrixXf af{ a };
+		const MatrixXf bf{ b };
+		const MatrixX<half> ah{ a };
+		const MatrixX<half> bh{ b };
+		const MatrixXd reference{ a * b };
+
+		std::printf("matrix-matrix %d x %d\n", n, n);
+		std::printf("%-9s %-11s %10s %10s %14s %14s\n", "storage", "accumulator", "ms", "GFLOP/s", "error", "accumulation");
+		const double flops{ 2.0 * n * n * n };
+		MatrixXd cd;
+		MatrixXf cf;
+
+		double time{ bestOf(5, [&] { cd = a * b; }) };
+		report("double", "double", time, flops / time * 1e-9, cd, reference, reference);
+		const MatrixXd exactFloat{ MatrixXd{ af } * MatrixXd{ bf } };
+		time = bestOf(5, [&] { cd = multiply<double>(af, bf); });
+		report("float", "double", time, flops / time * 1e-9, cd, reference, exactFloat);
+		time = bestOf(5, [&] { cf = af * bf; });
+		report("float", "float", time, flops / time * 1e-9, cf, reference, exactFloat);
+		const MatrixXd exactHalf{ MatrixXd{ ah } * MatrixXd{ bh } };
+		time = bestOf(5, [&] { cf = multiply<float>(ah, bh); });
+		report("half", "float", time, flops / time * 1e-9, cf, reference, exactHalf);
+	}
+}
+
+void runMixedPrecisionBenchmark()
+{
+	runMatrixVector(4096, 4096);
+	runMatrixMatrix(512);
+}
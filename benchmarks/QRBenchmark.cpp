@@ -0,0 +1,61 @@
+// QRBenchmark.cpp : Least squares on tall matrices, streamed and factored, and blocked QR factorizations.
+
+#include <cstdio>
+#include "Benchmark.h"
+#include "QR.h"
+#include "Cholesky.h"
+
+namespace
+{
+	void tallLeastSquares()
+	{
+		std::printf("%9s %4s %14s %14s %14s %12s   (milliseconds)\n", "m", "n", "leastSquares", "HouseholderQR",
+			"normal eqs", "stream GB/s");
+		const int n{ 10 };
+		for (int m : { 10000, 100000, 1000000 })
+		{
+			MatrixXd a{ m, n };
+			MatrixXd b{ m, 1 };
+			fillRandom(a.data(), a.data() + a.size(), 1);
+			fillRandom(b.data(), b.data() + b.size(), 2);
+			const int repetitions{ m < 1000000 ? 5 : 2 };
+			MatrixXd x;
+			const double streamTime{ bestOf(repetitions, [&] { x.resize(0, 0); x = leastSquares(a, b); }) };
+			const double qrTime{ bestOf(repetitions, [&] { x.resize(0, 0); x = HouseholderQR<double>{ a }.solve(b); }) };
+
+			// The normal equations square the condition number; shown for reference only.
+			const double normalTime{ bestOf(repetitions, [&] {
+				const MatrixXd ata{ a.transpose() * a };
+				const MatrixXd atb{ a.transpose() * b };
+				x.resize(0, 0);
+				x = LLTDecomposition<double>{ ata }.solve(atb);
+			}) };
+			const double bytes{ 8.0 * m * (n + 1) };
+			std::printf("%9d %4d %14.2f %14.2f %14.2f %12.2f\n", m, n, 1e3 * streamTime, 1e3 * qrTime, 1e3 * normalTime,
+				bytes / streamTime / 1e9);
+		}
+	}
+
+	void squareFactorizations()
+	{
+		std::printf("\n%6s %16s %16s   (GFLOP/s, 4/3 n^3 flops)\n", "n", "blocked WY", "column pivoted");
+		for (int n : { 250, 500, 1000 })
+		{
+			MatrixXd a{ n, n };
+			fillRandom(a.data(), a.data() + a.size(), 3);
+			HouseholderQR<double> qr;
+			ColPivHouseholderQR<double> pivoted;
+			const int repetitions{ n < 1000 ? 3 : 1 };
+			const double blockedTime{ bestOf(repetitions, [&] { qr.compute(a); }) };
+			const double pivotedTime{ bestOf(repetitions, [&] { pivoted.compute(a); }) };
+			const double flops{ 4.0 / 3.0 * n * n * n };
+			std::printf("%6d %16.2f %16.2f\n", n, flops / blockedTime / 1e9, flops / pivotedTime / 1e9);
+		}
+	}
+}
+
+void runQRBenchmark()
+{
+	tallLeastSquares();
+	squareFactorizations();
+}
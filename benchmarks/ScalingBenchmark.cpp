@@ -0,0 +1,67 @@
+// ScalingBenchmark.cpp : Speedup of the parallel MatrixX operations from 1 to N threads.
+
+#include <cstdio>
+#include <thread>
+#include "Benchmark.h"
+#include "MatrixX.h"
+
+namespace
+{
+	struct Operation
+	{
+		const char* name;
+		double time1{};	// seconds on one thread
+	};
+
+	/// <summary>
+	/// Print the time of ``f`` at the current thread count and its speedup over one thread.
+	/// </summary>
+	template<typename F>
+	void measure(Operation& operation, int threads, int repetitions, F&& f)
+	{
+		const double time{ bestOf(repetitions, f) };
+		if (threads == 1)
+			operation.time1 = time;
+		std::printf("%-12s %8d %12.2f %9.2fx\n", operation.name, threads, time * 1e3, operation.time1 / time);
+	}
+}
+
+void runScalingBenchmark()
+{
+	const int hardwareThreads{ static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) };
+	const int gemmSize{ 2048 };
+	const int size{ 4096 };
+
+	MatrixXd a{ gemmSize, gemmSize };
+	MatrixXd b{ gemmSize, gemmSize };
+	MatrixXd x{ size, size };
+	MatrixXd y{ size, size };
+	MatrixXd z{ size, size };
+	fillRandom(a.data(), a.data() + a.size(), 1);
+	fillRandom(b.data(), b.data() + b.size(), 2);
+	fillRandom(x.data(), x.data() + x.size(), 3);
+	fillRandom(y.data(), y.data() + y.size(), 4);
+
+	Operation gemm{ "gemm 2048" };
+	Operation transpose{ "transpose" };
+	Operation axpy{ "z += 2x" };
+	Operation add{ "z = x + y" };
+	Operation dot{ "x.dot(y)" };
+
+	std::printf("%-12s %8s %12s %10s   (hardware threads: %d)\n", "operation", "threads", "time (ms)", "speedup", hardwareThreads);
+	for (int threads{ 1 }; ; threads = std::min(2 * threads, hardwareThreads))
+	{
+		setThreadCount(threads);
+		double checksum{};
+		measure(gemm, threads, 3, [&] { checksum += (a * b)(0, 0); });
+		measure(transpose, threads, 5, [&] { z = x.transpose(); });
+		measure(axpy, threads, 5, [&] { z += 2.0 * x; });
+		measure(add, threads, 5, [&] { z = x + y; });
+		measure(dot, threads, 5, [&] { checksum += x.dot(y); });
+		if (checksum != checksum)
+			std::printf("NaN in result\n");
+		if (threads == hardwareThreads)
+			break;
+	}
+	setThreadCount(0);
+}
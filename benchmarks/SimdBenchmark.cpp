@@ -0,0 +1,78 @@
+// SimdBenchmark.cpp : Throughput of the element-wise kernels and reductions at every SIMD tier.
+
+#include <cstdio>
+#include <vector>
+#include "Benchmark.h"
+#include "Simd.h"
+
+namespace
+{
+	const char* levelName(SimdLevel level)
+	{
+		switch (level)
+		{
+		case SimdLevel::SSE2:
+			return "SSE2";
+		case SimdLevel::AVX2:
+			return "AVX2";
+		case SimdLevel::AVX512:
+			return "AVX-512";
+		default:
+			return "scalar";
+		}
+	}
+
+	/// <summary>
+	/// Time one kernel at every tier supported by this machine and print a row in GElem/s.
+	/// </summary>
+	template<typename F>
+	void runKernel(const char* kernelName, int n, F&& kernel)
+	{
+		const SimdLevel levels[]{ SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+		const int repetitions{ static_cast<int>(std::max(3.0, std::min(1000.0, 2e8 / n))) };
+
+		std::printf("%-10s %9d", kernelName, n);
+		for (SimdLevel level : levels)
+		{
+			if (level > maxSimdLevel())
+			{
+				std::printf(" %10s", "-");
+				continue;
+			}
+			setSimdLevel(level);
+			const double time{ bestOf(repetitions, kernel) };
+			std::printf(" %10.2f", n / time * 1e-9);
+		}
+		std::printf("\n");
+		setSimdLevel(maxSimdLevel());
+	}
+
+	template<typename scalarType>
+	void runFor(const char* typeName)
+	{
+		std::printf("%-10s %9s %10s %10s %10s %10s   (GElem/s)\n", typeName, "n", "scalar", "SSE2", "AVX2", "AVX-512");
+		// L1-, L2- and memory-resident working sets.
+		for (int n : { 1 << 10, 1 << 15, 1 << 22 })
+		{
+			std::vector<scalarType> x(n), y(n), z(n);
+			fillRandom(x.begin(), x.end(), 1);
+			fillRandom(y.begin(), y.end(), 2);
+			volatile scalarType sink{};
+
+			runKernel("add", n, [&] { simdKernels<scalarType>().add(x.data(), y.data(), z.data(), n); });
+			runKernel("scale", n, [&] { simdKernels<scalarType>().scale(x.data(), scalarType{ 3 }, z.data(), n); });
+			runKernel("axpy", n, [&] { simdKernels<scalarType>().axpy(scalarType{ 1 }, x.data(), z.data(), n); });
+			runKernel("sum", n, [&] { sink = simdKernels<scalarType>().sum(x.data(), n); });
+			runKernel("dot", n, [&] { sink = simdKernels<scalarType>().dot(x.data(), y.data(), n); });
+			runKernel("normInf", n, [&] { sink = simdKernels<scalarType>().normInf(x.data(), n); });
+		}
+	}
+}
+
+void runSimdBenchmark()
+{
+	std::printf("Widest instruction set on this machine: %s\n", levelName(maxSimdLevel()));
+	runFor<float>("float");
+	runFor<double>("double");
+	runFor<int>("int");
+}
@@ -0,0 +1,150 @@
+// SparseBenchmark.cpp : Memory and time of sparse and banded storage against dense matrices.
+
+#include <cstdio>
+#include <vector>
+#include "Benchmark.h"
+#include "SparseMatrixX.h"
+#include "BandedMatrixX.h"
+
+namespace
+{
+	/// <summary>
+	/// The 5-point Laplacian of a k x k grid, as triplets.
+	/// </summary>
+	std::vector<Triplet<double>> poisson(int k)
+	{
+		std::vector<Triplet<double>> triplets;
+		for (int i{}; i < k; ++i)
+			for (int j{}; j < k; ++j)
+			{
+				const int p{ i * k + j };
+				triplets.push_back({ p, p, 4 });
+				if (j > 0)
+					triplets.push_back({ p, p - 1, -1 });
+				if (j + 1 < k)
+					triplets.push_back({ p, p + 1, -1 });
+				if (i > 0)
+					triplets.push_back({ p, p - k, -1 });
+				if (i + 1 < k)
+					triplets.push_back({ p, p + k, -1 });
+			}
+		return triplets;
+	}
+
+	double megabytes(double bytes)
+	{
+		return bytes / (1 << 20);
+	}
+
+	void matrixVector()
+	{
+		std::printf("%8s %9s %10s %10s %10s %10s %10s %10s %10s   (memory in MB, time in us per product)\n",
+			"grid", "unknowns", "dense MB", "CSR MB", "band MB", "dense", "CSR", "CSC", "band");
+		for (int k : { 16, 32, 64, 128, 256 })
+		{
+			const int n{ k * k };
+			const std::vector<Triplet<double>> triplets{ poisson(k) };
+			const SparseMatrixXd csr{ n, n, triplets };
+			const SparseMatrixX<double, StorageOrder::ColumnMajor> csc{ csr.toColumnMajor() };
+			BandedMatrixX<double> band{ n, k, k };
+			for (const Triplet<double>& t : triplets)
+				band(t.row, t.col) = t.value;
+
+			MatrixXd x{ n, 1 };
+			fillRandom(x.data(), x.data() + x.size(), 1);
+			MatrixXd y{ n, 1 };
+			const int repetitions{ std::max(5, 2000000 / n) };
+			auto perProduct{ [&](auto&& product) {
+				return bestOf(3, [&] {
+					for (int r{}; r < repetitions; ++r)
+						product();
+				}) / repetitions * 1e6;
+			} };
+
+			const double denseBytes{ 8.0 * n * n };
+			const double csrBytes{ 12.0 * csr.nonZeros() + 4.0 * (n + 1) };
+			const double bandBytes{ 8.0 * n * band.bandWidth() };
+			const double csrTime{ perProduct([&] { csr.multiply(x.data(), y.data()); }) };
+			const double cscTime{ perProduct([&] { csc.multiply(x.data(), y.data()); }) };
+			const double bandTime{ perProduct([&] { band.multiply(x.data(), y.data()); }) };
+			if (n <= 4096)
+			{
+				const MatrixXd dense{ csr.toDense() };
+				const double denseTime{ bestOf(3, [&] { y = dense * x; }) * 1e6 };
+				std::printf("%4dx%-3d %9d %10.2f %10.2f %10.2f %10.1f %10.2f %10.2f %10.2f\n", k, k, n, megabytes(denseBytes),
+					megabytes(csrBytes), megabytes(bandBytes), denseTime, csrTime, cscTime, bandTime);
+			}
+			else
+				std::printf("%4dx%-3d %9d %10.2f %10.2f %10.2f %10s %10.2f %10.2f %10.2f\n", k, k, n, megabytes(denseBytes),
+					megabytes(csrBytes), megabytes(bandBytes), "-", csrTime, cscTime, bandTime);
+		}
+	}
+
+	void tridiagonal()
+	{
+		std::printf("\n%9s %12s %12s   (ns per row, product by a vector)\n", "n", "band 1+1", "CSR");
+		for (int n : { 1000, 100000, 1000000 })
+		{
+			BandedMatrixX<double> band{ n, 1, 1 };
+			std::vector<Triplet<double>> triplets;
+			for (int i{}; i < n; ++i)
+				for (int j{ std::max(0, i - 1) }; j <= std::min(n - 1, i + 1); ++j)
+				{
+					band(i, j) = i == j ? 2.0 : -1.0;
+					triplets.push_back({ i, j, band(i, j) });
+				}
+			const SparseMatrixXd csr{ n, n, triplets };
+			std::vector<double> x(n, 1.0);
+			std::vector<double> y(n);
+			const int repetitions{ std::max(3, 10000000 / n) };
+			const double bandTime{ bestOf(3, [&] { for (int r{}; r < repetitions; ++r) band.multiply(x.data(), y.data()); }) };
+			const double csrTime{ bestOf(3, [&] { for (int r{}; r < repetitions; ++r) csr.multiply(x.data(), y.data()); }) };
+			std::printf("%9d %12.2f %12.2f\n", n, bandTime / repetitions / n * 1e9, csrTime / repetitions / n * 1e9);
+		}
+	}
+
+	void sparseDense()
+	{
+		std::printf("\n%8s %8s %8s %8s %12s %12s %12s %12s   (ms per product, loadings x factors)\n",
+			"rows", "cols", "density", "k", "dense", "CSR", "CSC", "dense x CSC");
+		for (int density : { 1, 5 })
+		{
+			const int m{ 4000 };
+			const int n{ 1000 };
+			const int k{ 64 };
+			std::vector<Triplet<double>> triplets;
+			unsigned state{ 12345 };
+			for (int i{}; i < m; ++i)
+				for (int j{}; j < n; ++j)
+				{
+					state = state * 1664525u + 1013904223u;
+					if (state % 100 < static_cast<unsigned>(density))
+						triplets.push_back({ i, j, static_cast<double>(state % 1000) / 1000.0 });
+				}
+			const SparseMatrixXd csr{ m, n, triplets };
+			const SparseMatrixX<double, StorageOrder::ColumnMajor> csc{ csr.toColumnMajor() };
+			const MatrixXd dense{ csr.toDense() };
+			MatrixXd factors{ n, k };
+			fillRandom(factors.data(), factors.data() + factors.size(), 2);
+			MatrixXd weights{ k, n };
+			fillRandom(weights.data(), weights.data() + weights.size(), 3);
+			const SparseMatrixX<double, StorageOrder::ColumnMajor> transposed{ csr.transpose() };
+
+			MatrixXd result{ m, k };
+			MatrixXd resultTransposed{ k, m };
+			const double denseTime{ bestOf(3, [&] { result = dense * factors; }) };
+			const double csrTime{ bestOf(3, [&] { result = csr * factors; }) };
+			const double cscTime{ bestOf(3, [&] { result = csc * factors; }) };
+			const double leftTime{ bestOf(3, [&] { resultTransposed = weights * transposed; }) };
+			std::printf("%8d %8d %7d%% %8d %12.2f %12.2f %12.2f %12.2f\n", m, n, density, k,
+				denseTime * 1e3, csrTime * 1e3, cscTime * 1e3, leftTime * 1e3);
+		}
+	}
+}
+
+void runSparseBenchmark()
+{
+	matrixVector();
+	tridiagonal();
+	sparseDense();
+}
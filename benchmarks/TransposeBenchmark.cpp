@@ -0,0 +1,54 @@
+// TransposeBenchmark.cpp : Blocked out-of-place and in-place transpose against the original implementation.
+
+#include <cstdio>
+#include "Benchmark.h"
+#include "MatrixX.h"
+
+namespace
+{
+	/// <summary>
+	/// The original implementation of MatrixX::transpose(): a new matrix, written column by column
+	/// through the bounds-checked accessor.
+	/// </summary>
+	template<typename scalarType>
+	MatrixX<scalarType> naiveTranspose(const MatrixX<scalarType>& m)
+	{
+		MatrixX<scalarType> result{ m.cols(), m.rows() };
+		for (int i{}; i < m.rows(); ++i)
+			for (int j{}; j < m.cols(); ++j)
+				result(j, i) = m(i, j);
+		return result;
+	}
+
+	template<typename scalarType>
+	void runFor(const char* typeName)
+	{
+		std::printf("%-8s %6s %12s %12s %12s %12s   (GB/s read + written)\n", typeName, "n", "naive", "blocked", "into buffer", "in place");
+		for (int n : { 256, 1024, 4096 })
+		{
+			MatrixX<scalarType> a{ n, n };
+			MatrixX<scalarType> b{ n, n };
+			fillRandom(a.data(), a.data() + a.size(), 1);
+
+			const double bytes{ 2.0 * sizeof(scalarType) * n * n };
+			const int repetitions{ n <= 1024 ? 20 : 5 };
+			scalarType checksum{};
+
+			const double naiveTime{ bestOf(repetitions, [&] { checksum += naiveTranspose(a)(0, 1); }) };
+			const double blockedTime{ bestOf(repetitions, [&] { checksum += MatrixX<scalarType>{ a.transpose() }(0, 1); }) };
+			const double bufferTime{ bestOf(repetitions, [&] { b = a.transpose(); }) };
+			const double inPlaceTime{ bestOf(repetitions, [&] { a.transposeInPlace(); }) };
+
+			std::printf("%-8s %6d %12.2f %12.2f %12.2f %12.2f\n", "", n, bytes / naiveTime * 1e-9, bytes / blockedTime * 1e-9,
+				bytes / bufferTime * 1e-9, bytes / inPlaceTime * 1e-9);
+			if (checksum != checksum)
+				std::printf("NaN in result\n");
+		}
+	}
+}
+
+void runTransposeBenchmark()
+{
+	runFor<double>("double");
+	runFor<float>("float");
+}
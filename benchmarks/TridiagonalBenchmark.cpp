@@ -0,0 +1,115 @@
+// TridiagonalBenchmark.cpp : Tridiagonal solves per second, one system at a time against batched structure-of-arrays.
+
+#include <cstdio>
+#include <vector>
+#include "Benchmark.h"
+#include "Tridiagonal.h"
+#include "LU.h"
+
+namespace
+{
+	/// <summary>
+	/// Diagonally dominant coefficients of ``batch`` systems of order n, structure-of-arrays.
+	/// </summary>
+	void fillBatch(TridiagonalBatch<double>& systems, MatrixXd& rhs)
+	{
+		const int n{ systems.rows() };
+		const int batch{ systems.batchSize() };
+		fillRandom(systems.lower().data(), systems.lower().data() + n * batch, 1);
+		fillRandom(systems.upper().data(), systems.upper().data() + n * batch, 2);
+		fillRandom(rhs.data(), rhs.data() + n * batch, 3);
+		for (int i{}; i < n * batch; ++i)
+			systems.diagonal().coeffRef(i) = 3 + systems.lower().coeff(i) + systems.upper().coeff(i);
+	}
+
+	void independentSystems()
+	{
+		std::printf("%6s %7s %16s %16s %9s %16s   (solves per second, each system with its own coefficients)\n",
+			"n", "batch", "one at a time", "batched", "speedup", "dense LU");
+		for (int n : { 64, 256, 1024 })
+		{
+			for (int batch : { 16, 256, 4096 })
+			{
+				if (static_cast<long long>(n) * batch > (1 << 22))
+					continue;
+				TridiagonalBatch<double> systems{ n, batch };
+				MatrixXd rhs{ n, batch };
+				fillBatch(systems, rhs);
+				MatrixXd x{ n, batch };
+
+				// One system at a time: gather its coefficients, factor and solve, as a loop over grid lines would.
+				TridiagonalMatrixX<double> single{ n };
+				TridiagonalDecomposition<double> thomas;
+				MatrixXd b{ n, 1 };
+				const double singleTime{ bestOf(3, [&] {
+					for (int s{}; s < batch; ++s)
+					{
+						for (int i{}; i < n; ++i)
+						{
+							single.lower()[i] = systems.lower().coeff(i, s);
+							single.diagonal()[i] = systems.diagonal().coeff(i, s);
+							single.upper()[i] = systems.upper().coeff(i, s);
+							b.coeffRef(i) = rhs.coeff(i, s);
+						}
+						thomas.compute(single).solveInPlace(b);
+						x.coeffRef(0, s) = b.coeff(0);
+					}
+				}) };
+				const double batchTime{ bestOf(3, [&] {
+					x = rhs;
+					systems.solve(x);
+				}) };
+
+				char dense[32]{ "-" };
+				if (n <= 256 && batch == 16)
+				{
+					const MatrixXd a{ single.toDense() };
+					const double luTime{ bestOf(3, [&] { b = solve(a, b); }) };
+					std::snprintf(dense, sizeof dense, "%.0f", 1 / luTime);
+				}
+				std::printf("%6d %7d %16.0f %16.0f %8.1fx %16s\n", n, batch, batch / singleTime, batch / batchTime,
+					singleTime / batchTime, dense);
+			}
+		}
+	}
+
+	void sharedMatrix()
+	{
+		std::printf("\n%6s %7s %16s %16s %9s   (solves per second, one matrix and k right-hand sides)\n",
+			"n", "k", "one at a time", "k at once", "speedup");
+		for (int n : { 64, 1024 })
+		{
+			for (int k : { 16, 256, 4096 })
+			{
+				if (static_cast<long long>(n) * k > (1 << 22))
+					continue;
+				const TridiagonalMatrixX<double> a{ n, -1, 2.5, -1 };
+				const TridiagonalDecomposition<double> thomas{ a };
+				MatrixXd rhs{ n, k };
+				fillRandom(rhs.data(), rhs.data() + rhs.size(), 4);
+				MatrixXd x{ n, k };
+				MatrixXd column{ n, 1 };
+				const double singleTime{ bestOf(3, [&] {
+					for (int s{}; s < k; ++s)
+					{
+						for (int i{}; i < n; ++i)
+							column.coeffRef(i) = rhs.coeff(i, s);
+						thomas.solveInPlace(column);
+						x.coeffRef(0, s) = column.coeff(0);
+					}
+				}) };
+				const double blockTime{ bestOf(3, [&] {
+					x = rhs;
+					thomas.solveInPlace(x);
+				}) };
+				std::printf("%6d %7d %16.0f %16.0f %8.1fx\n", n, k, k / singleTime, k / blockTime, singleTime / blockTime);
+			}
+		}
+	}
+}
+
+void runTridiagonalBenchmark()
+{
+	independentSystems();
+	sharedMatrix();
+}
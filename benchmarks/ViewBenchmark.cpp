@@ -0,0 +1,63 @@
+// ViewBenchmark.cpp : Operations on rows, columns and blocks through strided views, against copying them out first.
+
+#include <cstdio>
+#include "Benchmark.h"
+#include "MatrixX.h"
+
+namespace
+{
+	/// <summary>
+	/// How rows and blocks were read before views: one bounds-checked coefficient at a time into a new matrix.
+	/// </summary>
+	MatrixXd copyBlock(const MatrixXd& m, int i0, int j0, int p, int q)
+	{
+		MatrixXd result{ p, q };
+		for (int i{}; i < p; ++i)
+			for (int j{}; j < q; ++j)
+				result(i, j) = m(i0 + i, j0 + j);
+		return result;
+	}
+
+	void report(const char* operation, int n, double copyTime, double viewTime)
+	{
+		std::printf("%-16s %6d %12.3f %12.3f %9.2fx\n", operation, n, copyTime * 1e3, viewTime * 1e3, copyTime / viewTime);
+	}
+}
+
+void runViewBenchmark()
+{
+	std::printf("%-16s %6s %12s %12s %10s\n", "operation", "n", "copy (ms)", "view (ms)", "speedup");
+	for (int n : { 512, 2048 })
+	{
+		MatrixXd a{ n, n };
+		MatrixXd b{ n, n };
+		fillRandom(a.data(), a.data() + a.size(), 1);
+		fillRandom(b.data(), b.data() + b.size(), 2);
+		MatrixXd rowVector{ 1, n };
+		const int half{ n / 2 };
+		const int repetitions{ n <= 512 ? 20 : 5 };
+		double checksum{};
+
+		report("copy rows", n,
+			bestOf(repetitions, [&] { for (int i{}; i < n; ++i) checksum += copyBlock(a, i, 0, 1, n)(0, i); }),
+			bestOf(repetitions, [&] { for (int i{}; i < n; ++i) { rowVector = a.row(i); checksum += rowVector(0, i); } }));
+
+		report("row axpy", n,
+			bestOf(repetitions, [&] {
+				for (int i{ 1 }; i < n; ++i)
+				{
+					MatrixXd updated{ copyBlock(b, i, 0, 1, n) + 0.5 * copyBlock(b, i - 1, 0, 1, n) };
+					for (int j{}; j < n; ++j)
+						b(i, j) = updated(0, j);
+				}
+			}),
+			bestOf(repetitions, [&] { for (int i{ 1 }; i < n; ++i) b.row(i) += 0.5 * b.row(i - 1); }));
+
+		report("block product", n,
+			bestOf(3, [&] { checksum += (copyBlock(a, 0, 0, half, n) * copyBlock(b, 0, half, n, half))(0, 0); }),
+			bestOf(3, [&] { checksum += (a.block(0, 0, half, n) * b.block(0, half, n, half))(0, 0); }));
+
+		if (checksum != checksum)
+			std::printf("NaN in result\n");
+	}
+}
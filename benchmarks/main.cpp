@@ -0,0 +1,53 @@
+// main.cpp : Runs the MathLib benchmark suites.
+//
+// Usage: benchmarks [suite ...]
+// Without arguments every suite is run; otherwise only the named ones.
+
+#include <cstdio>
+#include <cstring>
+#include "Benchmark.h"
+
+struct BenchmarkSuite
+{
+	const char* name;
+	void (*run)();
+};
+
+static const BenchmarkSuite suites[]{
+	{ "gemm", runGemmBenchmark },
+	{ "simd", runSimdBenchmark },
+	{ "scaling", runScalingBenchmark },
+	{ "transpose", runTransposeBenchmark },
+	{ "views", runViewBenchmark },
+	{ "allocators", runAllocatorBenchmark },
+	{ "fixed", runFixedSizeBenchmark },
+	{ "lu", runLUBenchmark },
+	{ "cholesky", runCholeskyBenchmark },
+	{ "iterative", runIterativeBenchmark },
+	{ "sparse", runSparseBenchmark },
+	{ "tridiagonal", runTridiagonalBenchmark },
+	{ "eigen", runEigenBenchmark },
+	{ "qr", runQRBenchmark },
+	{ "batch", runMatrixBatchBenchmark },
+	{ "mixed", runMixedPrecisionBenchmark },
+	{ "io", runMatrixIOBenchmark },
+	{ "calendar", runCalendarBenchmark },
+};
+
+int main(int argc, char* argv[])
+{
+	for (const BenchmarkSuite& suite : suites)
+	{
+		bool selected{ argc == 1 };
+		for (int i{ 1 }; i < argc; ++i)
+			selected = selected || std::strcmp(argv[i], suite.name) == 0;
+
+		if (selected)
+		{
+			std::printf("=== %s ===\n", suite.name);
+			suite.run();
+			std::printf("\n");
+		}
+	}
+	return 0;
+}
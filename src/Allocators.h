@@ -0,0 +1,279 @@
+#pragma once
+#ifndef Allocators_H
+#define Allocators_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <vector>
+
+/// Allocators for matrix storage.
+//
+/// ``MatrixX<scalarType, Allocator>`` keeps its coefficients in a ``std::vector<scalarType, Allocator>``.
+/// Two allocators are provided:
+/// - ``AlignedAllocator<T, Alignment>``, the default, allocates from the heap on ``Alignment``-byte
+///   (by default cache line) boundaries, so that the SIMD kernels never split a vector load across two
+///   cache lines at the start of a matrix.
+/// - ``ArenaAllocator<T, Alignment>`` carves storage out of a thread-local ``Arena`` by bumping a pointer.
+///   Releasing storage is a no-op; instead an ``ArenaScope`` rewinds the arena to where it stood when the
+///   scope was opened, freeing everything allocated since in O(1). The arena keeps its memory blocks, so
+///   a loop that opens a scope per iteration stops touching the global heap after the first iteration:
+///
+/// ```
+/// using MatrixA = MatrixX<double, ArenaAllocator<double>>;
+/// for (const Scenario& scenario : scenarios)
+/// {
+///		ArenaScope scope;
+///		MatrixA shocked{ curve + scenario.shift };
+///		MatrixA pv{ discount * shocked };
+///		results.push_back(pv.sum());
+/// }	// shocked and pv are released here
+/// ```
+///
+/// Matrices allocated from an arena must be destroyed before the innermost scope open at the time they
+/// were allocated is closed, and on the thread that allocated them. Storage allocated outside any scope
+/// is only released with the arena itself, when its thread exits.
+
+namespace internal
+{
+	/// <summary>
+	/// Alignment of matrix storage: a cache line, which is also the width of an AVX-512 register.
+	/// </summary>
+	constexpr std::size_t defaultAlignment{ 64 };
+
+	inline void* allocateAligned(std::size_t bytes, std::size_t alignment)
+	{
+		return ::operator new(bytes, std::align_val_t{ alignment });
+	}
+
+	inline void deallocateAligned(void* p, std::size_t alignment) noexcept
+	{
+		::operator delete(p, std::align_val_t{ alignment });
+	}
+}
+
+/// <summary>
+/// Heap allocator returning storage aligned on ``Alignment`` bytes.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+template<typename T, std::size_t Alignment = internal::defaultAlignment>
+class AlignedAllocator
+{
+	static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0, "the alignment must be a power of two, at least alignof(T)");
+public:
+	using value_type = T;
+
+	template<typename U>
+	struct rebind
+	{
+		using other = AlignedAllocator<U, Alignment>;
+	};
+
+	AlignedAllocator() noexcept = default;
+	template<typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+	T* allocate(std::size_t n)
+	{
+		if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+			throw std::bad_array_new_length{};
+		return static_cast<T*>(internal::allocateAligned(n * sizeof(T), Alignment));
+	}
+
+	void deallocate(T* p, std::size_t) noexcept
+	{
+		internal::deallocateAligned(p, Alignment);
+	}
+
+	template<typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+	template<typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+/// <summary>
+/// A bump allocator over a list of memory blocks. Allocation advances an offset within the current block
+/// and moves on to the next block (allocating it if needed) when the current one is full. ``release()``
+/// rewinds to an earlier ``mark()``; the blocks themselves are kept for reuse until the arena is destroyed.
+/// </summary>
+class Arena
+{
+public:
+	/// <summary>
+	/// A position in the arena, as returned by ``mark()``.
+	/// </summary>
+	struct Marker
+	{
+		std::size_t block;
+		std::size_t offset;
+	};
+
+private:
+	struct Block
+	{
+		std::byte* data;
+		std::size_t size;
+	};
+
+	std::vector<Block> _blocks;
+	std::size_t _block{};	// index of the current block
+	std::size_t _offset{};	// first free byte of the current block
+	std::size_t _blockSize;
+
+public:
+	/// <summary>
+	/// An empty arena; memory is requested from the heap in blocks of at least ``blockSize`` bytes.
+	/// </summary>
+	/// <param name="blockSize"></param>
+	explicit Arena(std::size_t blockSize = std::size_t{ 1 } << 20) : _blockSize{ blockSize } {}
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	~Arena()
+	{
+		for (const Block& block : _blocks)
+			internal::deallocateAligned(block.data, internal::defaultAlignment);
+	}
+
+	/// <summary>
+	/// The arena of the calling thread, used by ``ArenaAllocator`` and ``ArenaScope``.
+	/// </summary>
+	/// <returns></returns>
+	static Arena& local()
+	{
+		thread_local Arena arena;
+		return arena;
+	}
+
+	/// <summary>
+	/// ``bytes`` bytes of storage aligned on ``alignment`` bytes, which must be a power of two no larger
+	/// than the alignment of the blocks (64 bytes).
+	/// </summary>
+	/// <param name="bytes"></param>
+	/// <param name="alignment"></param>
+	/// <returns></returns>
+	void* allocate(std::size_t bytes, std::size_t alignment)
+	{
+		assert(alignment <= internal::defaultAlignment && (alignment & (alignment - 1)) == 0);
+		for (;;)
+		{
+			if (_block < _blocks.size())
+			{
+				const Block& block{ _blocks[_block] };
+				const std::size_t start{ (_offset + alignment - 1) & ~(alignment - 1) };
+				if (start <= block.size && bytes <= block.size - start)
+				{
+					_offset = start + bytes;
+					return block.data + start;
+				}
+				// The current block is full; move on to the next one.
+				if (_block + 1 < _blocks.size() && bytes <= _blocks[_block + 1].size)
+				{
+					++_block;
+					_offset = 0;
+					continue;
+				}
+			}
+
+			// Insert a new block after the current one; blocks further on stay available for reuse.
+			const std::size_t size{ std::max(_blockSize, bytes) };
+			const Block block{ static_cast<std::byte*>(internal::allocateAligned(size, internal::defaultAlignment)), size };
+			const std::size_t next{ _blocks.empty() ? 0 : _block + 1 };
+			_blocks.insert(_blocks.begin() + static_cast<std::ptrdiff_t>(next), block);
+			_block = next;
+			_offset = 0;
+		}
+	}
+
+	Marker mark() const
+	{
+		return Marker{ _block, _offset };
+	}
+
+	/// <summary>
+	/// Free everything allocated since ``marker`` was taken. O(1): no memory is returned to the heap.
+	/// </summary>
+	/// <param name="marker"></param>
+	void release(Marker marker)
+	{
+		_block = marker.block;
+		_offset = marker.offset;
+	}
+
+	/// <summary>
+	/// Total size of the memory blocks owned by the arena, in bytes.
+	/// </summary>
+	/// <returns></returns>
+	std::size_t capacity() const
+	{
+		std::size_t total{};
+		for (const Block& block : _blocks)
+			total += block.size;
+		return total;
+	}
+};
+
+/// <summary>
+/// Scoped reset of an arena, by default the arena of the calling thread: storage allocated from the arena
+/// during the lifetime of the scope is released when the scope is destroyed. Scopes nest.
+/// </summary>
+class ArenaScope
+{
+private:
+	Arena& _arena;
+	Arena::Marker _marker;
+public:
+	explicit ArenaScope(Arena& arena = Arena::local()) : _arena{ arena }, _marker{ arena.mark() } {}
+
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+
+	~ArenaScope()
+	{
+		_arena.release(_marker);
+	}
+};
+
+/// <summary>
+/// Allocator drawing from the arena of the calling thread. ``deallocate`` does nothing: the storage is
+/// reclaimed when the enclosing ``ArenaScope`` closes.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+template<typename T, std::size_t Alignment = internal::defaultAlignment>
+class ArenaAllocator
+{
+	static_assert(Alignment >= alignof(T) && Alignment <= internal::defaultAlignment && (Alignment & (Alignment - 1)) == 0,
+		"the alignment must be a power of two, between alignof(T) and 64");
+public:
+	using value_type = T;
+
+	template<typename U>
+	struct rebind
+	{
+		using other = ArenaAllocator<U, Alignment>;
+	};
+
+	ArenaAllocator() noexcept = default;
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U, Alignment>&) noexcept {}
+
+	T* allocate(std::size_t n)
+	{
+		if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+			throw std::bad_array_new_length{};
+		return static_cast<T*>(Arena::local().allocate(n * sizeof(T), Alignment));
+	}
+
+	void deallocate(T*, std::size_t) noexcept {}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U, Alignment>&) const noexcept { return true; }
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+#endif // !Allocators_H
@@ -0,0 +1,340 @@
+#pragma once
+#ifndef BANDED_MATRIX_X_H
+#define BANDED_MATRIX_X_H
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "MatrixX.h"
+
+/// Banded square matrices.
+//
+/// A ``BandedMatrixX`` of order n with lower bandwidth p and upper bandwidth q has non-zero coefficients
+/// only in the band \f$-p \le j - i \le q\f$: the 3-point stencils of one-dimensional finite-difference
+/// grids are tridiagonal (p = q = 1), and the stencils of higher order or of lines of a grid have wider
+/// bands. The band is stored by rows, ``p + q + 1`` coefficients per row, so that row i holds the
+/// coefficients (i, i - p) to (i, i + q); positions of the band that fall outside the matrix, in the first
+/// p and last q rows, are stored as zeros. The product by a vector costs \f$n(p + q + 1)\f$ multiply-adds
+/// and the tridiagonal case has its own kernel.
+///
+/// ```
+/// BandedMatrixX<double> a{ n, 1, 1 };      // tridiagonal
+/// for (int i{}; i < n; ++i)
+/// {
+///     a(i, i) = 2;
+///     if (i > 0)
+///         a(i, i - 1) = -1;
+///     if (i + 1 < n)
+///         a(i, i + 1) = -1;
+/// }
+/// MatrixXd y{ a * x };
+/// ```
+
+/// <summary>
+/// ``BandedMatrixX`` is a dynamic square matrix whose non-zero coefficients lie within a band around the diagonal.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+class BandedMatrixX
+{
+private:
+	int _rows;
+	int _lower;
+	int _upper;
+	std::vector<scalarType> _band;		// row i: coefficients (i, i - _lower) to (i, i + _upper)
+public:
+	using value_type = scalarType;
+
+	BandedMatrixX();
+	BandedMatrixX(int n, int lower, int upper);
+
+	int rows() const;
+	int cols() const;
+	int lowerBandwidth() const;
+	int upperBandwidth() const;
+	int bandWidth() const;
+	scalarType* data();
+	const scalarType* data() const;
+
+	bool inBand(int i, int j) const;
+	scalarType coeff(int i, int j) const;
+	scalarType& coeffRef(int i, int j);
+	scalarType operator()(int i, int j) const;
+	scalarType& operator()(int i, int j);
+
+	void multiply(const scalarType* x, scalarType* y) const;
+	MatrixX<scalarType> toDense() const;
+};
+
+/// <summary>
+/// An empty 0 x 0 matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+BandedMatrixX<scalarType>::BandedMatrixX() : _rows{}, _lower{}, _upper{}, _band{}
+{
+}
+
+/// <summary>
+/// The n x n zero matrix with lower bandwidth ``lower`` and upper bandwidth ``upper``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="n"></param>
+/// <param name="lower">number of sub-diagonals</param>
+/// <param name="upper">number of super-diagonals</param>
+template<typename scalarType>
+BandedMatrixX<scalarType>::BandedMatrixX(int n, int lower, int upper)
+	: _rows{ n }, _lower{ lower }, _upper{ upper }, _band{}
+{
+	if (n < 0 || lower < 0 || upper < 0)
+		throw std::logic_error("The order and the bandwidths of a banded matrix cannot be negative!");
+	_band.assign(static_cast<std::size_t>(n) * bandWidth(), scalarType{});
+}
+
+/// <summary>
+/// The number of rows.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int BandedMatrixX<scalarType>::rows() const
+{
+	return _rows;
+}
+
+/// <summary>
+/// The number of columns, equal to the number of rows.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int BandedMatrixX<scalarType>::cols() const
+{
+	return _rows;
+}
+
+/// <summary>
+/// The number of sub-diagonals of the band.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int BandedMatrixX<scalarType>::lowerBandwidth() const
+{
+	return _lower;
+}
+
+/// <summary>
+/// The number of super-diagonals of the band.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int BandedMatrixX<scalarType>::upperBandwidth() const
+{
+	return _upper;
+}
+
+/// <summary>
+/// The number of coefficients stored per row, ``lowerBandwidth() + upperBandwidth() + 1``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int BandedMatrixX<scalarType>::bandWidth() const
+{
+	return _lower + _upper + 1;
+}
+
+/// <summary>
+/// The band, ``bandWidth()`` coefficients per row.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline scalarType* BandedMatrixX<scalarType>::data()
+{
+	return _band.data();
+}
+
+/// <summary>
+/// The band, ``bandWidth()`` coefficients per row.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const scalarType* BandedMatrixX<scalarType>::data() const
+{
+	return _band.data();
+}
+
+/// <summary>
+/// Whether (i, j) is a position of the matrix within the band.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType>
+inline bool BandedMatrixX<scalarType>::inBand(int i, int j) const
+{
+	return i >= 0 && i < _rows && j >= 0 && j < _rows && j - i >= -_lower && j - i <= _upper;
+}
+
+/// <summary>
+/// The coefficient (i, j), zero outside the band. The indices are only checked by an assertion in debug builds.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType>
+inline scalarType BandedMatrixX<scalarType>::coeff(int i, int j) const
+{
+	assert(i >= 0 && i < _rows && j >= 0 && j < _rows);
+	const int d{ j - i };
+	return d >= -_lower && d <= _upper ? _band[static_cast<std::size_t>(i) * bandWidth() + _lower + d] : scalarType{};
+}
+
+/// <summary>
+/// A reference to the coefficient (i, j), which must lie in the band; only checked by an assertion in debug builds.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType>
+inline scalarType& BandedMatrixX<scalarType>::coeffRef(int i, int j)
+{
+	assert(inBand(i, j));
+	return _band[static_cast<std::size_t>(i) * bandWidth() + _lower + j - i];
+}
+
+/// <summary>
+/// The coefficient (i, j), zero outside the band. Throws ``std::out_of_range`` on indices outside the matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType>
+scalarType BandedMatrixX<scalarType>::operator()(int i, int j) const
+{
+	if (i < 0 || i >= _rows || j < 0 || j >= _rows)
+		throw std::out_of_range("Index out of bounds!");
+	return coeff(i, j);
+}
+
+/// <summary>
+/// A reference to the coefficient (i, j). Throws ``std::out_of_range`` if (i, j) is outside the band,
+/// since coefficients there are not stored.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType>
+scalarType& BandedMatrixX<scalarType>::operator()(int i, int j)
+{
+	if (!inBand(i, j))
+		throw std::out_of_range("Index outside the band of the matrix!");
+	return coeffRef(i, j);
+}
+
+/// <summary>
+/// The product \f$y = Ax\f$ by a vector of length n, split across threads by rows. The rows away from the
+/// edges of the matrix take the full band without bounds tests, and the tridiagonal case is unrolled.
+/// ``x`` and ``y`` must not overlap.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="x"></param>
+/// <param name="y"></param>
+template<typename scalarType>
+void BandedMatrixX<scalarType>::multiply(const scalarType* x, scalarType* y) const
+{
+	const int n{ _rows };
+	const int width{ bandWidth() };
+	const scalarType* band{ _band.data() };
+	const int lower{ _lower };
+	const int upper{ _upper };
+	const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+	parallelFor(0, n, std::max(1, grainSize() / width), [&](int first, int last) {
+		for (int i{ first }; i < last; ++i)
+		{
+			const scalarType* row{ band + static_cast<std::size_t>(i) * width };
+			if (i >= lower && i + upper < n)
+			{
+				if (lower == 1 && upper == 1)
+					y[i] = row[0] * x[i - 1] + row[1] * x[i] + row[2] * x[i + 1];
+				else
+					y[i] = kernels.dot(row, x + i - lower, width);
+			}
+			else
+			{
+				scalarType sum{};
+				for (int d{ std::max(-lower, -i) }; d <= std::min(upper, n - 1 - i); ++d)
+					sum += row[lower + d] * x[i + d];
+				y[i] = sum;
+			}
+		}
+	});
+}
+
+/// <summary>
+/// The dense matrix with the same coefficients.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+MatrixX<scalarType> BandedMatrixX<scalarType>::toDense() const
+{
+	MatrixX<scalarType> dense{ _rows, _rows };
+	for (int i{}; i < _rows; ++i)
+		for (int j{ std::max(0, i - _lower) }; j <= std::min(_rows - 1, i + _upper); ++j)
+			dense.coeffRef(i * _rows + j) = coeff(i, j);
+	return dense;
+}
+
+/// <summary>
+/// Banded times dense, \f$AX\f$. Each row of the product is the sum of the at most ``bandWidth()`` rows of X
+/// within the band, and the rows are computed in parallel.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="A"></param>
+/// <param name="X"></param>
+/// <returns></returns>
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator> operator*(const BandedMatrixX<scalarType>& A, const MatrixX<scalarType, Allocator>& X)
+{
+	if (A.cols() != X.rows())
+		throw std::logic_error("Error multiplying the matrices; the number of cols(A) must equal the number of rows(B)!");
+
+	const int k{ X.cols() };
+	MatrixX<scalarType, Allocator> result{ A.rows(), k };
+	if (k == 1)
+	{
+		A.multiply(X.data(), result.data());
+		return result;
+	}
+
+	const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+	const int n{ A.rows() };
+	const int width{ A.bandWidth() };
+	const int lower{ A.lowerBandwidth() };
+	const int upper{ A.upperBandwidth() };
+	const scalarType* band{ A.data() };
+	const scalarType* x{ X.data() };
+	scalarType* r{ result.data() };
+	parallelFor(0, n, std::max(1, grainSize() / std::max(1, width * k)), [&](int first, int last) {
+		for (int i{ first }; i < last; ++i)
+			for (int d{ std::max(-lower, -i) }; d <= std::min(upper, n - 1 - i); ++d)
+				kernels.axpy(band[static_cast<std::size_t>(i) * width + lower + d], x + static_cast<long long>(i + d) * k,
+					r + static_cast<long long>(i) * k, k);
+	});
+	return result;
+}
+
+#endif // !BANDED_MATRIX_X_H
@@ -0,0 +1,740 @@
+#pragma once
+#ifndef Cholesky_H
+#define Cholesky_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "Gemm.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "Transpose.h"
+#include "MatrixX.h"
+
+/// Cholesky factorizations of symmetric matrices, and correlated draws.
+//
+/// ``LLTDecomposition`` factors a symmetric positive definite matrix as \f$A = LL^T\f$ with L lower
+/// triangular. ``LDLTDecomposition`` factors a symmetric matrix as \f$PAP^T = LDL^T\f$ with L unit lower
+/// triangular and D diagonal, where the symmetric permutation P brings the largest remaining diagonal
+/// coefficient to the pivot at every step. It needs no square roots and also accepts positive semidefinite
+/// matrices, such as a correlation matrix of collinear curve points or one estimated from fewer
+/// observations than it has factors: once the remaining pivots vanish (relative to the largest diagonal
+/// coefficient), they are set to zero together with their columns of L.
+///
+/// Both factorizations read only the lower triangle of A and are blocked and right-looking, like
+/// ``LUDecomposition``: each panel of ``choleskyBlockSize`` columns is factored with dot products over
+/// contiguous rows (keeping the diagonal of the Schur complement up to date to choose the pivots of the
+/// LDLT), and the trailing matrix receives the update \f$A_{22} := A_{22} - L_{21}L_{21}^T\f$ (or
+/// \f$L_{21}D_1L_{21}^T\f$) through ``gemm``, one block row at a time so that only the lower triangle is
+/// computed.
+///
+/// ``CholeskyFactor`` holds a factor C with \f$CC^T = A\f$, from ``LLTDecomposition`` if A is positive definite
+/// and from ``LDLTDecomposition`` if it is only semidefinite. Its ``apply()`` turns a whole batch of
+/// independent standard normal vectors, one per row of z, into correlated ones with a single triangular
+/// matrix product (``applyLowerFactor``) instead of one matrix-vector product per path:
+///
+/// ```
+/// const CholeskyFactor<double> c{ correlation };
+/// MatrixXd z{ paths, factors };	// i.i.d. N(0, 1)
+/// MatrixXd x;
+/// c.apply(z, x);					// row p of x is C times row p of z
+/// ```
+
+namespace internal
+{
+	/// <summary>
+	/// Width of the column panels of the blocked Cholesky factorizations.
+	/// </summary>
+	constexpr int choleskyBlockSize{ 64 };
+
+	/// <summary>
+	/// Call ``fn(i)`` for the rows ``[first, last)`` below a diagonal block, in parallel: once the diagonal
+	/// block is factored, the panel entries of these rows are independent of each other.
+	/// </summary>
+	template<typename F>
+	void forEachPanelRow(int first, int last, int width, F&& fn)
+	{
+		parallelFor(first, last, std::max(16, grainSize() / std::max(1, width * width)), [&](int begin, int end) {
+			for (int i{ begin }; i < end; ++i)
+				fn(i);
+		});
+	}
+
+	/// <summary>
+	/// \f$A_{22} := A_{22} - L_{21}W^T\f$ on the lower triangle of the trailing m x m matrix ``a22``, where
+	/// ``l21`` and ``w`` are m x jb. Computed by ``gemm`` in block rows, each up to the diagonal.
+	/// </summary>
+	template<typename scalarType>
+	void choleskyUpdate(int m, int jb, const scalarType* l21, const scalarType* w, int ldw, scalarType* a22, int lda)
+	{
+		std::vector<scalarType> wt(static_cast<std::size_t>(jb) * m);
+		transposeCopy(m, jb, w, ldw, wt.data(), m);
+		for (int r0{}; r0 < m; r0 += choleskyBlockSize)
+		{
+			const int r1{ std::min(m, r0 + choleskyBlockSize) };
+			gemm(r1 - r0, r1, jb, scalarType{ -1 }, l21 + r0 * lda, lda, wt.data(), m, scalarType{ 1 }, a22 + r0 * lda, lda);
+		}
+	}
+
+	/// <summary>
+	/// Blocked \f$LL^T\f$ factorization of the lower triangle of the n x n matrix ``a``, in place.
+	/// Returns false if a pivot is not positive, leaving the factorization incomplete.
+	/// </summary>
+	template<typename scalarType>
+	bool llt(int n, scalarType* a, int lda)
+	{
+		const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+		for (int k{}; k < n; k += choleskyBlockSize)
+		{
+			const int jb{ std::min(choleskyBlockSize, n - k) };
+
+			// Diagonal block, column by column.
+			for (int j{ k }; j < k + jb; ++j)
+			{
+				const scalarType* rowJ{ a + j * lda + k };
+				const scalarType d{ a[j * lda + j] - kernels.dot(rowJ, rowJ, j - k) };
+				if (!(d > scalarType{}))
+					return false;
+				const scalarType ljj{ std::sqrt(d) };
+				a[j * lda + j] = ljj;
+				for (int i{ j + 1 }; i < k + jb; ++i)
+					a[i * lda + j] = (a[i * lda + j] - kernels.dot(a + i * lda + k, rowJ, j - k)) / ljj;
+			}
+
+			// L21 := A21 L11^-T, one row at a time.
+			forEachPanelRow(k + jb, n, jb, [&](int i) {
+				scalarType* rowI{ a + i * lda + k };
+				for (int j{}; j < jb; ++j)
+					rowI[j] = (rowI[j] - kernels.dot(rowI, a + (k + j) * lda + k, j)) / a[(k + j) * lda + k + j];
+			});
+
+			const int m{ n - k - jb };
+			if (m > 0)
+				choleskyUpdate(m, jb, a + (k + jb) * lda + k, a + (k + jb) * lda + k, lda, a + (k + jb) * lda + k + jb, lda);
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Exchange rows and columns i and p (i < p) of the symmetric n x n matrix whose lower triangle is ``a``.
+	/// </summary>
+	template<typename scalarType>
+	void symmetricSwap(int n, scalarType* a, int lda, int i, int p)
+	{
+		std::swap_ranges(a + i * lda, a + i * lda + i, a + p * lda);
+		std::swap(a[i * lda + i], a[p * lda + p]);
+		for (int c{ i + 1 }; c < p; ++c)
+			std::swap(a[c * lda + i], a[p * lda + c]);
+		for (int r{ p + 1 }; r < n; ++r)
+			std::swap(a[r * lda + i], a[r * lda + p]);
+	}
+
+	/// <summary>
+	/// Blocked \f$PAP^T = LDL^T\f$ factorization of the lower triangle of the n x n matrix ``a``, in place,
+	/// with diagonal pivoting: L is written below the diagonal, D to ``d`` and the permutation to
+	/// ``permutation`` (row i of \f$PAP^T\f$ is row ``permutation[i]`` of A). Each pivot is the largest
+	/// remaining diagonal coefficient of the Schur complement; once none exceeds ``tolerance`` in magnitude,
+	/// the remaining pivots and columns of L are set to zero. Returns false if a pivot is negative (beyond
+	/// the tolerance), i.e. if A is not positive semidefinite.
+	/// </summary>
+	template<typename scalarType>
+	bool ldlt(int n, scalarType* a, int lda, scalarType* d, int* permutation, scalarType tolerance)
+	{
+		const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+		bool semidefinite{ true };
+		std::vector<scalarType> diagonal(n);	// diagonal of the Schur complement, updated column by column
+		for (int i{}; i < n; ++i)
+		{
+			diagonal[i] = a[i * lda + i];
+			permutation[i] = i;
+		}
+
+		std::vector<scalarType> w(static_cast<std::size_t>(n) * choleskyBlockSize);	// L21 D1
+		std::vector<scalarType> wj(choleskyBlockSize);								// row j of L D, within the panel
+		for (int k{}; k < n; k += choleskyBlockSize)
+		{
+			const int jb{ std::min(choleskyBlockSize, n - k) };
+			for (int j{ k }; j < k + jb; ++j)
+			{
+				int p{ j };
+				for (int i{ j + 1 }; i < n; ++i)
+					if (diagonal[i] > diagonal[p])
+						p = i;
+				if (diagonal[p] <= tolerance)
+				{
+					for (int i{ j }; i < n; ++i)
+						if (std::abs(diagonal[i]) > std::abs(diagonal[p]))
+							p = i;
+					if (std::abs(diagonal[p]) <= tolerance)
+					{
+						// The rest of the Schur complement vanishes.
+						for (int i{ j }; i < n; ++i)
+						{
+							d[i] = scalarType{};
+							std::fill(a + i * lda + j, a + i * lda + i, scalarType{});
+						}
+						return semidefinite;
+					}
+					semidefinite = false;
+				}
+				if (p != j)
+				{
+					symmetricSwap(n, a, lda, j, p);
+					std::swap(diagonal[j], diagonal[p]);
+					std::swap(permutation[j], permutation[p]);
+				}
+
+				// Column j of L, from the panel columns already factored.
+				const scalarType dj{ diagonal[j] };
+				d[j] = dj;
+				for (int c{}; c < j - k; ++c)
+					wj[c] = a[j * lda + k + c] * d[k + c];
+				forEachPanelRow(j + 1, n, j - k + 1, [&](int i) {
+					scalarType* rowI{ a + i * lda + k };
+					const scalarType l{ (rowI[j - k] - kernels.dot(rowI, wj.data(), j - k)) / dj };
+					rowI[j - k] = l;
+					diagonal[i] -= l * l * dj;
+				});
+			}
+
+			const int m{ n - k - jb };
+			if (m > 0)
+			{
+				forEachPanelRow(k + jb, n, jb, [&](int i) {
+					for (int c{}; c < jb; ++c)
+						w[static_cast<std::size_t>(i - k - jb) * jb + c] = a[i * lda + k + c] * d[k + c];
+				});
+				choleskyUpdate(m, jb, a + (k + jb) * lda + k, w.data(), jb, a + (k + jb) * lda + k + jb, lda);
+			}
+		}
+		return semidefinite;
+	}
+
+	/// <summary>
+	/// Zero the strict upper triangle of the n x n matrix ``a``, and set its diagonal to one if ``unitDiagonal``.
+	/// </summary>
+	template<typename scalarType>
+	void keepLowerTriangle(int n, scalarType* a, int lda, bool unitDiagonal)
+	{
+		for (int i{}; i < n; ++i)
+		{
+			if (unitDiagonal)
+				a[i * lda + i] = scalarType{ 1 };
+			std::fill(a + i * lda + i + 1, a + i * lda + n, scalarType{});
+		}
+	}
+
+	/// <summary>
+	/// Solve \f$LX = B\f$ in place, for the n x n lower triangle of ``l`` (with its diagonal, or an implicit
+	/// unit diagonal) and n x m B.
+	/// </summary>
+	template<typename scalarType>
+	void solveLower(int n, int m, const scalarType* l, int ldl, scalarType* b, bool unitDiagonal)
+	{
+		const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+		for (int i{}; i < n; ++i)
+		{
+			scalarType* row{ b + i * m };
+			for (int c{}; c < i; ++c)
+				kernels.axpy(-l[i * ldl + c], b + c * m, row, m);
+			if (!unitDiagonal)
+				kernels.scale(row, scalarType{ 1 } / l[i * ldl + i], row, m);
+		}
+	}
+
+	/// <summary>
+	/// Solve \f$L^TX = B\f$ in place. Each solved row of X is eliminated from the rows above it, so that
+	/// the sweep runs along rows of L rather than down its columns.
+	/// </summary>
+	template<typename scalarType>
+	void solveLowerTransposed(int n, int m, const scalarType* l, int ldl, scalarType* b, bool unitDiagonal)
+	{
+		const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+		for (int i{ n - 1 }; i >= 0; --i)
+		{
+			scalarType* row{ b + i * m };
+			if (!unitDiagonal)
+				kernels.scale(row, scalarType{ 1 } / l[i * ldl + i], row, m);
+			for (int c{}; c < i; ++c)
+				kernels.axpy(-l[i * ldl + c], row, b + c * m, m);
+		}
+	}
+}
+
+/// <summary>
+/// Cholesky decomposition \f$A = LL^T\f$ of a symmetric positive definite matrix.
+/// </summary>
+/// <typeparam name="scalarType">``float`` or ``double``</typeparam>
+template<typename scalarType>
+class LLTDecomposition
+{
+	static_assert(std::is_floating_point<scalarType>::value, "LLTDecomposition requires a floating-point scalar type");
+private:
+	MatrixX<scalarType> _l;
+	bool _positiveDefinite;
+public:
+	LLTDecomposition();
+	template<typename Allocator>
+	explicit LLTDecomposition(const MatrixX<scalarType, Allocator>& a);
+
+	template<typename Allocator>
+	LLTDecomposition& compute(const MatrixX<scalarType, Allocator>& a);
+
+	int rows() const;
+	bool isPositiveDefinite() const;
+	const MatrixX<scalarType>& matrixL() const;
+	template<typename Allocator>
+	MatrixX<scalarType> solve(const MatrixX<scalarType, Allocator>& b) const;
+};
+
+/// <summary>
+/// An empty decomposition, to be filled by ``compute()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+LLTDecomposition<scalarType>::LLTDecomposition() : _l{}, _positiveDefinite{ false }
+{
+}
+
+/// <summary>
+/// Factor the symmetric matrix ``a``, of which only the lower triangle is read.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+template<typename scalarType>
+template<typename Allocator>
+LLTDecomposition<scalarType>::LLTDecomposition(const MatrixX<scalarType, Allocator>& a) : LLTDecomposition{}
+{
+	compute(a);
+}
+
+/// <summary>
+/// Factor the symmetric matrix ``a``, replacing the previous factorization. Throws ``std::logic_error`` if
+/// ``a`` is not square; if it is not positive definite, ``isPositiveDefinite()`` is false.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Allocator>
+LLTDecomposition<scalarType>& LLTDecomposition<scalarType>::compute(const MatrixX<scalarType, Allocator>& a)
+{
+	if (a.rows() != a.cols())
+		throw std::logic_error("Cholesky decomposition requires a square matrix!");
+
+	const int n{ a.rows() };
+	_l.resize(n, n);
+	std::copy(a.data(), a.data() + a.size(), _l.data());
+	_positiveDefinite = internal::llt(n, _l.data(), n);
+	internal::keepLowerTriangle(n, _l.data(), n, false);
+	return *this;
+}
+
+/// <summary>
+/// The order of the factored matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int LLTDecomposition<scalarType>::rows() const
+{
+	return _l.rows();
+}
+
+/// <summary>
+/// Whether the factorization succeeded, i.e. every pivot was positive.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline bool LLTDecomposition<scalarType>::isPositiveDefinite() const
+{
+	return _positiveDefinite;
+}
+
+/// <summary>
+/// The lower triangular factor L, with zeros above the diagonal.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const MatrixX<scalarType>& LLTDecomposition<scalarType>::matrixL() const
+{
+	return _l;
+}
+
+/// <summary>
+/// The solution X of \f$AX = B\f$. Throws ``std::logic_error`` if A is not positive definite.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="b"></param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Allocator>
+MatrixX<scalarType> LLTDecomposition<scalarType>::solve(const MatrixX<scalarType, Allocator>& b) const
+{
+	if (b.rows() != rows())
+		throw std::logic_error("Error solving the system; the number of rows(b) must equal the number of rows(A)!");
+	if (!_positiveDefinite)
+		throw std::logic_error("The matrix is not positive definite!");
+
+	MatrixX<scalarType> x{ b.rows(), b.cols() };
+	std::copy(b.data(), b.data() + b.size(), x.data());
+	internal::solveLower(rows(), x.cols(), _l.data(), rows(), x.data(), false);
+	internal::solveLowerTransposed(rows(), x.cols(), _l.data(), rows(), x.data(), false);
+	return x;
+}
+
+/// <summary>
+/// Decomposition \f$PAP^T = LDL^T\f$ of a symmetric positive semidefinite matrix, with diagonal pivoting.
+/// Vanishing pivots are set to zero, so that the rank of A is the number of non-zero pivots.
+/// </summary>
+/// <typeparam name="scalarType">``float`` or ``double``</typeparam>
+template<typename scalarType>
+class LDLTDecomposition
+{
+	static_assert(std::is_floating_point<scalarType>::value, "LDLTDecomposition requires a floating-point scalar type");
+private:
+	MatrixX<scalarType> _l;
+	MatrixX<scalarType> _d;
+	std::vector<int> _permutation;	// row i of P A P^T is row _permutation[i] of A
+	bool _positiveSemidefinite;
+public:
+	LDLTDecomposition();
+	template<typename Allocator>
+	explicit LDLTDecomposition(const MatrixX<scalarType, Allocator>& a);
+
+	template<typename Allocator>
+	LDLTDecomposition& compute(const MatrixX<scalarType, Allocator>& a);
+
+	int rows() const;
+	int rank() const;
+	bool isPositiveSemidefinite() const;
+	const MatrixX<scalarType>& matrixL() const;
+	const MatrixX<scalarType>& vectorD() const;
+	const std::vector<int>& permutation() const;
+	MatrixX<scalarType> factor() const;
+	template<typename Allocator>
+	MatrixX<scalarType> solve(const MatrixX<scalarType, Allocator>& b) const;
+};
+
+/// <summary>
+/// An empty decomposition, to be filled by ``compute()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+LDLTDecomposition<scalarType>::LDLTDecomposition() : _l{}, _d{}, _permutation{}, _positiveSemidefinite{ false }
+{
+}
+
+/// <summary>
+/// Factor the symmetric matrix ``a``, of which only the lower triangle is read.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+template<typename scalarType>
+template<typename Allocator>
+LDLTDecomposition<scalarType>::LDLTDecomposition(const MatrixX<scalarType, Allocator>& a) : LDLTDecomposition{}
+{
+	compute(a);
+}
+
+/// <summary>
+/// Factor the symmetric matrix ``a``, replacing the previous factorization. Pivots no larger than
+/// \f$n \epsilon \max_i |a_{ii}|\f$ in magnitude are treated as zero. Throws ``std::logic_error`` if ``a`` is
+/// not square.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Allocator>
+LDLTDecomposition<scalarType>& LDLTDecomposition<scalarType>::compute(const MatrixX<scalarType, Allocator>& a)
+{
+	if (a.rows() != a.cols())
+		throw std::logic_error("LDLT decomposition requires a square matrix!");
+
+	const int n{ a.rows() };
+	_l.resize(n, n);
+	_d.resize(n, 1);
+	_permutation.resize(n);
+	std::copy(a.data(), a.data() + a.size(), _l.data());
+
+	scalarType largest{};
+	for (int i{}; i < n; ++i)
+		largest = std::max(largest, std::abs(a.coeff(i, i)));
+	const scalarType tolerance{ n * std::numeric_limits<scalarType>::epsilon() * largest };
+
+	_positiveSemidefinite = internal::ldlt(n, _l.data(), n, _d.data(), _permutation.data(), tolerance);
+	internal::keepLowerTriangle(n, _l.data(), n, true);
+	return *this;
+}
+
+/// <summary>
+/// The order of the factored matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int LDLTDecomposition<scalarType>::rows() const
+{
+	return _l.rows();
+}
+
+/// <summary>
+/// The number of non-zero pivots.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+int LDLTDecomposition<scalarType>::rank() const
+{
+	return static_cast<int>(std::count_if(_d.data(), _d.data() + _d.size(), [](scalarType x) { return x != scalarType{}; }));
+}
+
+/// <summary>
+/// Whether no pivot is negative.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline bool LDLTDecomposition<scalarType>::isPositiveSemidefinite() const
+{
+	return _positiveSemidefinite;
+}
+
+/// <summary>
+/// The unit lower triangular factor L, with zeros above the diagonal.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const MatrixX<scalarType>& LDLTDecomposition<scalarType>::matrixL() const
+{
+	return _l;
+}
+
+/// <summary>
+/// The diagonal of D, as an n x 1 column vector.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const MatrixX<scalarType>& LDLTDecomposition<scalarType>::vectorD() const
+{
+	return _d;
+}
+
+/// <summary>
+/// The symmetric permutation P: row i of \f$PAP^T\f$ is row ``permutation()[i]`` of A.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const std::vector<int>& LDLTDecomposition<scalarType>::permutation() const
+{
+	return _permutation;
+}
+
+/// <summary>
+/// The lower triangular \f$LD^{1/2}\f$, a Cholesky factor of \f$PAP^T\f$. Throws ``std::logic_error``
+/// unless A is positive semidefinite.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+MatrixX<scalarType> LDLTDecomposition<scalarType>::factor() const
+{
+	if (!_positiveSemidefinite)
+		throw std::logic_error("The matrix is not positive semidefinite!");
+
+	const int n{ rows() };
+	MatrixX<scalarType> c{ _l };
+	for (int j{}; j < n; ++j)
+	{
+		const scalarType s{ std::sqrt(_d.coeff(j)) };
+		for (int i{ j }; i < n; ++i)
+			c.coeffRef(i, j) *= s;
+	}
+	return c;
+}
+
+/// <summary>
+/// The solution X of \f$AX = B\f$. Throws ``std::logic_error`` if a pivot is zero.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="b"></param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Allocator>
+MatrixX<scalarType> LDLTDecomposition<scalarType>::solve(const MatrixX<scalarType, Allocator>& b) const
+{
+	const int n{ rows() };
+	if (b.rows() != n)
+		throw std::logic_error("Error solving the system; the number of rows(b) must equal the number of rows(A)!");
+	if (rank() != n)
+		throw std::logic_error("The matrix is singular; the system has no unique solution!");
+
+	// Permute B, solve with L, D and L^T, and permute back.
+	const int m{ b.cols() };
+	const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+	MatrixX<scalarType> y{ n, m };
+	for (int i{}; i < n; ++i)
+		std::copy(b.data() + _permutation[i] * m, b.data() + (_permutation[i] + 1) * m, y.data() + i * m);
+	internal::solveLower(n, m, _l.data(), n, y.data(), true);
+	for (int i{}; i < n; ++i)
+		kernels.scale(y.data() + i * m, scalarType{ 1 } / _d.coeff(i), y.data() + i * m, m);
+	internal::solveLowerTransposed(n, m, _l.data(), n, y.data(), true);
+
+	MatrixX<scalarType> x{ n, m };
+	for (int i{}; i < n; ++i)
+		std::copy(y.data() + i * m, y.data() + (i + 1) * m, x.data() + _permutation[i] * m);
+	return x;
+}
+
+/// <summary>
+/// \f$X := ZC^T\f$ for a lower triangular n x n matrix C and a batch Z of vectors, one per row: row p of X
+/// is C times row p of Z. X is resized to the dimensions of Z (reusing its storage when possible).
+/// The product runs as one ``gemm`` per block of ``choleskyBlockSize`` columns of X, each over only
+/// the columns of Z that the triangle of C reaches, so that about half of the flops of a full product are saved.
+/// </summary>
+template<typename scalarType, typename AllocatorC, typename AllocatorZ, typename AllocatorX>
+void applyLowerFactor(const MatrixX<scalarType, AllocatorC>& c, const MatrixX<scalarType, AllocatorZ>& z, MatrixX<scalarType, AllocatorX>& x)
+{
+	const int n{ c.rows() };
+	if (c.cols() != n || z.cols() != n)
+		throw std::logic_error("Error applying the factor; the number of cols(z) must equal the order of the factor!");
+
+	const int m{ z.rows() };
+	x.resize(m, n);
+	std::vector<scalarType> ct(static_cast<std::size_t>(n) * n);
+	transposeCopy(n, n, c.data(), n, ct.data(), n);
+	for (int j0{}; j0 < n; j0 += internal::choleskyBlockSize)
+	{
+		const int j1{ std::min(n, j0 + internal::choleskyBlockSize) };
+		gemm(m, j1 - j0, j1, scalarType{ 1 }, z.data(), n, ct.data() + j0, n, scalarType{}, x.data() + j0, n);
+	}
+}
+
+/// <summary>
+/// A factor C with \f$CC^T = A\f$ of a symmetric positive semidefinite matrix A, for generating correlated
+/// draws. It is the lower triangular Cholesky factor if A is positive definite. Otherwise the pivoted
+/// \f$LDL^T\f$ decomposition gives \f$C = P^TLD^{1/2}\f$, a lower triangle with permuted rows.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+class CholeskyFactor
+{
+private:
+	MatrixX<scalarType> _c;
+	std::vector<int> _permutation;	// empty unless the factor is pivoted
+public:
+	template<typename Allocator>
+	explicit CholeskyFactor(const MatrixX<scalarType, Allocator>& a);
+
+	int rows() const;
+	bool isPivoted() const;
+	const MatrixX<scalarType>& matrixL() const;
+	const std::vector<int>& permutation() const;
+	template<typename AllocatorZ, typename AllocatorX>
+	void apply(const MatrixX<scalarType, AllocatorZ>& z, MatrixX<scalarType, AllocatorX>& x) const;
+};
+
+/// <summary>
+/// Factor A, trying \f$LL^T\f$ first. Throws ``std::logic_error`` if A is not positive semidefinite.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+template<typename scalarType>
+template<typename Allocator>
+CholeskyFactor<scalarType>::CholeskyFactor(const MatrixX<scalarType, Allocator>& a) : _c{}, _permutation{}
+{
+	LLTDecomposition<scalarType> llt{ a };
+	if (llt.isPositiveDefinite())
+	{
+		_c = llt.matrixL();
+		return;
+	}
+
+	const LDLTDecomposition<scalarType> ldlt{ a };
+	_c = ldlt.factor();
+	_permutation = ldlt.permutation();
+}
+
+/// <summary>
+/// The order of the factor.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int CholeskyFactor<scalarType>::rows() const
+{
+	return _c.rows();
+}
+
+/// <summary>
+/// Whether the matrix was only semidefinite, so that the factor is \f$P^TLD^{1/2}\f$.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline bool CholeskyFactor<scalarType>::isPivoted() const
+{
+	return !_permutation.empty();
+}
+
+/// <summary>
+/// The lower triangular part of the factor: C itself, or \f$LD^{1/2}\f$ if the factor is pivoted.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const MatrixX<scalarType>& CholeskyFactor<scalarType>::matrixL() const
+{
+	return _c;
+}
+
+/// <summary>
+/// The permutation of a pivoted factor (see ``LDLTDecomposition::permutation()``), and empty otherwise.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const std::vector<int>& CholeskyFactor<scalarType>::permutation() const
+{
+	return _permutation;
+}
+
+/// <summary>
+/// \f$X := ZC^T\f$: row p of X is C times row p of Z. Standard normal rows of Z give rows of X with
+/// covariance A.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="z"></param>
+/// <param name="x"></param>
+template<typename scalarType>
+template<typename AllocatorZ, typename AllocatorX>
+void CholeskyFactor<scalarType>::apply(const MatrixX<scalarType, AllocatorZ>& z, MatrixX<scalarType, AllocatorX>& x) const
+{
+	applyLowerFactor(_c, z, x);
+	if (_permutation.empty())
+		return;
+
+	// Component i of L D^1/2 z is component permutation[i] of C z.
+	const int n{ rows() };
+	parallelFor(0, x.rows(), std::max(1, grainSize() / std::max(1, n)), [&](int first, int last) {
+		std::vector<scalarType> row(n);
+		for (int p{ first }; p < last; ++p)
+		{
+			scalarType* xp{ x.data() + static_cast<std::size_t>(p) * n };
+			std::copy(xp, xp + n, row.data());
+			for (int i{}; i < n; ++i)
+				xp[_permutation[i]] = row[i];
+		}
+	});
+}
+
+#endif // !Cholesky_H
@@ -0,0 +1,179 @@
+#pragma once
+#ifndef Float16_H
+#define Float16_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/// 16-bit floating-point storage types.
+//
+/// Large factor and covariance matrices are often read far more often than they are computed, and products
+/// with them are limited by memory bandwidth rather than by arithmetic. Storing them in 16 bits halves the
+/// traffic of ``float`` storage and quarters that of ``double``:
+/// - ``half`` is the IEEE 754 binary16 format: 11 significant bits (about 3 decimal digits), and a range
+///   of \f$6 \cdot 10^{-8}\f$ (subnormal) to 65504.
+/// - ``bfloat16`` keeps the 8-bit exponent of ``float`` and its range, with only 8 significant bits.
+///
+/// Both are storage formats only. They convert implicitly to ``float``, so arithmetic on them is done in
+/// ``float``, and they are constructed explicitly from any arithmetic type, rounding to the nearest
+/// representable value (ties to even). ``MatrixX<half>`` and ``MatrixX<bfloat16>`` hold such matrices;
+/// ``multiply<float>`` and ``dot<float>`` (see MixedPrecision.h) convert them on the fly and accumulate in
+/// ``float``:
+///
+/// ```
+/// MatrixX<half> loadings{ factors };				// converted from a MatrixXd, rounding every coefficient
+/// MatrixXf exposure{ multiply<float>(loadings, weights) };
+/// ```
+///
+/// Conversions from ``double`` round to ``float`` first, which may differ from a direct rounding in the last
+/// bit for values halfway between two representable 16-bit numbers.
+
+namespace internal
+{
+	/// <summary>
+	/// The bits of a float.
+	/// </summary>
+	inline std::uint32_t floatBits(const float x)
+	{
+		std::uint32_t u;
+		std::memcpy(&u, &x, sizeof u);
+		return u;
+	}
+
+	/// <summary>
+	/// The float with the given bits.
+	/// </summary>
+	inline float bitsToFloat(const std::uint32_t u)
+	{
+		float x;
+		std::memcpy(&x, &u, sizeof x);
+		return x;
+	}
+
+	/// <summary>
+	/// Round a float to the nearest binary16, ties to even. Values beyond the range of binary16 become
+	/// infinities and NaNs stay NaNs.
+	/// </summary>
+	inline std::uint16_t floatToHalf(const float x)
+	{
+		std::uint32_t u{ floatBits(x) };
+		const std::uint32_t sign{ u & 0x80000000u };
+		u ^= sign;
+
+		std::uint32_t h;
+		if (u >= (127u + 16u) << 23)
+		{
+			// 65520 and above round to infinity; NaNs keep a quiet NaN.
+			h = u > 0x7f800000u ? 0x7e00u : 0x7c00u;
+		}
+		else if (u < (127u - 14u) << 23)
+		{
+			// Subnormal or zero: adding 0.5 aligns the 10 bits of the subnormal at the bottom of the mantissa,
+			// and the float addition rounds to nearest even.
+			const float magic{ bitsToFloat((127u - 1u) << 23) };
+			h = floatBits(bitsToFloat(u) + magic) - floatBits(magic);
+		}
+		else
+		{
+			// Rebias the exponent and round the 13 dropped mantissa bits to nearest even.
+			const std::uint32_t odd{ (u >> 13) & 1u };
+			u += ((15u - 127u) << 23) + 0xfffu + odd;
+			h = u >> 13;
+		}
+		return static_cast<std::uint16_t>(h | (sign >> 16));
+	}
+
+	/// <summary>
+	/// The float of a binary16. The conversion is exact.
+	/// </summary>
+	inline float halfToFloat(const std::uint16_t h)
+	{
+		const std::uint32_t sign{ static_cast<std::uint32_t>(h & 0x8000u) << 16 };
+		std::uint32_t u{ static_cast<std::uint32_t>(h & 0x7fffu) << 13 };
+		const std::uint32_t exponent{ u & (0x7c00u << 13) };
+		u += (127u - 15u) << 23;
+		if (exponent == 0x7c00u << 13)
+			u += (128u - 16u) << 23;										// infinity or NaN
+		else if (exponent == 0)
+			u = floatBits(bitsToFloat(u + (1u << 23)) - bitsToFloat(113u << 23));	// subnormal: renormalize
+		return bitsToFloat(u | sign);
+	}
+
+	/// <summary>
+	/// Round a float to the nearest bfloat16, ties to even. NaNs stay (quiet) NaNs.
+	/// </summary>
+	inline std::uint16_t floatToBFloat16(const float x)
+	{
+		const std::uint32_t u{ floatBits(x) };
+		if ((u & 0x7fffffffu) > 0x7f800000u)
+			return static_cast<std::uint16_t>((u >> 16) | 0x40u);
+		return static_cast<std::uint16_t>((u + 0x7fffu + ((u >> 16) & 1u)) >> 16);
+	}
+
+	/// <summary>
+	/// The float of a bfloat16. The conversion is exact.
+	/// </summary>
+	inline float bfloat16ToFloat(const std::uint16_t b)
+	{
+		return bitsToFloat(static_cast<std::uint32_t>(b) << 16);
+	}
+}
+
+/// <summary>
+/// IEEE 754 half precision (binary16) storage type. Converts implicitly to ``float``.
+/// </summary>
+class half
+{
+private:
+	std::uint16_t _bits;
+public:
+	constexpr half() : _bits{} {}
+
+	template<typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+	explicit half(const T x) : _bits{ internal::floatToHalf(static_cast<float>(x)) } {}
+
+	/// <summary>
+	/// The half with the given bit pattern.
+	/// </summary>
+	static constexpr half fromBits(const std::uint16_t bits) { half h; h._bits = bits; return h; }
+
+	constexpr std::uint16_t bits() const { return _bits; }
+	operator float() const { return internal::halfToFloat(_bits); }
+
+	constexpr half operator-() const { return fromBits(static_cast<std::uint16_t>(_bits ^ 0x8000u)); }
+	half& operator+=(const float x) { return *this = half{ float{ *this } + x }; }
+	half& operator-=(const float x) { return *this = half{ float{ *this } - x }; }
+	half& operator*=(const float x) { return *this = half{ float{ *this } * x }; }
+	half& operator/=(const float x) { return *this = half{ float{ *this } / x }; }
+};
+
+/// <summary>
+/// Brain floating-point (bfloat16) storage type: the upper half of a ``float``. Converts implicitly to ``float``.
+/// </summary>
+class bfloat16
+{
+private:
+	std::uint16_t _bits;
+public:
+	constexpr bfloat16() : _bits{} {}
+
+	template<typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+	explicit bfloat16(const T x) : _bits{ internal::floatToBFloat16(static_cast<float>(x)) } {}
+
+	/// <summary>
+	/// The bfloat16 with the given bit pattern.
+	/// </summary>
+	static constexpr bfloat16 fromBits(const std::uint16_t bits) { bfloat16 b; b._bits = bits; return b; }
+
+	constexpr std::uint16_t bits() const { return _bits; }
+	operator float() const { return internal::bfloat16ToFloat(_bits); }
+
+	constexpr bfloat16 operator-() const { return fromBits(static_cast<std::uint16_t>(_bits ^ 0x8000u)); }
+	bfloat16& operator+=(const float x) { return *this = bfloat16{ float{ *this } + x }; }
+	bfloat16& operator-=(const float x) { return *this = bfloat16{ float{ *this } - x }; }
+	bfloat16& operator*=(const float x) { return *this = bfloat16{ float{ *this } * x }; }
+	bfloat16& operator/=(const float x) { return *this = bfloat16{ float{ *this } / x }; }
+};
+
+#endif // !Float16_H
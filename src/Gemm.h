@@ -0,0 +1,451 @@
+#pragma once
+#ifndef Gemm_H
+#define Gemm_H
+
+#include <algorithm>
+#include <vector>
+#include <type_traits>
+#include "Simd.h"
+#include "ThreadPool.h"
+
+/// General matrix-matrix multiplication (GEMM).
+//
+/// Computes \f$C := \alpha A B + \beta C\f$ for row-major operands addressed through raw pointers
+/// and leading dimensions, so the same kernel serves whole matrices and sub-blocks of larger ones.
+///
+/// For floating-point scalars the product is computed the way high-performance BLAS libraries do it:
+/// - The k dimension is split into panels of ``KC`` elements and the n dimension into panels of ``NC``
+///   columns; the corresponding slice of B is packed into contiguous ``KC x NR`` micro-panels
+///   that stay resident in the L2/L3 cache.
+/// - The m dimension is split into blocks of ``MC`` rows; each block of A is packed into ``MR x KC``
+///   micro-panels that stay resident in the L1/L2 cache.
+/// - A register-tiled micro-kernel multiplies one ``MR x KC`` micro-panel of A with one ``KC x NR``
+///   micro-panel of B, keeping the ``MR x NR`` tile of C in registers for the whole k loop.
+///
+/// The micro-kernels of ``float`` and ``double`` are written with the SSE2, AVX2 and AVX-512 registers of
+/// Simd.h (see GemmKernels.inl), and the one matching ``simdLevel()`` is selected at runtime together with
+/// its register tile: 6 x 4 doubles with SSE2, 6 x 8 with AVX2 and 14 x 16 with AVX-512. Other scalar
+/// types, and the scalar level, use a portable kernel over a fixed-size accumulator array.
+///
+/// Integral scalars fall back to a straightforward i-k-j loop over the raw storage.
+///
+/// A and B may be stored in other types than C, as in a ``float`` product accumulated in ``double`` or a
+/// ``half`` (see Float16.h) product accumulated in ``float``: their coefficients are converted to the
+/// scalar type of C while they are packed, so the conversion costs O(mk + kn) and the micro-kernel
+/// always runs in the wider type, reading the narrower storage from memory.
+///
+/// Large products are split into tiles of C, by rows if C is at least as tall as it is wide and by
+/// columns otherwise, and the tiles are computed on the library thread pool (see ThreadPool.h).
+/// Each thread packs into its own workspace.
+
+namespace internal
+{
+	/// <summary>
+	/// Cache and register blocking parameters of the GEMM kernel for a given scalar type.
+	/// ``MR x NR`` is the register tile of C, ``MC x KC`` the packed block of A and ``KC x NC``
+	/// the packed block of B.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	template<typename scalarType>
+	struct GemmBlocking
+	{
+		static constexpr int MR = 4;
+		static constexpr int NR = 8;
+		static constexpr int MC = 128;
+		static constexpr int KC = 256;
+		static constexpr int NC = 2048;
+	};
+
+	template<>
+	struct GemmBlocking<float>
+	{
+		static constexpr int MR = 4;
+		static constexpr int NR = 8;
+		static constexpr int MC = 128;
+		static constexpr int KC = 384;
+		static constexpr int NC = 2048;
+	};
+
+	/// <summary>
+	/// Per-thread scratch space for the packed panels, so that repeated products do not hit the heap.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	template<typename scalarType>
+	struct GemmWorkspace
+	{
+		std::vector<scalarType> packedA;
+		std::vector<scalarType> packedB;
+
+		static GemmWorkspace& local()
+		{
+			thread_local GemmWorkspace workspace;
+			return workspace;
+		}
+	};
+
+	/// <summary>
+	/// Pack an ``mc x kc`` block of A into micro-panels of ``MR`` rows. Within a micro-panel, the
+	/// ``MR`` entries of each column are contiguous. Rows beyond ``mc`` are zero-padded.
+	/// </summary>
+	template<typename scalarType, int MR, typename TA>
+	void packA(int mc, int kc, const TA* A, int lda, scalarType* buffer)
+	{
+		for (int i{}; i < mc; i += MR)
+		{
+			const int mr{ std::min(MR, mc - i) };
+			for (int p{}; p < kc; ++p)
+			{
+				for (int r{}; r < mr; ++r)
+					buffer[r] = static_cast<scalarType>(A[(i + r) * lda + p]);
+				for (int r{ mr }; r < MR; ++r)
+					buffer[r] = scalarType{};
+				buffer += MR;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Pack a ``kc x nc`` block of B into micro-panels of ``NR`` columns. Within a micro-panel, the
+	/// ``NR`` entries of each row are contiguous. Columns beyond ``nc`` are zero-padded.
+	/// </summary>
+	template<typename scalarType, int NR, typename TB>
+	void packB(int kc, int nc, const TB* B, int ldb, scalarType* buffer)
+	{
+		for (int j{}; j < nc; j += NR)
+		{
+			const int nr{ std::min(NR, nc - j) };
+			for (int p{}; p < kc; ++p)
+			{
+				const TB* b{ B + p * ldb + j };
+				for (int c{}; c < nr; ++c)
+					buffer[c] = static_cast<scalarType>(b[c]);
+				for (int c{ nr }; c < NR; ++c)
+					buffer[c] = scalarType{};
+				buffer += NR;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Portable micro-kernel. Multiplies a packed ``MR x kc`` micro-panel of A with a packed
+	/// ``kc x NR`` micro-panel of B and merges the result into the ``mr x nr`` tile of C.
+	/// The accumulator has compile-time extents, so that the compiler may keep it in registers.
+	/// </summary>
+	template<typename scalarType, int MR, int NR>
+	void microKernel(int kc, const scalarType* a, const scalarType* b, scalarType alpha, scalarType beta,
+		scalarType* C, int ldc, int mr, int nr)
+	{
+		scalarType ab[MR][NR]{};
+
+		for (int p{}; p < kc; ++p)
+		{
+			for (int r{}; r < MR; ++r)
+			{
+				const scalarType a_rp{ a[r] };
+				for (int c{}; c < NR; ++c)
+					ab[r][c] += a_rp * b[c];
+			}
+			a += MR;
+			b += NR;
+		}
+
+		if (beta == scalarType{})
+		{
+			for (int r{}; r < mr; ++r)
+				for (int c{}; c < nr; ++c)
+					C[r * ldc + c] = alpha * ab[r][c];
+		}
+		else
+		{
+			for (int r{}; r < mr; ++r)
+				for (int c{}; c < nr; ++c)
+					C[r * ldc + c] = alpha * ab[r][c] + beta * C[r * ldc + c];
+		}
+	}
+
+	/// <summary>
+	/// Register tile of the portable micro-kernel.
+	/// </summary>
+	template<typename scalarType>
+	struct GemmPortableTile
+	{
+		static constexpr int MR = GemmBlocking<scalarType>::MR;
+		static constexpr int NR = GemmBlocking<scalarType>::NR;
+
+		static void kernel(int kc, const scalarType* a, const scalarType* b, scalarType alpha, scalarType beta,
+			scalarType* C, int ldc, int mr, int nr)
+		{
+			microKernel<scalarType, MR, NR>(kc, a, b, alpha, beta, C, ldc, mr, nr);
+		}
+	};
+
+#ifdef MATHLIB_X86
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+	namespace sse2
+	{
+		constexpr int vectorRegisters{ 16 };
+#include "GemmKernels.inl"
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+	namespace avx2
+	{
+		constexpr int vectorRegisters{ 16 };
+#include "GemmKernels.inl"
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+	namespace avx512
+	{
+		constexpr int vectorRegisters{ 32 };
+#include "GemmKernels.inl"
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif // MATHLIB_X86
+
+	/// <summary>
+	/// Call f with the register tile (``MR``, ``NR`` and ``kernel``) of the current instruction set level.
+	/// </summary>
+	template<typename scalarType, typename F>
+	void withGemmTile(F&& f)
+	{
+#ifdef MATHLIB_X86
+		if constexpr (std::is_same<scalarType, float>::value || std::is_same<scalarType, double>::value)
+		{
+			switch (simdLevel())
+			{
+			case SimdLevel::AVX512:
+				return f(avx512::GemmTile<scalarType>{});
+			case SimdLevel::AVX2:
+				return f(avx2::GemmTile<scalarType>{});
+			case SimdLevel::SSE2:
+				return f(sse2::GemmTile<scalarType>{});
+			default:
+				break;
+			}
+		}
+#endif
+		f(GemmPortableTile<scalarType>{});
+	}
+
+	/// <summary>
+	/// Scale the ``m x n`` matrix C by beta. A zero beta overwrites C, so that NaNs in an
+	/// uninitialized output do not propagate.
+	/// </summary>
+	template<typename scalarType>
+	void scaleC(int m, int n, scalarType beta, scalarType* C, int ldc)
+	{
+		if (beta == scalarType{ 1 })
+			return;
+
+		for (int i{}; i < m; ++i)
+		{
+			scalarType* c{ C + i * ldc };
+			if (beta == scalarType{})
+				std::fill(c, c + n, scalarType{});
+			else
+				for (int j{}; j < n; ++j)
+					c[j] *= beta;
+		}
+	}
+
+	/// <summary>
+	/// Reference i-k-j product over the raw storage. Used for integral scalars and for products
+	/// too small to amortize the cost of packing.
+	/// </summary>
+	template<typename scalarType, typename TA, typename TB>
+	void gemmSimple(int m, int n, int k, scalarType alpha, const TA* A, int lda,
+		const TB* B, int ldb, scalarType beta, scalarType* C, int ldc)
+	{
+		scaleC(m, n, beta, C, ldc);
+
+		for (int i{}; i < m; ++i)
+		{
+			scalarType* c{ C + i * ldc };
+			for (int p{}; p < k; ++p)
+			{
+				const scalarType a_ip{ alpha * static_cast<scalarType>(A[i * lda + p]) };
+				const TB* b{ B + p * ldb };
+				for (int j{}; j < n; ++j)
+					c[j] += a_ip * static_cast<scalarType>(b[j]);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Packed, cache-blocked product with the micro-kernel of a given register tile. The blocks of A are a
+	/// whole number of micro-panels.
+	/// </summary>
+	template<typename Tile, typename scalarType, typename TA, typename TB>
+	void gemmPanels(int m, int n, int k, scalarType alpha, const TA* A, int lda,
+		const TB* B, int ldb, scalarType beta, scalarType* C, int ldc)
+	{
+		using Blocking = GemmBlocking<scalarType>;
+		constexpr int MR{ Tile::MR };
+		constexpr int NR{ Tile::NR };
+		constexpr int MC{ Blocking::MC / MR * MR };
+		constexpr int KC{ Blocking::KC };
+		constexpr int NC{ Blocking::NC };
+
+		GemmWorkspace<scalarType>& workspace{ GemmWorkspace<scalarType>::local() };
+		const std::size_t sizeA{ static_cast<std::size_t>(MC) * KC };
+		const std::size_t sizeB{ static_cast<std::size_t>(KC) * (std::min(NC, n) + NR) };
+		if (workspace.packedA.size() < sizeA)
+			workspace.packedA.resize(sizeA);
+		if (workspace.packedB.size() < sizeB)
+			workspace.packedB.resize(sizeB);
+		scalarType* packedA{ workspace.packedA.data() };
+		scalarType* packedB{ workspace.packedB.data() };
+
+		for (int jc{}; jc < n; jc += NC)
+		{
+			const int nc{ std::min(NC, n - jc) };
+			for (int pc{}; pc < k; pc += KC)
+			{
+				const int kc{ std::min(KC, k - pc) };
+				// Only the first pass over k applies the caller's beta; later passes accumulate.
+				const scalarType betaPanel{ pc == 0 ? beta : scalarType{ 1 } };
+				packB<scalarType, NR>(kc, nc, B + pc * ldb + jc, ldb, packedB);
+
+				for (int ic{}; ic < m; ic += MC)
+				{
+					const int mc{ std::min(MC, m - ic) };
+					packA<scalarType, MR>(mc, kc, A + ic * lda + pc, lda, packedA);
+
+					for (int jr{}; jr < nc; jr += NR)
+					{
+						const int nr{ std::min(NR, nc - jr) };
+						const scalarType* b{ packedB + jr * kc };
+						for (int ir{}; ir < mc; ir += MR)
+						{
+							const int mr{ std::min(MR, mc - ir) };
+							Tile::kernel(kc, packedA + ir * kc, b, alpha, betaPanel, C + (ic + ir) * ldc + jc + jr, ldc, mr, nr);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Packed, cache-blocked product for floating-point scalars, with the micro-kernel of the current
+	/// instruction set level.
+	/// </summary>
+	template<typename scalarType, typename TA, typename TB>
+	void gemmBlocked(int m, int n, int k, scalarType alpha, const TA* A, int lda,
+		const TB* B, int ldb, scalarType beta, scalarType* C, int ldc)
+	{
+		withGemmTile<scalarType>([&](auto tile) {
+			gemmPanels<decltype(tile)>(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+		});
+	}
+
+	/// <summary>
+	/// Parallel product: C is cut into independent row (or column) tiles, each computed by ``gemmBlocked``.
+	/// Tiles are a whole number of register tiles and small enough to give every thread a few of them,
+	/// so that work stealing can even out the load.
+	/// </summary>
+	template<typename scalarType, typename TA, typename TB>
+	void gemmParallel(int m, int n, int k, scalarType alpha, const TA* A, int lda,
+		const TB* B, int ldb, scalarType beta, scalarType* C, int ldc)
+	{
+		withGemmTile<scalarType>([&](auto registerTile) {
+			using Tile = decltype(registerTile);
+			using Blocking = GemmBlocking<scalarType>;
+			const int threads{ threadCount() };
+
+			if (m >= n)
+			{
+				const int rowsPerThread{ (m - 1) / (2 * threads) + 1 };
+				const int tile{ std::min(Blocking::MC / Tile::MR * Tile::MR, std::max(4 * Tile::MR, (rowsPerThread + Tile::MR - 1) / Tile::MR * Tile::MR)) };
+				parallelFor(0, m, tile, [&](int first, int last) {
+					gemmPanels<Tile>(last - first, n, k, alpha, A + first * lda, lda, B, ldb, beta, C + first * ldc, ldc);
+				});
+			}
+			else
+			{
+				const int colsPerThread{ (n - 1) / (2 * threads) + 1 };
+				const int tile{ std::min(Blocking::NC, std::max(8 * Tile::NR, (colsPerThread + Tile::NR - 1) / Tile::NR * Tile::NR)) };
+				parallelFor(0, n, tile, [&](int first, int last) {
+					gemmPanels<Tile>(m, last - first, k, alpha, A, lda, B + first, ldb, beta, C + first, ldc);
+				});
+			}
+		});
+	}
+}
+
+/// <summary>
+/// General matrix-matrix multiplication \f$C := \alpha A B + \beta C\f$.
+/// A is an ``m x k`` matrix, B is a ``k x n`` matrix and C is an ``m x n`` matrix, all stored row-major,
+/// with consecutive rows ``lda``, ``ldb`` and ``ldc`` elements apart. When beta is zero, C need
+/// not be initialized. A and B may be stored in narrower types than C; the product is accumulated in
+/// the scalar type of C.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <typeparam name="TA"></typeparam>
+/// <typeparam name="TB"></typeparam>
+template<typename scalarType, typename TA, typename TB>
+void gemm(int m, int n, int k, scalarType alpha, const TA* A, int lda,
+	const TB* B, int ldb, scalarType beta, scalarType* C, int ldc)
+{
+	if (m <= 0 || n <= 0)
+		return;
+
+	if (k <= 0 || alpha == scalarType{})
+	{
+		internal::scaleC(m, n, beta, C, ldc);
+		return;
+	}
+
+	// Packing costs O(mk + kn); below this volume it is not recovered by the faster inner loop.
+	constexpr long long smallProduct{ 32LL * 32 * 32 };
+	// Below this volume a product takes a few tens of microseconds, comparable to waking the workers.
+	constexpr long long parallelProduct{ 128LL * 128 * 128 };
+	if constexpr (std::is_floating_point<scalarType>::value)
+	{
+		const long long volume{ static_cast<long long>(m) * n * k };
+		if (volume > parallelProduct && threadCount() > 1)
+		{
+			internal::gemmParallel(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+			return;
+		}
+		if (volume > smallProduct)
+		{
+			internal::gemmBlocked(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+			return;
+		}
+	}
+
+	internal::gemmSimple(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+#endif // !Gemm_H
@@ -0,0 +1,176 @@
+// GemmKernels.inl : Register micro-kernels of the packed matrix product.
+//
+// Like SimdKernels.inl, this file is compiled once per instruction set: Gemm.h includes it inside each
+// namespace of Simd.h that defines ``Vec<T>``, after defining ``vectorRegisters``, the number of vector
+// registers of that instruction set. For that reason this file has no include guard.
+//
+// The micro-kernel computes one ``MR x NR`` tile of C from a packed ``MR x kc`` micro-panel of A, whose
+// MR coefficients of each column are contiguous, and a packed ``kc x NR`` micro-panel of B, whose NR
+// coefficients of each row are contiguous (see ``packA`` and ``packB``). A row of the tile is two registers
+// wide; the ``2 * MR`` accumulators, the two registers of a row of B and one broadcast coefficient of A fill
+// the register file without spilling.
+
+/// <summary>
+/// One step of the k loop for one row of the tile: ``c += a * b0`` and ``d += a * b1``, with a broadcast.
+/// </summary>
+template<typename T>
+inline void gemmUpdateRow(T a, typename Vec<T>::reg b0, typename Vec<T>::reg b1, typename Vec<T>::reg& c, typename Vec<T>::reg& d)
+{
+	using V = Vec<T>;
+	const typename V::reg ar{ V::set1(a) };
+	c = V::fmadd(ar, b0, c);
+	d = V::fmadd(ar, b1, d);
+}
+
+/// <summary>
+/// Merge the two accumulators of a row of the tile into the first nr coefficients of a row of C:
+/// ``C := alpha * (c, d) + beta * C``. A zero beta overwrites C. Rows cut by the right edge of C go through
+/// memory, so that only the coefficients inside the matrix are touched.
+/// </summary>
+template<typename T>
+void gemmStoreRow(T* C, T alpha, T beta, int nr, typename Vec<T>::reg c, typename Vec<T>::reg d)
+{
+	using V = Vec<T>;
+	const typename V::reg va{ V::set1(alpha) };
+	if (nr == 2 * V::width)
+	{
+		if (beta == T{})
+		{
+			V::store(C, V::mul(va, c));
+			V::store(C + V::width, V::mul(va, d));
+		}
+		else
+		{
+			const typename V::reg vb{ V::set1(beta) };
+			V::store(C, V::fmadd(va, c, V::mul(vb, V::load(C))));
+			V::store(C + V::width, V::fmadd(va, d, V::mul(vb, V::load(C + V::width))));
+		}
+		return;
+	}
+
+	T row[2 * V::width];
+	V::store(row, V::mul(va, c));
+	V::store(row + V::width, V::mul(va, d));
+	for (int j{}; j < nr; ++j)
+		C[j] = beta == T{} ? row[j] : row[j] + beta * C[j];
+}
+
+/// <summary>
+/// ``C := alpha * A B + beta * C`` for the ``mr x nr`` top-left corner of an ``MR x NR`` tile, NR being two
+/// registers. The accumulators are named registers: ``ci`` and ``di`` hold the row i of the tile, and the
+/// rows beyond MR are compiled out. For every k, the row k of the micro-panel of B is loaded once into
+/// ``b0`` and ``b1``, and each coefficient of the column k of A is broadcast and multiplied into its row with
+/// two FMAs.
+/// </summary>
+template<typename T, int MR>
+void gemmMicroKernel(int kc, const T* a, const T* b, T alpha, T beta, T* C, int ldc, int mr, int nr)
+{
+	static_assert(MR >= 1 && MR <= 14, "the micro-kernel has 14 rows of accumulators");
+	using V = Vec<T>;
+	using reg = typename V::reg;
+
+	[[maybe_unused]] reg c0{ V::zero() }, d0{ V::zero() };
+	[[maybe_unused]] reg c1{ V::zero() }, d1{ V::zero() };
+	[[maybe_unused]] reg c2{ V::zero() }, d2{ V::zero() };
+	[[maybe_unused]] reg c3{ V::zero() }, d3{ V::zero() };
+	[[maybe_unused]] reg c4{ V::zero() }, d4{ V::zero() };
+	[[maybe_unused]] reg c5{ V::zero() }, d5{ V::zero() };
+	[[maybe_unused]] reg c6{ V::zero() }, d6{ V::zero() };
+	[[maybe_unused]] reg c7{ V::zero() }, d7{ V::zero() };
+	[[maybe_unused]] reg c8{ V::zero() }, d8{ V::zero() };
+	[[maybe_unused]] reg c9{ V::zero() }, d9{ V::zero() };
+	[[maybe_unused]] reg c10{ V::zero() }, d10{ V::zero() };
+	[[maybe_unused]] reg c11{ V::zero() }, d11{ V::zero() };
+	[[maybe_unused]] reg c12{ V::zero() }, d12{ V::zero() };
+	[[maybe_unused]] reg c13{ V::zero() }, d13{ V::zero() };
+
+	for (int p{}; p < kc; ++p, a += MR, b += 2 * V::width)
+	{
+		const reg b0{ V::load(b) };
+		const reg b1{ V::load(b + V::width) };
+		gemmUpdateRow<T>(a[0], b0, b1, c0, d0);
+		if constexpr (MR > 1)
+			gemmUpdateRow<T>(a[1], b0, b1, c1, d1);
+		if constexpr (MR > 2)
+			gemmUpdateRow<T>(a[2], b0, b1, c2, d2);
+		if constexpr (MR > 3)
+			gemmUpdateRow<T>(a[3], b0, b1, c3, d3);
+		if constexpr (MR > 4)
+			gemmUpdateRow<T>(a[4], b0, b1, c4, d4);
+		if constexpr (MR > 5)
+			gemmUpdateRow<T>(a[5], b0, b1, c5, d5);
+		if constexpr (MR > 6)
+			gemmUpdateRow<T>(a[6], b0, b1, c6, d6);
+		if constexpr (MR > 7)
+			gemmUpdateRow<T>(a[7], b0, b1, c7, d7);
+		if constexpr (MR > 8)
+			gemmUpdateRow<T>(a[8], b0, b1, c8, d8);
+		if constexpr (MR > 9)
+			gemmUpdateRow<T>(a[9], b0, b1, c9, d9);
+		if constexpr (MR > 10)
+			gemmUpdateRow<T>(a[10], b0, b1, c10, d10);
+		if constexpr (MR > 11)
+			gemmUpdateRow<T>(a[11], b0, b1, c11, d11);
+		if constexpr (MR > 12)
+			gemmUpdateRow<T>(a[12], b0, b1, c12, d12);
+		if constexpr (MR > 13)
+			gemmUpdateRow<T>(a[13], b0, b1, c13, d13);
+	}
+
+	gemmStoreRow<T>(C, alpha, beta, nr, c0, d0);
+	if constexpr (MR > 1)
+		if (mr > 1)
+			gemmStoreRow<T>(C + 1 * ldc, alpha, beta, nr, c1, d1);
+	if constexpr (MR > 2)
+		if (mr > 2)
+			gemmStoreRow<T>(C + 2 * ldc, alpha, beta, nr, c2, d2);
+	if constexpr (MR > 3)
+		if (mr > 3)
+			gemmStoreRow<T>(C + 3 * ldc, alpha, beta, nr, c3, d3);
+	if constexpr (MR > 4)
+		if (mr > 4)
+			gemmStoreRow<T>(C + 4 * ldc, alpha, beta, nr, c4, d4);
+	if constexpr (MR > 5)
+		if (mr > 5)
+			gemmStoreRow<T>(C + 5 * ldc, alpha, beta, nr, c5, d5);
+	if constexpr (MR > 6)
+		if (mr > 6)
+			gemmStoreRow<T>(C + 6 * ldc, alpha, beta, nr, c6, d6);
+	if constexpr (MR > 7)
+		if (mr > 7)
+			gemmStoreRow<T>(C + 7 * ldc, alpha, beta, nr, c7, d7);
+	if constexpr (MR > 8)
+		if (mr > 8)
+			gemmStoreRow<T>(C + 8 * ldc, alpha, beta, nr, c8, d8);
+	if constexpr (MR > 9)
+		if (mr > 9)
+			gemmStoreRow<T>(C + 9 * ldc, alpha, beta, nr, c9, d9);
+	if constexpr (MR > 10)
+		if (mr > 10)
+			gemmStoreRow<T>(C + 10 * ldc, alpha, beta, nr, c10, d10);
+	if constexpr (MR > 11)
+		if (mr > 11)
+			gemmStoreRow<T>(C + 11 * ldc, alpha, beta, nr, c11, d11);
+	if constexpr (MR > 12)
+		if (mr > 12)
+			gemmStoreRow<T>(C + 12 * ldc, alpha, beta, nr, c12, d12);
+	if constexpr (MR > 13)
+		if (mr > 13)
+			gemmStoreRow<T>(C + 13 * ldc, alpha, beta, nr, c13, d13);
+}
+
+/// <summary>
+/// Register tile of the micro-kernel: two registers per row of C, and as many rows as the register file
+/// holds after the row of B, the broadcast coefficient of A and a temporary.
+/// </summary>
+template<typename T>
+struct GemmTile
+{
+	static constexpr int MR = (vectorRegisters - 4) / 2;
+	static constexpr int NR = 2 * Vec<T>::width;
+
+	static void kernel(int kc, const T* a, const T* b, T alpha, T beta, T* C, int ldc, int mr, int nr)
+	{
+		gemmMicroKernel<T, MR>(kc, a, b, alpha, beta, C, ldc, mr, nr);
+	}
+};
@@ -5,6 +5,15 @@
 
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include "BusinessDayConventions.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -15,6 +24,108 @@ typedef boost::gregorian::date::year_type year_type;
 typedef boost::gregorian::date::month_type month_type;
 typedef boost::gregorian::date::day_type day_type;
 
+namespace internal
+{
+	/// <summary>
+	/// Number of set bits of x.
+	/// </summary>
+	inline int popcount(const std::uint64_t x)
+	{
+		return static_cast<int>(std::bitset<64>{ x }.count());
+	}
+
+	/// <summary>
+	/// Position of the lowest set bit of x, which is not 0.
+	/// </summary>
+	inline int lowestBit(const std::uint64_t x)
+	{
+		return popcount((x & (0 - x)) - 1);
+	}
+
+	/// <summary>
+	/// Position of the highest set bit of x, which is not 0.
+	/// </summary>
+	inline int highestBit(std::uint64_t x)
+	{
+		x |= x >> 1;
+		x |= x >> 2;
+		x |= x >> 4;
+		x |= x >> 8;
+		x |= x >> 16;
+		x |= x >> 32;
+		return popcount(x) - 1;
+	}
+
+	/// <summary>
+	/// The 64 bits of a bitmap from bit n: bit i of the result is bit n + i of the bitmap, whose word
+	/// n / 64 + 1 must exist.
+	/// </summary>
+	inline std::uint64_t bitWindow(const std::uint64_t* words, const std::uint32_t n)
+	{
+		const std::uint32_t shift{ n & 63 };
+		return (words[n >> 6] >> shift) | ((words[(n >> 6) + 1] << 1) << (63 - shift));
+	}
+
+	/// <summary>
+	/// Positions of the set bits of every byte: ``selectInByte.position[b][k]`` is the k-th set bit of b.
+	/// </summary>
+	struct SelectInByte
+	{
+		std::uint8_t position[256][8];
+
+		constexpr SelectInByte() : position{}
+		{
+			for (int b{}; b < 256; ++b)
+				for (int i{}, k{}; i < 8; ++i)
+					if ((b >> i) & 1)
+						position[b][k++] = static_cast<std::uint8_t>(i);
+		}
+	};
+
+	inline constexpr SelectInByte selectInByte{};
+
+	/// <summary>
+	/// Position of the k-th (from 0) set bit of x, which has more than k set bits. The byte that holds it is
+	/// found without branches from the running bit counts of the bytes (Vigna, "Broadword implementation of
+	/// rank/select queries"), so that the time does not depend on k.
+	/// </summary>
+	inline int selectBit(const std::uint64_t x, const int k)
+	{
+		constexpr std::uint64_t ones{ 0x0101010101010101ull };
+		constexpr std::uint64_t highs{ 0x8080808080808080ull };
+
+		// Byte i of counts is the number of set bits in bytes 0 to i of x.
+		std::uint64_t counts{ x - ((x >> 1) & 0x5555555555555555ull) };
+		counts = (counts & 0x3333333333333333ull) + ((counts >> 2) & 0x3333333333333333ull);
+		counts = ((counts + (counts >> 4)) & 0x0f0f0f0f0f0f0f0full) * ones;
+
+		// The bytes whose running count is at most k precede the byte of the k-th set bit.
+		const int byte{ popcount(((static_cast<std::uint64_t>(k) * ones | highs) - counts) & highs) };
+		const int before{ static_cast<int>(((counts << 8) >> (8 * byte)) & 0xff) };
+		return 8 * byte + selectInByte.position[(x >> (8 * byte)) & 0xff][k - before];
+	}
+
+	/// <summary>
+	/// Month of a day number, counted from March (0) to February (11): two dates less than a year apart
+	/// are in the same month if they have the same index. The civil calendar arithmetic of H. Hinnant,
+	/// "chrono-Compatible Low-Level Date Algorithms", without branches.
+	/// </summary>
+	inline std::uint32_t monthIndex(const std::uint32_t dayNumber)
+	{
+		// Day 0 is 1 March of year 0 (Julian day number 1721120); the cycle of the Gregorian calendar is
+		// 146097 days.
+		const std::uint32_t dayOfEra{ (dayNumber - 1721120) % 146097 };
+		const std::uint32_t yearOfEra{ (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365 };
+		const std::uint32_t dayOfYear{ dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100) };
+		return (5 * dayOfYear + 2) / 153;
+	}
+
+	inline std::uint32_t dayNumberOf(const date& d) { return d.day_number(); }
+	inline std::uint32_t dayNumberOf(const std::uint32_t dayNumber) { return dayNumber; }
+	inline date withDayNumber(const date& d, const std::uint32_t dayNumber) { return d + days(static_cast<std::int64_t>(dayNumber) - d.day_number()); }
+	inline std::uint32_t withDayNumber(std::uint32_t, const std::uint32_t dayNumber) { return dayNumber; }
+}
+
 enum class HolidayCalendarId
 {
 	GBLO, // London(UK) Holidays
@@ -35,7 +146,32 @@ enum class HolidayCalendarId
 /// for individual exchanges or other financial entities to have their own calendar.
 
 /// When a HolidayCalendar instance is created, an internal holidays vector is populated with the 
-/// different holiday dates for the specified country.
+/// different holiday dates for the specified country. The calendar is then compiled into a bitmap with
+/// one bit per day, set for business days, covering at least the years 1950 to 2099 (and every year
+/// with a holiday). ``isHoliday`` and ``isBusinessDay`` test a single bit, in constant time whatever the
+/// number of holidays; outside the bitmap, only weekends are holidays.
+///
+/// The bitmap is indexed by the number of business days before each 64-day word, so that business day
+/// arithmetic is constant-time as well: ``businessDaysBetween`` subtracts two such counts, and
+/// ``addBusinessDays``, ``nextBusinessDay`` and ``previousBusinessDay`` find the business day with a given
+/// count, instead of stepping through the dates one by one.
+///
+/// Adjusting a date is a lookup as well: the following (preceding) business day is the lowest (highest) set
+/// bit of the 64 days of the bitmap from (up to) the date, and whether it is in another month is read from a
+/// second bitmap of the first days of the months. The bulk ``adjust`` overloads adjust a whole array of dates,
+/// or of day numbers, with the convention chosen once for the array rather than tested for every date, in
+/// parallel chunks (see ThreadPool.h).
+///
+/// Cross-currency trades need joint calendars. ``a + b`` (``combinedWith``) is the calendar whose holidays
+/// are those of either a or b, such as ``GBLO+NYSE`` for days that are business days in both London and
+/// New York; ``a | b`` (``linkedWith``) is the calendar whose business days are those of either calendar.
+/// The bitmap of a joint calendar is the AND or the OR of those of its calendars, computed once when it is
+/// built, so that it answers every query as fast as a single calendar.
+///
+/// Building a calendar generates its holidays for 150 years, and copying it copies them. Services should
+/// rather ask the registry, ``holidayCalendar(HolidayCalendarId::GBLO)`` or ``holidayCalendar("GBLO+NYSE")``:
+/// it builds each calendar once, on first use, and then hands out shared handles on the same immutable
+/// calendar to every thread, without locking.
 
 /// My naive implementation of HolidayCalendars is inspired by the open-source pricing and risk 
 /// analytics library, OpenGamma. See here : 
@@ -62,6 +198,68 @@ private:
 	/// A unique calendar identifier e.g. NYSE, GBLO, EUTA(Target).
 	/// </summary>
 	HolidayCalendarId holidayCalendarId;						
+
+	/// <summary>
+	/// Name of the calendar: that of its identifier, or e.g. GBLO+NYSE for a joint calendar.
+	/// </summary>
+	string name;
+
+	/// <summary>
+	/// Weekend days, as a mask of bits indexed by day of the week (Sunday is 0). A joint calendar may have
+	/// more than two weekend days.
+	/// </summary>
+	std::uint8_t weekendDays{};
+
+	/// <summary>
+	/// Business days, one bit per day from ``firstDayNumber``: bit ``n % 64`` of ``businessDays[n / 64]``
+	/// is set if the day number ``firstDayNumber + n`` is a business day.
+	/// </summary>
+	vector<std::uint64_t> businessDays;
+
+	/// <summary>
+	/// Day number (see ``date::day_number()``) of the first day of the bitmap, and number of days in it.
+	/// </summary>
+	std::uint32_t firstDayNumber{};
+	std::uint32_t dayCount{};
+
+	/// <summary>
+	/// Cumulative index of the bitmap: ``businessDaysBefore[w]`` business days precede the word ``w``, and
+	/// ``wordOfRank[j]`` is the word that holds the business day preceded by ``64 * j`` others.
+	/// </summary>
+	vector<std::uint32_t> businessDaysBefore;
+	vector<std::uint32_t> wordOfRank;
+
+	/// <summary>
+	/// First days of the months, one bit per day like ``businessDays``.
+	/// </summary>
+	vector<std::uint64_t> monthStarts;
+
+	/// <summary>
+	/// Compile the weekend days and the holidays into the business day bitmap and its index.
+	/// </summary>
+	void buildBusinessDayIndex();
+	void indexBusinessDays();
+
+	HolidayCalendar(const HolidayCalendar& a, const HolidayCalendar& b, bool combined);
+
+	bool isWeekend(std::uint32_t dayNumber) const;
+	bool isBusinessDayNumber(std::uint32_t dayNumber) const;
+	std::int64_t weekdaysBetween(std::uint32_t first, std::uint32_t last) const;
+	std::int64_t businessDayRank(std::uint32_t dayNumber) const;
+	std::uint32_t businessDayOfRank(std::int64_t rank) const;
+	std::uint32_t followingBusinessDay(std::uint32_t dayNumber) const;
+	std::uint32_t precedingBusinessDay(std::uint32_t dayNumber) const;
+	bool monthChanges(std::uint32_t from, std::uint32_t to) const;
+
+	template<businessDayConventions convention>
+	std::uint32_t adjustDayNumber(std::uint32_t dayNumber) const;
+	std::uint32_t adjustDayNumber(std::uint32_t dayNumber, businessDayConventions convention) const;
+
+	template<businessDayConventions convention, typename Day>
+	void adjustRange(const Day* first, Day* result, int n) const;
+
+	template<typename Day>
+	void adjustRange(const Day* first, Day* result, int n, businessDayConventions convention) const;
 public:
 	// Constructors
 	HolidayCalendar();														// Default Constructor
@@ -71,9 +269,11 @@ public:
 
 	//Getters
 	vector<date> getHolidays() const;
-	gregorian_calendar::day_of_week_type getFirstWeekendDay() const;
-	gregorian_calendar::day_of_week_type getSecondWeekendDay() const;
+	gregorian_calendar::day_of_week_type getFirstWeekendDay() const;	// Only meaningful for calendars that are not joint
+	gregorian_calendar::day_of_week_type getSecondWeekendDay() const;	// Only meaningful for calendars that are not joint
+	std::uint8_t getWeekendDays() const;								// Bit d is set if day of the week d (Sunday is 0) is a weekend day
 	HolidayCalendarId getHolidayCalendarId() const;
+	string getName() const;
 
 	//Assignment Operator
 	HolidayCalendar& operator = (const HolidayCalendar& h);
@@ -84,6 +284,12 @@ public:
 	/// </summary>
 	void generateCalendar();
 
+	/// <summary>
+	/// Years always covered by the business day bitmap.
+	/// </summary>
+	static constexpr int firstIndexedYear{ 1950 };
+	static constexpr int lastIndexedYear{ 2099 };
+
 	//Utility functions
 	
 	/// <summary>
@@ -115,41 +321,129 @@ public:
 	void removeSatSun();																		//Remove any saturdays and sundays from the holiday calendar
 
 	/// <summary>
-	/// Scan the holiday calendar to check if a given date is a business holiday.
+	/// Check if a given date is a weekend day or a business holiday, by a lookup in the business day bitmap.
 	/// </summary>
 	/// <param name="d"></param>
 	/// <returns></returns>
-	bool isHoliday(date d);									// Check if a given date is a holiday
-	bool isBusinessDay(date d);								// Check if a given date is a business day
-	date adjust(const date& d, BusinessDayConventions c);	// Find the adjusted date for a given unadjusted date, according to the business day conventions.
+	bool isHoliday(const date& d) const;							// Check if a given date is a holiday
+	bool isBusinessDay(const date& d) const;						// Check if a given date is a business day
+	date adjust(const date& d, BusinessDayConventions c) const;		// Find the adjusted date for a given unadjusted date, according to the business day conventions.
+	void adjust(const date* dates, date* adjusted, int n, BusinessDayConventions c) const;							// Adjust n dates; adjusted may be dates
+	void adjust(const std::uint32_t* dayNumbers, std::uint32_t* adjusted, int n, BusinessDayConventions c) const;	// Adjust n day numbers; adjusted may be dayNumbers
+	void adjust(vector<date>& dates, BusinessDayConventions c) const;												// Adjust dates in place
+
+	int businessDaysBetween(const date& start, const date& end) const;	// Number of business days in [start, end)
+	date addBusinessDays(const date& d, int n) const;					// Move n business days forward (or backward if n < 0)
+	date nextBusinessDay(const date& d) const;							// First business day after d
+	date previousBusinessDay(const date& d) const;						// Last business day before d
+
+	HolidayCalendar combinedWith(const HolidayCalendar& other) const;	// Holidays of either calendar, e.g. GBLO+NYSE
+	HolidayCalendar linkedWith(const HolidayCalendar& other) const;		// Business days of either calendar, e.g. GBLO|EUTA
 };
 
+/// <summary>
+/// The name of a calendar identifier: GBLO, NYSE, EUTA or CUST.
+/// </summary>
+/// <param name="id"></param>
+/// <returns></returns>
+string holidayCalendarName(HolidayCalendarId id)
+{
+	switch (id)
+	{
+	case HolidayCalendarId::GBLO:
+		return "GBLO";
+	case HolidayCalendarId::NYSE:
+		return "NYSE";
+	case HolidayCalendarId::EUTA:
+		return "EUTA";
+	default:
+		return "CUST";
+	}
+}
+
 HolidayCalendar::HolidayCalendar() {
 	//Default holiday calendar
 	firstWeekendDay = greg_weekday{ Saturday };
 	secondWeekendDay = greg_weekday{ Sunday };
 	holidayCalendarId = HolidayCalendarId::CUST;
+	name = holidayCalendarName(holidayCalendarId);
+	buildBusinessDayIndex();
 }
 
 
-HolidayCalendar::HolidayCalendar(HolidayCalendarId id) : holidayCalendarId{ id }
+HolidayCalendar::HolidayCalendar(HolidayCalendarId id) : holidayCalendarId{ id }, name{ holidayCalendarName(id) }
 {
 	generateCalendar();
+	buildBusinessDayIndex();
 }
 
-HolidayCalendar::HolidayCalendar(std::vector<date> h, gregorian_calendar::day_of_week_type f, gregorian_calendar::day_of_week_type s, HolidayCalendarId id) : holidays{ h }, firstWeekendDay{ f }, secondWeekendDay{ s }, holidayCalendarId{ id }
+HolidayCalendar::HolidayCalendar(std::vector<date> h, gregorian_calendar::day_of_week_type f, gregorian_calendar::day_of_week_type s, HolidayCalendarId id) : holidays{ h }, firstWeekendDay{ f }, secondWeekendDay{ s }, holidayCalendarId{ id }, name{ holidayCalendarName(id) }
 {
+	buildBusinessDayIndex();
 }
 
-HolidayCalendar::HolidayCalendar(const HolidayCalendar& h) : HolidayCalendar{ h.holidays, h.firstWeekendDay, h.secondWeekendDay, h.holidayCalendarId }
+HolidayCalendar::HolidayCalendar(const HolidayCalendar& h) = default;
+
+/// <summary>
+/// Joint calendar of a and b: a day is a business day if it is one in both calendars (combined), or in
+/// either of them. The bitmaps are combined word by word when they cover the same days. Throws logic_error if
+/// the weekends of the joint calendar cover the whole week, which would leave it without business days.
+/// </summary>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <param name="combined"></param>
+HolidayCalendar::HolidayCalendar(const HolidayCalendar& a, const HolidayCalendar& b, bool combined) :
+	firstWeekendDay{ a.firstWeekendDay }, secondWeekendDay{ a.secondWeekendDay }, holidayCalendarId{ HolidayCalendarId::CUST }
 {
+	// Joint names are parenthesized where the two operators mix, as in (GBLO|EUTA)+NYSE.
+	const char op{ combined ? '+' : '|' };
+	const char other{ combined ? '|' : '+' };
+	const auto operand{ [other](const string& n) { return n.find(other) == string::npos ? n : "(" + n + ")"; } };
+	name = operand(a.name) + op + operand(b.name);
+	weekendDays = combined ? a.weekendDays | b.weekendDays : a.weekendDays & b.weekendDays;
+	if (weekendDays == 0x7F)
+		throw std::logic_error("Joint calendar " + name + " has no business days: every day of the week is a weekend day");
+
+	firstDayNumber = std::min(a.firstDayNumber, b.firstDayNumber);
+	dayCount = std::max(a.firstDayNumber + a.dayCount, b.firstDayNumber + b.dayCount) - firstDayNumber;
+	businessDays.assign((dayCount + 63) / 64, 0);
+	if (a.firstDayNumber == b.firstDayNumber && a.dayCount == b.dayCount)
+	{
+		for (std::size_t w{}; w < businessDays.size(); ++w)
+			businessDays[w] = combined ? a.businessDays[w] & b.businessDays[w] : a.businessDays[w] | b.businessDays[w];
+	}
+	else
+	{
+		for (std::uint32_t n{}; n < dayCount; ++n)
+		{
+			const bool inA{ a.isBusinessDayNumber(firstDayNumber + n) };
+			const bool inB{ b.isBusinessDayNumber(firstDayNumber + n) };
+			if (combined ? inA && inB : inA || inB)
+				businessDays[n >> 6] |= std::uint64_t{ 1 } << (n & 63);
+		}
+	}
+
+	// The holidays of the joint calendar are the days of the bitmap that are neither business nor weekend days.
+	const date first{ gregorian_calendar::from_day_number(firstDayNumber) };
+	for (std::uint32_t n{}; n < dayCount; ++n)
+		if (!((businessDays[n >> 6] >> (n & 63)) & 1) && !isWeekend(firstDayNumber + n))
+			holidays.push_back(first + days(n));
+
+	indexBusinessDays();
 }
 
+HolidayCalendar& HolidayCalendar::operator=(const HolidayCalendar& h) = default;
+
 vector<date> HolidayCalendar::getHolidays() const
 {
 	return holidays;
 }
 
+/// <summary>
+/// The first weekend day the calendar was built with. A joint calendar keeps those of its first calendar,
+/// which need not be its weekend days: use getWeekendDays for the weekend days of any calendar.
+/// </summary>
+/// <returns></returns>
 gregorian_calendar::day_of_week_type HolidayCalendar::getFirstWeekendDay() const
 {
 	return firstWeekendDay;
@@ -160,11 +454,26 @@ gregorian_calendar::day_of_week_type HolidayCalendar::getSecondWeekendDay() cons
 	return secondWeekendDay;
 }
 
+/// <summary>
+/// The weekend days, as a mask of bits indexed by day of the week: for GBLO, (1 << Saturday) | (1 << Sunday).
+/// A joint calendar may have any number of weekend days but seven.
+/// </summary>
+/// <returns></returns>
+std::uint8_t HolidayCalendar::getWeekendDays() const
+{
+	return weekendDays;
+}
+
 HolidayCalendarId HolidayCalendar::getHolidayCalendarId() const
 {
 	return holidayCalendarId;
 }
 
+string HolidayCalendar::getName() const
+{
+	return name;
+}
+
 void HolidayCalendar::generateCalendar()
 {
 	if (holidayCalendarId == HolidayCalendarId::GBLO)
@@ -254,6 +563,162 @@ void HolidayCalendar::generateCalendar()
 	}
 }
 
+void HolidayCalendar::buildBusinessDayIndex()
+{
+	int firstYear{ firstIndexedYear };
+	int lastYear{ lastIndexedYear };
+	for (const date& h : holidays)
+	{
+		if (h.is_special())
+			continue;
+		firstYear = std::min(firstYear, static_cast<int>(h.year()));
+		lastYear = std::max(lastYear, static_cast<int>(h.year()));
+	}
+
+	const date first{ static_cast<year_type>(firstYear), 1, 1 };
+	const date last{ static_cast<year_type>(lastYear), 12, 31 };
+	firstDayNumber = first.day_number();
+	dayCount = last.day_number() - firstDayNumber + 1;
+	businessDays.assign((dayCount + 63) / 64, 0);
+	weekendDays = static_cast<std::uint8_t>((1 << firstWeekendDay) | (1 << secondWeekendDay));
+
+	for (std::uint32_t n{}; n < dayCount; ++n)
+		if (!isWeekend(firstDayNumber + n))
+			businessDays[n >> 6] |= std::uint64_t{ 1 } << (n & 63);
+	for (const date& h : holidays)
+	{
+		if (h.is_special())
+			continue;
+		const std::uint32_t n{ h.day_number() - firstDayNumber };
+		businessDays[n >> 6] &= ~(std::uint64_t{ 1 } << (n & 63));
+	}
+
+	indexBusinessDays();
+}
+
+/// <summary>
+/// Build the indexes of the business day bitmap: the bitmap of the first days of the months, the number of
+/// business days before each word, and the words of the ranks.
+/// </summary>
+void HolidayCalendar::indexBusinessDays()
+{
+	const date first{ gregorian_calendar::from_day_number(firstDayNumber) };
+	const date last{ first + days(dayCount - 1) };
+	monthStarts.assign(businessDays.size(), 0);
+	for (date d{ first }; d <= last; d += months(1))
+	{
+		const std::uint32_t n{ d.day_number() - firstDayNumber };
+		monthStarts[n >> 6] |= std::uint64_t{ 1 } << (n & 63);
+	}
+
+	businessDaysBefore.assign(businessDays.size() + 1, 0);
+	wordOfRank.clear();
+	for (std::size_t w{}; w < businessDays.size(); ++w)
+	{
+		const std::uint32_t before{ businessDaysBefore[w] };
+		businessDaysBefore[w + 1] = before + internal::popcount(businessDays[w]);
+		while (64 * wordOfRank.size() < businessDaysBefore[w + 1])
+			wordOfRank.push_back(static_cast<std::uint32_t>(w));
+	}
+}
+
+/// <summary>
+/// True if the day with the given day number falls on a weekend day. Day number 0 is a Monday.
+/// </summary>
+/// <param name="dayNumber"></param>
+/// <returns></returns>
+bool HolidayCalendar::isWeekend(std::uint32_t dayNumber) const
+{
+	return (weekendDays >> ((dayNumber + 1) % 7)) & 1;
+}
+
+/// <summary>
+/// True if the day with the given day number is a business day.
+/// </summary>
+/// <param name="dayNumber"></param>
+/// <returns></returns>
+bool HolidayCalendar::isBusinessDayNumber(std::uint32_t dayNumber) const
+{
+	// Dates before the bitmap wrap around to large offsets, so one comparison checks both bounds.
+	const std::uint32_t n{ dayNumber - firstDayNumber };
+	if (n < dayCount)
+		return (businessDays[n >> 6] >> (n & 63)) & 1;
+
+	return !isWeekend(dayNumber);
+}
+
+/// <summary>
+/// Number of days in the day numbers [first, last) that are not weekend days.
+/// </summary>
+/// <param name="first"></param>
+/// <param name="last"></param>
+/// <returns></returns>
+std::int64_t HolidayCalendar::weekdaysBetween(std::uint32_t first, std::uint32_t last) const
+{
+	const std::int64_t weekdaysPerWeek{ 7 - internal::popcount(weekendDays) };
+	const std::uint32_t weeks{ (last - first) / 7 };
+	std::int64_t count{ weeks * weekdaysPerWeek };
+	for (std::uint32_t n{ first + 7 * weeks }; n < last; ++n)
+		count += !isWeekend(n);
+	return count;
+}
+
+/// <summary>
+/// Number of business days from the start of the bitmap up to (excluding) the given day; negative for days
+/// before the bitmap. Two ranks differ by the number of business days between their days.
+/// </summary>
+/// <param name="dayNumber"></param>
+/// <returns></returns>
+std::int64_t HolidayCalendar::businessDayRank(std::uint32_t dayNumber) const
+{
+	if (dayNumber < firstDayNumber)
+		return -weekdaysBetween(dayNumber, firstDayNumber);
+
+	const std::uint32_t n{ dayNumber - firstDayNumber };
+	if (n >= dayCount)
+		return businessDaysBefore.back() + weekdaysBetween(firstDayNumber + dayCount, dayNumber);
+
+	const std::uint64_t earlier{ (std::uint64_t{ 1 } << (n & 63)) - 1 };
+	return businessDaysBefore[n >> 6] + internal::popcount(businessDays[n >> 6] & earlier);
+}
+
+/// <summary>
+/// Day number of the business day of the given rank.
+/// </summary>
+/// <param name="rank"></param>
+/// <returns></returns>
+std::uint32_t HolidayCalendar::businessDayOfRank(std::int64_t rank) const
+{
+	const std::int64_t total{ businessDaysBefore.back() };
+	if (rank >= 0 && rank < total)
+	{
+		// A word holds at least 40 business days except in calendars with long holidays, so the 64 ranks from
+		// the hint span at most two more words; the loop covers the other calendars.
+		std::uint32_t w{ wordOfRank[rank >> 6] };
+		w += businessDaysBefore[w + 1] <= rank;
+		w += businessDaysBefore[w + 1] <= rank;
+		while (businessDaysBefore[w + 1] <= rank)
+			++w;
+		return firstDayNumber + 64 * w + internal::selectBit(businessDays[w], static_cast<int>(rank - businessDaysBefore[w]));
+	}
+
+	// Beyond the bitmap, skip whole weeks and step through the last few days.
+	const std::int64_t weekdaysPerWeek{ 7 - internal::popcount(weekendDays) };
+	if (rank >= total)
+	{
+		std::int64_t k{ rank - total };
+		std::uint32_t n{ static_cast<std::uint32_t>(firstDayNumber + dayCount + k / weekdaysPerWeek * 7) };
+		for (k %= weekdaysPerWeek; ; ++n)
+			if (!isWeekend(n) && k-- == 0)
+				return n;
+	}
+	std::int64_t k{ -rank - 1 };
+	std::uint32_t n{ static_cast<std::uint32_t>(firstDayNumber - 1 - k / weekdaysPerWeek * 7) };
+	for (k %= weekdaysPerWeek; ; --n)
+		if (!isWeekend(n) && k-- == 0)
+			return n;
+}
+
 /// <summary>
 /// The first date in a month that falls on a day of the week, specified by the ``dayOfWeek`` argument.
 /// </summary>
@@ -328,67 +793,277 @@ void HolidayCalendar::removeSatSun()
 
 
 
-bool HolidayCalendar::isHoliday(date d)
+bool HolidayCalendar::isHoliday(const date& d) const
 {
-	if (d.day_of_week() == firstWeekendDay || d.day_of_week() == secondWeekendDay)
-		return true;
-	else
-		return false;
-
-	vector<date>::iterator it;
-	it = find(holidays.begin(), holidays.end(), d);
-	if (it != holidays.end())
-		return true;
-	else
-		return false;
+	return !isBusinessDayNumber(d.day_number());
 }
 
-bool HolidayCalendar::isBusinessDay(date d)
+bool HolidayCalendar::isBusinessDay(const date& d) const
 {
 	return !isHoliday(d);
 }
 
-date HolidayCalendar::adjust(const date& d, BusinessDayConventions c)
+/// <summary>
+/// Number of business days from start (included) to end (excluded); negative if end is before start.
+/// </summary>
+/// <param name="start"></param>
+/// <param name="end"></param>
+/// <returns></returns>
+int HolidayCalendar::businessDaysBetween(const date& start, const date& end) const
 {
-	if (c.getBusDayConvention() == businessDayConventions::NO_ADJUST)
+	return static_cast<int>(businessDayRank(end.day_number()) - businessDayRank(start.day_number()));
+}
+
+/// <summary>
+/// The n-th business day after d, or before d if n is negative; d itself if n is zero. d need not be a
+/// business day: ``addBusinessDays(d, 1)`` is the first business day after d.
+/// </summary>
+/// <param name="d"></param>
+/// <param name="n"></param>
+/// <returns></returns>
+date HolidayCalendar::addBusinessDays(const date& d, int n) const
+{
+	if (n == 0)
 		return d;
 
-	date d1 = d;
-	if (c.getBusDayConvention() == businessDayConventions::FOLLOWING ||
-		c.getBusDayConvention() == businessDayConventions::MODIFIED_FOLLOWING)
+	const std::int64_t rank{ n > 0 ? businessDayRank(d.day_number() + 1) + n - 1 : businessDayRank(d.day_number()) + n };
+	return d + days(static_cast<std::int64_t>(businessDayOfRank(rank)) - d.day_number());
+}
+
+date HolidayCalendar::nextBusinessDay(const date& d) const
+{
+	return addBusinessDays(d, 1);
+}
+
+date HolidayCalendar::previousBusinessDay(const date& d) const
+{
+	return addBusinessDays(d, -1);
+}
+
+/// <summary>
+/// Day number of the first business day on or after the given day.
+/// </summary>
+/// <param name="dayNumber"></param>
+/// <returns></returns>
+std::uint32_t HolidayCalendar::followingBusinessDay(std::uint32_t dayNumber) const
+{
+	// Inside the bitmap, the lowest business day of the 64 days from this one; unsigned arithmetic checks
+	// 64 <= n < dayCount - 64 in one comparison.
+	const std::uint32_t n{ dayNumber - firstDayNumber };
+	if (n - 64 < dayCount - 128)
 	{
-		while (isHoliday(d1))
-			d1 += days(1);
-		if (c.getBusDayConvention() == businessDayConventions::MODIFIED_FOLLOWING)
-		{
-			if (d1.month() != d.month())
-			{
-				BusinessDayConventions preceding{ "Preceding" };
-				adjust(d, preceding);
-			}
+		const std::uint64_t ahead{ internal::bitWindow(businessDays.data(), n) };
+		if (ahead != 0)
+			return dayNumber + internal::lowestBit(ahead);
+	}
+	return businessDayOfRank(businessDayRank(dayNumber));
+}
 
-		}
+/// <summary>
+/// Day number of the last business day on or before the given day.
+/// </summary>
+/// <param name="dayNumber"></param>
+/// <returns></returns>
+std::uint32_t HolidayCalendar::precedingBusinessDay(std::uint32_t dayNumber) const
+{
+	const std::uint32_t n{ dayNumber - firstDayNumber };
+	if (n - 64 < dayCount - 128)
+	{
+		const std::uint64_t behind{ internal::bitWindow(businessDays.data(), n - 63) };
+		if (behind != 0)
+			return dayNumber - 63 + internal::highestBit(behind);
+	}
+	return businessDayOfRank(businessDayRank(dayNumber + 1) - 1);
+}
+
+/// <summary>
+/// True if the two days are in different months, i.e. if a month starts after the earlier day and on or before
+/// the later one.
+/// </summary>
+/// <param name="from"></param>
+/// <param name="to"></param>
+/// <returns></returns>
+bool HolidayCalendar::monthChanges(std::uint32_t from, std::uint32_t to) const
+{
+	const std::uint32_t earlier{ std::min(from, to) };
+	const std::uint32_t distance{ std::max(from, to) - earlier };
+	const std::uint32_t n{ earlier + 1 - firstDayNumber };
+	if (n - 64 < dayCount - 128 && distance < 64)
+		return (internal::bitWindow(monthStarts.data(), n) & ((std::uint64_t{ 1 } << distance) - 1)) != 0;
+	return internal::monthIndex(from) != internal::monthIndex(to);
+}
+
+/// <summary>
+/// Adjust a day number according to a business day convention known at compile time. The modified conventions
+/// only look for the other business day when the first one is in another month, which is rare enough to be
+/// predicted.
+/// </summary>
+/// <param name="dayNumber"></param>
+/// <returns></returns>
+template<businessDayConventions convention>
+std::uint32_t HolidayCalendar::adjustDayNumber(std::uint32_t dayNumber) const
+{
+	if constexpr (convention == businessDayConventions::FOLLOWING)
+		return followingBusinessDay(dayNumber);
+	else if constexpr (convention == businessDayConventions::PRECEDING)
+		return precedingBusinessDay(dayNumber);
+	else if constexpr (convention == businessDayConventions::MODIFIED_FOLLOWING)
+	{
+		const std::uint32_t following{ followingBusinessDay(dayNumber) };
+		if (!monthChanges(dayNumber, following))
+			return following;
+		return precedingBusinessDay(dayNumber);
 	}
-	else if (c.getBusDayConvention() == businessDayConventions::PRECEDING ||
-		c.getBusDayConvention() == businessDayConventions::MODIFIED_PRECEDING)
+	else if constexpr (convention == businessDayConventions::MODIFIED_PRECEDING)
 	{
-		while (isHoliday(d1))
-			d1 -= days(1);
-		if (c.getBusDayConvention() == businessDayConventions::MODIFIED_PRECEDING)
-		{
-			if (d1.month() != d.month())
-			{
-				BusinessDayConventions following{ "Following" };
-				adjust(d, following);
-			}
+		const std::uint32_t preceding{ precedingBusinessDay(dayNumber) };
+		if (!monthChanges(dayNumber, preceding))
+			return preceding;
+		return followingBusinessDay(dayNumber);
+	}
+	else
+		return dayNumber;
+}
 
-		}
+/// <summary>
+/// Adjust a day number according to a business day convention.
+/// </summary>
+/// <param name="dayNumber"></param>
+/// <param name="convention"></param>
+/// <returns></returns>
+std::uint32_t HolidayCalendar::adjustDayNumber(std::uint32_t dayNumber, businessDayConventions convention) const
+{
+	switch (convention)
+	{
+	case businessDayConventions::FOLLOWING:
+		return adjustDayNumber<businessDayConventions::FOLLOWING>(dayNumber);
+	case businessDayConventions::MODIFIED_FOLLOWING:
+		return adjustDayNumber<businessDayConventions::MODIFIED_FOLLOWING>(dayNumber);
+	case businessDayConventions::PRECEDING:
+		return adjustDayNumber<businessDayConventions::PRECEDING>(dayNumber);
+	case businessDayConventions::MODIFIED_PRECEDING:
+		return adjustDayNumber<businessDayConventions::MODIFIED_PRECEDING>(dayNumber);
+	default:
+		return dayNumber;
 	}
+}
+
+/// <summary>
+/// Adjust n dates or day numbers according to a business day convention known at compile time, in parallel
+/// chunks.
+/// </summary>
+/// <param name="first"></param>
+/// <param name="result"></param>
+/// <param name="n"></param>
+template<businessDayConventions convention, typename Day>
+void HolidayCalendar::adjustRange(const Day* first, Day* result, int n) const
+{
+	parallelFor(0, n, grainSize(), [this, first, result](int begin, int end) {
+		for (int i{ begin }; i < end; ++i)
+			result[i] = internal::withDayNumber(first[i], adjustDayNumber<convention>(internal::dayNumberOf(first[i])));
+	});
+}
 
-	return d1;
+/// <summary>
+/// Choose the loop of a business day convention once for all the dates.
+/// </summary>
+/// <param name="first"></param>
+/// <param name="result"></param>
+/// <param name="n"></param>
+/// <param name="convention"></param>
+template<typename Day>
+void HolidayCalendar::adjustRange(const Day* first, Day* result, int n, businessDayConventions convention) const
+{
+	switch (convention)
+	{
+	case businessDayConventions::FOLLOWING:
+		adjustRange<businessDayConventions::FOLLOWING>(first, result, n);
+		break;
+	case businessDayConventions::MODIFIED_FOLLOWING:
+		adjustRange<businessDayConventions::MODIFIED_FOLLOWING>(first, result, n);
+		break;
+	case businessDayConventions::PRECEDING:
+		adjustRange<businessDayConventions::PRECEDING>(first, result, n);
+		break;
+	case businessDayConventions::MODIFIED_PRECEDING:
+		adjustRange<businessDayConventions::MODIFIED_PRECEDING>(first, result, n);
+		break;
+	default:
+		if (result != first)
+			std::copy(first, first + n, result);
+		break;
+	}
 }
 
+date HolidayCalendar::adjust(const date& d, BusinessDayConventions c) const
+{
+	if (c.getBusDayConvention() == businessDayConventions::NO_ADJUST)
+		return d;
 
+	return internal::withDayNumber(d, adjustDayNumber(d.day_number(), c.getBusDayConvention()));
+}
+
+/// <summary>
+/// Adjust the n dates starting at ``dates`` into ``adjusted``, which may be the same array.
+/// </summary>
+/// <param name="dates"></param>
+/// <param name="adjusted"></param>
+/// <param name="n"></param>
+/// <param name="c"></param>
+void HolidayCalendar::adjust(const date* dates, date* adjusted, int n, BusinessDayConventions c) const
+{
+	adjustRange(dates, adjusted, n, c.getBusDayConvention());
+}
+
+/// <summary>
+/// Adjust the n day numbers (see ``date::day_number()``) starting at ``dayNumbers`` into ``adjusted``, which may
+/// be the same array.
+/// </summary>
+/// <param name="dayNumbers"></param>
+/// <param name="adjusted"></param>
+/// <param name="n"></param>
+/// <param name="c"></param>
+void HolidayCalendar::adjust(const std::uint32_t* dayNumbers, std::uint32_t* adjusted, int n, BusinessDayConventions c) const
+{
+	adjustRange(dayNumbers, adjusted, n, c.getBusDayConvention());
+}
+
+void HolidayCalendar::adjust(vector<date>& dates, BusinessDayConventions c) const
+{
+	adjustRange(dates.data(), dates.data(), static_cast<int>(dates.size()), c.getBusDayConvention());
+}
+
+/// <summary>
+/// The joint calendar whose holidays are those of this calendar and those of the other one: its business days
+/// are business days in both.
+/// </summary>
+/// <param name="other"></param>
+/// <returns></returns>
+HolidayCalendar HolidayCalendar::combinedWith(const HolidayCalendar& other) const
+{
+	return HolidayCalendar{ *this, other, true };
+}
+
+/// <summary>
+/// The joint calendar whose business days are those of this calendar and those of the other one: its holidays
+/// are holidays in both.
+/// </summary>
+/// <param name="other"></param>
+/// <returns></returns>
+HolidayCalendar HolidayCalendar::linkedWith(const HolidayCalendar& other) const
+{
+	return HolidayCalendar{ *this, other, false };
+}
+
+HolidayCalendar operator+(const HolidayCalendar& a, const HolidayCalendar& b)
+{
+	return a.combinedWith(b);
+}
+
+HolidayCalendar operator|(const HolidayCalendar& a, const HolidayCalendar& b)
+{
+	return a.linkedWith(b);
+}
 
 date HolidayCalendar::easter(int year)
 {
@@ -408,4 +1083,165 @@ date HolidayCalendar::easter(int year)
 	int day{ ((h + l - 7 * m + 114) % 31) + 1 };
 	return date{ static_cast<year_type>(year), static_cast<month_type>(month), static_cast<day_type>(day) };
 }
+
+/// <summary>
+/// Shared handle on an immutable calendar of the registry.
+/// </summary>
+typedef std::shared_ptr<const HolidayCalendar> HolidayCalendarHandle;
+
+namespace internal
+{
+	/// <summary>
+	/// The registered calendar of an identifier. The function-local static is built by the first caller,
+	/// exactly once even if several threads race; later calls only test that it has been initialized.
+	/// </summary>
+	template<HolidayCalendarId id>
+	const HolidayCalendarHandle& registeredCalendar()
+	{
+		static const HolidayCalendarHandle calendar{ std::make_shared<const HolidayCalendar>(id) };
+		return calendar;
+	}
+
+	/// <summary>
+	/// Calendars by name. Each bucket of a fixed hash table is a list of entries that only grows at its head:
+	/// readers follow the lists from an atomic load of the heads, without locking, and writers build the
+	/// calendar and publish its entry under the lock. Entries are never moved or removed, so memory grows with
+	/// the number of distinct names only, and the handles returned stay valid until exit.
+	/// </summary>
+	class JointCalendarRegistry
+	{
+		struct Entry
+		{
+			string name;
+			HolidayCalendarHandle calendar;
+			const Entry* next;
+		};
+
+		static constexpr std::size_t bucketCount{ 256 };
+
+		std::atomic<const Entry*> buckets[bucketCount]{};
+		std::vector<std::unique_ptr<const Entry>> entries;
+		std::mutex mutex;
+
+		static std::size_t bucketOf(const string& name)
+		{
+			return std::hash<string>{}(name) % bucketCount;
+		}
+
+	public:
+		const HolidayCalendarHandle* find(const string& name) const
+		{
+			for (const Entry* entry{ buckets[bucketOf(name)].load(std::memory_order_acquire) }; entry != nullptr; entry = entry->next)
+				if (entry->name == name)
+					return &entry->calendar;
+			return nullptr;
+		}
+
+		/// <summary>
+		/// The calendar of the given name, built by build() unless another thread has registered it first.
+		/// </summary>
+		template<typename Build>
+		const HolidayCalendarHandle& insert(const string& name, Build build)
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			if (const HolidayCalendarHandle* found{ find(name) })
+				return *found;
+
+			std::atomic<const Entry*>& bucket{ buckets[bucketOf(name)] };
+			entries.push_back(std::make_unique<const Entry>(Entry{ name, build(), bucket.load(std::memory_order_relaxed) }));
+			bucket.store(entries.back().get(), std::memory_order_release);
+			return entries.back()->calendar;
+		}
+	};
+
+	inline JointCalendarRegistry& jointCalendarRegistry()
+	{
+		static JointCalendarRegistry registry;
+		return registry;
+	}
+}
+
+/// <summary>
+/// The registered calendar of an identifier, built on first use.
+/// </summary>
+/// <param name="id"></param>
+/// <returns></returns>
+const HolidayCalendarHandle& holidayCalendar(HolidayCalendarId id)
+{
+	switch (id)
+	{
+	case HolidayCalendarId::GBLO:
+		return internal::registeredCalendar<HolidayCalendarId::GBLO>();
+	case HolidayCalendarId::NYSE:
+		return internal::registeredCalendar<HolidayCalendarId::NYSE>();
+	case HolidayCalendarId::EUTA:
+		return internal::registeredCalendar<HolidayCalendarId::EUTA>();
+	default:
+		return internal::registeredCalendar<HolidayCalendarId::CUST>();
+	}
+}
+
+/// <summary>
+/// The registered calendar of a name: an identifier such as GBLO, or a joint calendar such as GBLO+NYSE,
+/// GBLO|EUTA or (GBLO|EUTA)+NYSE, built on first use. The two operators may only be mixed with parentheses.
+/// Throws invalid_argument if the name is not valid.
+/// </summary>
+/// <param name="name"></param>
+/// <returns></returns>
+const HolidayCalendarHandle& holidayCalendar(const string& name)
+{
+	internal::JointCalendarRegistry& registry{ internal::jointCalendarRegistry() };
+	if (const HolidayCalendarHandle* found{ registry.find(name) })
+		return *found;
+
+	// Split the name at the operators outside parentheses.
+	vector<string> operands;
+	char op{};
+	int depth{};
+	std::size_t start{};
+	for (std::size_t i{}; i < name.size(); ++i)
+	{
+		if (name[i] == '(')
+			++depth;
+		else if (name[i] == ')' && --depth < 0)
+			break;
+		else if (depth == 0 && (name[i] == '+' || name[i] == '|'))
+		{
+			if (op != 0 && op != name[i])
+				throw std::invalid_argument{ "holidayCalendar: + and | mixed without parentheses in " + name };
+			op = name[i];
+			operands.push_back(name.substr(start, i - start));
+			start = i + 1;
+		}
+	}
+	if (depth != 0)
+		throw std::invalid_argument{ "holidayCalendar: unbalanced parentheses in " + name };
+	operands.push_back(name.substr(start));
+
+	// Other spellings of a calendar, such as GBLO or (GBLO+NYSE), are registered too, so that they are
+	// parsed only once. The calendar is resolved first, so that the lock is never taken twice by the same thread.
+	if (operands.size() == 1)
+	{
+		const HolidayCalendarHandle* calendar{ nullptr };
+		if (name.size() > 2 && name.front() == '(' && name.back() == ')')
+			calendar = &holidayCalendar(name.substr(1, name.size() - 2));
+		for (HolidayCalendarId id : { HolidayCalendarId::GBLO, HolidayCalendarId::NYSE, HolidayCalendarId::EUTA, HolidayCalendarId::CUST })
+			if (name == holidayCalendarName(id))
+				calendar = &holidayCalendar(id);
+		if (calendar == nullptr)
+			throw std::invalid_argument{ "holidayCalendar: unknown calendar " + name };
+		return registry.insert(name, [calendar] { return *calendar; });
+	}
+
+	// Likewise, the operands are registered before the lock is taken.
+	vector<HolidayCalendarHandle> calendars;
+	for (const string& operand : operands)
+		calendars.push_back(holidayCalendar(operand));
+	return registry.insert(name, [&calendars, op] {
+		HolidayCalendar joint{ *calendars[0] };
+		for (std::size_t k{ 1 }; k < calendars.size(); ++k)
+			joint = op == '+' ? joint.combinedWith(*calendars[k]) : joint.linkedWith(*calendars[k]);
+		return std::make_shared<const HolidayCalendar>(std::move(joint));
+	});
+}
 #endif
\ No newline at end of file
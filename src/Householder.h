@@ -0,0 +1,219 @@
+#pragma once
+#ifndef HOUSEHOLDER_H
+#define HOUSEHOLDER_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Gemm.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "Transpose.h"
+
+/// Householder reflectors.
+//
+/// A Householder reflector \f$H = I - \tau vv^T\f$ maps a vector x onto a multiple \f$\beta e_1\f$ of the
+/// first unit vector; v is normalized so that \f$v_0 = 1\f$ and only its tail needs storing, in place of
+/// the entries of x it annihilates. The orthogonal factors of the QR decomposition and of the reduction of
+/// a symmetric matrix to tridiagonal form are products of such reflectors.
+///
+/// Applying the reflectors one at a time is a sequence of matrix-vector products, bound by memory
+/// bandwidth. ``BlockReflector`` gathers k consecutive reflectors into the compact WY form
+/// \f$H_0 H_1 \cdots H_{k-1} = I - VTV^T\f$, with V the m x k unit lower trapezoidal matrix of the vectors
+/// and T a k x k upper triangular matrix, so that applying them to a block of columns takes two calls of
+/// ``gemm``.
+
+namespace internal
+{
+	/// <summary>
+	/// Generate the reflector H with \f$Hx = \beta e_1\f$ for the vector x of length m whose consecutive
+	/// entries are ``incx`` apart. On return ``x[0]`` holds beta and the tail of x holds the tail of v;
+	/// returns beta. If the tail of x is already zero, tau is zero and H is the identity.
+	/// </summary>
+	template<typename scalarType>
+	scalarType householder(int m, scalarType* x, int incx, scalarType& tau)
+	{
+		const scalarType alpha{ x[0] };
+		scalarType sigma{};
+		if (incx == 1)
+			sigma = simdKernels<scalarType>().dot(x + 1, x + 1, m - 1);
+		else
+			for (int i{ 1 }; i < m; ++i)
+				sigma += x[i * incx] * x[i * incx];
+		if (sigma == scalarType{})
+		{
+			tau = scalarType{};
+			return alpha;
+		}
+
+		const scalarType norm{ std::sqrt(alpha * alpha + sigma) };
+		const scalarType beta{ alpha > scalarType{} ? -norm : norm };
+		tau = (beta - alpha) / beta;
+		const scalarType scale{ scalarType{ 1 } / (alpha - beta) };
+		for (int i{ 1 }; i < m; ++i)
+			x[i * incx] *= scale;
+		x[0] = beta;
+		return beta;
+	}
+
+	/// <summary>
+	/// \f$C := (I - \tau vv^T)C\f$ for the m x p matrix C stored by columns, each of length m and ``ldc`` apart,
+	/// where v has an implicit unit first entry (``v[0]`` is not read). Each column takes a dot product and an
+	/// axpy over contiguous coefficients, and the columns are split across threads.
+	/// </summary>
+	template<typename scalarType>
+	void applyHouseholderToColumns(int m, int p, const scalarType* v, scalarType tau, scalarType* c, int ldc)
+	{
+		if (tau == scalarType{} || p <= 0)
+			return;
+		const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+		parallelFor(0, p, std::max(1, grainSize() / std::max(1, 2 * m)), [&](int first, int last) {
+			for (int q{ first }; q < last; ++q)
+			{
+				scalarType* column{ c + static_cast<std::size_t>(q) * ldc };
+				const scalarType w{ tau * (column[0] + kernels.dot(v + 1, column + 1, m - 1)) };
+				column[0] -= w;
+				kernels.axpy(-w, v + 1, column + 1, m - 1);
+			}
+		});
+	}
+
+	/// <summary>
+	/// Householder QR factorization of the first k columns of the m x n matrix stored by columns in ``at``
+	/// (column c at ``at + c * ldat``), with the reflectors also applied to the other n - k columns. R is left
+	/// on and above the diagonal and the tail of the j-th reflector below it, in column j.
+	/// </summary>
+	template<typename scalarType>
+	void householderQRColumns(int m, int n, int k, scalarType* at, int ldat, scalarType* tau)
+	{
+		const int steps{ std::min(m, k) };
+		for (int j{}; j < steps; ++j)
+		{
+			scalarType* x{ at + static_cast<std::size_t>(j) * ldat + j };
+			householder(m - j, x, 1, tau[j]);
+			applyHouseholderToColumns(m - j, n - j - 1, x, tau[j], x + ldat, ldat);
+		}
+	}
+
+	/// <summary>
+	/// ``BlockReflector`` holds k reflectors of length m in the compact WY form \f$I - VTV^T\f$ and applies
+	/// them, or their transpose, to blocks of columns. It keeps its workspace between uses.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	template<typename scalarType>
+	class BlockReflector
+	{
+	private:
+		int _m;
+		int _k;
+		std::vector<scalarType> _vt;	// k x m, row l is the l-th vector, explicit zeros and unit diagonal
+		std::vector<scalarType> _v;		// m x k, the transpose of _vt
+		std::vector<scalarType> _t;		// k x k upper triangular
+		std::vector<scalarType> _w;		// k x p workspace
+	public:
+		BlockReflector();
+
+		void compute(int m, int k, const scalarType* v, int ldv, const scalarType* tau);
+		void apply(bool transpose, int p, scalarType* c, int ldc);
+	};
+
+	/// <summary>
+	/// An empty block reflector, to be filled by ``compute()``.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	template<typename scalarType>
+	BlockReflector<scalarType>::BlockReflector() : _m{}, _k{}, _vt{}, _v{}, _t{}, _w{}
+	{
+	}
+
+	/// <summary>
+	/// Gather the reflectors \f$H_l = I - \tau_l v_lv_l^T\f$, l < k, into \f$H_0 \cdots H_{k-1} = I - VTV^T\f$.
+	/// The vector \f$v_l\f$ is column l of the m x k matrix ``v`` (rows ``ldv`` apart) below row l, with an
+	/// implicit unit entry in row l and zeros above it; the upper triangle of ``v`` is not read.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	/// <param name="m">length of the reflectors</param>
+	/// <param name="k">number of reflectors, at most m</param>
+	/// <param name="v"></param>
+	/// <param name="ldv"></param>
+	/// <param name="tau"></param>
+	template<typename scalarType>
+	void BlockReflector<scalarType>::compute(int m, int k, const scalarType* v, int ldv, const scalarType* tau)
+	{
+		const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+		_m = m;
+		_k = k;
+		_vt.assign(static_cast<std::size_t>(k) * m, scalarType{});
+		_v.resize(static_cast<std::size_t>(m) * k);
+		_t.assign(static_cast<std::size_t>(k) * k, scalarType{});
+		for (int l{}; l < k; ++l)
+		{
+			scalarType* row{ _vt.data() + static_cast<std::size_t>(l) * m };
+			row[l] = scalarType{ 1 };
+			for (int r{ l + 1 }; r < m; ++r)
+				row[r] = v[static_cast<std::size_t>(r) * ldv + l];
+		}
+		transposeCopy(k, m, _vt.data(), m, _v.data(), k);
+
+		// T(0:i, i) = -tau_i T(0:i, 0:i) V(:, 0:i)^T v_i, where v_i vanishes above row i.
+		for (int i{}; i < k; ++i)
+		{
+			const scalarType* vi{ _vt.data() + static_cast<std::size_t>(i) * m };
+			scalarType* t{ _t.data() };
+			for (int l{}; l < i; ++l)
+				t[l * k + i] = -tau[i] * kernels.dot(_vt.data() + static_cast<std::size_t>(l) * m + i, vi + i, m - i);
+			for (int l{}; l < i; ++l)
+			{
+				scalarType sum{};
+				for (int q{ l }; q < i; ++q)
+					sum += t[l * k + q] * t[q * k + i];
+				t[l * k + i] = sum;
+			}
+			t[i * k + i] = tau[i];
+		}
+	}
+
+	/// <summary>
+	/// \f$C := HC\f$, or \f$C := H^TC\f$ if ``transpose`` is set, for the m x p matrix C whose rows are ``ldc``
+	/// apart: \f$W = V^TC\f$, \f$W := TW\f$ (or \f$T^TW\f$) and \f$C := C - VW\f$.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	/// <param name="transpose"></param>
+	/// <param name="p">number of columns of C</param>
+	/// <param name="c"></param>
+	/// <param name="ldc"></param>
+	template<typename scalarType>
+	void BlockReflector<scalarType>::apply(bool transpose, int p, scalarType* c, int ldc)
+	{
+		if (_k == 0 || p <= 0)
+			return;
+
+		const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+		const int k{ _k };
+		_w.resize(static_cast<std::size_t>(k) * p);
+		scalarType* w{ _w.data() };
+		const scalarType* t{ _t.data() };
+		gemm(k, p, _m, scalarType{ 1 }, _vt.data(), _m, c, ldc, scalarType{}, w, p);
+		if (transpose)
+		{
+			for (int i{ k - 1 }; i >= 0; --i)
+			{
+				kernels.scale(w + i * p, t[i * k + i], w + i * p, p);
+				for (int l{}; l < i; ++l)
+					kernels.axpy(t[l * k + i], w + l * p, w + i * p, p);
+			}
+		}
+		else
+		{
+			for (int i{}; i < k; ++i)
+			{
+				kernels.scale(w + i * p, t[i * k + i], w + i * p, p);
+				for (int l{ i + 1 }; l < k; ++l)
+					kernels.axpy(t[i * k + l], w + l * p, w + i * p, p);
+			}
+		}
+		gemm(_m, p, k, scalarType{ -1 }, _v.data(), k, w, p, scalarType{ 1 }, c, ldc);
+	}
+}
+
+#endif // !HOUSEHOLDER_H
@@ -0,0 +1,1128 @@
+#pragma once
+#ifndef ITERATIVE_SOLVERS_H
+#define ITERATIVE_SOLVERS_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "MatrixX.h"
+#include "SparseMatrixX.h"
+#include "BandedMatrixX.h"
+
+/// Iterative solvers of linear systems.
+//
+/// The solvers of this file compute \f$x\f$ with \f$Ax = b\f$ by successive approximations, and only ever
+/// touch A through products \f$y = Ax\f$. Each iteration costs one such product plus a few vector operations,
+/// so a sparse system, e.g. the finite-difference grid of a PDE, is solved in O(nnz) per iteration
+/// without ever forming A:
+/// - ``JacobiSolver``: (weighted) Jacobi iteration, for diagonally dominant matrices;
+/// - ``GaussSeidelSolver``: Gauss-Seidel, or successive over-relaxation when ``omega`` is not 1;
+/// - ``ConjugateGradientSolver``: preconditioned conjugate gradient, for symmetric positive definite matrices;
+/// - ``GMRESSolver``: restarted GMRES(m) with right preconditioning, for any non-singular matrix.
+///
+/// A is a ``MatrixX``, a ``SparseMatrixX``, a ``BandedMatrixX``, or any callable
+/// ``a(const scalarType* x, scalarType* y)`` that writes \f$y = Ax\f$ for vectors of length n. Preconditioners are callables ``m(const scalarType* r, scalarType* z)``
+/// that write \f$z = M^{-1}r\f$: ``IdentityPreconditioner`` (none), ``DiagonalPreconditioner`` and
+/// ``IncompleteCholeskyPreconditioner`` (IC(0)) are provided.
+///
+/// ```
+/// // -u'' = f on a grid of n points, matrix-free.
+/// auto laplacian{ [n](const double* u, double* y) {
+///     for (int i{}; i < n; ++i)
+///         y[i] = 2 * u[i] - (i > 0 ? u[i - 1] : 0) - (i + 1 < n ? u[i + 1] : 0);
+/// } };
+/// ConjugateGradientSolver<double> cg;
+/// IterativeSolverResult<double> result{ cg.solve(laplacian, f, u) };
+/// ```
+///
+/// A solver object keeps its work vectors between calls to ``solve()``: they are allocated when the system
+/// grows, never inside the iteration loop. ``settings().callback``, if set, is called after every iteration
+/// with the iteration count and the relative residual, and stops the solver by returning false.
+
+/// <summary>
+/// Stopping criteria and parameters of an iterative solver.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+struct IterativeSolverSettings
+{
+	int maxIterations{ 1000 };
+	scalarType tolerance{ std::sqrt(std::numeric_limits<scalarType>::epsilon()) };	// on \f$\|b - Ax\|_2 / \|b\|_2\f$
+	scalarType omega{ 1 };				// weight of the Jacobi update, relaxation factor of SOR
+	int restart{ 30 };					// GMRES: Krylov vectors per cycle
+	std::function<bool(int iteration, scalarType residual)> callback{};		// return false to stop
+};
+
+/// <summary>
+/// Outcome of an iterative solve.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+struct IterativeSolverResult
+{
+	int iterations;
+	scalarType residual;		// relative residual \f$\|b - Ax\|_2 / \|b\|_2\f$ of the returned x
+	bool converged;
+};
+
+/// <summary>
+/// No preconditioning, \f$M = I\f$. The solvers skip the preconditioning step altogether.
+/// </summary>
+struct IdentityPreconditioner
+{
+};
+
+/// <summary>
+/// Jacobi preconditioner \f$M = \mathrm{diag}(A)\f$.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+class DiagonalPreconditioner
+{
+private:
+	std::vector<scalarType> _inverse;		// 1 / a_ii
+public:
+	DiagonalPreconditioner();
+	explicit DiagonalPreconditioner(std::vector<scalarType> diagonal);
+	DiagonalPreconditioner(const scalarType* diagonal, int n);
+	template<typename Allocator>
+	explicit DiagonalPreconditioner(const MatrixX<scalarType, Allocator>& a);
+	template<StorageOrder order>
+	explicit DiagonalPreconditioner(const SparseMatrixX<scalarType, order>& a);
+	explicit DiagonalPreconditioner(const BandedMatrixX<scalarType>& a);
+
+	int rows() const;
+	void operator()(const scalarType* r, scalarType* z) const;
+};
+
+/// <summary>
+/// Incomplete Cholesky factorization IC(0): \f$M = LL^T\f$, where L has the non-zero pattern of the lower
+/// triangle of A. L is stored by rows in compressed form, so that applying \f$M^{-1}\f$ costs O(nnz).
+/// A is a dense ``MatrixX``, whose zeros are left out of the pattern, or a ``SparseMatrixX``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+class IncompleteCholeskyPreconditioner
+{
+private:
+	std::vector<scalarType> _values;		// row i: L(i, j) for the j < i of its pattern, then L(i, i)
+	std::vector<int> _columns;
+	std::vector<int> _rowStart;				// n + 1 offsets into _values and _columns
+
+	template<typename RowVisitor>
+	void factor(int n, RowVisitor&& forEachInRow);
+public:
+	IncompleteCholeskyPreconditioner();
+	template<typename Allocator>
+	explicit IncompleteCholeskyPreconditioner(const MatrixX<scalarType, Allocator>& a);
+	template<StorageOrder order>
+	explicit IncompleteCholeskyPreconditioner(const SparseMatrixX<scalarType, order>& a);
+
+	template<typename Allocator>
+	IncompleteCholeskyPreconditioner& compute(const MatrixX<scalarType, Allocator>& a);
+	template<StorageOrder order>
+	IncompleteCholeskyPreconditioner& compute(const SparseMatrixX<scalarType, order>& a);
+
+	int rows() const;
+	int nonZeros() const;
+	void operator()(const scalarType* r, scalarType* z) const;
+};
+
+namespace internal
+{
+	/// <summary>
+	/// The product \f$y = Ax\f$ with a dense square matrix, one dot product per row, split across threads by rows.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	template<typename scalarType>
+	class DenseOperator
+	{
+	private:
+		const scalarType* _a;
+		int _n;
+	public:
+		DenseOperator(const scalarType* a, int n) : _a{ a }, _n{ n }
+		{
+		}
+
+		void operator()(const scalarType* x, scalarType* y) const
+		{
+			const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+			parallelFor(0, _n, std::max(1, grainSize() / std::max(1, _n)), [&](int first, int last) {
+				for (int i{ first }; i < last; ++i)
+					y[i] = kernels.dot(_a + static_cast<long long>(i) * _n, x, _n);
+			});
+		}
+	};
+
+	/// <summary>
+	/// The operator of a dense matrix; ``a`` must be square.
+	/// </summary>
+	template<typename scalarType, typename Allocator>
+	DenseOperator<scalarType> linearOperator(const MatrixX<scalarType, Allocator>& a)
+	{
+		if (a.rows() != a.cols())
+			throw std::logic_error("An iterative solver requires a square matrix!");
+		return DenseOperator<scalarType>{ a.data(), a.rows() };
+	}
+
+	/// <summary>
+	/// The product \f$y = Ax\f$ with a matrix type that provides ``multiply(x, y)``.
+	/// </summary>
+	/// <typeparam name="Matrix"></typeparam>
+	template<typename Matrix>
+	class MultiplyOperator
+	{
+	private:
+		const Matrix& _a;
+	public:
+		explicit MultiplyOperator(const Matrix& a) : _a{ a }
+		{
+		}
+
+		void operator()(const typename Matrix::value_type* x, typename Matrix::value_type* y) const
+		{
+			_a.multiply(x, y);
+		}
+	};
+
+	/// <summary>
+	/// The operator of a sparse matrix; ``a`` must be square.
+	/// </summary>
+	template<typename scalarType, StorageOrder order>
+	MultiplyOperator<SparseMatrixX<scalarType, order>> linearOperator(const SparseMatrixX<scalarType, order>& a)
+	{
+		if (a.rows() != a.cols())
+			throw std::logic_error("An iterative solver requires a square matrix!");
+		return MultiplyOperator<SparseMatrixX<scalarType, order>>{ a };
+	}
+
+	/// <summary>
+	/// The operator of a banded matrix.
+	/// </summary>
+	template<typename scalarType>
+	MultiplyOperator<BandedMatrixX<scalarType>> linearOperator(const BandedMatrixX<scalarType>& a)
+	{
+		return MultiplyOperator<BandedMatrixX<scalarType>>{ a };
+	}
+
+	/// <summary>
+	/// Any other operator is a callable ``a(x, y)`` and is used as it is.
+	/// </summary>
+	template<typename Operator>
+	const Operator& linearOperator(const Operator& a)
+	{
+		return a;
+	}
+
+	/// <summary>
+	/// \f$z = M^{-1}r\f$. With the identity, ``z`` is not written and ``r`` is returned instead.
+	/// </summary>
+	template<typename Preconditioner, typename scalarType>
+	const scalarType* precondition(const Preconditioner& m, const scalarType* r, scalarType* z)
+	{
+		if constexpr (std::is_same<Preconditioner, IdentityPreconditioner>::value)
+			return r;
+		else
+		{
+			m(r, z);
+			return z;
+		}
+	}
+
+	/// <summary>
+	/// Check that b is a vector, and make x a vector of the same length. An x of the wrong size is
+	/// replaced by the initial guess zero. Returns the length n.
+	/// </summary>
+	template<typename scalarType, typename AllocatorB, typename AllocatorX>
+	int prepareIterativeSolve(int n, const MatrixX<scalarType, AllocatorB>& b, MatrixX<scalarType, AllocatorX>& x)
+	{
+		if (b.cols() != 1 || (n >= 0 && b.rows() != n))
+			throw std::logic_error("The right-hand side must be a column vector of the order of the matrix!");
+		if (x.rows() != b.rows() || x.cols() != 1)
+		{
+			x.resize(b.rows(), 1);
+			std::fill(x.data(), x.data() + x.size(), scalarType{});
+		}
+		return b.rows();
+	}
+
+	/// <summary>
+	/// Order of a dense matrix, or -1 (unknown) for a matrix-free operator.
+	/// </summary>
+	template<typename scalarType, typename Allocator>
+	int operatorOrder(const MatrixX<scalarType, Allocator>& a)
+	{
+		return a.rows();
+	}
+
+	template<typename scalarType, StorageOrder order>
+	int operatorOrder(const SparseMatrixX<scalarType, order>& a)
+	{
+		return a.rows();
+	}
+
+	template<typename scalarType>
+	int operatorOrder(const BandedMatrixX<scalarType>& a)
+	{
+		return a.rows();
+	}
+
+	template<typename Operator>
+	int operatorOrder(const Operator&)
+	{
+		return -1;
+	}
+
+	/// <summary>
+	/// The diagonal of a square matrix. Throws ``std::logic_error`` if the matrix is not square.
+	/// </summary>
+	template<typename Matrix>
+	std::vector<typename Matrix::value_type> diagonalOf(const Matrix& a)
+	{
+		if (a.rows() != a.cols())
+			throw std::logic_error("A diagonal preconditioner requires a square matrix!");
+		std::vector<typename Matrix::value_type> diagonal(a.rows());
+		for (int i{}; i < a.rows(); ++i)
+			diagonal[i] = a.coeff(i, i);
+		return diagonal;
+	}
+
+	/// <summary>
+	/// Euclidean norm of a vector of length n.
+	/// </summary>
+	template<typename scalarType>
+	scalarType norm2(const scalarType* x, int n)
+	{
+		return std::sqrt(simdKernels<scalarType>().dot(x, x, n));
+	}
+
+	/// <summary>
+	/// Records the residual of each iteration in the result, calls the callback and decides when to stop:
+	/// on convergence, when the callback returns false, or after ``maxIterations`` iterations.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	template<typename scalarType>
+	class ConvergenceMonitor
+	{
+	private:
+		const IterativeSolverSettings<scalarType>& _settings;
+		scalarType _scale;
+	public:
+		IterativeSolverResult<scalarType> result;
+
+		ConvergenceMonitor(const IterativeSolverSettings<scalarType>& settings, scalarType normB)
+			: _settings{ settings }, _scale{ normB > scalarType{} ? scalarType{ 1 } / normB : scalarType{ 1 } }, result{ 0, scalarType{}, false }
+		{
+		}
+
+		/// <summary>
+		/// True if the solver must stop after ``iteration`` iterations, where x has the residual norm ``residual``.
+		/// </summary>
+		bool operator()(int iteration, scalarType residual)
+		{
+			result.iterations = iteration;
+			record(residual);
+			if (iteration > 0 && _settings.callback && !_settings.callback(iteration, result.residual))
+				return true;
+			return result.converged || iteration >= _settings.maxIterations;
+		}
+
+		/// <summary>
+		/// Replace the residual of the result, e.g. by the true residual of an estimated one.
+		/// </summary>
+		void record(scalarType residual)
+		{
+			result.residual = residual * _scale;
+			result.converged = result.residual <= _settings.tolerance;
+		}
+	};
+
+	/// <summary>
+	/// \f$r = b - Ax\f$; returns \f$\|r\|_2\f$.
+	/// </summary>
+	template<typename Operator, typename scalarType>
+	scalarType residual(const Operator& a, const scalarType* b, const scalarType* x, scalarType* r, int n)
+	{
+		a(x, r);
+		simdKernels<scalarType>().subtract(b, r, r, n);
+		return norm2(r, n);
+	}
+}
+
+/// <summary>
+/// Weighted Jacobi iteration \f$x := x + \omega D^{-1}(b - Ax)\f$, where D is the diagonal of A.
+/// Converges for strictly diagonally dominant A with \f$\omega = 1\f$.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+class JacobiSolver
+{
+private:
+	IterativeSolverSettings<scalarType> _settings;
+	std::vector<scalarType> _r;
+	std::vector<scalarType> _z;
+public:
+	explicit JacobiSolver(IterativeSolverSettings<scalarType> settings = {});
+
+	IterativeSolverSettings<scalarType>& settings();
+
+	template<typename Matrix, typename AllocatorB, typename AllocatorX>
+	IterativeSolverResult<scalarType> solve(const Matrix& a, const MatrixX<scalarType, AllocatorB>& b, MatrixX<scalarType, AllocatorX>& x);
+	template<typename Operator, typename AllocatorB, typename AllocatorX>
+	IterativeSolverResult<scalarType> solve(const Operator& a, const DiagonalPreconditioner<scalarType>& diagonal, const MatrixX<scalarType, AllocatorB>& b, MatrixX<scalarType, AllocatorX>& x);
+};
+
+/// <summary>
+/// Gauss-Seidel iteration, or successive over-relaxation (SOR) with the relaxation factor ``settings().omega``
+/// in (0, 2). Each sweep updates the unknowns in place, row by row, so A must be given as a dense matrix or
+/// as a sparse matrix in compressed rows.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+class GaussSeidelSolver
+{
+private:
+	IterativeSolverSettings<scalarType> _settings;
+	std::vector<scalarType> _r;
+
+	template<typename Operator, typename Sweep>
+	IterativeSolverResult<scalarType> iterate(const Operator& a, Sweep&& sweep, const scalarType* b, scalarType* x, int n);
+public:
+	explicit GaussSeidelSolver(IterativeSolverSettings<scalarType> settings = {});
+
+	IterativeSolverSettings<scalarType>& settings();
+
+	template<typename Allocator, typename AllocatorB, typename AllocatorX>
+	IterativeSolverResult<scalarType> solve(const MatrixX<scalarType, Allocator>& a, const MatrixX<scalarType, AllocatorB>& b, MatrixX<scalarType, AllocatorX>& x);
+	template<typename AllocatorB, typename AllocatorX>
+	IterativeSolverResult<scalarType> solve(const SparseMatrixX<scalarType, StorageOrder::RowMajor>& a, const MatrixX<scalarType, AllocatorB>& b, MatrixX<scalarType, AllocatorX>& x);
+};
+
+/// <summary>
+/// Preconditioned conjugate gradient, for symmetric positive definite A and M.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+class ConjugateGradientSolver
+{
+private:
+	IterativeSolverSettings<scalarType> _settings;
+	std::vector<scalarType> _r;
+	std::vector<scalarType> _z;
+	std::vector<scalarType> _p;
+	std::vector<scalarType> _q;
+public:
+	explicit ConjugateGradientSolver(IterativeSolverSettings<scalarType> settings = {});
+
+	IterativeSolverSettings<scalarType>& settings();
+
+	template<typename Operator, typename AllocatorB, typename AllocatorX, typename Preconditioner = IdentityPreconditioner>
+	IterativeSolverResult<scalarType> solve(const Operator& a, const MatrixX<scalarType, AllocatorB>& b, MatrixX<scalarType, AllocatorX>& x, const Preconditioner& m = {});
+};
+
+/// <summary>
+/// Restarted GMRES(m) with right preconditioning: each cycle minimizes \f$\|b - A(x_0 + M^{-1}V y)\|_2\f$ over
+/// a Krylov basis V of ``settings().restart`` vectors, orthonormalized by modified Gram-Schmidt.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+class GMRESSolver
+{
+private:
+	IterativeSolverSettings<scalarType> _settings;
+	std::vector<scalarType> _v;			// restart + 1 basis vectors of length n
+	std::vector<scalarType> _h;			// (restart + 1) x restart Hessenberg matrix, by rows
+	std::vector<scalarType> _cosines;
+	std::vector<scalarType> _sines;
+	std::vector<scalarType> _g;			// rotated right-hand side of the least-squares problem
+	std::vector<scalarType> _w;
+	std::vector<scalarType> _z;
+public:
+	explicit GMRESSolver(IterativeSolverSettings<scalarType> settings = {});
+
+	IterativeSolverSettings<scalarType>& settings();
+
+	template<typename Operator, typename AllocatorB, typename AllocatorX, typename Preconditioner = IdentityPreconditioner>
+	IterativeSolverResult<scalarType> solve(const Operator& a, const MatrixX<scalarType, AllocatorB>& b, MatrixX<scalarType, AllocatorX>& x, const Preconditioner& m = {});
+};
+
+/// <summary>
+/// An empty preconditioner.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+DiagonalPreconditioner<scalarType>::DiagonalPreconditioner() : _inverse{}
+{
+}
+
+/// <summary>
+/// The diagonal ``diagonal`` of a matrix-free operator. Throws ``std::logic_error`` on a zero coefficient.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="diagonal"></param>
+template<typename scalarType>
+DiagonalPreconditioner<scalarType>::DiagonalPreconditioner(std::vector<scalarType> diagonal) : _inverse{ std::move(diagonal) }
+{
+	for (scalarType& d : _inverse)
+	{
+		if (d == scalarType{})
+			throw std::logic_error("Zero diagonal coefficient in a diagonal preconditioner!");
+		d = scalarType{ 1 } / d;
+	}
+}
+
+/// <summary>
+/// The diagonal ``diagonal[0..n)`` of a matrix-free operator. Throws ``std::logic_error`` on a zero coefficient.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="diagonal"></param>
+/// <param name="n"></param>
+template<typename scalarType>
+DiagonalPreconditioner<scalarType>::DiagonalPreconditioner(const scalarType* diagonal, int n)
+	: DiagonalPreconditioner{ std::vector<scalarType>(diagonal, diagonal + n) }
+{
+}
+
+/// <summary>
+/// The diagonal of the square matrix ``a``. Throws ``std::logic_error`` on a zero diagonal coefficient.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+template<typename scalarType>
+template<typename Allocator>
+DiagonalPreconditioner<scalarType>::DiagonalPreconditioner(const MatrixX<scalarType, Allocator>& a)
+	: DiagonalPreconditioner{ internal::diagonalOf(a) }
+{
+}
+
+/// <summary>
+/// The diagonal of the square sparse matrix ``a``. Throws ``std::logic_error`` on a zero diagonal coefficient.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+template<typename scalarType>
+template<StorageOrder order>
+DiagonalPreconditioner<scalarType>::DiagonalPreconditioner(const SparseMatrixX<scalarType, order>& a)
+	: DiagonalPreconditioner{ internal::diagonalOf(a) }
+{
+}
+
+/// <summary>
+/// The diagonal of the banded matrix ``a``. Throws ``std::logic_error`` on a zero diagonal coefficient.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+template<typename scalarType>
+DiagonalPreconditioner<scalarType>::DiagonalPreconditioner(const BandedMatrixX<scalarType>& a)
+	: DiagonalPreconditioner{ internal::diagonalOf(a) }
+{
+}
+
+/// <summary>
+/// The order of the preconditioned matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int DiagonalPreconditioner<scalarType>::rows() const
+{
+	return static_cast<int>(_inverse.size());
+}
+
+/// <summary>
+/// \f$z_i = r_i / a_{ii}\f$.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="r"></param>
+/// <param name="z"></param>
+template<typename scalarType>
+void DiagonalPreconditioner<scalarType>::operator()(const scalarType* r, scalarType* z) const
+{
+	const int n{ rows() };
+	for (int i{}; i < n; ++i)
+		z[i] = r[i] * _inverse[i];
+}
+
+/// <summary>
+/// An empty factorization, to be filled by ``compute()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+IncompleteCholeskyPreconditioner<scalarType>::IncompleteCholeskyPreconditioner() : _values{}, _columns{}, _rowStart{ 0 }
+{
+}
+
+/// <summary>
+/// Factor the symmetric positive definite matrix ``a``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+template<typename scalarType>
+template<typename Allocator>
+IncompleteCholeskyPreconditioner<scalarType>::IncompleteCholeskyPreconditioner(const MatrixX<scalarType, Allocator>& a)
+	: IncompleteCholeskyPreconditioner{}
+{
+	compute(a);
+}
+
+/// <summary>
+/// Factor the symmetric positive definite sparse matrix ``a``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+template<typename scalarType>
+template<StorageOrder order>
+IncompleteCholeskyPreconditioner<scalarType>::IncompleteCholeskyPreconditioner(const SparseMatrixX<scalarType, order>& a)
+	: IncompleteCholeskyPreconditioner{}
+{
+	compute(a);
+}
+
+/// <summary>
+/// IC(0) factorization of the lower triangle of the dense matrix ``a``, restricted to its non-zero coefficients.
+/// Throws ``std::logic_error`` if ``a`` is not square or if the factorization breaks down; see ``factor()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Allocator>
+IncompleteCholeskyPreconditioner<scalarType>& IncompleteCholeskyPreconditioner<scalarType>::compute(const MatrixX<scalarType, Allocator>& a)
+{
+	if (a.rows() != a.cols())
+		throw std::logic_error("Incomplete Cholesky factorization requires a square matrix!");
+	const int n{ a.rows() };
+	factor(n, [&](int i, auto&& visit) {
+		for (int j{}; j <= i; ++j)
+			if (a.coeff(i * n + j) != scalarType{})
+				visit(j, a.coeff(i * n + j));
+	});
+	return *this;
+}
+
+/// <summary>
+/// IC(0) factorization of the lower triangle of the sparse matrix ``a``, with the pattern of its stored
+/// coefficients. A CSC matrix is read through its transpose, whose rows are its columns: since A is
+/// symmetric, the lower triangle of its transpose is that of A.
+/// Throws ``std::logic_error`` if ``a`` is not square or if the factorization breaks down; see ``factor()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <returns></returns>
+template<typename scalarType>
+template<StorageOrder order>
+IncompleteCholeskyPreconditioner<scalarType>& IncompleteCholeskyPreconditioner<scalarType>::compute(const SparseMatrixX<scalarType, order>& a)
+{
+	if (a.rows() != a.cols())
+		throw std::logic_error("Incomplete Cholesky factorization requires a square matrix!");
+	const int* outerStart{ a.outerStart() };
+	const int* inner{ a.innerIndices() };
+	const scalarType* values{ a.values() };
+	factor(a.rows(), [&](int i, auto&& visit) {
+		for (int p{ outerStart[i] }; p < outerStart[i + 1] && inner[p] <= i; ++p)
+			visit(inner[p], values[p]);
+	});
+	return *this;
+}
+
+/// <summary>
+/// IC(0) factorization of the matrix of order n whose lower triangle is enumerated by ``forEachInRow(i, visit)``,
+/// which calls ``visit(j, a_ij)`` for the coefficients \f$j \le i\f$ of the pattern of row i, in increasing j.
+/// For each of them, \f$l_{ij} = (a_{ij} - \sum_k l_{ik} l_{jk}) / l_{jj}\f$ with the sum restricted to the
+/// pattern, and \f$l_{ii} = \sqrt{a_{ii} - \sum_k l_{ik}^2}\f$. Throws ``std::logic_error`` if a pivot
+/// \f$l_{ii}^2\f$ is not positive, which can happen even for positive definite A.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="n"></param>
+/// <param name="forEachInRow"></param>
+template<typename scalarType>
+template<typename RowVisitor>
+void IncompleteCholeskyPreconditioner<scalarType>::factor(int n, RowVisitor&& forEachInRow)
+{
+	_values.clear();
+	_columns.clear();
+	_rowStart.assign(1, 0);
+	for (int i{}; i < n; ++i)
+	{
+		const int start{ _rowStart.back() };
+		bool diagonal{ false };
+		auto visit{ [&](int j, scalarType aij) {
+			// Sparse dot product of the computed parts of rows i and j, both sorted by column.
+			scalarType sum{ aij };
+			int p{ start };
+			int q{ _rowStart[j] };
+			const int pEnd{ static_cast<int>(_values.size()) };
+			const int qEnd{ j < i ? _rowStart[j + 1] - 1 : pEnd };
+			while (p < pEnd && q < qEnd)
+			{
+				if (_columns[p] < _columns[q])
+					++p;
+				else if (_columns[p] > _columns[q])
+					++q;
+				else
+					sum -= _values[p++] * _values[q++];
+			}
+
+			if (j < i)
+				_values.push_back(sum / _values[_rowStart[j + 1] - 1]);
+			else
+			{
+				if (!(sum > scalarType{}))
+					throw std::logic_error("Incomplete Cholesky factorization broke down on a non-positive pivot!");
+				_values.push_back(std::sqrt(sum));
+				diagonal = true;
+			}
+			_columns.push_back(j);
+		} };
+		forEachInRow(i, visit);
+		if (!diagonal)
+			visit(i, scalarType{});
+		_rowStart.push_back(static_cast<int>(_values.size()));
+	}
+}
+
+/// <summary>
+/// The order of the factored matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int IncompleteCholeskyPreconditioner<scalarType>::rows() const
+{
+	return static_cast<int>(_rowStart.size()) - 1;
+}
+
+/// <summary>
+/// The number of coefficients stored for L, diagonal included.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int IncompleteCholeskyPreconditioner<scalarType>::nonZeros() const
+{
+	return static_cast<int>(_values.size());
+}
+
+/// <summary>
+/// \f$z = (LL^T)^{-1} r\f$ by a forward substitution on the rows of L followed by a backward substitution
+/// on its columns, both in place in ``z``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="r"></param>
+/// <param name="z"></param>
+template<typename scalarType>
+void IncompleteCholeskyPreconditioner<scalarType>::operator()(const scalarType* r, scalarType* z) const
+{
+	const int n{ rows() };
+	for (int i{}; i < n; ++i)
+	{
+		scalarType sum{ r[i] };
+		const int diagonal{ _rowStart[i + 1] - 1 };
+		for (int p{ _rowStart[i] }; p < diagonal; ++p)
+			sum -= _values[p] * z[_columns[p]];
+		z[i] = sum / _values[diagonal];
+	}
+	for (int i{ n - 1 }; i >= 0; --i)
+	{
+		const int diagonal{ _rowStart[i + 1] - 1 };
+		const scalarType zi{ z[i] /= _values[diagonal] };
+		for (int p{ _rowStart[i] }; p < diagonal; ++p)
+			z[_columns[p]] -= _values[p] * zi;
+	}
+}
+
+/// <summary>
+/// A Jacobi solver with the given stopping criteria.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="settings"></param>
+template<typename scalarType>
+JacobiSolver<scalarType>::JacobiSolver(IterativeSolverSettings<scalarType> settings) : _settings{ std::move(settings) }, _r{}, _z{}
+{
+}
+
+/// <summary>
+/// The stopping criteria and parameters, which can be changed between solves.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline IterativeSolverSettings<scalarType>& JacobiSolver<scalarType>::settings()
+{
+	return _settings;
+}
+
+/// <summary>
+/// Solve \f$Ax = b\f$ for the square matrix ``a``, starting from ``x`` if it has the size of ``b`` and from zero otherwise.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a">a ``MatrixX``, ``SparseMatrixX`` or ``BandedMatrixX``</param>
+/// <param name="b">column vector</param>
+/// <param name="x">initial guess, overwritten by the solution</param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Matrix, typename AllocatorB, typename AllocatorX>
+IterativeSolverResult<scalarType> JacobiSolver<scalarType>::solve(const Matrix& a, const MatrixX<scalarType, AllocatorB>& b, MatrixX<scalarType, AllocatorX>& x)
+{
+	return solve(internal::linearOperator(a), DiagonalPreconditioner<scalarType>{ a }, b, x);
+}
+
+/// <summary>
+/// Solve \f$Ax = b\f$ for a matrix-free operator ``a(x, y)`` whose diagonal is ``diagonal``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="diagonal"></param>
+/// <param name="b">column vector</param>
+/// <param name="x">initial guess, overwritten by the solution</param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Operator, typename AllocatorB, typename AllocatorX>
+IterativeSolverResult<scalarType> JacobiSolver<scalarType>::solve(const Operator& a, const DiagonalPreconditioner<scalarType>& diagonal, const MatrixX<scalarType, AllocatorB>& b, MatrixX<scalarType, AllocatorX>& x)
+{
+	const int n{ internal::prepareIterativeSolve(diagonal.rows(), b, x) };
+	_r.resize(n);
+	_z.resize(n);
+	const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+	internal::ConvergenceMonitor<scalarType> monitor{ _settings, internal::norm2(b.data(), n) };
+
+	for (int iteration{};; ++iteration)
+	{
+		const scalarType norm{ internal::residual(a, b.data(), x.data(), _r.data(), n) };
+		if (monitor(iteration, norm))
+			break;
+		diagonal(_r.data(), _z.data());
+		kernels.axpy(_settings.omega, _z.data(), x.data(), n);
+	}
+	return monitor.result;
+}
+
+/// <summary>
+/// A Gauss-Seidel (SOR) solver with the given stopping criteria.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="settings"></param>
+template<typename scalarType>
+GaussSeidelSolver<scalarType>::GaussSeidelSolver(IterativeSolverSettings<scalarType> settings) : _settings{ std::move(settings) }, _r{}
+{
+}
+
+/// <summary>
+/// The stopping criteria and parameters, which can be changed between solves.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline IterativeSolverSettings<scalarType>& GaussSeidelSolver<scalarType>::settings()
+{
+	return _settings;
+}
+
+/// <summary>
+/// Alternate residual checks and sweeps ``sweep(x)`` until the monitor stops the iteration.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="sweep"></param>
+/// <param name="b"></param>
+/// <param name="x"></param>
+/// <param name="n"></param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Operator, typename Sweep>
+IterativeSolverResult<scalarType> GaussSeidelSolver<scalarType>::iterate(const Operator& a, Sweep&& sweep, const scalarType* b, scalarType* x, int n)
+{
+	_r.resize(n);
+	internal::ConvergenceMonitor<scalarType> monitor{ _settings, internal::norm2(b, n) };
+	for (int iteration{};; ++iteration)
+	{
+		const scalarType norm{ internal::residual(a, b, x, _r.data(), n) };
+		if (monitor(iteration, norm))
+			break;
+		sweep(x);
+	}
+	return monitor.result;
+}
+
+/// <summary>
+/// Solve \f$Ax = b\f$ for the square matrix ``a``, starting from ``x`` if it has the size of ``b`` and from zero
+/// otherwise. Each sweep computes, for i in increasing order,
+/// \f$x_i := (1 - \omega)x_i + \omega(b_i - \sum_{j \ne i} a_{ij}x_j) / a_{ii}\f$.
+/// Throws ``std::logic_error`` on a zero diagonal coefficient.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="b">column vector</param>
+/// <param name="x">initial guess, overwritten by the solution</param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Allocator, typename AllocatorB, typename AllocatorX>
+IterativeSolverResult<scalarType> GaussSeidelSolver<scalarType>::solve(const MatrixX<scalarType, Allocator>& a, const MatrixX<scalarType, AllocatorB>& b, MatrixX<scalarType, AllocatorX>& x)
+{
+	const int n{ internal::prepareIterativeSolve(internal::operatorOrder(a), b, x) };
+	const internal::DenseOperator<scalarType> op{ internal::linearOperator(a) };
+	for (int i{}; i < n; ++i)
+		if (a.coeff(i * n + i) == scalarType{})
+			throw std::logic_error("Gauss-Seidel requires non-zero diagonal coefficients!");
+
+	const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+	const scalarType omega{ _settings.omega };
+	return iterate(op, [&](scalarType* xi) {
+		for (int i{}; i < n; ++i)
+		{
+			const scalarType* row{ a.data() + static_cast<long long>(i) * n };
+			const scalarType aii{ row[i] };
+			const scalarType offDiagonal{ kernels.dot(row, xi, n) - aii * xi[i] };
+			xi[i] += omega * ((b.coeff(i) - offDiagonal) / aii - xi[i]);
+		}
+	}, b.data(), x.data(), n);
+}
+
+/// <summary>
+/// Solve \f$Ax = b\f$ for the square sparse matrix ``a``, as above. A sweep costs O(nnz).
+/// A CSC matrix must first be converted by ``toRowMajor()``.
+/// Throws ``std::logic_error`` on a zero diagonal coefficient.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="b">column vector</param>
+/// <param name="x">initial guess, overwritten by the solution</param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename AllocatorB, typename AllocatorX>
+IterativeSolverResult<scalarType> GaussSeidelSolver<scalarType>::solve(const SparseMatrixX<scalarType, StorageOrder::RowMajor>& a, const MatrixX<scalarType, AllocatorB>& b, MatrixX<scalarType, AllocatorX>& x)
+{
+	const int n{ internal::prepareIterativeSolve(internal::operatorOrder(a), b, x) };
+	const auto op{ internal::linearOperator(a) };
+	for (int i{}; i < n; ++i)
+		if (a.coeff(i, i) == scalarType{})
+			throw std::logic_error("Gauss-Seidel requires non-zero diagonal coefficients!");
+
+	const int* rowStart{ a.outerStart() };
+	const int* columns{ a.innerIndices() };
+	const scalarType* values{ a.values() };
+	const scalarType omega{ _settings.omega };
+	return iterate(op, [&](scalarType* xi) {
+		for (int i{}; i < n; ++i)
+		{
+			scalarType aii{};
+			scalarType offDiagonal{};
+			for (int p{ rowStart[i] }; p < rowStart[i + 1]; ++p)
+			{
+				if (columns[p] == i)
+					aii = values[p];
+				else
+					offDiagonal += values[p] * xi[columns[p]];
+			}
+			xi[i] += omega * ((b.coeff(i) - offDiagonal) / aii - xi[i]);
+		}
+	}, b.data(), x.data(), n);
+}
+
+/// <summary>
+/// A conjugate gradient solver with the given stopping criteria.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="settings"></param>
+template<typename scalarType>
+ConjugateGradientSolver<scalarType>::ConjugateGradientSolver(IterativeSolverSettings<scalarType> settings)
+	: _settings{ std::move(settings) }, _r{}, _z{}, _p{}, _q{}
+{
+}
+
+/// <summary>
+/// The stopping criteria and parameters, which can be changed between solves.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline IterativeSolverSettings<scalarType>& ConjugateGradientSolver<scalarType>::settings()
+{
+	return _settings;
+}
+
+/// <summary>
+/// Solve \f$Ax = b\f$, starting from ``x`` if it has the size of ``b`` and from zero otherwise.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a">a square ``MatrixX``, or a callable ``a(x, y)`` writing \f$y = Ax\f$</param>
+/// <param name="b">column vector</param>
+/// <param name="x">initial guess, overwritten by the solution</param>
+/// <param name="m">a callable ``m(r, z)`` writing \f$z = M^{-1}r\f$</param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Operator, typename AllocatorB, typename AllocatorX, typename Preconditioner>
+IterativeSolverResult<scalarType> ConjugateGradientSolver<scalarType>::solve(const Operator& a, const MatrixX<scalarType, AllocatorB>& b, MatrixX<scalarType, AllocatorX>& x, const Preconditioner& m)
+{
+	const int n{ internal::prepareIterativeSolve(internal::operatorOrder(a), b, x) };
+	const auto& op{ internal::linearOperator(a) };
+	_r.resize(n);
+	_z.resize(n);
+	_p.resize(n);
+	_q.resize(n);
+	const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+	internal::ConvergenceMonitor<scalarType> monitor{ _settings, internal::norm2(b.data(), n) };
+	scalarType* r{ _r.data() };
+	scalarType* p{ _p.data() };
+	scalarType* q{ _q.data() };
+
+	scalarType norm{ internal::residual(op, b.data(), x.data(), r, n) };
+	const scalarType* z{ internal::precondition(m, r, _z.data()) };
+	std::copy(z, z + n, p);
+	scalarType rz{ kernels.dot(r, z, n) };
+	for (int iteration{};; ++iteration)
+	{
+		if (monitor(iteration, norm))
+			break;
+		op(p, q);
+		const scalarType pq{ kernels.dot(p, q, n) };
+		if (!(pq > scalarType{}))
+			break;		// A is not positive definite, or p vanished
+		const scalarType alpha{ rz / pq };
+		kernels.axpy(alpha, p, x.data(), n);
+		kernels.axpy(-alpha, q, r, n);
+		norm = internal::norm2(r, n);
+
+		z = internal::precondition(m, r, _z.data());
+		const scalarType rzNext{ kernels.dot(r, z, n) };
+		const scalarType beta{ rzNext / rz };
+		rz = rzNext;
+		// p := z + beta p
+		kernels.scale(p, beta, p, n);
+		kernels.add(z, p, p, n);
+	}
+	return monitor.result;
+}
+
+/// <summary>
+/// A GMRES solver with the given stopping criteria and restart length.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="settings"></param>
+template<typename scalarType>
+GMRESSolver<scalarType>::GMRESSolver(IterativeSolverSettings<scalarType> settings)
+	: _settings{ std::move(settings) }, _v{}, _h{}, _cosines{}, _sines{}, _g{}, _w{}, _z{}
+{
+}
+
+/// <summary>
+/// The stopping criteria and parameters, which can be changed between solves.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline IterativeSolverSettings<scalarType>& GMRESSolver<scalarType>::settings()
+{
+	return _settings;
+}
+
+/// <summary>
+/// Solve \f$Ax = b\f$, starting from ``x`` if it has the size of ``b`` and from zero otherwise. Every
+/// Arnoldi step counts as one iteration; the residual reported between restarts is the least-squares
+/// estimate, and the true residual is recomputed at each restart.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a">a square ``MatrixX``, or a callable ``a(x, y)`` writing \f$y = Ax\f$</param>
+/// <param name="b">column vector</param>
+/// <param name="x">initial guess, overwritten by the solution</param>
+/// <param name="m">a callable ``m(r, z)`` writing \f$z = M^{-1}r\f$</param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Operator, typename AllocatorB, typename AllocatorX, typename Preconditioner>
+IterativeSolverResult<scalarType> GMRESSolver<scalarType>::solve(const Operator& a, const MatrixX<scalarType, AllocatorB>& b, MatrixX<scalarType, AllocatorX>& x, const Preconditioner& m)
+{
+	const int n{ internal::prepareIterativeSolve(internal::operatorOrder(a), b, x) };
+	const auto& op{ internal::linearOperator(a) };
+	const int restart{ std::max(1, _settings.restart) };
+	_v.resize(static_cast<std::size_t>(restart + 1) * n);
+	_h.resize(static_cast<std::size_t>(restart + 1) * restart);
+	_cosines.resize(restart);
+	_sines.resize(restart);
+	_g.resize(restart + 1);
+	_w.resize(n);
+	_z.resize(n);
+	const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+	internal::ConvergenceMonitor<scalarType> monitor{ _settings, internal::norm2(b.data(), n) };
+	scalarType* h{ _h.data() };
+	scalarType* g{ _g.data() };
+
+	int iteration{};
+	scalarType beta{ internal::residual(op, b.data(), x.data(), _v.data(), n) };
+	bool stop{ monitor(iteration, beta) };
+	while (!stop)
+	{
+		// v_0 = r / |r|
+		kernels.scale(_v.data(), scalarType{ 1 } / beta, _v.data(), n);
+		std::fill(g, g + restart + 1, scalarType{});
+		g[0] = beta;
+
+		int k{};
+		while (k < restart && !stop)
+		{
+			const scalarType* vk{ _v.data() + static_cast<std::size_t>(k) * n };
+			scalarType* w{ _v.data() + static_cast<std::size_t>(k + 1) * n };
+			op(internal::precondition(m, vk, _z.data()), w);
+			for (int i{}; i <= k; ++i)
+			{
+				const scalarType* vi{ _v.data() + static_cast<std::size_t>(i) * n };
+				const scalarType hik{ kernels.dot(w, vi, n) };
+				h[i * restart + k] = hik;
+				kernels.axpy(-hik, vi, w, n);
+			}
+			const scalarType hNext{ internal::norm2(w, n) };
+			if (hNext > scalarType{})
+				kernels.scale(w, scalarType{ 1 } / hNext, w, n);
+
+			// Apply the previous rotations to column k of H, then the rotation that zeroes h(k + 1, k).
+			for (int i{}; i < k; ++i)
+			{
+				const scalarType upper{ h[i * restart + k] };
+				const scalarType lower{ h[(i + 1) * restart + k] };
+				h[i * restart + k] = _cosines[i] * upper + _sines[i] * lower;
+				h[(i + 1) * restart + k] = -_sines[i] * upper + _cosines[i] * lower;
+			}
+			const scalarType diagonal{ h[k * restart + k] };
+			const scalarType radius{ std::hypot(diagonal, hNext) };
+			_cosines[k] = radius > scalarType{} ? diagonal / radius : scalarType{ 1 };
+			_sines[k] = radius > scalarType{} ? hNext / radius : scalarType{};
+			h[k * restart + k] = radius;
+			g[k + 1] = -_sines[k] * g[k];
+			g[k] *= _cosines[k];
+			++k;
+
+			stop = monitor(++iteration, std::abs(g[k])) || !(hNext > scalarType{});
+		}
+
+		// Back substitution for y in H y = g, then x := x + M^-1 V y.
+		for (int i{ k - 1 }; i >= 0; --i)
+		{
+			scalarType sum{ g[i] };
+			for (int j{ i + 1 }; j < k; ++j)
+				sum -= h[i * restart + j] * g[j];
+			g[i] = h[i * restart + i] != scalarType{} ? sum / h[i * restart + i] : scalarType{};
+		}
+		std::fill(_w.begin(), _w.end(), scalarType{});
+		for (int i{}; i < k; ++i)
+			kernels.axpy(g[i], _v.data() + static_cast<std::size_t>(i) * n, _w.data(), n);
+		const scalarType* update{ internal::precondition(m, _w.data(), _z.data()) };
+		kernels.add(x.data(), update, x.data(), n);
+
+		beta = internal::residual(op, b.data(), x.data(), _v.data(), n);
+		if (stop || !(beta > scalarType{}))
+		{
+			// Report the true residual of the returned x rather than the estimate.
+			monitor.record(beta);
+			stop = true;
+		}
+	}
+	return monitor.result;
+}
+
+#endif // !ITERATIVE_SOLVERS_H
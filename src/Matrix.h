@@ -1,13 +1,15 @@
 #pragma once
 #ifndef Matrix_H
+#define Matrix_H
+
 #include <array>
-#include <vector>
 #include <stdexcept>
 #include <type_traits>
-#include <iterator>
+#include <utility>
 #include <iomanip>
+#include <ostream>
 #include <initializer_list>
-#include <algorithm>
+#include <cassert>
 
 template <typename T, int r = 0, int c = 0>
 class Matrix;
@@ -44,6 +46,47 @@ using Vector4f = Matrix<float, 1, 4>;
 
 
 
+/// Fixed-size matrices.
+//
+/// The dimensions of a ``Matrix<scalarType, rows, cols>`` are template parameters, so a matrix is nothing
+/// but its ``rows * cols`` coefficients: it is trivially copyable, can be built and used in constant
+/// expressions, and combining matrices of mismatched dimensions is a compile error rather than a runtime
+/// exception.
+///
+/// Products, determinants and inverses are unrolled at compile time into straight-line code (closed-form
+/// cofactor expansions for the determinant and inverse of 2x2, 3x3 and 4x4 matrices), without loops or
+/// branches the compiler has to see through. Column vectors are ``Matrix<scalarType, n, 1>``, so that
+/// a matrix-vector product is an ordinary product:
+///
+/// ```
+/// constexpr Matrix3d rotation{ {0, -1, 0}, {1, 0, 0}, {0, 0, 1} };
+/// Matrix<double, 3, 1> x;
+/// x << 1, 2, 3;
+/// Matrix<double, 3, 1> y{ rotation.inverse() * x };
+/// ```
+
+/// <summary>
+/// Proxy returned by ``Matrix::operator<<``: each ``,`` writes the next coefficient in row-major order.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType, int sizeAtCompileTime>
+class MatrixCommaInitializer
+{
+private:
+	scalarType* _data;
+	int _index;
+public:
+	constexpr MatrixCommaInitializer(scalarType* data, int index) : _data{ data }, _index{ index } {}
+
+	constexpr MatrixCommaInitializer& operator,(const scalarType x)
+	{
+		if (_index >= sizeAtCompileTime)
+			throw std::logic_error("Error: Attempting to set values beyond matrix bounds!");
+		_data[_index++] = x;
+		return *this;
+	}
+};
+
 /// <summary>
 /// Class template for fixed-size matrices.
 /// </summary>
@@ -53,33 +96,34 @@ using Vector4f = Matrix<float, 1, 4>;
 template <typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
 class Matrix
 {
+	static_assert(rowsAtCompileTime > 0 && colsAtCompileTime > 0, "a fixed-size matrix must have at least one row and one column");
 private:
 	std::array<scalarType, rowsAtCompileTime* colsAtCompileTime> A;
-	int _rows;
-	int _cols;
-	int _size;
-	typename std::array<scalarType, rowsAtCompileTime* colsAtCompileTime>::iterator currentPosition;
 public:
-	Matrix();
-	Matrix(int m, int n);
-	Matrix(const Matrix& m);
-	Matrix(std::initializer_list<std::initializer_list<scalarType>>);
+	constexpr Matrix();
+	constexpr Matrix(int m, int n);
+	constexpr Matrix(std::initializer_list<std::initializer_list<scalarType>>);
 
-	int rows() const;
-	int cols() const;
-	int size() const;
+	static constexpr int rows() { return rowsAtCompileTime; }
+	static constexpr int cols() { return colsAtCompileTime; }
+	static constexpr int size() { return rowsAtCompileTime * colsAtCompileTime; }
+	constexpr scalarType* data() { return A.data(); }
+	constexpr const scalarType* data() const { return A.data(); }
 
 	//Overloaded operators
-	scalarType operator()(const int i, const int j) const;		//Subscript operator
-	scalarType& operator()(const int i, const int j);			//Subscript operator const arrays
-	Matrix operator+(const Matrix& m) const;
-	Matrix operator-(const Matrix& m) const;
-	Matrix& operator<<(const scalarType x);
-	Matrix& operator,(const scalarType x);
-	Matrix& operator=(const Matrix& right_hand_side);
-	bool operator==(const Matrix& right_hand_side);
-	Matrix& operator+=(const Matrix& m);
-	Matrix& operator-=(const Matrix& m);
+	constexpr scalarType operator()(const int i, const int j) const;		//Subscript operator
+	constexpr scalarType& operator()(const int i, const int j);			//Subscript operator const arrays
+	constexpr scalarType coeff(const int i, const int j) const;			//Unchecked accessors
+	constexpr scalarType& coeffRef(const int i, const int j);
+	constexpr Matrix operator+(const Matrix& m) const;
+	constexpr Matrix operator-(const Matrix& m) const;
+	constexpr MatrixCommaInitializer<scalarType, rowsAtCompileTime* colsAtCompileTime> operator<<(const scalarType x);
+	constexpr bool operator==(const Matrix& right_hand_side) const;
+	constexpr Matrix& operator+=(const Matrix& m);
+	constexpr Matrix& operator-=(const Matrix& m);
+
+	constexpr scalarType determinant() const;
+	constexpr Matrix inverse() const;
 	
 	//Matrix& transpose();
 
@@ -87,28 +131,92 @@ public:
 
 // Global operators
 template<typename scalarType, int m, int n, int p, int q>
-Matrix<scalarType, m, q> operator*(const Matrix<scalarType, m, n>& A, const Matrix<scalarType, p, q>& B);
+constexpr Matrix<scalarType, m, q> operator*(const Matrix<scalarType, m, n>& A, const Matrix<scalarType, p, q>& B);
 
 
 template<typename scalarType, int m, int n>
-Matrix<scalarType, m, n> operator*(const scalarType k, const Matrix<scalarType, m, n>& mat);
+constexpr Matrix<scalarType, m, n> operator*(const scalarType k, const Matrix<scalarType, m, n>& mat);
 
 // Non-member operator functions
 template<typename scalarType, int m, int n, int p, int q>
-Matrix<scalarType, m, q>& operator*=(Matrix<scalarType, m, n>& A, const Matrix<scalarType, p, q>& B);
+constexpr Matrix<scalarType, m, n>& operator*=(Matrix<scalarType, m, n>& A, const Matrix<scalarType, p, q>& B);
 
 
 template<typename scalarType, int m, int n>
-Matrix<scalarType, m, n>& operator*=(const scalarType k, Matrix<scalarType, m, n>& mat);
+constexpr Matrix<scalarType, m, n>& operator*=(const scalarType k, Matrix<scalarType, m, n>& mat);
+
+namespace internal
+{
+	/// <summary>
+	/// Products with at most this many multiplications are unrolled completely; larger ones loop.
+	/// </summary>
+	constexpr int maxUnrolledProduct{ 64 };
+
+	/// <summary>
+	/// The coefficient (i, k) of the product AB as one expression: A(i,0)B(0,k) + ... + A(i,n-1)B(n-1,k),
+	/// summed in the same order as the loop.
+	/// </summary>
+	template<typename scalarType, int m, int n, int q, int... j>
+	constexpr scalarType productCoeff(const Matrix<scalarType, m, n>& A, const Matrix<scalarType, n, q>& B, int i, int k, std::integer_sequence<int, j...>)
+	{
+		return (... + (A.coeff(i, j) * B.coeff(j, k)));
+	}
+
+	/// <summary>
+	/// AB with one statement per coefficient of the result, indexed by k = i * q + j.
+	/// </summary>
+	template<typename scalarType, int m, int n, int q, int... k>
+	constexpr Matrix<scalarType, m, q> multiplyUnrolled(const Matrix<scalarType, m, n>& A, const Matrix<scalarType, n, q>& B, std::integer_sequence<int, k...>)
+	{
+		Matrix<scalarType, m, q> result;
+		((result.coeffRef(k / q, k % q) = productCoeff(A, B, k / q, k % q, std::make_integer_sequence<int, n>{})), ...);
+		return result;
+	}
+
+	/// <summary>
+	/// The 2x2 minors of rows (0, 1) and of rows (2, 3) of a 4x4 matrix, shared by its determinant and inverse.
+	/// ``s[0..5]`` are the minors of columns (0,1), (0,2), (0,3), (1,2), (1,3), (2,3) of the top rows and
+	/// ``c[0..5]`` those of the bottom rows.
+	/// </summary>
+	template<typename scalarType>
+	struct Minors4
+	{
+		scalarType s[6];
+		scalarType c[6];
+
+		constexpr explicit Minors4(const Matrix<scalarType, 4, 4>& a) :
+			s{ a.coeff(0, 0) * a.coeff(1, 1) - a.coeff(1, 0) * a.coeff(0, 1),
+				a.coeff(0, 0) * a.coeff(1, 2) - a.coeff(1, 0) * a.coeff(0, 2),
+				a.coeff(0, 0) * a.coeff(1, 3) - a.coeff(1, 0) * a.coeff(0, 3),
+				a.coeff(0, 1) * a.coeff(1, 2) - a.coeff(1, 1) * a.coeff(0, 2),
+				a.coeff(0, 1) * a.coeff(1, 3) - a.coeff(1, 1) * a.coeff(0, 3),
+				a.coeff(0, 2) * a.coeff(1, 3) - a.coeff(1, 2) * a.coeff(0, 3) },
+			c{ a.coeff(2, 0) * a.coeff(3, 1) - a.coeff(3, 0) * a.coeff(2, 1),
+				a.coeff(2, 0) * a.coeff(3, 2) - a.coeff(3, 0) * a.coeff(2, 2),
+				a.coeff(2, 0) * a.coeff(3, 3) - a.coeff(3, 0) * a.coeff(2, 3),
+				a.coeff(2, 1) * a.coeff(3, 2) - a.coeff(3, 1) * a.coeff(2, 2),
+				a.coeff(2, 1) * a.coeff(3, 3) - a.coeff(3, 1) * a.coeff(2, 3),
+				a.coeff(2, 2) * a.coeff(3, 3) - a.coeff(3, 2) * a.coeff(2, 3) }
+		{
+		}
+
+		/// <summary>
+		/// Laplace expansion along the top two rows.
+		/// </summary>
+		constexpr scalarType determinant() const
+		{
+			return s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0];
+		}
+	};
+}
 
 /// <summary>
-/// The default constructor.
+/// The default constructor. The coefficients are zero.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>::Matrix() :_rows{ rowsAtCompileTime }, _cols{ colsAtCompileTime }, _size{ rowsAtCompileTime * colsAtCompileTime }
+constexpr Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::Matrix() : A{}
 {
-	currentPosition = A.begin();
 }
 
 /// <summary>
@@ -120,261 +228,320 @@ inline Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>::Matrix
 /// <param name="m"></param>
 /// <param name="n"></param>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>::Matrix(int m, int n)
+constexpr Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::Matrix(int, int) : A{}
 {
-	//Do nothing.
 }
 
 /// <summary>
-/// Copy constructor.
-/// Creates a deep copy of the Matrix object passed.
-/// </summary>
-/// <typeparam name="scalarType"></typeparam>
-/// <param name="m"></param>
-template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>::Matrix(const Matrix& m) : A{ m.A }, _rows{ m.rows() }, _cols{ m.cols() }, currentPosition{ m.currentPosition }
-{
-}
-
-/// <summary>
-/// Allocates and initializes a matrix using the curly brace initializer list.
+/// Initializes a matrix using the curly brace initializer list. Coefficients left out are zero;
+/// throws ``std::logic_error`` if the list has more rows or columns than the matrix.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="list"></param>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>::Matrix(std::initializer_list<std::initializer_list<scalarType>> list) :Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>{}	//Delegate to the default constructor to set up the initial array
+constexpr Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::Matrix(std::initializer_list<std::initializer_list<scalarType>> list) : A{}
 {
-	// Initialize the array from our list.
-	typename std::array<scalarType, rowsAtCompileTime* colsAtCompileTime>::iterator A_it{ A.begin() };
-	typename std::initializer_list<std::initializer_list<scalarType>>::iterator i{};
+	if (list.size() > static_cast<std::size_t>(rowsAtCompileTime))
+		throw std::logic_error("Error: Attempting to set values beyond matrix bounds!");
 
-	for (i = list.begin(); i < list.end(); ++i)
+	int i{};
+	for (const std::initializer_list<scalarType>& row : list)
 	{
-		typename std::initializer_list<scalarType>::iterator j{};
-		for (j = (*i).begin(); j < (*i).end(); ++j)
-		{
-			*A_it = *j;
-			++A_it;
-		}
+		if (row.size() > static_cast<std::size_t>(colsAtCompileTime))
+			throw std::logic_error("Error: Attempting to set values beyond matrix bounds!");
+
+		int j{};
+		for (const scalarType& x : row)
+			A[i * colsAtCompileTime + j++] = x;
+		++i;
 	}
 }
 
 /// <summary>
-/// Getter method for the number of rows of the matrix.
+/// Coefficient accessor.
+/// This routine overloads the parentheses operator ``()``. ``A(i,j)`` is used the retrieve
+/// the element \f$a_{ij}\f$ belonging to the matrix \f$A\f$. This is const-version of the method,
+/// that works on const Matrix objects.
+/// Throws ``std::out_of_range`` unless \f$0 \le i < rows\f$ and \f$0 \le j < cols\f$. Defining
+/// ``MATHLIB_NO_BOUNDS_CHECK`` removes the check, making ``A(i,j)`` the same as ``A.coeff(i,j)``.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline int Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::rows() const
+constexpr scalarType Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::operator()(const int i, const int j) const
 {
-	return _rows;
+#ifndef MATHLIB_NO_BOUNDS_CHECK
+	if (i < 0 || i >= rowsAtCompileTime || j < 0 || j >= colsAtCompileTime)
+		throw std::out_of_range("\nError accessing an element beyond matrix bounds");
+#endif
+	return A[i * colsAtCompileTime + j];
 }
 
 /// <summary>
-/// Getter method for the number of columns of the matrix.
+/// Coefficient accessor.
+/// This routine retrieves the element in the (i,j) place of the matrix. This works on non-const Matrix
+/// objects. Bounds are checked as in the const version.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline int Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::cols() const
+constexpr scalarType& Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::operator()(const int i, const int j)
 {
-	return _cols;
+#ifndef MATHLIB_NO_BOUNDS_CHECK
+	if (i < 0 || i >= rowsAtCompileTime || j < 0 || j >= colsAtCompileTime)
+		throw std::out_of_range("\nError accessing an element beyond matrix bounds");
+#endif
+	return A[i * colsAtCompileTime + j];
 }
 
 /// <summary>
-/// Getter method for the size (the total number of elements) of the matrix.
+/// Coefficient accessor without bounds checking, used by the kernels of the library.
+/// Out-of-range indices are caught by an assertion in debug builds.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline int Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::size() const
+constexpr scalarType Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::coeff(const int i, const int j) const
 {
-	return A.size();
+	assert(i >= 0 && i < rowsAtCompileTime && j >= 0 && j < colsAtCompileTime);
+	return A[i * colsAtCompileTime + j];
 }
 
 /// <summary>
-/// Coefficient accessor.
-/// This routine overloads the parentheses operator ``()``. ``A(i,j)`` is used the retrieve
-/// the element \f$a_{ij}\f$ belonging to the matrix \f$A\f$. This is const-version of the method,
-/// that works on const Matrix objects.
+/// Writable coefficient accessor without bounds checking, the counterpart of ``coeff(i,j)``.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="i"></param>
 /// <param name="j"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline scalarType Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>::operator()(const int i, const int j) const
+constexpr scalarType& Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::coeffRef(const int i, const int j)
 {
-	typename std::array<scalarType, rowsAtCompileTime* colsAtCompileTime>::const_iterator it{ A.begin() };
-	it = it + (i * _cols) + j;
-	if (it < A.end())
-		return *it;
-	else
-		throw std::out_of_range("\nError accessing an element beyond matrix bounds");
+	assert(i >= 0 && i < rowsAtCompileTime && j >= 0 && j < colsAtCompileTime);
+	return A[i * colsAtCompileTime + j];
 }
 
 /// <summary>
-/// Coefficient accessor.
-/// This routine retrieves the element in the (i,j) place of the matrix. This works on non-const Matrix
-/// objects.
+/// Matrix addition.
+/// This routine overloads the binary addition operator ``+`` and is used to add two matrices.
+/// The loop runs over the compile-time size on the raw array, so that the compiler fully unrolls and
+/// vectorizes it; fixed-size matrices are too small to amortize a runtime SIMD dispatch.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-/// <param name="i"></param>
-/// <param name="j"></param>
+/// <param name="m"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline scalarType& Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>::operator()(const int i, const int j)
+constexpr Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime> Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::operator+(const Matrix& m) const
 {
-	typename std::array<scalarType, rowsAtCompileTime* colsAtCompileTime>::iterator it{ A.begin() };
-	it = it + (i * _cols) + j;
-	if (it < A.end())
-		return *it;
-	else
-		throw std::out_of_range("\nError accessing an element beyond matrix bounds");
+	Matrix result{ *this };
+	result += m;
+	return result;
 }
 
 /// <summary>
-/// Matrix addition.
-/// This routine overloads the binary addition operator ``+`` and is used to add two matrices.
+/// Matrix subtraction.
+/// This routine overloads the binary subtraction operator ``-`` and is used to subtract two matrices.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="m"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime> Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>::operator+(const Matrix& m) const
+constexpr Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime> Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::operator-(const Matrix& m) const
 {
-	Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime> result{};
+	Matrix result{ *this };
+	result -= m;
+	return result;
+}
 
-	if (this->rows() == m.rows() && this->cols() == m.cols())
-	{
-		for (int i{}; i < A.size(); ++i)
-			result.A[i] = A[i] + m.A[i];
-		return result;
-	}
-	else
-	{
-		throw std::logic_error("Matrices have different dimensions; therefore cannot be added!");
-	}
+/// <summary>
+/// Overload the ``<<`` operator to initialize a matrix: ``m << 1, 2, 3, 4;`` sets the coefficients
+/// in row-major order, starting from the first. Throws ``std::logic_error`` past the last coefficient.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="x"></param>
+/// <returns></returns>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+constexpr MatrixCommaInitializer<scalarType, rowsAtCompileTime* colsAtCompileTime> Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::operator<<(const scalarType x)
+{
+	A[0] = x;
+	return MatrixCommaInitializer<scalarType, rowsAtCompileTime* colsAtCompileTime>{ A.data(), 1 };
 }
 
 /// <summary>
-/// Matrix subtraction.
-/// This routine overloads the binary subtraction operator ``-`` and is used to subtract two matrices.
+/// Addition assignment operator. Adds m to this matrix in place.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="m"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime> Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>::operator-(const Matrix& m) const
+constexpr Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::operator+=(const Matrix& m)
 {
-	Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime> result{};
-
-	if (this->rows() == m.rows() && this->cols() == m.cols())
-	{
-		for (int i{}; i < A.size(); ++i)
-			result.A[i] = A[i] - m.A[i];
-		return result;
-	}
-	else
-	{
-		throw std::logic_error("Matrices have different dimensions; therefore cannot be added!");
-	}
+	constexpr int size{ rowsAtCompileTime * colsAtCompileTime };
+	for (int i{}; i < size; ++i)
+		A[i] += m.A[i];
+	return *this;
 }
 
 /// <summary>
-/// Overload the ``<<`` operator to initialize a matrix.
+/// Subtraction assignment operator. Subtracts m from this matrix in place.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-/// <param name="x"></param>
+/// <param name="m"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>& Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>::operator<<(const scalarType x)
+constexpr Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::operator-=(const Matrix& m)
 {
-	if (currentPosition < A.end())
-	{
-		*currentPosition = x;
-		++currentPosition;
-	}
-	else
-	{
-		throw std::logic_error("Error: Attempting to set values beyond matrix bounds!");
-	}
+	constexpr int size{ rowsAtCompileTime * colsAtCompileTime };
+	for (int i{}; i < size; ++i)
+		A[i] -= m.A[i];
 	return *this;
 }
 
 /// <summary>
-/// Overload the ``,`` operator to initialize a matrix.
+/// Determinant of a square matrix of at most 4 rows, by cofactor expansion.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-/// <param name="x"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>& Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>::operator,(const scalarType x)
+constexpr scalarType Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::determinant() const
 {
-	if (currentPosition < A.end())
-	{
-		*currentPosition = x;
-		++currentPosition;
-	}
+	static_assert(rowsAtCompileTime == colsAtCompileTime, "the determinant is only defined for square matrices");
+	static_assert(rowsAtCompileTime <= 4, "determinant() is implemented for matrices up to 4x4");
+
+	const Matrix& a{ *this };
+	if constexpr (rowsAtCompileTime == 1)
+		return a.coeff(0, 0);
+	else if constexpr (rowsAtCompileTime == 2)
+		return a.coeff(0, 0) * a.coeff(1, 1) - a.coeff(0, 1) * a.coeff(1, 0);
+	else if constexpr (rowsAtCompileTime == 3)
+		return a.coeff(0, 0) * (a.coeff(1, 1) * a.coeff(2, 2) - a.coeff(1, 2) * a.coeff(2, 1))
+			- a.coeff(0, 1) * (a.coeff(1, 0) * a.coeff(2, 2) - a.coeff(1, 2) * a.coeff(2, 0))
+			+ a.coeff(0, 2) * (a.coeff(1, 0) * a.coeff(2, 1) - a.coeff(1, 1) * a.coeff(2, 0));
 	else
-	{
-		throw std::logic_error("Error: Attempting to set values beyond matrix bounds!");
-	}
-	return *this;
+		return internal::Minors4<scalarType>{ a }.determinant();
 }
 
 /// <summary>
-/// Copy assignment operator.
+/// Inverse of a square floating-point matrix of at most 4 rows: the adjugate divided by the determinant.
+/// Throws ``std::logic_error`` if the matrix is singular.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-/// <param name="right_hand_side"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>& Matrix<typename scalarType, rowsAtCompileTime, colsAtCompileTime>::operator=(const Matrix& right_hand_side)
+constexpr Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime> Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::inverse() const
 {
-	if (this->rows() != right_hand_side.rows() || this->cols() != right_hand_side.cols())
-		throw std::logic_error("Assignment failed, matrices have different dimensions");
-
-	if (this == &right_hand_side)
-		return *this;
+	static_assert(rowsAtCompileTime == colsAtCompileTime, "only square matrices can be inverted");
+	static_assert(rowsAtCompileTime <= 4, "inverse() is implemented for matrices up to 4x4");
+	static_assert(std::is_floating_point<scalarType>::value, "inverse() requires a floating-point scalar type");
 
-	this->A = right_hand_side.A;
-	this->_rows = right_hand_side._rows;
-	this->_cols = right_hand_side._cols;
-	this->currentPosition = right_hand_side.currentPosition;
-	return *this;
+	const Matrix& a{ *this };
+	Matrix r;
+	if constexpr (rowsAtCompileTime == 1)
+	{
+		if (a.coeff(0, 0) == scalarType{})
+			throw std::logic_error("The matrix is singular; therefore cannot be inverted!");
+		r.coeffRef(0, 0) = scalarType{ 1 } / a.coeff(0, 0);
+	}
+	else if constexpr (rowsAtCompileTime == 2)
+	{
+		const scalarType det{ determinant() };
+		if (det == scalarType{})
+			throw std::logic_error("The matrix is singular; therefore cannot be inverted!");
+		const scalarType k{ scalarType{ 1 } / det };
+		r.coeffRef(0, 0) = a.coeff(1, 1) * k;
+		r.coeffRef(0, 1) = -a.coeff(0, 1) * k;
+		r.coeffRef(1, 0) = -a.coeff(1, 0) * k;
+		r.coeffRef(1, 1) = a.coeff(0, 0) * k;
+	}
+	else if constexpr (rowsAtCompileTime == 3)
+	{
+		// Cofactors of the first column, reused by the determinant.
+		const scalarType c00{ a.coeff(1, 1) * a.coeff(2, 2) - a.coeff(1, 2) * a.coeff(2, 1) };
+		const scalarType c10{ a.coeff(1, 2) * a.coeff(2, 0) - a.coeff(1, 0) * a.coeff(2, 2) };
+		const scalarType c20{ a.coeff(1, 0) * a.coeff(2, 1) - a.coeff(1, 1) * a.coeff(2, 0) };
+		const scalarType det{ a.coeff(0, 0) * c00 + a.coeff(0, 1) * c10 + a.coeff(0, 2) * c20 };
+		if (det == scalarType{})
+			throw std::logic_error("The matrix is singular; therefore cannot be inverted!");
+		const scalarType k{ scalarType{ 1 } / det };
+		r.coeffRef(0, 0) = c00 * k;
+		r.coeffRef(0, 1) = (a.coeff(0, 2) * a.coeff(2, 1) - a.coeff(0, 1) * a.coeff(2, 2)) * k;
+		r.coeffRef(0, 2) = (a.coeff(0, 1) * a.coeff(1, 2) - a.coeff(0, 2) * a.coeff(1, 1)) * k;
+		r.coeffRef(1, 0) = c10 * k;
+		r.coeffRef(1, 1) = (a.coeff(0, 0) * a.coeff(2, 2) - a.coeff(0, 2) * a.coeff(2, 0)) * k;
+		r.coeffRef(1, 2) = (a.coeff(0, 2) * a.coeff(1, 0) - a.coeff(0, 0) * a.coeff(1, 2)) * k;
+		r.coeffRef(2, 0) = c20 * k;
+		r.coeffRef(2, 1) = (a.coeff(0, 1) * a.coeff(2, 0) - a.coeff(0, 0) * a.coeff(2, 1)) * k;
+		r.coeffRef(2, 2) = (a.coeff(0, 0) * a.coeff(1, 1) - a.coeff(0, 1) * a.coeff(1, 0)) * k;
+	}
+	else
+	{
+		const internal::Minors4<scalarType> minors{ a };
+		const scalarType* s{ minors.s };
+		const scalarType* c{ minors.c };
+		const scalarType det{ minors.determinant() };
+		if (det == scalarType{})
+			throw std::logic_error("The matrix is singular; therefore cannot be inverted!");
+		const scalarType k{ scalarType{ 1 } / det };
+		r.coeffRef(0, 0) = (a.coeff(1, 1) * c[5] - a.coeff(1, 2) * c[4] + a.coeff(1, 3) * c[3]) * k;
+		r.coeffRef(0, 1) = (-a.coeff(0, 1) * c[5] + a.coeff(0, 2) * c[4] - a.coeff(0, 3) * c[3]) * k;
+		r.coeffRef(0, 2) = (a.coeff(3, 1) * s[5] - a.coeff(3, 2) * s[4] + a.coeff(3, 3) * s[3]) * k;
+		r.coeffRef(0, 3) = (-a.coeff(2, 1) * s[5] + a.coeff(2, 2) * s[4] - a.coeff(2, 3) * s[3]) * k;
+		r.coeffRef(1, 0) = (-a.coeff(1, 0) * c[5] + a.coeff(1, 2) * c[2] - a.coeff(1, 3) * c[1]) * k;
+		r.coeffRef(1, 1) = (a.coeff(0, 0) * c[5] - a.coeff(0, 2) * c[2] + a.coeff(0, 3) * c[1]) * k;
+		r.coeffRef(1, 2) = (-a.coeff(3, 0) * s[5] + a.coeff(3, 2) * s[2] - a.coeff(3, 3) * s[1]) * k;
+		r.coeffRef(1, 3) = (a.coeff(2, 0) * s[5] - a.coeff(2, 2) * s[2] + a.coeff(2, 3) * s[1]) * k;
+		r.coeffRef(2, 0) = (a.coeff(1, 0) * c[4] - a.coeff(1, 1) * c[2] + a.coeff(1, 3) * c[0]) * k;
+		r.coeffRef(2, 1) = (-a.coeff(0, 0) * c[4] + a.coeff(0, 1) * c[2] - a.coeff(0, 3) * c[0]) * k;
+		r.coeffRef(2, 2) = (a.coeff(3, 0) * s[4] - a.coeff(3, 1) * s[2] + a.coeff(3, 3) * s[0]) * k;
+		r.coeffRef(2, 3) = (-a.coeff(2, 0) * s[4] + a.coeff(2, 1) * s[2] - a.coeff(2, 3) * s[0]) * k;
+		r.coeffRef(3, 0) = (-a.coeff(1, 0) * c[3] + a.coeff(1, 1) * c[1] - a.coeff(1, 2) * c[0]) * k;
+		r.coeffRef(3, 1) = (a.coeff(0, 0) * c[3] - a.coeff(0, 1) * c[1] + a.coeff(0, 2) * c[0]) * k;
+		r.coeffRef(3, 2) = (-a.coeff(3, 0) * s[3] + a.coeff(3, 1) * s[1] - a.coeff(3, 2) * s[0]) * k;
+		r.coeffRef(3, 3) = (a.coeff(2, 0) * s[3] - a.coeff(2, 1) * s[1] + a.coeff(2, 2) * s[0]) * k;
+	}
+	return r;
 }
 
-
 /// <summary>
-/// Matrix multiplication.
+/// Matrix multiplication. The inner dimensions must agree: multiplying an m x n matrix by a p x q
+/// matrix with n != p does not compile. Small products (up to 4x4 by 4x4) are fully unrolled.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="A"></param>
 /// <param name="B"></param>
 /// <returns></returns>
 template<typename scalarType, int m, int n, int p, int q>
-Matrix<scalarType, m, q> operator*(const Matrix<scalarType, m, n>& A, const Matrix<scalarType, p, q>& B)
+constexpr Matrix<scalarType, m, q> operator*(const Matrix<scalarType, m, n>& A, const Matrix<scalarType, p, q>& B)
 {
-	if (n != p)
-		throw std::logic_error("Error multiplying the matrices; the number of cols(A) must equal the number of rows(B)!");
+	static_assert(n == p, "Error multiplying the matrices; the number of cols(A) must equal the number of rows(B)!");
 
-	Matrix<scalarType, m, q, std::array<scalarType, m* q>> result;
-
-	for (int i{}; i < m; ++i)
+	if constexpr (m * n * q <= internal::maxUnrolledProduct)
 	{
-		for (int k{}; k < p; ++k)
+		return internal::multiplyUnrolled(A, B, std::make_integer_sequence<int, m * q>{});
+	}
+	else
+	{
+		Matrix<scalarType, m, q> result;
+		for (int i{}; i < m; ++i)
 		{
-			scalarType sum{};
-			for (int j{}; j < n; ++j)
+			for (int k{}; k < q; ++k)
 			{
-				sum += A(i, j) * B(j, k);
+				scalarType sum{};
+				for (int j{}; j < n; ++j)
+				{
+					sum += A.coeff(i, j) * B.coeff(j, k);
+				}
+				result.coeffRef(i, k) = sum;
 			}
-			result(i, k) = sum;
 		}
+		return result;
 	}
-
-	return result;
 }
 
 /// <summary>
@@ -385,7 +552,7 @@ Matrix<scalarType, m, q> operator*(const Matrix<scalarType, m, n>& A, const Matr
 /// <param name="m"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-std::ostream& operator<<(std::ostream& os, Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& m)
+std::ostream& operator<<(std::ostream& os, const Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& m)
 {
 	for (int i{}; i < m.rows(); ++i)
 	{
@@ -393,9 +560,9 @@ std::ostream& operator<<(std::ostream& os, Matrix<scalarType, rowsAtCompileTime,
 		for (int j{}; j < m.cols(); ++j)
 		{
 			if (j != m.cols() - 1)
-				os << m(i, j) << std::setw(5);
+				os << m.coeff(i, j) << std::setw(5);
 			else
-				os << m(i, j);
+				os << m.coeff(i, j);
 			if (j % 10 == 0 && j > 0)
 				os << std::endl;
 		}
@@ -414,12 +581,12 @@ std::ostream& operator<<(std::ostream& os, Matrix<scalarType, rowsAtCompileTime,
 /// <param name="m"></param>
 /// <returns></returns>
 template<typename scalarType, int m, int n>
-Matrix<scalarType, m, n> operator*(const scalarType k, Matrix<scalarType, m, n>& mat)
+constexpr Matrix<scalarType, m, n> operator*(const scalarType k, const Matrix<scalarType, m, n>& mat)
 {
 	Matrix<scalarType, m, n> result{ mat };
-	for (int i{}; i < m.rows(); ++i)
-		for (int j{}; j < m.cols(); ++j)
-			result(i, j) *= k;
+	for (int i{}; i < m; ++i)
+		for (int j{}; j < n; ++j)
+			result.coeffRef(i, j) *= k;
 
 	return result;
 }
@@ -432,9 +599,13 @@ Matrix<scalarType, m, n> operator*(const scalarType k, Matrix<scalarType, m, n>&
 /// <param name="right_hand_side"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-inline bool Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::operator==(const Matrix& right_hand_side)
+constexpr bool Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::operator==(const Matrix& right_hand_side) const
 {
-	return (this->A == right_hand_side.A);
+	constexpr int size{ rowsAtCompileTime * colsAtCompileTime };
+	for (int i{}; i < size; ++i)
+		if (!(A[i] == right_hand_side.A[i]))
+			return false;
+	return true;
 }
 
 /// <summary>
@@ -444,7 +615,7 @@ inline bool Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>::operator==
 /// <param name="right_hand_side"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& operator+(const Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& right_hand_side)
+constexpr Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime> operator+(const Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& right_hand_side)
 {
 	return right_hand_side;
 }
@@ -456,32 +627,24 @@ Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& operator+(const Matrix
 /// <param name="right_hand_side"></param>
 /// <returns></returns>
 template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
-Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& operator-(const Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& right_hand_side)
+constexpr Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime> operator-(const Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& right_hand_side)
 {
-	return operator*<scalarType>(-1, right_hand_side);
+	return scalarType{ -1 } * right_hand_side;
 }
 
 template<typename scalarType, int m, int n, int p, int q>
-Matrix<scalarType, m, q>& operator*=(Matrix<scalarType, m, n>& A, const Matrix<scalarType, p, q>& B)
+constexpr Matrix<scalarType, m, n>& operator*=(Matrix<scalarType, m, n>& A, const Matrix<scalarType, p, q>& B)
 {
+	static_assert(p == n && q == n, "Error multiplying the matrices; A *= B requires a square B with as many rows as cols(A)!");
 	A = A * B;
 	return A;
 }
 
 template<typename scalarType, int m, int n>
-Matrix<scalarType, m, n>& operator*=(const scalarType k, Matrix<scalarType, m, n>& mat)
+constexpr Matrix<scalarType, m, n>& operator*=(const scalarType k, Matrix<scalarType, m, n>& mat)
 {
-	A = k * A;
-	return A;
+	mat = k * mat;
+	return mat;
 }
 
-template <int rowsAtCompileTime, int colsAtCompileTime>
-class Matrix<double, rowsAtCompileTime, colsAtCompileTime>;
-
-template <int rowsAtCompileTime, int colsAtCompileTime>
-class Matrix<float, rowsAtCompileTime, colsAtCompileTime>;
-
-template <int rowsAtCompileTime, int colsAtCompileTime>
-class Matrix<long, rowsAtCompileTime, colsAtCompileTime>;
 #endif // !Matrix_H
-
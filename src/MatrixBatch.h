@@ -0,0 +1,589 @@
+#pragma once
+#ifndef MATRIX_BATCH_H
+#define MATRIX_BATCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "Allocators.h"
+#include "Matrix.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+
+/// Batches of small fixed-size matrices.
+//
+/// Monte Carlo simulations multiply, invert and solve with millions of independent 2x2 to 8x8 matrices, one
+/// or more per path. A ``std::vector`` of ``Matrix<double, 4, 4>`` stores them one after the other, so the
+/// arithmetic of a single matrix, a chain of dependent scalar operations on 16 coefficients, is all that the
+/// compiler can vectorize. ``MatrixBatch`` stores the matrices interleaved instead: the batch is cut into
+/// blocks of ``lanes`` matrices (one cache line of coefficients, 8 doubles or 16 floats), and within a block
+/// the coefficient (i, j) of every matrix is stored contiguously. The kernels then run the scalar algorithm
+/// on one vector register of matrices at a time, one matrix per lane, with the SSE2, AVX2 or AVX-512
+/// instructions selected at runtime like those of Simd.h; the blocks are split across threads.
+///
+/// The operations are free functions over batches of the same size: ``multiply`` (and ``operator*``),
+/// ``determinant``, ``inverse`` and ``solve``. Like ``Matrix``, the last three use closed-form cofactor
+/// expansions up to 4x4; larger matrices use Gaussian elimination with partial pivoting, where the rows of
+/// different matrices are exchanged by lane selects rather than branches:
+///
+/// ```
+/// MatrixBatch<double, 4, 4> a{ paths };
+/// MatrixBatch<double, 4, 1> b{ paths };
+/// ...								// a.coeffRef(p, i, j) = ..., or a.setMatrix(p, m)
+/// MatrixBatch<double, 4, 1> x{ solve(a, b) };
+/// ```
+
+namespace internal
+{
+	/// <summary>
+	/// Number of matrices per block of a ``MatrixBatch``: one 64-byte cache line, and one AVX-512 register, of
+	/// coefficients. Narrower instruction sets cover a block with several registers.
+	/// </summary>
+	template<typename scalarType>
+	constexpr int batchLanes{ static_cast<int>(64 / sizeof(scalarType)) };
+
+	/// <summary>
+	/// Portable batch kernels: one matrix at a time.
+	/// </summary>
+	namespace scalar
+	{
+#include "MatrixBatchKernels.inl"
+	}
+
+#ifdef MATHLIB_X86
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+	namespace sse2
+	{
+#include "MatrixBatchKernels.inl"
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+	namespace avx2
+	{
+#include "MatrixBatchKernels.inl"
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+	namespace avx512
+	{
+#include "MatrixBatchKernels.inl"
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif // MATHLIB_X86
+
+	template<typename T>
+	using BatchMultiplyKernel = void (*)(int blocks, const T* a, const T* b, T* c);
+
+	template<typename T>
+	using BatchDeterminantKernel = void (*)(int blocks, const T* a, T* det, int count);
+
+	template<typename T>
+	using BatchInverseKernel = bool (*)(int blocks, const T* a, T* x, int count);
+
+	template<typename T>
+	using BatchSolveKernel = bool (*)(int blocks, const T* a, const T* b, T* x, int count);
+
+	/// <summary>
+	/// The product kernel for m x n by n x q matrices of scalar type T at the current instruction set level.
+	/// </summary>
+	template<typename T, int m, int n, int q>
+	BatchMultiplyKernel<T> batchMultiplyKernel()
+	{
+#ifdef MATHLIB_X86
+		if constexpr (hasSimdKernels<T>)
+		{
+			switch (simdLevel())
+			{
+			case SimdLevel::AVX512:
+				return &avx512::batchMultiply<T, m, n, q, batchLanes<T>>;
+			case SimdLevel::AVX2:
+				return &avx2::batchMultiply<T, m, n, q, batchLanes<T>>;
+			case SimdLevel::SSE2:
+				return &sse2::batchMultiply<T, m, n, q, batchLanes<T>>;
+			default:
+				break;
+			}
+		}
+#endif
+		return &scalar::batchMultiply<T, m, n, q, batchLanes<T>>;
+	}
+
+	/// <summary>
+	/// The determinant kernel for n x n matrices of floating-point type T at the current instruction set level.
+	/// </summary>
+	template<typename T, int n>
+	BatchDeterminantKernel<T> batchDeterminantKernel()
+	{
+#ifdef MATHLIB_X86
+		switch (simdLevel())
+		{
+		case SimdLevel::AVX512:
+			return &avx512::batchDeterminant<T, n, batchLanes<T>>;
+		case SimdLevel::AVX2:
+			return &avx2::batchDeterminant<T, n, batchLanes<T>>;
+		case SimdLevel::SSE2:
+			return &sse2::batchDeterminant<T, n, batchLanes<T>>;
+		default:
+			break;
+		}
+#endif
+		return &scalar::batchDeterminant<T, n, batchLanes<T>>;
+	}
+
+	/// <summary>
+	/// The inverse kernel for n x n matrices of floating-point type T at the current instruction set level.
+	/// </summary>
+	template<typename T, int n>
+	BatchInverseKernel<T> batchInverseKernel()
+	{
+#ifdef MATHLIB_X86
+		switch (simdLevel())
+		{
+		case SimdLevel::AVX512:
+			return &avx512::batchInverse<T, n, batchLanes<T>>;
+		case SimdLevel::AVX2:
+			return &avx2::batchInverse<T, n, batchLanes<T>>;
+		case SimdLevel::SSE2:
+			return &sse2::batchInverse<T, n, batchLanes<T>>;
+		default:
+			break;
+		}
+#endif
+		return &scalar::batchInverse<T, n, batchLanes<T>>;
+	}
+
+	/// <summary>
+	/// The solve kernel for n x n matrices and n x k right-hand sides of floating-point type T at the current
+	/// instruction set level.
+	/// </summary>
+	template<typename T, int n, int k>
+	BatchSolveKernel<T> batchSolveKernel()
+	{
+#ifdef MATHLIB_X86
+		switch (simdLevel())
+		{
+		case SimdLevel::AVX512:
+			return &avx512::batchSolve<T, n, k, batchLanes<T>>;
+		case SimdLevel::AVX2:
+			return &avx2::batchSolve<T, n, k, batchLanes<T>>;
+		case SimdLevel::SSE2:
+			return &sse2::batchSolve<T, n, k, batchLanes<T>>;
+		default:
+			break;
+		}
+#endif
+		return &scalar::batchSolve<T, n, k, batchLanes<T>>;
+	}
+
+	/// <summary>
+	/// Number of blocks per task for an operation costing about ``work`` multiply-adds per matrix.
+	/// </summary>
+	template<typename scalarType>
+	int batchGrain(int work)
+	{
+		return std::max(1, grainSize() / std::max(1, work * batchLanes<scalarType>));
+	}
+}
+
+/// <summary>
+/// ``MatrixBatch`` holds a batch of ``rowsAtCompileTime x colsAtCompileTime`` matrices, interleaved by blocks of
+/// ``lanes`` matrices.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <typeparam name="rowsAtCompileTime"></typeparam>
+/// <typeparam name="colsAtCompileTime"></typeparam>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+class MatrixBatch
+{
+	static_assert(rowsAtCompileTime > 0 && colsAtCompileTime > 0, "the matrices of a batch must have at least one row and one column");
+public:
+	static constexpr int lanes{ internal::batchLanes<scalarType> };
+	static constexpr int blockSize{ rowsAtCompileTime * colsAtCompileTime * lanes };
+private:
+	int _size;
+	std::vector<scalarType, AlignedAllocator<scalarType>> _data;	// block b, coefficient (i, j), matrix l at b * blockSize + (i * cols + j) * lanes + l
+public:
+	using value_type = scalarType;
+
+	MatrixBatch();
+	explicit MatrixBatch(int size);
+
+	static constexpr int rows() { return rowsAtCompileTime; }
+	static constexpr int cols() { return colsAtCompileTime; }
+	int size() const;
+	int blocks() const;
+	void resize(int size);
+
+	scalarType* block(int b);
+	const scalarType* block(int b) const;
+	scalarType coeff(int t, int i, int j) const;
+	scalarType& coeffRef(int t, int i, int j);
+	scalarType operator()(int t, int i, int j) const;
+	scalarType& operator()(int t, int i, int j);
+
+	Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime> matrix(int t) const;
+	void setMatrix(int t, const Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& m);
+};
+
+/// <summary>
+/// An empty batch.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+MatrixBatch<scalarType, rowsAtCompileTime, colsAtCompileTime>::MatrixBatch() : _size{}, _data{}
+{
+}
+
+/// <summary>
+/// A batch of ``size`` zero matrices.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="size"></param>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+MatrixBatch<scalarType, rowsAtCompileTime, colsAtCompileTime>::MatrixBatch(int size) : MatrixBatch{}
+{
+	resize(size);
+}
+
+/// <summary>
+/// The number of matrices.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+inline int MatrixBatch<scalarType, rowsAtCompileTime, colsAtCompileTime>::size() const
+{
+	return _size;
+}
+
+/// <summary>
+/// The number of blocks of ``lanes`` matrices; the last one is padded with zero matrices.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+inline int MatrixBatch<scalarType, rowsAtCompileTime, colsAtCompileTime>::blocks() const
+{
+	return (_size + lanes - 1) / lanes;
+}
+
+/// <summary>
+/// Change the number of matrices. The coefficients of the matrices kept are unchanged and the new ones are zero.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="size"></param>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+void MatrixBatch<scalarType, rowsAtCompileTime, colsAtCompileTime>::resize(int size)
+{
+	if (size < 0)
+		throw std::logic_error("The size of a batch cannot be negative!");
+	_size = size;
+	_data.resize(static_cast<std::size_t>(blocks()) * blockSize, scalarType{});
+}
+
+/// <summary>
+/// The coefficients of block b: coefficient (i, j) of its matrix l at ``(i * cols() + j) * lanes + l``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="b"></param>
+/// <returns></returns>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+inline scalarType* MatrixBatch<scalarType, rowsAtCompileTime, colsAtCompileTime>::block(int b)
+{
+	return _data.data() + static_cast<std::size_t>(b) * blockSize;
+}
+
+/// <summary>
+/// The coefficients of block b: coefficient (i, j) of its matrix l at ``(i * cols() + j) * lanes + l``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="b"></param>
+/// <returns></returns>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+inline const scalarType* MatrixBatch<scalarType, rowsAtCompileTime, colsAtCompileTime>::block(int b) const
+{
+	return _data.data() + static_cast<std::size_t>(b) * blockSize;
+}
+
+/// <summary>
+/// The coefficient (i, j) of matrix t, unchecked.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="t"></param>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+inline scalarType MatrixBatch<scalarType, rowsAtCompileTime, colsAtCompileTime>::coeff(int t, int i, int j) const
+{
+	return block(t / lanes)[(i * colsAtCompileTime + j) * lanes + t % lanes];
+}
+
+/// <summary>
+/// A reference to the coefficient (i, j) of matrix t, unchecked.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="t"></param>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+inline scalarType& MatrixBatch<scalarType, rowsAtCompileTime, colsAtCompileTime>::coeffRef(int t, int i, int j)
+{
+	return block(t / lanes)[(i * colsAtCompileTime + j) * lanes + t % lanes];
+}
+
+/// <summary>
+/// The coefficient (i, j) of matrix t. Throws ``std::out_of_range`` on invalid indices.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="t"></param>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+scalarType MatrixBatch<scalarType, rowsAtCompileTime, colsAtCompileTime>::operator()(int t, int i, int j) const
+{
+	if (t < 0 || t >= _size || i < 0 || i >= rowsAtCompileTime || j < 0 || j >= colsAtCompileTime)
+		throw std::out_of_range("Index out of bounds!");
+	return coeff(t, i, j);
+}
+
+/// <summary>
+/// A reference to the coefficient (i, j) of matrix t. Throws ``std::out_of_range`` on invalid indices.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="t"></param>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+scalarType& MatrixBatch<scalarType, rowsAtCompileTime, colsAtCompileTime>::operator()(int t, int i, int j)
+{
+	if (t < 0 || t >= _size || i < 0 || i >= rowsAtCompileTime || j < 0 || j >= colsAtCompileTime)
+		throw std::out_of_range("Index out of bounds!");
+	return coeffRef(t, i, j);
+}
+
+/// <summary>
+/// A copy of matrix t.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="t"></param>
+/// <returns></returns>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime> MatrixBatch<scalarType, rowsAtCompileTime, colsAtCompileTime>::matrix(int t) const
+{
+	Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime> m;
+	for (int i{}; i < rowsAtCompileTime; ++i)
+		for (int j{}; j < colsAtCompileTime; ++j)
+			m.coeffRef(i, j) = coeff(t, i, j);
+	return m;
+}
+
+/// <summary>
+/// Overwrite matrix t with m.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="t"></param>
+/// <param name="m"></param>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+void MatrixBatch<scalarType, rowsAtCompileTime, colsAtCompileTime>::setMatrix(int t, const Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& m)
+{
+	for (int i{}; i < rowsAtCompileTime; ++i)
+		for (int j{}; j < colsAtCompileTime; ++j)
+			coeffRef(t, i, j) = m.coeff(i, j);
+}
+
+/// <summary>
+/// The products \f$C_t = A_tB_t\f$ of the matrices of two batches of the same size. C is resized if needed;
+/// it may be A or B.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <param name="c"></param>
+template<typename scalarType, int m, int n, int q>
+void multiply(const MatrixBatch<scalarType, m, n>& a, const MatrixBatch<scalarType, n, q>& b, MatrixBatch<scalarType, m, q>& c)
+{
+	if (a.size() != b.size())
+		throw std::logic_error("The batches must hold the same number of matrices!");
+	if (static_cast<const void*>(&c) == &a || static_cast<const void*>(&c) == &b)
+	{
+		MatrixBatch<scalarType, m, q> product{ a.size() };
+		multiply(a, b, product);
+		c = std::move(product);
+		return;
+	}
+	if (c.size() != a.size())
+		c.resize(a.size());
+
+	const internal::BatchMultiplyKernel<scalarType> kernel{ internal::batchMultiplyKernel<scalarType, m, n, q>() };
+	parallelFor(0, a.blocks(), internal::batchGrain<scalarType>(m * n * q), [&](int first, int last) {
+		kernel(last - first, a.block(first), b.block(first), c.block(first));
+	});
+}
+
+/// <summary>
+/// The batch of the products \f$A_tB_t\f$.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns></returns>
+template<typename scalarType, int m, int n, int q>
+MatrixBatch<scalarType, m, q> operator*(const MatrixBatch<scalarType, m, n>& a, const MatrixBatch<scalarType, n, q>& b)
+{
+	MatrixBatch<scalarType, m, q> c{ a.size() };
+	multiply(a, b, c);
+	return c;
+}
+
+/// <summary>
+/// The determinants of the matrices of the batch, written to ``result[0..size)``, as the signed products of
+/// the pivots of Gaussian elimination.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="result"></param>
+template<typename scalarType, int n>
+void determinant(const MatrixBatch<scalarType, n, n>& a, scalarType* result)
+{
+	static_assert(std::is_floating_point<scalarType>::value, "determinant() of a batch requires a floating-point scalar type");
+	constexpr int lanes{ internal::batchLanes<scalarType> };
+	const internal::BatchDeterminantKernel<scalarType> kernel{ internal::batchDeterminantKernel<scalarType, n>() };
+	parallelFor(0, a.blocks(), internal::batchGrain<scalarType>(n * n * n / 3 + 1), [&](int first, int last) {
+		kernel(last - first, a.block(first), result + first * lanes, a.size() - first * lanes);
+	});
+}
+
+/// <summary>
+/// The determinants of the matrices of the batch.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <returns></returns>
+template<typename scalarType, int n>
+std::vector<scalarType> determinant(const MatrixBatch<scalarType, n, n>& a)
+{
+	std::vector<scalarType> result(a.size());
+	determinant(a, result.data());
+	return result;
+}
+
+/// <summary>
+/// The solutions \f$X_t\f$ of \f$A_tX_t = B_t\f$ for two batches of the same size, by Gaussian elimination with
+/// partial pivoting. X is resized if needed; it may be B. Throws ``std::logic_error`` if a matrix of A is
+/// singular.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <param name="x"></param>
+template<typename scalarType, int n, int k>
+void solve(const MatrixBatch<scalarType, n, n>& a, const MatrixBatch<scalarType, n, k>& b, MatrixBatch<scalarType, n, k>& x)
+{
+	static_assert(std::is_floating_point<scalarType>::value, "solve() of a batch requires a floating-point scalar type");
+	if (a.size() != b.size())
+		throw std::logic_error("The batches must hold the same number of matrices!");
+	if (x.size() != a.size())
+		x.resize(a.size());
+
+	constexpr int lanes{ internal::batchLanes<scalarType> };
+	const internal::BatchSolveKernel<scalarType> kernel{ internal::batchSolveKernel<scalarType, n, k>() };
+	std::atomic<bool> regular{ true };
+	parallelFor(0, a.blocks(), internal::batchGrain<scalarType>(n * n * (n / 3 + k) + 1), [&](int first, int last) {
+		if (!kernel(last - first, a.block(first), b.block(first), x.block(first), a.size() - first * lanes))
+			regular.store(false, std::memory_order_relaxed);
+	});
+	if (!regular.load())
+		throw std::logic_error("A matrix of the batch is singular; the system has no unique solution!");
+}
+
+/// <summary>
+/// The batch of the solutions of \f$A_tX_t = B_t\f$.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns></returns>
+template<typename scalarType, int n, int k>
+MatrixBatch<scalarType, n, k> solve(const MatrixBatch<scalarType, n, n>& a, const MatrixBatch<scalarType, n, k>& b)
+{
+	MatrixBatch<scalarType, n, k> x{ a.size() };
+	solve(a, b, x);
+	return x;
+}
+
+/// <summary>
+/// The inverses of the matrices of the batch. The result is resized if needed; it may be A. Throws
+/// ``std::logic_error`` if a matrix is singular.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="result"></param>
+template<typename scalarType, int n>
+void inverse(const MatrixBatch<scalarType, n, n>& a, MatrixBatch<scalarType, n, n>& result)
+{
+	static_assert(std::is_floating_point<scalarType>::value, "inverse() of a batch requires a floating-point scalar type");
+	if (result.size() != a.size())
+		result.resize(a.size());
+
+	constexpr int lanes{ internal::batchLanes<scalarType> };
+	const internal::BatchInverseKernel<scalarType> kernel{ internal::batchInverseKernel<scalarType, n>() };
+	std::atomic<bool> regular{ true };
+	parallelFor(0, a.blocks(), internal::batchGrain<scalarType>(n * n * n + 1), [&](int first, int last) {
+		if (!kernel(last - first, a.block(first), result.block(first), a.size() - first * lanes))
+			regular.store(false, std::memory_order_relaxed);
+	});
+	if (!regular.load())
+		throw std::logic_error("A matrix of the batch is singular; therefore cannot be inverted!");
+}
+
+/// <summary>
+/// The batch of the inverses of the matrices.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <returns></returns>
+template<typename scalarType, int n>
+MatrixBatch<scalarType, n, n> inverse(const MatrixBatch<scalarType, n, n>& a)
+{
+	MatrixBatch<scalarType, n, n> result{ a.size() };
+	inverse(a, result);
+	return result;
+}
+
+#endif // !MATRIX_BATCH_H
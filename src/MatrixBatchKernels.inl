@@ -0,0 +1,401 @@
+// MatrixBatchKernels.inl : Products, determinants and solves of blocks of interleaved small matrices.
+//
+// Like SimdKernels.inl, this file is compiled once per instruction set: MatrixBatch.h includes it inside
+// each namespace of Simd.h that defines ``Vec<T>``. For that reason this file has no include guard.
+//
+// A block holds ``lanes`` matrices, coefficient c of matrix l at ``block[c * lanes + l]``; the kernels run
+// the scalar algorithm on ``Vec<T>::width`` consecutive matrices at a time, one per vector lane, so that
+// every load and store is contiguous. Like ``Matrix``, matrices up to 4x4 use closed-form cofactor
+// expansions, and larger ones Gaussian elimination with partial pivoting. Besides the element-wise operations, they use the floating-point
+// ``div``, ``greater`` (a lane mask), ``select`` (mask ? a : b) and ``any`` (some lane set) of ``Vec<T>``.
+
+/// <summary>
+/// \f$C = AB\f$ for ``blocks`` consecutive blocks of m x n matrices A and n x q matrices B. C must not overlap
+/// A or B.
+/// </summary>
+template<typename T, int m, int n, int q, int lanes>
+void batchMultiply(int blocks, const T* a, const T* b, T* c)
+{
+	using V = Vec<T>;
+	for (int blk{}; blk < blocks; ++blk, a += m * n * lanes, b += n * q * lanes, c += m * q * lanes)
+		for (int v{}; v < lanes; v += V::width)
+			for (int i{}; i < m; ++i)
+				for (int k{}; k < q; ++k)
+				{
+					typename V::reg sum{ V::mul(V::load(a + i * n * lanes + v), V::load(b + k * lanes + v)) };
+					for (int j{ 1 }; j < n; ++j)
+						sum = V::fmadd(V::load(a + (i * n + j) * lanes + v), V::load(b + (j * q + k) * lanes + v), sum);
+					V::store(c + (i * q + k) * lanes + v, sum);
+				}
+}
+
+/// <summary>
+/// Gaussian elimination with partial pivoting of the augmented matrices \f$[A \mid B]\f$ held in ``w``, in
+/// registers: on return the first n columns hold U and the last k ones \f$L^{-1}PB\f$. A row whose
+/// coefficient in the pivot column is larger than the current pivot is exchanged with the pivot row at
+/// once, lane by lane, with selects; rows that no lane picks are skipped. ``inverse`` receives the
+/// reciprocals of the pivots (1 for a zero pivot), ``det`` the determinants and ``smallest`` the smallest
+/// pivot magnitudes, zero for the singular matrices.
+/// </summary>
+template<typename T, int n, int k>
+void batchEliminate(typename Vec<T>::reg (&w)[n][n + k], typename Vec<T>::reg (&inverse)[n], typename Vec<T>::reg& det,
+	typename Vec<T>::reg& smallest)
+{
+	using V = Vec<T>;
+	using reg = typename V::reg;
+	const reg zero{ V::zero() };
+	const reg one{ V::set1(T{ 1 }) };
+	det = one;
+	smallest = V::set1(std::numeric_limits<T>::max());
+	for (int p{}; p < n; ++p)
+	{
+		reg best{ V::abs(w[p][p]) };
+		for (int r{ p + 1 }; r < n; ++r)
+		{
+			const reg candidate{ V::abs(w[r][p]) };
+			const typename V::mask larger{ V::greater(candidate, best) };
+			if (!V::any(larger))
+				continue;
+			best = V::select(larger, candidate, best);
+			det = V::select(larger, V::sub(zero, det), det);
+			for (int j{ p }; j < n + k; ++j)
+			{
+				const reg x{ w[p][j] };
+				w[p][j] = V::select(larger, w[r][j], x);
+				w[r][j] = V::select(larger, x, w[r][j]);
+			}
+		}
+		smallest = V::select(V::greater(smallest, best), best, smallest);
+		det = V::mul(det, w[p][p]);
+		inverse[p] = V::div(one, V::select(V::greater(best, zero), w[p][p], one));
+		for (int r{ p + 1 }; r < n; ++r)
+		{
+			const reg factor{ V::sub(zero, V::mul(w[r][p], inverse[p])) };
+			for (int j{ p + 1 }; j < n + k; ++j)
+				w[r][j] = V::fmadd(factor, w[p][j], w[r][j]);
+		}
+	}
+}
+
+/// <summary>
+/// Back substitution after ``batchEliminate()``: overwrite the last k columns of ``w`` with \f$U^{-1}\f$ times them.
+/// </summary>
+template<typename T, int n, int k>
+void batchBackSubstitute(typename Vec<T>::reg (&w)[n][n + k], const typename Vec<T>::reg (&inverse)[n])
+{
+	using V = Vec<T>;
+	for (int i{ n - 1 }; i >= 0; --i)
+		for (int c{}; c < k; ++c)
+		{
+			typename V::reg sum{ w[i][n + c] };
+			for (int j{ i + 1 }; j < n; ++j)
+				sum = V::sub(sum, V::mul(w[i][j], w[j][n + c]));
+			w[i][n + c] = V::mul(sum, inverse[i]);
+		}
+}
+
+/// <summary>
+/// \f$ab - cd\f$.
+/// </summary>
+template<typename T>
+typename Vec<T>::reg batchCross(typename Vec<T>::reg a, typename Vec<T>::reg b, typename Vec<T>::reg c, typename Vec<T>::reg d)
+{
+	return Vec<T>::sub(Vec<T>::mul(a, b), Vec<T>::mul(c, d));
+}
+
+/// <summary>
+/// \f$a_0b_0 - a_1b_1 + a_2b_2\f$, a cofactor of a 4x4 matrix from the minors of two of its rows.
+/// </summary>
+template<typename T>
+typename Vec<T>::reg batchCofactor(typename Vec<T>::reg a0, typename Vec<T>::reg b0, typename Vec<T>::reg a1, typename Vec<T>::reg b1,
+	typename Vec<T>::reg a2, typename Vec<T>::reg b2)
+{
+	return Vec<T>::fmadd(a2, b2, batchCross<T>(a0, b0, a1, b1));
+}
+
+/// <summary>
+/// The 2x2 minors of rows (0, 1), in ``s``, and of rows (2, 3), in ``c``, of 4x4 matrices, for the column pairs
+/// (0,1), (0,2), (0,3), (1,2), (1,3), (2,3), as in ``internal::Minors4``. Returns the determinants.
+/// </summary>
+template<typename T>
+typename Vec<T>::reg batchMinors4(const typename Vec<T>::reg (&a)[4][4], typename Vec<T>::reg (&s)[6], typename Vec<T>::reg (&c)[6])
+{
+	using V = Vec<T>;
+	s[0] = batchCross<T>(a[0][0], a[1][1], a[1][0], a[0][1]);
+	s[1] = batchCross<T>(a[0][0], a[1][2], a[1][0], a[0][2]);
+	s[2] = batchCross<T>(a[0][0], a[1][3], a[1][0], a[0][3]);
+	s[3] = batchCross<T>(a[0][1], a[1][2], a[1][1], a[0][2]);
+	s[4] = batchCross<T>(a[0][1], a[1][3], a[1][1], a[0][3]);
+	s[5] = batchCross<T>(a[0][2], a[1][3], a[1][2], a[0][3]);
+	c[0] = batchCross<T>(a[2][0], a[3][1], a[3][0], a[2][1]);
+	c[1] = batchCross<T>(a[2][0], a[3][2], a[3][0], a[2][2]);
+	c[2] = batchCross<T>(a[2][0], a[3][3], a[3][0], a[2][3]);
+	c[3] = batchCross<T>(a[2][1], a[3][2], a[3][1], a[2][2]);
+	c[4] = batchCross<T>(a[2][1], a[3][3], a[3][1], a[2][3]);
+	c[5] = batchCross<T>(a[2][2], a[3][3], a[3][2], a[2][3]);
+	return V::add(V::add(batchCofactor<T>(s[0], c[5], s[1], c[4], s[2], c[3]), batchCross<T>(s[3], c[2], s[4], c[1])), V::mul(s[5], c[0]));
+}
+
+/// <summary>
+/// The determinants of the n x n matrices held in ``a``, n <= 4, by the cofactor expansions of ``Matrix``.
+/// </summary>
+template<typename T, int n>
+typename Vec<T>::reg batchCofactorDeterminant(const typename Vec<T>::reg (&a)[n][n])
+{
+	using V = Vec<T>;
+	if constexpr (n == 1)
+	{
+		return a[0][0];
+	}
+	else if constexpr (n == 2)
+	{
+		return batchCross<T>(a[0][0], a[1][1], a[0][1], a[1][0]);
+	}
+	else if constexpr (n == 3)
+	{
+		return V::fmadd(a[0][0], batchCross<T>(a[1][1], a[2][2], a[1][2], a[2][1]),
+			V::fmadd(a[0][1], batchCross<T>(a[1][2], a[2][0], a[1][0], a[2][2]), V::mul(a[0][2], batchCross<T>(a[1][0], a[2][1], a[1][1], a[2][0]))));
+	}
+	else
+	{
+		static_assert(n == 4, "closed-form determinants are implemented for matrices up to 4x4");
+		typename V::reg s[6], c[6];
+		return batchMinors4<T>(a, s, c);
+	}
+}
+
+/// <summary>
+/// The adjugates of the n x n matrices held in ``a``, n <= 4, by the cofactor expansions of ``Matrix``;
+/// returns their determinants.
+/// </summary>
+template<typename T, int n>
+typename Vec<T>::reg batchAdjugate(const typename Vec<T>::reg (&a)[n][n], typename Vec<T>::reg (&adj)[n][n])
+{
+	using V = Vec<T>;
+	const typename V::reg zero{ V::zero() };
+	if constexpr (n == 1)
+	{
+		adj[0][0] = V::set1(T{ 1 });
+		return a[0][0];
+	}
+	else if constexpr (n == 2)
+	{
+		adj[0][0] = a[1][1];
+		adj[0][1] = V::sub(zero, a[0][1]);
+		adj[1][0] = V::sub(zero, a[1][0]);
+		adj[1][1] = a[0][0];
+		return batchCross<T>(a[0][0], a[1][1], a[0][1], a[1][0]);
+	}
+	else if constexpr (n == 3)
+	{
+		// With cyclic row and column indices, the cofactors need no sign.
+		adj[0][0] = batchCross<T>(a[1][1], a[2][2], a[1][2], a[2][1]);
+		adj[1][0] = batchCross<T>(a[1][2], a[2][0], a[1][0], a[2][2]);
+		adj[2][0] = batchCross<T>(a[1][0], a[2][1], a[1][1], a[2][0]);
+		adj[0][1] = batchCross<T>(a[2][1], a[0][2], a[2][2], a[0][1]);
+		adj[1][1] = batchCross<T>(a[2][2], a[0][0], a[2][0], a[0][2]);
+		adj[2][1] = batchCross<T>(a[2][0], a[0][1], a[2][1], a[0][0]);
+		adj[0][2] = batchCross<T>(a[0][1], a[1][2], a[0][2], a[1][1]);
+		adj[1][2] = batchCross<T>(a[0][2], a[1][0], a[0][0], a[1][2]);
+		adj[2][2] = batchCross<T>(a[0][0], a[1][1], a[0][1], a[1][0]);
+		return V::fmadd(a[0][0], adj[0][0], V::fmadd(a[0][1], adj[1][0], V::mul(a[0][2], adj[2][0])));
+	}
+	else
+	{
+		static_assert(n == 4, "closed-form adjugates are implemented for matrices up to 4x4");
+		typename V::reg s[6], c[6];
+		const typename V::reg det{ batchMinors4<T>(a, s, c) };
+		adj[0][0] = batchCofactor<T>(a[1][1], c[5], a[1][2], c[4], a[1][3], c[3]);
+		adj[0][1] = V::sub(zero, batchCofactor<T>(a[0][1], c[5], a[0][2], c[4], a[0][3], c[3]));
+		adj[0][2] = batchCofactor<T>(a[3][1], s[5], a[3][2], s[4], a[3][3], s[3]);
+		adj[0][3] = V::sub(zero, batchCofactor<T>(a[2][1], s[5], a[2][2], s[4], a[2][3], s[3]));
+		adj[1][0] = V::sub(zero, batchCofactor<T>(a[1][0], c[5], a[1][2], c[2], a[1][3], c[1]));
+		adj[1][1] = batchCofactor<T>(a[0][0], c[5], a[0][2], c[2], a[0][3], c[1]);
+		adj[1][2] = V::sub(zero, batchCofactor<T>(a[3][0], s[5], a[3][2], s[2], a[3][3], s[1]));
+		adj[1][3] = batchCofactor<T>(a[2][0], s[5], a[2][2], s[2], a[2][3], s[1]);
+		adj[2][0] = batchCofactor<T>(a[1][0], c[4], a[1][1], c[2], a[1][3], c[0]);
+		adj[2][1] = V::sub(zero, batchCofactor<T>(a[0][0], c[4], a[0][1], c[2], a[0][3], c[0]));
+		adj[2][2] = batchCofactor<T>(a[3][0], s[4], a[3][1], s[2], a[3][3], s[0]);
+		adj[2][3] = V::sub(zero, batchCofactor<T>(a[2][0], s[4], a[2][1], s[2], a[2][3], s[0]));
+		adj[3][0] = V::sub(zero, batchCofactor<T>(a[1][0], c[3], a[1][1], c[1], a[1][2], c[0]));
+		adj[3][1] = batchCofactor<T>(a[0][0], c[3], a[0][1], c[1], a[0][2], c[0]);
+		adj[3][2] = V::sub(zero, batchCofactor<T>(a[3][0], s[3], a[3][1], s[1], a[3][2], s[0]));
+		adj[3][3] = batchCofactor<T>(a[2][0], s[3], a[2][1], s[1], a[2][2], s[0]);
+		return det;
+	}
+}
+
+/// <summary>
+/// Load the n x n matrices of one register of block ``a``, at lane offset v.
+/// </summary>
+template<typename T, int n, int k, int lanes>
+void batchLoad(const T* a, int v, typename Vec<T>::reg (&w)[n][k])
+{
+	for (int i{}; i < n; ++i)
+		for (int j{}; j < k; ++j)
+			w[i][j] = Vec<T>::load(a + (i * k + j) * lanes + v);
+}
+
+/// <summary>
+/// True if none of the lanes of ``det`` that hold one of the first ``count`` matrices is zero.
+/// </summary>
+template<typename T>
+bool batchRegular(typename Vec<T>::reg det, int count)
+{
+	T lane[Vec<T>::width];
+	Vec<T>::store(lane, det);
+	bool regular{ true };
+	for (int l{}; l < Vec<T>::width && l < count; ++l)
+		regular &= lane[l] != T{};
+	return regular;
+}
+
+/// <summary>
+/// The determinants of the first ``count`` matrices of the ``blocks`` consecutive blocks of n x n matrices
+/// at a, written to ``det[0..count)``.
+/// </summary>
+template<typename T, int n, int lanes>
+void batchDeterminant(int blocks, const T* a, T* det, int count)
+{
+	using V = Vec<T>;
+	using reg = typename V::reg;
+	for (int blk{}; blk < blocks; ++blk, a += n * n * lanes)
+		for (int v{}; v < lanes; v += V::width)
+		{
+			reg w[n][n];
+			batchLoad<T, n, n, lanes>(a, v, w);
+			reg d;
+			if constexpr (n <= 4)
+			{
+				d = batchCofactorDeterminant<T, n>(w);
+			}
+			else
+			{
+				reg inverse[n];
+				reg smallest;
+				batchEliminate<T, n, 0>(w, inverse, d, smallest);
+			}
+
+			const int offset{ blk * lanes + v };
+			if (offset + V::width <= count)
+			{
+				V::store(det + offset, d);
+			}
+			else if (offset < count)
+			{
+				T lane[V::width];
+				V::store(lane, d);
+				std::copy(lane, lane + (count - offset), det + offset);
+			}
+		}
+}
+
+/// <summary>
+/// The inverses of the ``blocks`` consecutive blocks of n x n matrices at a, written to x: the adjugate
+/// divided by the determinant up to 4x4, Gauss-Jordan elimination against the identity beyond. Returns
+/// false if one of the first ``count`` matrices is singular.
+/// </summary>
+template<typename T, int n, int lanes>
+bool batchInverse(int blocks, const T* a, T* x, int count)
+{
+	using V = Vec<T>;
+	using reg = typename V::reg;
+	const reg zero{ V::zero() };
+	const reg one{ V::set1(T{ 1 }) };
+	bool regular{ true };
+	for (int blk{}; blk < blocks; ++blk, a += n * n * lanes, x += n * n * lanes)
+		for (int v{}; v < lanes; v += V::width)
+		{
+			const int offset{ blk * lanes + v };
+			if constexpr (n <= 4)
+			{
+				reg w[n][n];
+				batchLoad<T, n, n, lanes>(a, v, w);
+				reg adj[n][n];
+				const reg det{ batchAdjugate<T, n>(w, adj) };
+				regular &= batchRegular<T>(det, count - offset);
+				const reg scale{ V::div(one, V::select(V::greater(V::abs(det), zero), det, one)) };
+				for (int i{}; i < n; ++i)
+					for (int j{}; j < n; ++j)
+						V::store(x + (i * n + j) * lanes + v, V::mul(adj[i][j], scale));
+			}
+			else
+			{
+				reg w[n][2 * n];
+				for (int i{}; i < n; ++i)
+					for (int j{}; j < n; ++j)
+					{
+						w[i][j] = V::load(a + (i * n + j) * lanes + v);
+						w[i][n + j] = i == j ? one : zero;
+					}
+				reg inverse[n];
+				reg det, smallest;
+				batchEliminate<T, n, n>(w, inverse, det, smallest);
+				regular &= batchRegular<T>(smallest, count - offset);
+				batchBackSubstitute<T, n, n>(w, inverse);
+				for (int i{}; i < n; ++i)
+					for (int j{}; j < n; ++j)
+						V::store(x + (i * n + j) * lanes + v, w[i][n + j]);
+			}
+		}
+	return regular;
+}
+
+/// <summary>
+/// Solve \f$AX = B\f$ for the ``blocks`` consecutive blocks of n x n matrices A and n x k right-hand sides B;
+/// x may be b. Up to 4x4, \f$X = \mathrm{adj}(A)B / \det A\f$, as with the inverse of a ``Matrix``. Returns
+/// false if one of the first ``count`` matrices of A is singular.
+/// </summary>
+template<typename T, int n, int k, int lanes>
+bool batchSolve(int blocks, const T* a, const T* b, T* x, int count)
+{
+	using V = Vec<T>;
+	using reg = typename V::reg;
+	const reg zero{ V::zero() };
+	const reg one{ V::set1(T{ 1 }) };
+	bool regular{ true };
+	for (int blk{}; blk < blocks; ++blk, a += n * n * lanes, b += n * k * lanes, x += n * k * lanes)
+		for (int v{}; v < lanes; v += V::width)
+		{
+			const int offset{ blk * lanes + v };
+			if constexpr (n <= 4)
+			{
+				reg w[n][n];
+				batchLoad<T, n, n, lanes>(a, v, w);
+				reg rhs[n][k];
+				batchLoad<T, n, k, lanes>(b, v, rhs);
+				reg adj[n][n];
+				const reg det{ batchAdjugate<T, n>(w, adj) };
+				regular &= batchRegular<T>(det, count - offset);
+				const reg scale{ V::div(one, V::select(V::greater(V::abs(det), zero), det, one)) };
+				for (int i{}; i < n; ++i)
+					for (int c{}; c < k; ++c)
+					{
+						reg sum{ V::mul(adj[i][0], rhs[0][c]) };
+						for (int j{ 1 }; j < n; ++j)
+							sum = V::fmadd(adj[i][j], rhs[j][c], sum);
+						V::store(x + (i * k + c) * lanes + v, V::mul(sum, scale));
+					}
+			}
+			else
+			{
+				reg w[n][n + k];
+				for (int i{}; i < n; ++i)
+				{
+					for (int j{}; j < n; ++j)
+						w[i][j] = V::load(a + (i * n + j) * lanes + v);
+					for (int c{}; c < k; ++c)
+						w[i][n + c] = V::load(b + (i * k + c) * lanes + v);
+				}
+				reg inverse[n];
+				reg det, smallest;
+				batchEliminate<T, n, k>(w, inverse, det, smallest);
+				regular &= batchRegular<T>(smallest, count - offset);
+				batchBackSubstitute<T, n, k>(w, inverse);
+				for (int i{}; i < n; ++i)
+					for (int c{}; c < k; ++c)
+						V::store(x + (i * k + c) * lanes + v, w[i][n + c]);
+			}
+		}
+	return regular;
+}
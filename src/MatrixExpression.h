@@ -0,0 +1,699 @@
+#pragma once
+#ifndef MatrixExpression_H
+#define MatrixExpression_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "Transpose.h"
+
+/// Expression templates for element-wise matrix arithmetic.
+//
+/// An arithmetic expression such as ``m1 + m2 + m3`` or ``2.0 * (a - b)`` does not compute anything
+/// when it is written. Instead, each operator returns a light-weight node (``MatrixSum``,
+/// ``MatrixDifference``, ``MatrixScalarProduct``, ``MatrixNegation``, ``MatrixTranspose``) that records its
+/// operands. The whole tree is evaluated in a single loop when it is assigned to a ``MatrixX``, so
+/// chained expressions allocate no intermediate matrices and read each operand once. The simplest
+/// shapes, ``A + B``, ``A - B``, ``k * A`` and the AXPY update ``C += k * A``, are evaluated by the
+/// SIMD kernels of Simd.h.
+///
+/// Operands of different scalar types are promoted the way C++ promotes the scalars themselves: the
+/// coefficients of ``MatrixXi + MatrixXd`` or ``0.5 * MatrixXi`` are ``double``, and those of
+/// ``2.0 * MatrixXf`` as well. Assigning an expression to a matrix converts its coefficients to the scalar
+/// type of the matrix; the SIMD kernels are used whenever this gives the same result, e.g. for
+/// ``MatrixXf m = 2.0 * a`` since 2.0 is a ``float``.
+///
+/// Every node derives from ``MatrixExpression<Node>`` (the curiously recurring template pattern) and
+/// provides:
+/// - ``value_type``, the scalar type of its coefficients;
+/// - ``isLinear``, true if the coefficients can be read in storage order through ``coeff(index)``;
+/// - ``rows()``, ``cols()`` and ``coeff(i, j)``.
+
+template <typename Derived>
+class MatrixExpression
+{
+public:
+	/// <summary>
+	/// The concrete expression type.
+	/// </summary>
+	/// <returns></returns>
+	const Derived& derived() const
+	{
+		return static_cast<const Derived&>(*this);
+	}
+
+	int rows() const
+	{
+		return derived().rows();
+	}
+
+	int cols() const
+	{
+		return derived().cols();
+	}
+};
+
+namespace internal
+{
+	/// <summary>
+	/// How an expression node holds on to an operand of type ``T``. Expression nodes are small and are
+	/// held by value, so that an expression may outlive the temporaries it was built from. Types that
+	/// own their storage specialize this trait to be held through a non-owning leaf instead.
+	/// </summary>
+	/// <typeparam name="T"></typeparam>
+	template<typename T>
+	struct ExpressionNesting
+	{
+		using type = T;
+	};
+
+	template<typename T>
+	using nested_t = const typename ExpressionNesting<T>::type;
+
+	/// <summary>
+	/// The scalar type of ``a + b`` (or ``a - b``, ``a * b``) for scalars ``a`` and ``b`` of types ``A`` and ``B``.
+	/// </summary>
+	template<typename A, typename B>
+	using promoted_t = decltype(std::declval<A>() + std::declval<B>());
+
+	/// <summary>
+	/// True for the strided views of MatrixView.h. A view addresses its coefficients through a pair of
+	/// slices; its rows are contiguous in memory when its column stride is 1.
+	/// </summary>
+	template<typename T>
+	struct IsStridedView : std::false_type {};
+}
+
+/// <summary>
+/// Leaf of an expression tree: a non-owning, read-only handle on contiguous row-major storage.
+/// Matrices enter expressions through a leaf, so that the evaluation loop works on a raw pointer
+/// rather than reloading it from the owning container on every coefficient.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template <typename scalarType>
+class MatrixLeaf : public MatrixExpression<MatrixLeaf<scalarType>>
+{
+private:
+	const scalarType* _data;
+	int _rows;
+	int _cols;
+public:
+	using value_type = scalarType;
+	static constexpr bool isLinear = true;
+
+	MatrixLeaf(const scalarType* data, int rows, int cols) : _data{ data }, _rows{ rows }, _cols{ cols } {}
+
+	template<typename Storage>
+	MatrixLeaf(const Storage& m) : MatrixLeaf{ m.data(), m.rows(), m.cols() } {}
+
+	const scalarType* data() const { return _data; }
+	int rows() const { return _rows; }
+	int cols() const { return _cols; }
+	int size() const { return _rows * _cols; }
+	scalarType coeff(int i, int j) const { return _data[i * _cols + j]; }
+	scalarType coeff(int index) const { return _data[index]; }
+};
+
+/// <summary>
+/// Expression node for the matrix sum \f$A + B\f$. The scalar types of A and B are promoted to a common one.
+/// </summary>
+/// <typeparam name="Lhs"></typeparam>
+/// <typeparam name="Rhs"></typeparam>
+template <typename Lhs, typename Rhs>
+class MatrixSum : public MatrixExpression<MatrixSum<Lhs, Rhs>>
+{
+private:
+	internal::nested_t<Lhs> _lhs;
+	internal::nested_t<Rhs> _rhs;
+public:
+	using value_type = internal::promoted_t<typename Lhs::value_type, typename Rhs::value_type>;
+	static constexpr bool isLinear = Lhs::isLinear && Rhs::isLinear;
+
+	MatrixSum(const Lhs& lhs, const Rhs& rhs) : _lhs{ lhs }, _rhs{ rhs }
+	{
+		if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols())
+			throw std::logic_error("Matrices have different dimensions; therefore cannot be added!");
+	}
+
+	const internal::nested_t<Lhs>& lhs() const { return _lhs; }
+	const internal::nested_t<Rhs>& rhs() const { return _rhs; }
+	int rows() const { return _lhs.rows(); }
+	int cols() const { return _lhs.cols(); }
+	value_type coeff(int i, int j) const { return _lhs.coeff(i, j) + _rhs.coeff(i, j); }
+	value_type coeff(int index) const { return _lhs.coeff(index) + _rhs.coeff(index); }
+};
+
+/// <summary>
+/// Expression node for the matrix difference \f$A - B\f$. The scalar types of A and B are promoted to a
+/// common one.
+/// </summary>
+/// <typeparam name="Lhs"></typeparam>
+/// <typeparam name="Rhs"></typeparam>
+template <typename Lhs, typename Rhs>
+class MatrixDifference : public MatrixExpression<MatrixDifference<Lhs, Rhs>>
+{
+private:
+	internal::nested_t<Lhs> _lhs;
+	internal::nested_t<Rhs> _rhs;
+public:
+	using value_type = internal::promoted_t<typename Lhs::value_type, typename Rhs::value_type>;
+	static constexpr bool isLinear = Lhs::isLinear && Rhs::isLinear;
+
+	MatrixDifference(const Lhs& lhs, const Rhs& rhs) : _lhs{ lhs }, _rhs{ rhs }
+	{
+		if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols())
+			throw std::logic_error("Matrices have different dimensions; therefore cannot be added!");
+	}
+
+	const internal::nested_t<Lhs>& lhs() const { return _lhs; }
+	const internal::nested_t<Rhs>& rhs() const { return _rhs; }
+	int rows() const { return _lhs.rows(); }
+	int cols() const { return _lhs.cols(); }
+	value_type coeff(int i, int j) const { return _lhs.coeff(i, j) - _rhs.coeff(i, j); }
+	value_type coeff(int index) const { return _lhs.coeff(index) - _rhs.coeff(index); }
+};
+
+/// <summary>
+/// Expression node for the scalar multiple \f$k \cdot A\f$. The scalar k may be of another type than the
+/// coefficients of A, as in ``0.5 * MatrixXi``, and the two are promoted to a common type.
+/// </summary>
+/// <typeparam name="Expr"></typeparam>
+/// <typeparam name="Scalar"></typeparam>
+template <typename Expr, typename Scalar = typename Expr::value_type>
+class MatrixScalarProduct : public MatrixExpression<MatrixScalarProduct<Expr, Scalar>>
+{
+public:
+	using value_type = internal::promoted_t<Scalar, typename Expr::value_type>;
+	static constexpr bool isLinear = Expr::isLinear;
+
+	MatrixScalarProduct(const Scalar k, const Expr& expr) : _k{ k }, _expr{ expr } {}
+
+	Scalar scalar() const { return _k; }
+	const internal::nested_t<Expr>& nestedExpression() const { return _expr; }
+	int rows() const { return _expr.rows(); }
+	int cols() const { return _expr.cols(); }
+	value_type coeff(int i, int j) const { return _k * _expr.coeff(i, j); }
+	value_type coeff(int index) const { return _k * _expr.coeff(index); }
+private:
+	Scalar _k;
+	internal::nested_t<Expr> _expr;
+};
+
+/// <summary>
+/// Expression node for the negation \f$-A\f$.
+/// </summary>
+/// <typeparam name="Expr"></typeparam>
+template <typename Expr>
+class MatrixNegation : public MatrixExpression<MatrixNegation<Expr>>
+{
+private:
+	internal::nested_t<Expr> _expr;
+public:
+	using value_type = typename Expr::value_type;
+	static constexpr bool isLinear = Expr::isLinear;
+
+	MatrixNegation(const Expr& expr) : _expr{ expr } {}
+
+	int rows() const { return _expr.rows(); }
+	int cols() const { return _expr.cols(); }
+	value_type coeff(int i, int j) const { return -_expr.coeff(i, j); }
+	value_type coeff(int index) const { return -_expr.coeff(index); }
+};
+
+/// <summary>
+/// Expression node for the transpose \f$A^T\f$. This is a view: no coefficients are moved until the
+/// expression is assigned to a matrix.
+/// </summary>
+/// <typeparam name="Expr"></typeparam>
+template <typename Expr>
+class MatrixTranspose : public MatrixExpression<MatrixTranspose<Expr>>
+{
+private:
+	internal::nested_t<Expr> _expr;
+public:
+	using value_type = typename Expr::value_type;
+	static constexpr bool isLinear = false;
+
+	MatrixTranspose(const Expr& expr) : _expr{ expr } {}
+
+	int rows() const { return _expr.cols(); }
+	int cols() const { return _expr.rows(); }
+	value_type coeff(int i, int j) const { return _expr.coeff(j, i); }
+
+	/// <summary>
+	/// The transpose of a transpose is the original expression.
+	/// </summary>
+	/// <returns></returns>
+	const internal::nested_t<Expr>& transpose() const { return _expr; }
+};
+
+// ===========================================================================================
+//                                   Expression Operators
+// -------------------------------------------------------------------------------------------
+
+/// <summary>
+/// Matrix addition. Returns an unevaluated ``MatrixSum``.
+/// </summary>
+template<typename Lhs, typename Rhs>
+MatrixSum<Lhs, Rhs> operator+(const MatrixExpression<Lhs>& lhs, const MatrixExpression<Rhs>& rhs)
+{
+	return MatrixSum<Lhs, Rhs>{ lhs.derived(), rhs.derived() };
+}
+
+/// <summary>
+/// Matrix subtraction. Returns an unevaluated ``MatrixDifference``.
+/// </summary>
+template<typename Lhs, typename Rhs>
+MatrixDifference<Lhs, Rhs> operator-(const MatrixExpression<Lhs>& lhs, const MatrixExpression<Rhs>& rhs)
+{
+	return MatrixDifference<Lhs, Rhs>{ lhs.derived(), rhs.derived() };
+}
+
+namespace internal
+{
+	/// <summary>
+	/// True if ``Scalar`` can multiply an expression with coefficients of type ``T``: an arithmetic type, or ``T`` itself.
+	/// </summary>
+	template<typename Scalar, typename T>
+	constexpr bool isScalarFor = std::is_arithmetic<Scalar>::value || std::is_same<Scalar, T>::value;
+}
+
+/// <summary>
+/// Scalar multiplication of an expression with a constant, as in ``k * A``.
+/// </summary>
+template<typename Scalar, typename Derived, typename = std::enable_if_t<internal::isScalarFor<Scalar, typename Derived::value_type>>>
+MatrixScalarProduct<Derived, Scalar> operator*(const Scalar k, const MatrixExpression<Derived>& expr)
+{
+	return MatrixScalarProduct<Derived, Scalar>{ k, expr.derived() };
+}
+
+/// <summary>
+/// Scalar multiplication of an expression with a constant, as in ``A * k``.
+/// </summary>
+template<typename Scalar, typename Derived, typename = std::enable_if_t<internal::isScalarFor<Scalar, typename Derived::value_type>>>
+MatrixScalarProduct<Derived, Scalar> operator*(const MatrixExpression<Derived>& expr, const Scalar k)
+{
+	return MatrixScalarProduct<Derived, Scalar>{ k, expr.derived() };
+}
+
+/// <summary>
+/// Unary plus operator. This is the identity and returns its operand.
+/// </summary>
+template<typename Derived>
+const Derived& operator+(const MatrixExpression<Derived>& expr)
+{
+	return expr.derived();
+}
+
+/// <summary>
+/// Unary minus operator. Returns an unevaluated ``MatrixNegation``.
+/// </summary>
+template<typename Derived>
+MatrixNegation<Derived> operator-(const MatrixExpression<Derived>& expr)
+{
+	return MatrixNegation<Derived>{ expr.derived() };
+}
+
+/// <summary>
+/// Transpose of an expression. Returns an unevaluated ``MatrixTranspose`` view.
+/// </summary>
+template<typename Derived>
+MatrixTranspose<Derived> transpose(const MatrixExpression<Derived>& expr)
+{
+	return MatrixTranspose<Derived>{ expr.derived() };
+}
+
+namespace internal
+{
+	/// <summary>
+	/// True if ``T`` enters expressions as a ``MatrixLeaf``, i.e. its coefficients are contiguous in memory.
+	/// </summary>
+	template<typename T>
+	constexpr bool isLeaf = std::is_same<typename ExpressionNesting<T>::type, MatrixLeaf<typename T::value_type>>::value;
+
+	/// <summary>
+	/// True if the coefficients of every expression ``T`` are of type ``scalarType``, so that the SIMD kernels
+	/// of ``scalarType`` can read them.
+	/// </summary>
+	template<typename scalarType, typename... T>
+	constexpr bool hasValueType = (std::is_same<typename T::value_type, scalarType>::value && ...);
+
+	/// <summary>
+	/// The scalar k of ``k * A`` as a ``scalarType``, for the SIMD kernels of A. Returns false if the conversion
+	/// is not exact, in which case the kernels would not compute the promoted product.
+	/// </summary>
+	template<typename scalarType, typename Scalar>
+	bool exactScalar(const Scalar k, scalarType& result)
+	{
+		result = static_cast<scalarType>(k);
+		return static_cast<Scalar>(result) == k;
+	}
+
+	/// <summary>
+	/// Evaluate coefficients ``[begin, end)`` of the common shapes ``A + B``, ``A - B`` and ``k * A`` over
+	/// matrices with the SIMD kernels. Returns false, without touching the destination, for any other expression.
+	/// </summary>
+	template<typename scalarType, typename Derived>
+	bool assignVectorized(scalarType*, const Derived&, int, int)
+	{
+		return false;
+	}
+
+	template<typename scalarType, typename Lhs, typename Rhs>
+	bool assignVectorized(scalarType* destination, const MatrixSum<Lhs, Rhs>& expr, int begin, int end)
+	{
+		if constexpr (hasSimdKernels<scalarType> && isLeaf<Lhs> && isLeaf<Rhs> && hasValueType<scalarType, Lhs, Rhs>)
+		{
+			simdKernels<scalarType>().add(expr.lhs().data() + begin, expr.rhs().data() + begin, destination + begin, end - begin);
+			return true;
+		}
+		return false;
+	}
+
+	template<typename scalarType, typename Lhs, typename Rhs>
+	bool assignVectorized(scalarType* destination, const MatrixDifference<Lhs, Rhs>& expr, int begin, int end)
+	{
+		if constexpr (hasSimdKernels<scalarType> && isLeaf<Lhs> && isLeaf<Rhs> && hasValueType<scalarType, Lhs, Rhs>)
+		{
+			simdKernels<scalarType>().subtract(expr.lhs().data() + begin, expr.rhs().data() + begin, destination + begin, end - begin);
+			return true;
+		}
+		return false;
+	}
+
+	template<typename scalarType, typename Expr, typename Scalar>
+	bool assignVectorized(scalarType* destination, const MatrixScalarProduct<Expr, Scalar>& expr, int begin, int end)
+	{
+		if constexpr (hasSimdKernels<scalarType> && isLeaf<Expr> && hasValueType<scalarType, Expr>)
+		{
+			scalarType k;
+			if (!exactScalar(expr.scalar(), k))
+				return false;
+			simdKernels<scalarType>().scale(expr.nestedExpression().data() + begin, k, destination + begin, end - begin);
+			return true;
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// Evaluate ``destination += expr`` (or ``destination -= expr`` if ``subtract`` is set) over coefficients
+	/// ``[begin, end)`` with the SIMD kernels, for ``expr`` a matrix or a scalar multiple ``k * A`` of one
+	/// (AXPY). Returns false, without touching the destination, for any other expression.
+	/// </summary>
+	template<typename scalarType, typename Derived>
+	bool accumulateVectorized(scalarType* destination, const Derived& e, const bool subtract, int begin, int end)
+	{
+		if constexpr (hasSimdKernels<scalarType> && isLeaf<Derived> && hasValueType<scalarType, Derived>)
+		{
+			const nested_t<Derived> expr{ e };
+			if (subtract)
+				simdKernels<scalarType>().subtract(destination + begin, expr.data() + begin, destination + begin, end - begin);
+			else
+				simdKernels<scalarType>().add(destination + begin, expr.data() + begin, destination + begin, end - begin);
+			return true;
+		}
+		return false;
+	}
+
+	template<typename scalarType, typename Expr, typename Scalar>
+	bool accumulateVectorized(scalarType* destination, const MatrixScalarProduct<Expr, Scalar>& expr, const bool subtract, int begin, int end)
+	{
+		if constexpr (hasSimdKernels<scalarType> && isLeaf<Expr> && hasValueType<scalarType, Expr>)
+		{
+			scalarType k;
+			if (!exactScalar(expr.scalar(), k))
+				return false;
+			simdKernels<scalarType>().axpy(subtract ? -k : k, expr.nestedExpression().data() + begin, destination + begin, end - begin);
+			return true;
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// Pointer to the first coefficient of row i of x if the coefficients of that row are contiguous in
+	/// memory (x is a matrix, or a view with unit column stride), nullptr otherwise.
+	/// </summary>
+	template<typename X>
+	const typename X::value_type* contiguousRow(const X& x, int i)
+	{
+		if constexpr (isLeaf<X>)
+			return x.data() + i * x.cols();
+		else if constexpr (IsStridedView<X>::value)
+			return x.colStride() == 1 ? x.rowData(i) : nullptr;
+		else
+			return nullptr;
+	}
+
+	/// <summary>
+	/// Evaluate row i of an expression over matrices and strided views with contiguous rows: a copy,
+	/// ``A + B``, ``A - B`` or ``k * A``, the last three with the SIMD kernels. Returns false, without
+	/// touching the destination, for any other expression.
+	/// </summary>
+	template<typename scalarType, typename Derived>
+	bool assignRowVectorized(scalarType* destination, const Derived& expr, int i)
+	{
+		const auto* source{ contiguousRow(expr, i) };
+		if (source == nullptr)
+			return false;
+		std::transform(source, source + expr.cols(), destination, [](auto x) { return static_cast<scalarType>(x); });
+		return true;
+	}
+
+	template<typename scalarType, typename Lhs, typename Rhs>
+	bool assignRowVectorized(scalarType* destination, const MatrixSum<Lhs, Rhs>& expr, int i)
+	{
+		if constexpr (hasSimdKernels<scalarType> && hasValueType<scalarType, Lhs, Rhs>)
+		{
+			const scalarType* a{ contiguousRow(expr.lhs(), i) };
+			const scalarType* b{ contiguousRow(expr.rhs(), i) };
+			if (a != nullptr && b != nullptr)
+			{
+				simdKernels<scalarType>().add(a, b, destination, expr.cols());
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template<typename scalarType, typename Lhs, typename Rhs>
+	bool assignRowVectorized(scalarType* destination, const MatrixDifference<Lhs, Rhs>& expr, int i)
+	{
+		if constexpr (hasSimdKernels<scalarType> && hasValueType<scalarType, Lhs, Rhs>)
+		{
+			const scalarType* a{ contiguousRow(expr.lhs(), i) };
+			const scalarType* b{ contiguousRow(expr.rhs(), i) };
+			if (a != nullptr && b != nullptr)
+			{
+				simdKernels<scalarType>().subtract(a, b, destination, expr.cols());
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template<typename scalarType, typename Expr, typename Scalar>
+	bool assignRowVectorized(scalarType* destination, const MatrixScalarProduct<Expr, Scalar>& expr, int i)
+	{
+		if constexpr (hasSimdKernels<scalarType> && hasValueType<scalarType, Expr>)
+		{
+			const scalarType* a{ contiguousRow(expr.nestedExpression(), i) };
+			scalarType k;
+			if (a != nullptr && exactScalar(expr.scalar(), k))
+			{
+				simdKernels<scalarType>().scale(a, k, destination, expr.cols());
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// Row-wise counterpart of ``accumulateVectorized``: ``destination += expr`` (or ``-=``) over row i,
+	/// for ``expr`` a matrix or view with contiguous rows, or a scalar multiple of one (AXPY).
+	/// </summary>
+	template<typename scalarType, typename Derived>
+	bool accumulateRowVectorized(scalarType* destination, const Derived& expr, const bool subtract, int i)
+	{
+		if constexpr (hasSimdKernels<scalarType> && hasValueType<scalarType, Derived>)
+		{
+			const scalarType* a{ contiguousRow(expr, i) };
+			if (a != nullptr)
+			{
+				if (subtract)
+					simdKernels<scalarType>().subtract(destination, a, destination, expr.cols());
+				else
+					simdKernels<scalarType>().add(destination, a, destination, expr.cols());
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template<typename scalarType, typename Expr, typename Scalar>
+	bool accumulateRowVectorized(scalarType* destination, const MatrixScalarProduct<Expr, Scalar>& expr, const bool subtract, int i)
+	{
+		if constexpr (hasSimdKernels<scalarType> && hasValueType<scalarType, Expr>)
+		{
+			const scalarType* a{ contiguousRow(expr.nestedExpression(), i) };
+			scalarType k;
+			if (a != nullptr && exactScalar(expr.scalar(), k))
+			{
+				simdKernels<scalarType>().axpy(subtract ? -k : k, a, destination, expr.cols());
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// Evaluate the transpose ``A^T`` of a matrix, or of a view with contiguous rows, with the blocked
+	/// kernel of Transpose.h. Returns false, without touching the destination, for any other expression.
+	/// </summary>
+	template<typename scalarType, typename Derived>
+	bool assignTransposed(scalarType*, const Derived&)
+	{
+		return false;
+	}
+
+	template<typename scalarType, typename Expr>
+	bool assignTransposed(scalarType* destination, const MatrixTranspose<Expr>& expr)
+	{
+		const auto& source{ expr.transpose() };
+		if constexpr (!hasValueType<scalarType, Expr>)
+			return false;
+		else if constexpr (isLeaf<Expr>)
+		{
+			transposeCopy(source.rows(), source.cols(), source.data(), source.cols(), destination, source.rows());
+			return true;
+		}
+		else if constexpr (IsStridedView<Expr>::value)
+		{
+			if (source.colStride() != 1)
+				return false;
+			transposeCopy(source.rows(), source.cols(), source.data(), source.rowStride(), destination, source.rows());
+			return true;
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// True if no coefficient of an expression lives in the storage ``[begin, end)``, so that the
+	/// expression can be evaluated directly into that storage whatever order it reads its coefficients in.
+	/// Expressions made of matrices and views are checked; any other expression is assumed to alias.
+	/// Matrices and views of another scalar type are distinct objects from the storage.
+	/// </summary>
+	template<typename scalarType, typename Derived>
+	bool disjointFrom(const Derived& x, const scalarType* begin, const scalarType* end)
+	{
+		if constexpr ((isLeaf<Derived> || IsStridedView<Derived>::value) && !hasValueType<scalarType, Derived>)
+			return true;
+		else if constexpr (isLeaf<Derived>)
+			return x.size() == 0 || x.data() + x.size() <= begin || end <= x.data();
+		else if constexpr (IsStridedView<Derived>::value)
+		{
+			if (x.rows() == 0 || x.cols() == 0)
+				return true;
+			const scalarType* first{ x.data() };
+			const scalarType* last{ first + (x.rows() - 1) * x.rowStride() + (x.cols() - 1) * x.colStride() };
+			return last < begin || end <= first;
+		}
+		else
+			return false;
+	}
+
+	template<typename scalarType, typename Lhs, typename Rhs>
+	bool disjointFrom(const MatrixSum<Lhs, Rhs>& x, const scalarType* begin, const scalarType* end)
+	{
+		return disjointFrom(x.lhs(), begin, end) && disjointFrom(x.rhs(), begin, end);
+	}
+
+	template<typename scalarType, typename Lhs, typename Rhs>
+	bool disjointFrom(const MatrixDifference<Lhs, Rhs>& x, const scalarType* begin, const scalarType* end)
+	{
+		return disjointFrom(x.lhs(), begin, end) && disjointFrom(x.rhs(), begin, end);
+	}
+
+	template<typename scalarType, typename Expr, typename Scalar>
+	bool disjointFrom(const MatrixScalarProduct<Expr, Scalar>& x, const scalarType* begin, const scalarType* end)
+	{
+		return disjointFrom(x.nestedExpression(), begin, end);
+	}
+
+	template<typename scalarType, typename Expr>
+	bool disjointFrom(const MatrixTranspose<Expr>& x, const scalarType* begin, const scalarType* end)
+	{
+		return disjointFrom(x.transpose(), begin, end);
+	}
+
+	/// <summary>
+	/// Evaluate an expression into row-major storage, in a single pass. Shapes handled by
+	/// ``assignVectorized`` go to the SIMD kernels, and transposed matrices to ``assignTransposed``.
+	/// Expressions over strided views are evaluated row by row, with ``assignRowVectorized`` where the
+	/// rows are contiguous. Large expressions are split into chunks of
+	/// ``grainSize()`` coefficients (whole rows, for expressions that are not linear) that are
+	/// evaluated on the library thread pool.
+	/// </summary>
+	/// <param name="destination"></param>
+	/// <param name="expr"></param>
+	template<typename scalarType, typename Derived>
+	void assignExpression(scalarType* destination, const Derived& e)
+	{
+		const nested_t<Derived> expr{ e };
+		const int rows{ expr.rows() };
+		const int cols{ expr.cols() };
+
+		if constexpr (Derived::isLinear)
+		{
+			parallelFor(0, rows * cols, grainSize(), [&](int first, int last) {
+				if (assignVectorized(destination, e, first, last))
+					return;
+				for (int index{ first }; index < last; ++index)
+					destination[index] = static_cast<scalarType>(expr.coeff(index));
+			});
+		}
+		else
+		{
+			if (assignTransposed(destination, e))
+				return;
+
+			parallelFor(0, rows, std::max(1, grainSize() / std::max(cols, 1)), [&](int first, int last) {
+				for (int i{ first }; i < last; ++i)
+				{
+					if (assignRowVectorized(destination + i * cols, expr, i))
+						continue;
+					for (int j{}; j < cols; ++j)
+						destination[i * cols + j] = static_cast<scalarType>(expr.coeff(i, j));
+				}
+			});
+		}
+	}
+
+	/// <summary>
+	/// Merge a linear expression into row-major storage in place, as in ``destination[k] += expr[k]``.
+	/// Each coefficient of the destination is read and written exactly once. Shapes handled by
+	/// ``accumulateVectorized`` go to the SIMD kernels; large expressions are evaluated in parallel.
+	/// </summary>
+	/// <param name="destination"></param>
+	/// <param name="expr"></param>
+	/// <param name="subtract">Subtract the expression instead of adding it</param>
+	template<typename scalarType, typename Derived>
+	void accumulateExpression(scalarType* destination, const Derived& e, const bool subtract)
+	{
+		static_assert(Derived::isLinear, "compound assignment requires an expression readable in storage order");
+		const nested_t<Derived> expr{ e };
+		parallelFor(0, expr.rows() * expr.cols(), grainSize(), [&](int first, int last) {
+			if (accumulateVectorized(destination, e, subtract, first, last))
+				return;
+			if (subtract)
+				for (int index{ first }; index < last; ++index)
+					destination[index] -= expr.coeff(index);
+			else
+				for (int index{ first }; index < last; ++index)
+					destination[index] += expr.coeff(index);
+		});
+	}
+}
+
+#endif // !MatrixExpression_H
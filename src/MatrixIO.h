@@ -0,0 +1,862 @@
+#pragma once
+#ifndef MatrixIO_H
+#define MatrixIO_H
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "Float16.h"
+#include "Matrix.h"
+#include "MatrixX.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// Binary files of matrices, memory-mapped matrices and NumPy ``.npy`` files.
+//
+/// ``operator<<`` formats a matrix for reading; these functions store the coefficients themselves, so that a
+/// matrix of \f$10^8\f$ coefficients is written and read at the speed of the disk.
+///
+/// The MathLib matrix file is a 64-byte header followed by the coefficients, in row-major order and in the
+/// byte order of the machine (little-endian on every platform MathLib builds on). The header holds a magic
+/// string, the version of the format, the scalar type and its size, the layout, the dimensions and a 64-bit
+/// checksum of the coefficients. The coefficients start 64 bytes into the file, so that they are aligned
+/// like those of a ``MatrixX`` when the file is mapped into memory.
+///
+/// - ``save(path, m)`` writes a ``MatrixX`` or ``Matrix``; ``MatrixFileWriter`` writes a matrix a few rows
+///   at a time, for matrices produced piece by piece or larger than memory.
+/// - ``load<scalarType>(path)`` reads a file into a ``MatrixX`` and verifies its checksum.
+/// - ``MappedMatrix<scalarType>`` maps a file into memory read-only. Opening it only reads the header, so it
+///   takes constant time whatever the size of the file, and the pages are read from disk as they are first
+///   used. It takes part in expressions and products like a ``MatrixX``; ``verify()`` checks the checksum.
+/// - ``saveNpy(path, m)`` and ``loadNpy<scalarType>(path)`` write and read the ``.npy`` format of NumPy, for
+///   ``int``, ``float``, ``double`` and ``half`` matrices. Vectors (1-D arrays) are read as columns and
+///   Fortran-ordered arrays are transposed on reading.
+///
+/// ```
+/// save("factors.mlm", factors);
+/// MappedMatrix<double> mapped{ "factors.mlm" };		// O(1), no copy
+/// MatrixXd exposure{ mapped * weights };
+/// saveNpy("exposure.npy", exposure);					// numpy.load("exposure.npy") in Python
+/// ```
+///
+/// Files that cannot be opened, read or written, and files that are not valid (bad magic string, unknown
+/// version, another scalar type, truncated, wrong checksum) throw ``std::runtime_error``.
+
+namespace internal
+{
+	/// <summary>
+	/// The scalar types that can be stored: their code in the header of a matrix file, and their NumPy type
+	/// descriptor (nullptr if NumPy has none).
+	/// </summary>
+	template<typename T>
+	struct StoredScalar;
+
+	template<>
+	struct StoredScalar<int>
+	{
+		static_assert(sizeof(int) == 4, "int must be 32 bits");
+		static constexpr std::uint32_t code{ 1 };
+		static constexpr const char* npy{ "<i4" };
+	};
+
+	template<>
+	struct StoredScalar<float>
+	{
+		static constexpr std::uint32_t code{ 2 };
+		static constexpr const char* npy{ "<f4" };
+	};
+
+	template<>
+	struct StoredScalar<double>
+	{
+		static constexpr std::uint32_t code{ 3 };
+		static constexpr const char* npy{ "<f8" };
+	};
+
+	template<>
+	struct StoredScalar<half>
+	{
+		static constexpr std::uint32_t code{ 4 };
+		static constexpr const char* npy{ "<f2" };
+	};
+
+	template<>
+	struct StoredScalar<bfloat16>
+	{
+		static constexpr std::uint32_t code{ 5 };
+		static constexpr const char* npy{ nullptr };
+	};
+
+	/// <summary>
+	/// 64-bit checksum of a byte stream: FNV-1a over 8-byte words, in four interleaved lanes so that the
+	/// multiplications of consecutive words do not wait for each other. The bytes can be fed in pieces of any
+	/// size; the checksum only depends on their concatenation.
+	/// </summary>
+	class Checksum
+	{
+	private:
+		static constexpr std::uint64_t offset{ 0xcbf29ce484222325ull };
+		static constexpr std::uint64_t prime{ 0x100000001b3ull };
+		static constexpr int blockSize{ 32 };
+
+		std::uint64_t _lanes[4]{ offset, offset ^ 1, offset ^ 2, offset ^ 3 };
+		unsigned char _pending[blockSize]{};
+		int _pendingBytes{};
+		std::uint64_t _length{};
+
+		void block(const unsigned char* p)
+		{
+			for (int lane{}; lane < 4; ++lane)
+			{
+				std::uint64_t word;
+				std::memcpy(&word, p + 8 * lane, sizeof word);
+				_lanes[lane] = (_lanes[lane] ^ word) * prime;
+			}
+		}
+	public:
+		void update(const void* data, std::size_t bytes)
+		{
+			// The storage of an empty matrix may be null, which memcpy does not accept even for no bytes.
+			if (bytes == 0)
+				return;
+			const unsigned char* p{ static_cast<const unsigned char*>(data) };
+			_length += bytes;
+			if (_pendingBytes > 0)
+			{
+				const std::size_t take{ std::min<std::size_t>(bytes, blockSize - _pendingBytes) };
+				std::memcpy(_pending + _pendingBytes, p, take);
+				_pendingBytes += static_cast<int>(take);
+				p += take;
+				bytes -= take;
+				if (_pendingBytes < blockSize)
+					return;
+				block(_pending);
+				_pendingBytes = 0;
+			}
+			for (; bytes >= blockSize; p += blockSize, bytes -= blockSize)
+				block(p);
+			std::memcpy(_pending, p, bytes);
+			_pendingBytes = static_cast<int>(bytes);
+		}
+
+		std::uint64_t value() const
+		{
+			std::uint64_t h{ offset };
+			for (std::uint64_t lane : _lanes)
+				h = (h ^ lane) * prime;
+			for (int i{}; i < _pendingBytes; ++i)
+				h = (h ^ _pending[i]) * prime;
+			return (h ^ _length) * prime;
+		}
+	};
+
+	/// <summary>
+	/// Header of a MathLib matrix file. A file whose magic string is not set was not completely written.
+	/// </summary>
+	struct MatrixFileHeader
+	{
+		static constexpr char expectedMagic[8]{ 'M', 'A', 'T', 'H', 'L', 'I', 'B', 'M' };
+		static constexpr std::uint32_t currentVersion{ 1 };
+		static constexpr std::uint32_t rowMajor{ 0 };
+
+		char magic[8]{};
+		std::uint32_t version{ currentVersion };
+		std::uint32_t scalar{};
+		std::uint32_t scalarSize{};
+		std::uint32_t layout{ rowMajor };
+		std::int64_t rows{};
+		std::int64_t cols{};
+		std::uint64_t checksum{};
+		unsigned char reserved[16]{};
+	};
+	static_assert(sizeof(MatrixFileHeader) == 64, "the header of a matrix file is 64 bytes");
+
+	/// <summary>
+	/// Check that a header describes a complete matrix of scalarType that this version of MathLib can read.
+	/// </summary>
+	template<typename scalarType>
+	void validateHeader(const MatrixFileHeader& header, const std::string& path)
+	{
+		if (std::memcmp(header.magic, MatrixFileHeader::expectedMagic, sizeof header.magic) != 0)
+			throw std::runtime_error(path + " is not a MathLib matrix file, or was not completely written!");
+		if (header.version > MatrixFileHeader::currentVersion)
+			throw std::runtime_error(path + " was written by a newer version of MathLib!");
+		if (header.scalar != StoredScalar<scalarType>::code || header.scalarSize != sizeof(scalarType))
+			throw std::runtime_error(path + " holds a matrix of another scalar type!");
+		if (header.layout != MatrixFileHeader::rowMajor)
+			throw std::runtime_error(path + " has an unknown layout!");
+		if (header.rows < 0 || header.cols < 0 || header.rows > INT_MAX || header.cols > INT_MAX
+			|| (header.cols > 0 && header.rows > INT_MAX / header.cols))
+			throw std::runtime_error(path + " has invalid dimensions!");
+	}
+
+	/// <summary>
+	/// A whole file mapped read-only into memory, unmapped on destruction.
+	/// </summary>
+	class FileMapping
+	{
+	private:
+		const unsigned char* _address{ nullptr };
+		std::size_t _length{};
+
+		void unmap()
+		{
+			if (_address == nullptr)
+				return;
+#ifdef _WIN32
+			UnmapViewOfFile(_address);
+#else
+			munmap(const_cast<unsigned char*>(_address), _length);
+#endif
+			_address = nullptr;
+			_length = 0;
+		}
+	public:
+		FileMapping() = default;
+
+		explicit FileMapping(const std::string& path)
+		{
+#ifdef _WIN32
+			const HANDLE file{ CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+			if (file == INVALID_HANDLE_VALUE)
+				throw std::runtime_error("Cannot open " + path);
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(file, &size))
+			{
+				CloseHandle(file);
+				throw std::runtime_error("Cannot read the size of " + path);
+			}
+			_length = static_cast<std::size_t>(size.QuadPart);
+			if (_length > 0)
+			{
+				const HANDLE mapping{ CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+				if (mapping != nullptr)
+				{
+					_address = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+					CloseHandle(mapping);
+				}
+			}
+			CloseHandle(file);
+#else
+			const int file{ ::open(path.c_str(), O_RDONLY) };
+			if (file < 0)
+				throw std::runtime_error("Cannot open " + path);
+			struct stat status;
+			if (fstat(file, &status) != 0)
+			{
+				::close(file);
+				throw std::runtime_error("Cannot read the size of " + path);
+			}
+			_length = static_cast<std::size_t>(status.st_size);
+			if (_length > 0)
+			{
+				void* address{ mmap(nullptr, _length, PROT_READ, MAP_SHARED, file, 0) };
+				if (address != MAP_FAILED)
+					_address = static_cast<const unsigned char*>(address);
+			}
+			::close(file);
+#endif
+			if (_length > 0 && _address == nullptr)
+				throw std::runtime_error("Cannot map " + path + " into memory");
+		}
+
+		FileMapping(const FileMapping&) = delete;
+		FileMapping& operator=(const FileMapping&) = delete;
+
+		FileMapping(FileMapping&& other) noexcept : _address{ other._address }, _length{ other._length }
+		{
+			other._address = nullptr;
+			other._length = 0;
+		}
+
+		FileMapping& operator=(FileMapping&& other) noexcept
+		{
+			if (this != &other)
+			{
+				unmap();
+				std::swap(_address, other._address);
+				std::swap(_length, other._length);
+			}
+			return *this;
+		}
+
+		~FileMapping() { unmap(); }
+
+		const unsigned char* data() const { return _address; }
+		std::size_t size() const { return _length; }
+	};
+}
+
+// ===========================================================================================
+//                                   MathLib matrix files
+// -------------------------------------------------------------------------------------------
+
+/// <summary>
+/// ``MatrixFileWriter`` writes a MathLib matrix file piece by piece: the coefficients are passed to ``write()``
+/// in row-major order, in as many calls as convenient, and ``close()`` completes the header with the checksum.
+/// A file that is not closed, or closed before all its coefficients were written, is not a valid matrix file.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+class MatrixFileWriter
+{
+private:
+	std::ofstream _file;
+	std::string _path;
+	internal::MatrixFileHeader _header;
+	std::int64_t _written;
+	internal::Checksum _checksum;
+public:
+	MatrixFileWriter(const std::string& path, int rows, int cols);
+	MatrixFileWriter(const MatrixFileWriter&) = delete;
+	MatrixFileWriter& operator=(const MatrixFileWriter&) = delete;
+
+	void write(const scalarType* data, std::int64_t count);
+	void close();
+};
+
+/// <summary>
+/// Create (or truncate) the file and reserve its header.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="path"></param>
+/// <param name="rows"></param>
+/// <param name="cols"></param>
+template<typename scalarType>
+MatrixFileWriter<scalarType>::MatrixFileWriter(const std::string& path, int rows, int cols) :
+	_file{ path, std::ios::binary | std::ios::trunc }, _path{ path }, _written{}
+{
+	if (rows < 0 || cols < 0)
+		throw std::logic_error("Matrix dimensions must be non-negative!");
+	if (!_file)
+		throw std::runtime_error("Cannot open " + path + " for writing");
+
+	_header.scalar = internal::StoredScalar<scalarType>::code;
+	_header.scalarSize = sizeof(scalarType);
+	_header.rows = rows;
+	_header.cols = cols;
+	// The magic string is only written by close(), so that an incomplete file cannot be read.
+	_file.write(reinterpret_cast<const char*>(&_header), sizeof _header);
+	if (!_file)
+		throw std::runtime_error("Error writing " + path);
+}
+
+/// <summary>
+/// Append the next ``count`` coefficients, in row-major order.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="data"></param>
+/// <param name="count"></param>
+template<typename scalarType>
+void MatrixFileWriter<scalarType>::write(const scalarType* data, std::int64_t count)
+{
+	if (!_file.is_open())
+		throw std::logic_error("The matrix file is already closed!");
+	if (count < 0 || _written + count > _header.rows * _header.cols)
+		throw std::logic_error("More coefficients written than the matrix has!");
+
+	const std::size_t bytes{ static_cast<std::size_t>(count) * sizeof(scalarType) };
+	_checksum.update(data, bytes);
+	_file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+	if (!_file)
+		throw std::runtime_error("Error writing " + _path);
+	_written += count;
+}
+
+/// <summary>
+/// Complete the header and close the file. Throws if fewer coefficients were written than the matrix has.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+void MatrixFileWriter<scalarType>::close()
+{
+	if (!_file.is_open())
+		return;
+	if (_written != _header.rows * _header.cols)
+		throw std::logic_error("Fewer coefficients written than the matrix has!");
+
+	std::memcpy(_header.magic, internal::MatrixFileHeader::expectedMagic, sizeof _header.magic);
+	_header.checksum = _checksum.value();
+	_file.seekp(0);
+	_file.write(reinterpret_cast<const char*>(&_header), sizeof _header);
+	_file.close();
+	if (!_file)
+		throw std::runtime_error("Error writing " + _path);
+}
+
+namespace internal
+{
+	template<typename scalarType>
+	void saveMatrix(const std::string& path, const scalarType* data, int rows, int cols)
+	{
+		MatrixFileWriter<scalarType> writer{ path, rows, cols };
+		writer.write(data, static_cast<std::int64_t>(rows) * cols);
+		writer.close();
+	}
+
+	/// <summary>
+	/// Read the header of a matrix file and the ``rows x cols`` coefficients that follow into ``data``, and verify
+	/// the checksum. ``allocate(rows, cols)`` is called once the dimensions are known and returns the storage.
+	/// </summary>
+	template<typename scalarType, typename Allocate>
+	void loadMatrix(const std::string& path, Allocate allocate)
+	{
+		std::ifstream file{ path, std::ios::binary };
+		if (!file)
+			throw std::runtime_error("Cannot open " + path);
+
+		MatrixFileHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof header))
+			throw std::runtime_error(path + " is not a MathLib matrix file, or was not completely written!");
+		validateHeader<scalarType>(header, path);
+
+		scalarType* data{ allocate(static_cast<int>(header.rows), static_cast<int>(header.cols)) };
+		const std::size_t bytes{ static_cast<std::size_t>(header.rows * header.cols) * sizeof(scalarType) };
+		if (!file.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(bytes)))
+			throw std::runtime_error(path + " is truncated!");
+
+		Checksum checksum;
+		checksum.update(data, bytes);
+		if (checksum.value() != header.checksum)
+			throw std::runtime_error(path + " is corrupt: its checksum does not match its coefficients!");
+	}
+}
+
+/// <summary>
+/// Write a matrix to a MathLib matrix file.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="path"></param>
+/// <param name="m"></param>
+template<typename scalarType, typename Allocator>
+void save(const std::string& path, const MatrixX<scalarType, Allocator>& m)
+{
+	internal::saveMatrix(path, m.data(), m.rows(), m.cols());
+}
+
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+void save(const std::string& path, const Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& m)
+{
+	internal::saveMatrix(path, m.data(), m.rows(), m.cols());
+}
+
+/// <summary>
+/// Read a MathLib matrix file into a new matrix, verifying its checksum.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="path"></param>
+/// <returns></returns>
+template<typename scalarType>
+MatrixX<scalarType> load(const std::string& path)
+{
+	MatrixX<scalarType> m;
+	internal::loadMatrix<scalarType>(path, [&m](int rows, int cols) {
+		m.resize(rows, cols);
+		return m.data();
+	});
+	return m;
+}
+
+/// <summary>
+/// Read a MathLib matrix file into a fixed-size matrix, verifying its checksum. The file must hold a matrix of the
+/// same dimensions.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="path"></param>
+/// <param name="m"></param>
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+void load(const std::string& path, Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& m)
+{
+	Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime> result;
+	internal::loadMatrix<scalarType>(path, [&result](int rows, int cols) {
+		if (rows != rowsAtCompileTime || cols != colsAtCompileTime)
+			throw std::logic_error("The file holds a matrix of other dimensions!");
+		return result.data();
+	});
+	m = result;
+}
+
+// ===========================================================================================
+//                                   Memory-mapped matrices
+// -------------------------------------------------------------------------------------------
+
+template<typename scalarType>
+class MappedMatrix;
+
+namespace internal
+{
+	/// <summary>
+	/// Mapped matrices take part in expressions through a non-owning leaf over the mapped coefficients.
+	/// </summary>
+	template<typename scalarType>
+	struct ExpressionNesting<MappedMatrix<scalarType>>
+	{
+		using type = MatrixLeaf<scalarType>;
+	};
+}
+
+/// <summary>
+/// ``MappedMatrix`` is a read-only matrix whose coefficients are those of a MathLib matrix file mapped into
+/// memory. Opening a file reads and validates its header only; the operating system reads the coefficients
+/// from disk as they are used, and may share them between processes mapping the same file. The mapping
+/// stays valid as long as the object lives, even if the file is deleted.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+class MappedMatrix : public MatrixExpression<MappedMatrix<scalarType>>
+{
+private:
+	internal::FileMapping _mapping;
+	const scalarType* _data;
+	int _rows;
+	int _cols;
+	std::uint64_t _checksum;
+public:
+	using value_type = scalarType;
+	static constexpr bool isLinear = true;
+
+	MappedMatrix();
+	explicit MappedMatrix(const std::string& path);
+
+	const scalarType* data() const;
+	int rows() const;
+	int cols() const;
+	int size() const;
+
+	scalarType operator()(const int i, const int j) const;
+	scalarType coeff(const int i, const int j) const;
+	scalarType coeff(const int index) const;
+
+	MatrixView<const scalarType> block(int i, int j, int p, int q) const;
+	bool verify() const;
+};
+
+/// <summary>
+/// An empty mapped matrix, not backed by any file.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+MappedMatrix<scalarType>::MappedMatrix() : _data{ nullptr }, _rows{ 0 }, _cols{ 0 }, _checksum{}
+{
+}
+
+/// <summary>
+/// Map a MathLib matrix file into memory. Takes constant time: only the header is read.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="path"></param>
+template<typename scalarType>
+MappedMatrix<scalarType>::MappedMatrix(const std::string& path) : _mapping{ path }
+{
+	internal::MatrixFileHeader header;
+	if (_mapping.size() < sizeof header)
+		throw std::runtime_error(path + " is not a MathLib matrix file, or was not completely written!");
+	std::memcpy(&header, _mapping.data(), sizeof header);
+	internal::validateHeader<scalarType>(header, path);
+	if (_mapping.size() - sizeof header < static_cast<std::size_t>(header.rows * header.cols) * sizeof(scalarType))
+		throw std::runtime_error(path + " is truncated!");
+
+	_data = reinterpret_cast<const scalarType*>(_mapping.data() + sizeof header);
+	_rows = static_cast<int>(header.rows);
+	_cols = static_cast<int>(header.cols);
+	_checksum = header.checksum;
+}
+
+/// <summary>
+/// Pointer to the mapped coefficients, in row-major order.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+const scalarType* MappedMatrix<scalarType>::data() const
+{
+	return _data;
+}
+
+/// <summary>
+/// Number of rows.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+int MappedMatrix<scalarType>::rows() const
+{
+	return _rows;
+}
+
+/// <summary>
+/// Number of columns.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+int MappedMatrix<scalarType>::cols() const
+{
+	return _cols;
+}
+
+/// <summary>
+/// Number of coefficients.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+int MappedMatrix<scalarType>::size() const
+{
+	return _rows * _cols;
+}
+
+/// <summary>
+/// The coefficient (i, j). Throws ``std::out_of_range`` if the indices are outside the matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType>
+scalarType MappedMatrix<scalarType>::operator()(const int i, const int j) const
+{
+	if (i < 0 || i >= _rows || j < 0 || j >= _cols)
+		throw std::out_of_range("Index out of bounds!");
+	return _data[i * _cols + j];
+}
+
+/// <summary>
+/// The coefficient (i, j), without bounds checking.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType>
+scalarType MappedMatrix<scalarType>::coeff(const int i, const int j) const
+{
+	return _data[i * _cols + j];
+}
+
+/// <summary>
+/// The coefficient at ``index`` in row-major order, without bounds checking.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="index"></param>
+/// <returns></returns>
+template<typename scalarType>
+scalarType MappedMatrix<scalarType>::coeff(const int index) const
+{
+	return _data[index];
+}
+
+/// <summary>
+/// Read-only view of the p x q block starting at (i, j), for products and solvers that take views.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+MatrixView<const scalarType> MappedMatrix<scalarType>::block(int i, int j, int p, int q) const
+{
+	if (i < 0 || j < 0 || p < 0 || q < 0 || i + p > _rows || j + q > _cols)
+		throw std::out_of_range("Block out of bounds!");
+	return MatrixView<const scalarType>{ _data + i * _cols + j, slice{ 0, p, _cols }, slice{ 0, q, 1 } };
+}
+
+/// <summary>
+/// True if the checksum of the mapped coefficients matches the one of the header. This reads the whole file.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+bool MappedMatrix<scalarType>::verify() const
+{
+	internal::Checksum checksum;
+	checksum.update(_data, static_cast<std::size_t>(size()) * sizeof(scalarType));
+	return checksum.value() == _checksum;
+}
+
+/// <summary>
+/// Matrix multiplication of a mapped matrix with a matrix, by the ``gemm`` kernel over the mapped coefficients.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="A"></param>
+/// <param name="B"></param>
+/// <returns></returns>
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator> operator*(const MappedMatrix<scalarType>& A, const MatrixX<scalarType, Allocator>& B)
+{
+	if (A.cols() != B.rows())
+		throw std::logic_error("Error multiplying the matrices; the number of cols(A) must equal the number of rows(B)!");
+
+	MatrixX<scalarType, Allocator> result{ A.rows(), B.cols() };
+	gemm(A.rows(), B.cols(), A.cols(), scalarType{ 1 }, A.data(), A.cols(), B.data(), B.cols(), scalarType{}, result.data(), result.cols());
+	return result;
+}
+
+// ===========================================================================================
+//                                   NumPy .npy files
+// -------------------------------------------------------------------------------------------
+
+namespace internal
+{
+	constexpr char npyMagic[6]{ '\x93', 'N', 'U', 'M', 'P', 'Y' };
+
+	/// <summary>
+	/// The value of ``key`` in the dictionary of a .npy header: the text after ``'key':`` up to the next
+	/// top-level comma, without surrounding spaces.
+	/// </summary>
+	inline std::string npyValue(const std::string& header, const std::string& key, const std::string& path)
+	{
+		std::size_t begin{ header.find("'" + key + "'") };
+		if (begin == std::string::npos)
+			throw std::runtime_error(path + " has no '" + key + "' in its header!");
+		begin = header.find(':', begin);
+		if (begin == std::string::npos)
+			throw std::runtime_error(path + " has an invalid header!");
+		++begin;
+		std::size_t end{ begin };
+		int depth{};
+		for (; end < header.size(); ++end)
+		{
+			const char c{ header[end] };
+			if (c == '(')
+				++depth;
+			else if (c == ')')
+				--depth;
+			else if ((c == ',' && depth == 0) || c == '}')
+				break;
+		}
+		const std::size_t first{ header.find_first_not_of(' ', begin) };
+		const std::size_t last{ header.find_last_not_of(' ', end - 1) };
+		return first > last ? std::string{} : header.substr(first, last - first + 1);
+	}
+
+	template<typename scalarType>
+	void saveNpy(const std::string& path, const scalarType* data, int rows, int cols)
+	{
+		static_assert(StoredScalar<scalarType>::npy != nullptr, "NumPy has no type for this scalar type");
+
+		std::string header{ "{'descr': '" + std::string{ StoredScalar<scalarType>::npy } + "', 'fortran_order': False, 'shape': ("
+			+ std::to_string(rows) + ", " + std::to_string(cols) + "), }" };
+		// The magic string, version, header length, header and newline take a multiple of 64 bytes.
+		const std::size_t total{ (sizeof npyMagic + 4 + header.size() + 1 + 63) / 64 * 64 };
+		header.append(total - sizeof npyMagic - 4 - header.size() - 1, ' ');
+		header.push_back('\n');
+
+		std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+		if (!file)
+			throw std::runtime_error("Cannot open " + path + " for writing");
+		const unsigned char preamble[4]{ 1, 0, static_cast<unsigned char>(header.size() & 0xff), static_cast<unsigned char>(header.size() >> 8) };
+		file.write(npyMagic, sizeof npyMagic);
+		file.write(reinterpret_cast<const char*>(preamble), sizeof preamble);
+		file.write(header.data(), static_cast<std::streamsize>(header.size()));
+		file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(static_cast<std::size_t>(rows) * cols * sizeof(scalarType)));
+		file.close();
+		if (!file)
+			throw std::runtime_error("Error writing " + path);
+	}
+}
+
+/// <summary>
+/// Write a matrix to a NumPy .npy file, as a 2-D C-ordered array.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="path"></param>
+/// <param name="m"></param>
+template<typename scalarType, typename Allocator>
+void saveNpy(const std::string& path, const MatrixX<scalarType, Allocator>& m)
+{
+	internal::saveNpy(path, m.data(), m.rows(), m.cols());
+}
+
+template<typename scalarType, int rowsAtCompileTime, int colsAtCompileTime>
+void saveNpy(const std::string& path, const Matrix<scalarType, rowsAtCompileTime, colsAtCompileTime>& m)
+{
+	internal::saveNpy(path, m.data(), m.rows(), m.cols());
+}
+
+/// <summary>
+/// Read a NumPy .npy file holding a 1-D or 2-D array of ``scalarType``. A 1-D array of n elements is read as
+/// an n x 1 column, and a Fortran-ordered array is transposed into row-major order.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="path"></param>
+/// <returns></returns>
+template<typename scalarType>
+MatrixX<scalarType> loadNpy(const std::string& path)
+{
+	static_assert(internal::StoredScalar<scalarType>::npy != nullptr, "NumPy has no type for this scalar type");
+
+	std::ifstream file{ path, std::ios::binary };
+	if (!file)
+		throw std::runtime_error("Cannot open " + path);
+
+	char magic[sizeof internal::npyMagic];
+	unsigned char version[2];
+	if (!file.read(magic, sizeof magic) || std::memcmp(magic, internal::npyMagic, sizeof magic) != 0
+		|| !file.read(reinterpret_cast<char*>(version), sizeof version))
+		throw std::runtime_error(path + " is not a .npy file!");
+	if (version[0] < 1 || version[0] > 3)
+		throw std::runtime_error(path + " has an unknown .npy version!");
+
+	// Version 1 stores the length of the header on 2 bytes, versions 2 and 3 on 4 bytes.
+	unsigned char length[4]{};
+	const int lengthBytes{ version[0] == 1 ? 2 : 4 };
+	if (!file.read(reinterpret_cast<char*>(length), lengthBytes))
+		throw std::runtime_error(path + " is truncated!");
+	const std::size_t headerLength{ length[0] | static_cast<std::size_t>(length[1]) << 8
+		| static_cast<std::size_t>(length[2]) << 16 | static_cast<std::size_t>(length[3]) << 24 };
+	std::string header(headerLength, ' ');
+	if (!file.read(&header[0], static_cast<std::streamsize>(headerLength)))
+		throw std::runtime_error(path + " is truncated!");
+
+	const std::string descr{ internal::npyValue(header, "descr", path) };
+	if (descr != "'" + std::string{ internal::StoredScalar<scalarType>::npy } + "'")
+		throw std::runtime_error(path + " holds an array of type " + descr + ", not " + internal::StoredScalar<scalarType>::npy);
+	const bool fortranOrder{ internal::npyValue(header, "fortran_order", path) == "True" };
+
+	const std::string shape{ internal::npyValue(header, "shape", path) };
+	std::int64_t extents[2]{ 1, 1 };
+	int dimensions{};
+	for (std::size_t p{ shape.find_first_of("0123456789") }; p != std::string::npos; p = shape.find_first_of("0123456789", p))
+	{
+		if (dimensions == 2)
+			throw std::runtime_error(path + " holds an array of more than 2 dimensions!");
+		std::size_t digits{};
+		extents[dimensions++] = std::stoll(shape.substr(p), &digits);
+		p += digits;
+	}
+	if (dimensions == 0)
+		throw std::runtime_error(path + " holds a scalar, not a matrix!");
+	if (extents[0] > INT_MAX || extents[1] > INT_MAX || (extents[1] > 0 && extents[0] > INT_MAX / extents[1]))
+		throw std::runtime_error(path + " holds an array too large for a matrix!");
+
+	const int rows{ static_cast<int>(extents[0]) };
+	const int cols{ static_cast<int>(extents[1]) };
+	// A Fortran-ordered rows x cols array holds the coefficients of its cols x rows transpose in C order.
+	MatrixX<scalarType> m{ fortranOrder ? cols : rows, fortranOrder ? rows : cols };
+	if (!file.read(reinterpret_cast<char*>(m.data()), static_cast<std::streamsize>(static_cast<std::size_t>(m.size()) * sizeof(scalarType))))
+		throw std::runtime_error(path + " is truncated!");
+	if (fortranOrder && rows > 1 && cols > 1)
+		return MatrixX<scalarType>{ m.transpose() };
+	if (fortranOrder)
+		m.resize(rows, cols);
+	return m;
+}
+
+#endif // !MatrixIO_H
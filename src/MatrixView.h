@@ -0,0 +1,544 @@
+#pragma once
+#ifndef MatrixView_H
+#define MatrixView_H
+
+#include <algorithm>
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "slice.h"
+#include "Gemm.h"
+#include "ThreadPool.h"
+#include "MatrixExpression.h"
+#include <cassert>
+
+/// Zero-copy strided views of matrices.
+//
+/// A ``MatrixView`` refers to coefficients of a row-major matrix without owning or copying them. It is
+/// described by a pointer to the storage and two slices: the coefficient \f$(i, j)\f$ of the view is
+/// ``data[rowSlice(i) + colSlice(j)]``. This covers rows, columns, blocks, the diagonal and every k-th
+/// row or column of a matrix, and views of views:
+///
+/// ```
+/// MatrixXd m{ 6, 6 };
+/// m.row(1) = m.row(2);                          // copy a row
+/// m.col(0) += 2.0 * m.col(5);                   // AXPY on columns
+/// m.block(0, 0, 3, 3) = m.block(3, 3, 3, 3);    // copy a block
+/// m(slice{ 0, 3, 2 }, slice{ 0, 6 }) *= -1.0;   // negate rows 0, 2 and 4
+/// MatrixXd c{ m.block(0, 0, 3, 6) * m.block(0, 0, 6, 3) };
+/// ```
+///
+/// Views take part in expressions like matrices. Where the rows of a view are contiguous (a unit column
+/// stride, as for rows and blocks), expressions are evaluated row by row with the SIMD kernels, transposes
+/// with the blocked transpose, and products are computed by ``gemm`` in place through the leading
+/// dimension of the underlying matrix.
+///
+/// ``MatrixView<const T>`` is a read-only view, obtained from a const matrix. As with ``std::span``, the
+/// constness of a ``MatrixView<T>`` object does not propagate to the coefficients it refers to. A view
+/// must not outlive the matrix it was created from, and assigning to a view from an expression over an
+/// overlapping (but different) view of the same matrix is undefined.
+
+template<typename T>
+class MatrixView;
+
+namespace internal
+{
+	template<typename T>
+	struct IsStridedView<MatrixView<T>> : std::true_type {};
+
+	/// <summary>
+	/// Check a slice of the indices ``[0, extent)`` and fill in its defaults: ``slice{}`` selects all
+	/// indices and ``slice{ s }`` the indices from s to the end.
+	/// </summary>
+	inline slice resolveSlice(slice s, int extent)
+	{
+		if (s.getStart() == -1 && s.getLength() == -1)
+			return slice{ 0, extent, 1 };
+
+		const int stride{ s.getStride() };
+		const int length{ s.getLength() == -1 ? (extent - s.getStart() + stride - 1) / stride : s.getLength() };
+#ifndef MATHLIB_NO_BOUNDS_CHECK
+		if (stride <= 0 || length < 0 || s.getStart() < 0 || (length > 0 && s.getStart() + stride * (length - 1) >= extent))
+			throw std::out_of_range("\nError: slice extends beyond matrix bounds");
+#endif
+		return slice{ s.getStart(), length, stride };
+	}
+}
+
+/// <summary>
+/// A strided view of a matrix: the coefficient \f$(i, j)\f$ of the view is ``data[rows(i) + cols(j)]``,
+/// for the slices ``rows`` and ``cols`` of storage offsets.
+/// </summary>
+/// <typeparam name="T">The scalar type, const-qualified for a read-only view</typeparam>
+template<typename T>
+class MatrixView : public MatrixExpression<MatrixView<T>>
+{
+private:
+	T* _data;
+	slice _rowSlice;	// storage offsets of the rows
+	slice _colSlice;	// storage offsets of the columns within a row
+public:
+	using value_type = std::remove_const_t<T>;
+	static constexpr bool isLinear = false;
+
+	MatrixView(T* data, slice rows, slice cols) : _data{ data }, _rowSlice{ rows }, _colSlice{ cols } {}
+
+	/// <summary>
+	/// View of a whole ``rows x cols`` row-major matrix.
+	/// </summary>
+	MatrixView(T* data, int rows, int cols) : MatrixView{ data, slice{ 0, rows, cols }, slice{ 0, cols, 1 } } {}
+
+	/// <summary>
+	/// A writable view converts to a read-only one.
+	/// </summary>
+	template<typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+	MatrixView(const MatrixView<U>& view) : MatrixView{ view.data(), slice{ 0, view.rows(), view.rowStride() }, slice{ 0, view.cols(), view.colStride() } } {}
+
+	MatrixView(const MatrixView&) = default;
+
+	int rows() const { return _rowSlice.getLength(); }
+	int cols() const { return _colSlice.getLength(); }
+	int size() const { return rows() * cols(); }
+
+	/// <summary>
+	/// Distance in storage between consecutive rows of the view; the leading dimension for ``gemm``.
+	/// </summary>
+	int rowStride() const { return _rowSlice.getStride(); }
+
+	/// <summary>
+	/// Distance in storage between consecutive columns of the view; 1 when the rows are contiguous.
+	/// </summary>
+	int colStride() const { return _colSlice.getStride(); }
+
+	/// <summary>
+	/// Address of the coefficient \f$(0, 0)\f$ of the view.
+	/// </summary>
+	T* data() const { return _data + _rowSlice.getStart() + _colSlice.getStart(); }
+
+	/// <summary>
+	/// Address of the first coefficient of row i of the view.
+	/// </summary>
+	T* rowData(int i) const { return _data + _rowSlice(i) + _colSlice.getStart(); }
+
+	value_type coeff(int i, int j) const
+	{
+		assert(i >= 0 && i < rows() && j >= 0 && j < cols());
+		return _data[_rowSlice(i) + _colSlice(j)];
+	}
+
+	T& coeffRef(int i, int j) const
+	{
+		assert(i >= 0 && i < rows() && j >= 0 && j < cols());
+		return _data[_rowSlice(i) + _colSlice(j)];
+	}
+
+	/// <summary>
+	/// Coefficient accessor, bounds-checked like ``MatrixX::operator()``. For vectors, that is views with a
+	/// single row or column, ``v(k)`` is the k-th coefficient.
+	/// </summary>
+	T& operator()(int i, int j) const
+	{
+#ifndef MATHLIB_NO_BOUNDS_CHECK
+		if (i < 0 || i >= rows() || j < 0 || j >= cols())
+			throw std::out_of_range("\nError accessing an element beyond matrix bounds");
+#endif
+		return _data[_rowSlice(i) + _colSlice(j)];
+	}
+
+	T& operator()(int k) const
+	{
+		return rows() == 1 ? (*this)(0, k) : (*this)(k, 0);
+	}
+
+	//Sub-views
+	MatrixView row(int i) const;
+	MatrixView col(int j) const;
+	MatrixView block(int i, int j, int p, int q) const;
+	MatrixView diagonal() const;
+	MatrixView operator()(slice rows, slice cols) const;
+
+	//Assignment
+	MatrixView& operator=(const MatrixView& view);
+	template<typename Derived>
+	MatrixView& operator=(const MatrixExpression<Derived>& expr);
+	MatrixView& operator=(std::initializer_list<std::initializer_list<value_type>> list);
+	MatrixView& setConstant(const value_type x);
+	template<typename Derived>
+	MatrixView& operator+=(const MatrixExpression<Derived>& expr);
+	template<typename Derived>
+	MatrixView& operator-=(const MatrixExpression<Derived>& expr);
+	MatrixView& operator*=(const value_type k);
+};
+
+/// <summary>
+/// The rows and columns of a matrix were proxy classes of their own before ``MatrixView`` generalized them.
+/// </summary>
+template<typename scalarType>
+using MatrixRowSlice = MatrixView<scalarType>;
+
+template<typename scalarType>
+using MatrixColSlice = MatrixView<scalarType>;
+
+namespace internal
+{
+	/// <summary>
+	/// Evaluate an expression into a view, row by row. Rows of the destination and of the expression
+	/// that are contiguous are handled by ``assignRowVectorized``; large views are split into strips of
+	/// rows that are evaluated on the library thread pool.
+	/// </summary>
+	template<typename T, typename Derived>
+	void assignToView(const MatrixView<T>& destination, const Derived& e)
+	{
+		const nested_t<Derived> expr{ e };
+		const int cols{ destination.cols() };
+		const bool contiguous{ destination.colStride() == 1 };
+		parallelFor(0, destination.rows(), std::max(1, grainSize() / std::max(cols, 1)), [&](int first, int last) {
+			for (int i{ first }; i < last; ++i)
+			{
+				if (contiguous && assignRowVectorized(destination.rowData(i), expr, i))
+					continue;
+				for (int j{}; j < cols; ++j)
+					destination.coeffRef(i, j) = expr.coeff(i, j);
+			}
+		});
+	}
+
+	/// <summary>
+	/// ``destination += expr`` (or ``-=``) for a view, row by row, with ``accumulateRowVectorized`` where
+	/// the rows are contiguous.
+	/// </summary>
+	template<typename T, typename Derived>
+	void accumulateToView(const MatrixView<T>& destination, const Derived& e, const bool subtract)
+	{
+		const nested_t<Derived> expr{ e };
+		const int cols{ destination.cols() };
+		const bool contiguous{ destination.colStride() == 1 };
+		parallelFor(0, destination.rows(), std::max(1, grainSize() / std::max(cols, 1)), [&](int first, int last) {
+			for (int i{ first }; i < last; ++i)
+			{
+				if (contiguous && accumulateRowVectorized(destination.rowData(i), expr, subtract, i))
+					continue;
+				if (subtract)
+					for (int j{}; j < cols; ++j)
+						destination.coeffRef(i, j) -= expr.coeff(i, j);
+				else
+					for (int j{}; j < cols; ++j)
+						destination.coeffRef(i, j) += expr.coeff(i, j);
+			}
+		});
+	}
+
+	/// <summary>
+	/// True if no coefficient of an expression lives between the first and the last coefficient of a view,
+	/// so that the expression can be evaluated directly into the view (see ``disjointFrom``).
+	/// </summary>
+	template<typename T, typename Derived>
+	bool disjointFromView(const Derived& expr, const MatrixView<T>& view)
+	{
+		if (view.rows() == 0 || view.cols() == 0)
+			return true;
+		const T* first{ view.data() };
+		const T* last{ first + (view.rows() - 1) * view.rowStride() + (view.cols() - 1) * view.colStride() };
+		return disjointFrom(expr, std::min(first, last), std::max(first, last) + 1);
+	}
+
+	/// <summary>
+	/// The coefficients of an expression in row-major storage, for an expression that reads the view it is
+	/// assigned to: evaluated directly, the rows written first would be read again by the later ones.
+	/// </summary>
+	template<typename T, typename Derived>
+	std::vector<T> evaluateToStorage(const Derived& expr)
+	{
+		std::vector<T> storage(static_cast<std::size_t>(expr.rows()) * expr.cols());
+		assignToView(MatrixView<T>{ storage.data(), expr.rows(), expr.cols() }, expr);
+		return storage;
+	}
+
+	/// <summary>
+	/// A ``gemm`` operand: the view itself when its rows are contiguous, otherwise a packed copy.
+	/// </summary>
+	template<typename scalarType>
+	struct GemmOperand
+	{
+		std::vector<scalarType> packed;
+		const scalarType* data;
+		int ld;
+
+		template<typename T>
+		GemmOperand(const MatrixView<T>& view)
+		{
+			if (view.colStride() == 1)
+			{
+				data = view.data();
+				ld = view.rowStride();
+				return;
+			}
+			packed.resize(static_cast<std::size_t>(view.rows()) * view.cols());
+			assignToView(MatrixView<scalarType>{ packed.data(), view.rows(), view.cols() }, view);
+			data = packed.data();
+			ld = view.cols();
+		}
+	};
+}
+
+/// <summary>
+/// View of row i.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+/// <param name="i"></param>
+/// <returns></returns>
+template<typename T>
+MatrixView<T> MatrixView<T>::row(int i) const
+{
+	return (*this)(slice{ i, 1, 1 }, slice{});
+}
+
+/// <summary>
+/// View of column j.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename T>
+MatrixView<T> MatrixView<T>::col(int j) const
+{
+	return (*this)(slice{}, slice{ j, 1, 1 });
+}
+
+/// <summary>
+/// View of the ``p x q`` block whose top left coefficient is \f$(i, j)\f$.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+/// <returns></returns>
+template<typename T>
+MatrixView<T> MatrixView<T>::block(int i, int j, int p, int q) const
+{
+	return (*this)(slice{ i, p, 1 }, slice{ j, q, 1 });
+}
+
+/// <summary>
+/// View of the main diagonal, as a column vector.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+/// <returns></returns>
+template<typename T>
+MatrixView<T> MatrixView<T>::diagonal() const
+{
+	const int n{ std::min(rows(), cols()) };
+	return MatrixView{ _data, slice{ _rowSlice.getStart() + _colSlice.getStart(), n, rowStride() + colStride() }, slice{ 0, 1, 1 } };
+}
+
+/// <summary>
+/// View of the rows and columns selected by two slices of indices, as in ``m(slice{ 0, n / 2, 2 }, slice{})``
+/// for the even rows. Throws ``std::out_of_range`` if a slice extends beyond the view.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+/// <returns></returns>
+template<typename T>
+MatrixView<T> MatrixView<T>::operator()(slice rows, slice cols) const
+{
+	const slice r{ internal::resolveSlice(rows, this->rows()) };
+	const slice c{ internal::resolveSlice(cols, this->cols()) };
+	return MatrixView{ _data,
+		slice{ _rowSlice(r.getStart()), r.getLength(), rowStride() * r.getStride() },
+		slice{ _colSlice(c.getStart()), c.getLength(), colStride() * c.getStride() } };
+}
+
+/// <summary>
+/// Copy the coefficients of another view into the coefficients of this view, as in ``m.row(1) = m.row(2);``.
+/// Both views must have the same dimensions.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+/// <param name="view"></param>
+/// <returns></returns>
+template<typename T>
+MatrixView<T>& MatrixView<T>::operator=(const MatrixView& view)
+{
+	return (*this) = static_cast<const MatrixExpression<MatrixView>&>(view);
+}
+
+/// <summary>
+/// Evaluate an expression into the coefficients of this view, which must have the dimensions of the expression.
+/// An expression that reads the storage of the view, as in ``a.block(1, 1, 3, 3) = a.block(0, 0, 3, 3)``, is
+/// evaluated into a temporary first.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+/// <param name="expr"></param>
+/// <returns></returns>
+template<typename T>
+template<typename Derived>
+MatrixView<T>& MatrixView<T>::operator=(const MatrixExpression<Derived>& expr)
+{
+	static_assert(!std::is_const<T>::value, "cannot assign to a read-only view");
+	if (rows() != expr.rows() || cols() != expr.cols())
+		throw std::logic_error("Assignment failed, matrices have different dimensions");
+
+	if (internal::disjointFromView(expr.derived(), *this))
+		internal::assignToView(*this, expr.derived());
+	else
+	{
+		std::vector<T> copy(internal::evaluateToStorage<T>(expr.derived()));
+		internal::assignToView(*this, MatrixView<T>{ copy.data(), rows(), cols() });
+	}
+	return *this;
+}
+
+/// <summary>
+/// Assign a list of rows, as in ``m.row(1) = { {1, 2, 3} };``.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+/// <param name="list"></param>
+/// <returns></returns>
+template<typename T>
+MatrixView<T>& MatrixView<T>::operator=(std::initializer_list<std::initializer_list<value_type>> list)
+{
+	static_assert(!std::is_const<T>::value, "cannot assign to a read-only view");
+	if (static_cast<int>(list.size()) != rows())
+		throw std::logic_error("Assignment failed, matrices have different dimensions");
+
+	int i{};
+	for (const std::initializer_list<value_type>& r : list)
+	{
+		if (static_cast<int>(r.size()) != cols())
+			throw std::logic_error("Assignment failed, matrices have different dimensions");
+		int j{};
+		for (const value_type& x : r)
+			coeffRef(i, j++) = x;
+		++i;
+	}
+	return *this;
+}
+
+/// <summary>
+/// Set every coefficient of the view to x.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+/// <param name="x"></param>
+/// <returns></returns>
+template<typename T>
+MatrixView<T>& MatrixView<T>::setConstant(const value_type x)
+{
+	static_assert(!std::is_const<T>::value, "cannot assign to a read-only view");
+	for (int i{}; i < rows(); ++i)
+	{
+		if (colStride() == 1)
+			std::fill(rowData(i), rowData(i) + cols(), x);
+		else
+			for (int j{}; j < cols(); ++j)
+				coeffRef(i, j) = x;
+	}
+	return *this;
+}
+
+/// <summary>
+/// Addition assignment operator. ``v += A`` and ``v += k * A`` use the SIMD kernels row by row when the
+/// rows of both operands are contiguous. As for assignment, an expression that reads the storage of the view is
+/// evaluated into a temporary first.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+/// <param name="expr"></param>
+/// <returns></returns>
+template<typename T>
+template<typename Derived>
+MatrixView<T>& MatrixView<T>::operator+=(const MatrixExpression<Derived>& expr)
+{
+	static_assert(!std::is_const<T>::value, "cannot assign to a read-only view");
+	if (rows() != expr.rows() || cols() != expr.cols())
+		throw std::logic_error("Matrices have different dimensions; therefore cannot be added!");
+
+	if (internal::disjointFromView(expr.derived(), *this))
+		internal::accumulateToView(*this, expr.derived(), false);
+	else
+	{
+		std::vector<T> copy(internal::evaluateToStorage<T>(expr.derived()));
+		internal::accumulateToView(*this, MatrixView<T>{ copy.data(), rows(), cols() }, false);
+	}
+	return *this;
+}
+
+/// <summary>
+/// Subtraction assignment operator, the counterpart of ``+=``.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+/// <param name="expr"></param>
+/// <returns></returns>
+template<typename T>
+template<typename Derived>
+MatrixView<T>& MatrixView<T>::operator-=(const MatrixExpression<Derived>& expr)
+{
+	static_assert(!std::is_const<T>::value, "cannot assign to a read-only view");
+	if (rows() != expr.rows() || cols() != expr.cols())
+		throw std::logic_error("Matrices have different dimensions; therefore cannot be added!");
+
+	if (internal::disjointFromView(expr.derived(), *this))
+		internal::accumulateToView(*this, expr.derived(), true);
+	else
+	{
+		std::vector<T> copy(internal::evaluateToStorage<T>(expr.derived()));
+		internal::accumulateToView(*this, MatrixView<T>{ copy.data(), rows(), cols() }, true);
+	}
+	return *this;
+}
+
+/// <summary>
+/// Scale the coefficients of the view in place.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+/// <param name="k"></param>
+/// <returns></returns>
+template<typename T>
+MatrixView<T>& MatrixView<T>::operator*=(const value_type k)
+{
+	static_assert(!std::is_const<T>::value, "cannot assign to a read-only view");
+	for (int i{}; i < rows(); ++i)
+	{
+		if constexpr (hasSimdKernels<value_type>)
+		{
+			if (colStride() == 1)
+			{
+				simdKernels<value_type>().scale(rowData(i), k, rowData(i), cols());
+				continue;
+			}
+		}
+		for (int j{}; j < cols(); ++j)
+			coeffRef(i, j) *= k;
+	}
+	return *this;
+}
+
+/// <summary>
+/// \f$C := \alpha A B + \beta C\f$ on views, for instance on sub-blocks of larger matrices:
+/// ``gemm(-1.0, a.block(k, 0, m, k), a.block(0, k, k, n), 1.0, a.block(k, k, m, n))``. Views with
+/// contiguous rows are multiplied in place through their leading dimension; other operands are
+/// packed first. C must not overlap A or B.
+/// </summary>
+template<typename TA, typename TB, typename TC>
+void gemm(typename MatrixView<TC>::value_type alpha, const MatrixView<TA>& A, const MatrixView<TB>& B,
+	typename MatrixView<TC>::value_type beta, const MatrixView<TC>& C)
+{
+	using scalarType = typename MatrixView<TC>::value_type;
+	static_assert(std::is_same<typename MatrixView<TA>::value_type, scalarType>::value
+		&& std::is_same<typename MatrixView<TB>::value_type, scalarType>::value, "gemm operands must have the same scalar type");
+	static_assert(!std::is_const<TC>::value, "cannot assign to a read-only view");
+
+	if (A.cols() != B.rows() || A.rows() != C.rows() || B.cols() != C.cols())
+		throw std::logic_error("Error multiplying the matrices; the number of cols(A) must equal the number of rows(B)!");
+
+	const internal::GemmOperand<scalarType> a{ A };
+	const internal::GemmOperand<scalarType> b{ B };
+	if (C.colStride() == 1)
+	{
+		gemm(C.rows(), C.cols(), A.cols(), alpha, a.data, a.ld, b.data, b.ld, beta, C.data(), C.rowStride());
+		return;
+	}
+
+	std::vector<scalarType> c(static_cast<std::size_t>(C.rows()) * C.cols());
+	const MatrixView<scalarType> packedC{ c.data(), C.rows(), C.cols() };
+	if (beta != scalarType{})
+		internal::assignToView(packedC, C);
+	gemm(C.rows(), C.cols(), A.cols(), alpha, a.data, a.ld, b.data, b.ld, beta, packedC.data(), C.cols());
+	internal::assignToView(C, packedC);
+}
+
+#endif // !MatrixView_H
@@ -7,10 +7,16 @@
 #include <iomanip>
 #include <initializer_list>
 #include <algorithm>
+#include <cmath>
 #include "slice.h"
+#include "Gemm.h"
+#include "ThreadPool.h"
+#include "MatrixExpression.h"
+#include "MatrixView.h"
+#include "Allocators.h"
 #include <cassert>
 
-template <typename T>
+template <typename T, typename Allocator = AlignedAllocator<T>>
 class MatrixX;
 
 using MatrixXi = MatrixX<int>;
@@ -21,275 +27,129 @@ using VectorXf = MatrixXf;
 using VectorXd = MatrixXd;
 using VectorXi = MatrixXi;
 
-/// <summary>
-/// MatrixRowSlice is a proxy object that represents a row of a matrix without being the row itself. 
-/// It holds a reference to a MatrixX object, a slice and a row/col index. We are then free to implement
-/// how this proxy behaves, by having its operations inspect and manipulate the matrix it was created from.
-/// </summary>
-/// <typeparam name="scalarType"></typeparam>
-template <class scalarType>
-class MatrixRowSlice 
-{
-private:
-	MatrixX<scalarType>& _matrix_ref;
-	slice _matrix_slice;
-	int _row;
-public:
-	MatrixRowSlice() = default;
-	MatrixRowSlice(MatrixX<scalarType>& m_ref, slice s, int r) : _matrix_ref{ m_ref }, _matrix_slice{ s }, _row{ r } {}
-	
-	//Overload operators
-	MatrixRowSlice operator=(const MatrixRowSlice matrixSlice) const;
-	MatrixRowSlice<scalarType> operator=(const MatrixX<scalarType>& rowVector);
-
-	slice getMatrixSlice() const;
-	int getRow() const;
-	MatrixX<scalarType>& getMatrixRef() const;
-};
-
-/// <summary>
-/// MatrixColSlice is a proxy object that represents a column of a matrix.
-/// </summary>
-/// <typeparam name="scalarType"></typeparam>
-template <class scalarType>
-class MatrixColSlice 
-{
-private:
-	MatrixX<scalarType>& _matrix_ref;
-	slice _matrix_slice;
-	int _col;
-public:
-	MatrixColSlice() = default;
-	MatrixColSlice(MatrixX<scalarType>& m_ref, slice s, int c) : _matrix_ref{ m_ref }, _matrix_slice{ s }, _col{ c } {}
-
-	//Overload operators
-	MatrixColSlice operator=(const MatrixColSlice matrixSlice) const;
-	MatrixColSlice<scalarType> operator=(const MatrixX<scalarType>& colVector);
-
-	slice getMatrixSlice() const;
-	int getCol() const;
-	MatrixX<scalarType>& getMatrixRef() const;
-};
-
-/// <summary>
-/// Return a ref to the matrix object from which this row vector was created.
-/// </summary>
-/// <typeparam name="scalarType"></typeparam>
-/// <returns></returns>
-template<class scalarType>
-MatrixX<scalarType>& MatrixRowSlice<scalarType>::getMatrixRef() const
-{
-	return _matrix_ref;
-}
-
-/// <summary>
-/// Return a ref to the matrix object from which this col vector was created.
-/// </summary>
-/// <typeparam name="scalarType"></typeparam>
-/// <returns></returns>
-template<class scalarType>
-MatrixX<scalarType>& MatrixColSlice<scalarType>::getMatrixRef() const
-{
-	return _matrix_ref;
-}
-
-
-template<class scalarType>
-slice MatrixRowSlice<scalarType>::getMatrixSlice() const
-{
-	return _matrix_slice;
-}
-
-template<class scalarType>
-slice MatrixColSlice<scalarType>::getMatrixSlice() const
-{
-	return _matrix_slice;
-}
-
-template<class scalarType>
-int MatrixRowSlice<scalarType>::getRow() const
-{
-	return _row;
-}
-
-template<class scalarType>
-int MatrixColSlice<scalarType>::getCol() const
-{
-	return _col;
-}
-
-/// <summary>
-/// Overloaded assignment operator. This allows you to do `m.row(1) = m.row(2);`
-/// </summary>
-/// <typeparam name="scalarType"></typeparam>
-/// <param name="s"></param>
-/// <returns></returns>
-template <class scalarType>
-MatrixRowSlice<scalarType> MatrixRowSlice<scalarType>::operator=(const MatrixRowSlice s) const
-{
-	assert(_matrix_slice.length == s.getMatrixSlice().getLength());
-	MatrixX<scalarType>& otherMatrix = s.getMatrixRef();
-	slice otherSlice{ s.getMatrixSlice() };
-
-	for (int j{}; i < _matrix_slice.length; ++j)
-		_matrix_ref(_row, _matrix_slice(j)) = otherMatrix(s.getRow(),s.getMatrixSlice(j));
-	return *this;
-}
-
-/// <summary>
-/// Overloaded assignment operator. This allows you to do `m.row(1) = VectorXd {{1,2,3}};`
-/// </summary>
-/// <typeparam name="scalarType"></typeparam>
-/// <param name="s"></param>
-/// <returns></returns>
-template<class scalarType>
-MatrixRowSlice<scalarType> MatrixRowSlice<scalarType>::operator=(const MatrixX<scalarType>& rowVector)
-{
-	assert(rowVector.rows() == 1);
-	assert(rowVector.cols() == _matrix_slice.getLength());
-	for (int j{}; j < rowVector.cols(); ++j)
-		_matrix_ref(_row, _matrix_slice(j)) = rowVector(0, j);
-	
-	return *this;
-}
-
-/// <summary>
-/// Overloaded assignment operator. This allows you to do `m.col(1) = m.col(2);`
-/// </summary>
-/// <typeparam name="scalarType"></typeparam>
-/// <param name="s"></param>
-/// <returns></returns>
-template <class scalarType>
-MatrixColSlice<scalarType> MatrixColSlice<scalarType>::operator=(const MatrixColSlice s) const
-{
-	assert(_matrix_slice.length == s.getMatrixSlice().getLength());
-	MatrixX<scalarType>& rhs = s.getMatrixRef();
-	slice rhsSlice{ s.getMatrixSlice() };
-
-	for (int i{}; i < _matrix_slice.length; ++i)
-		_matrix_ref(rhsSlice(i), _col) = rhs(s.getMatrixSlice(i),s.getCol() );
-	return *this;
-}
-
-/// <summary>
-/// Overloaded assignment operator. This allows you to assign a user-supplied column vector
-/// to a given column of the matrix m, something like `m.col(1) = VectorXd {{1},{2},{3}};`
-/// </summary>
-/// <typeparam name="scalarType"></typeparam>
-/// <param name="s"></param>
-/// <returns></returns>
-template<class scalarType>
-MatrixColSlice<scalarType> MatrixColSlice<scalarType>::operator=(const MatrixX<scalarType>& colVector)
-{
-	assert(colVector.cols() == 1);
-	assert(colVector.rows() == _matrix_slice.length);
-	for (int i{}; i < colVector.rows(); ++i)
-		_matrix_ref(_matrix_slice(i),_col ) = colVector(i, 0);
-
-	return *this;
-}
-
-/// <summary>
-/// Scalar multiplication of a constant with a row vector
-/// </summary>
-/// <typeparam name="scalarType"></typeparam>
-/// <param name="k"></param>
-/// <param name="colVector"></param>
-/// <returns></returns>
-template<class scalarType>
-MatrixX<scalarType> operator*(const scalarType k, const MatrixRowSlice<scalarType>& rowVec)
-{
-	slice s = rowVec.getMatrixSlice();
-	MatrixX<scalarType>& m = rowVec.getMatrixRef();
-	int row = rowVec.getRow();
-	MatrixX<scalarType> result{1, s.getLength()};
-
-	for (int j{}; j < s.getLength(); ++j)
-		result(0, j) = k * m(row, j);
-	return result;
-}
-
-/// <summary>
-/// Scalar multiplication of a constant with a column vector
-/// </summary>
-/// <typeparam name="scalarType"></typeparam>
-/// <param name="k"></param>
-/// <param name="colVector"></param>
-/// <returns></returns>
-template<class scalarType>
-MatrixX<scalarType> operator*(const scalarType k, const MatrixColSlice<scalarType>& colVec)
+namespace internal
 {
-	slice s = colVec.getMatrixSlice();
-	MatrixX<scalarType>& m = colVec.getMatrixRef();
-	int col = colVec.getCol();
-	MatrixX<scalarType> result{ s.getLength(),1 };
-
-	for (int i{}; i < s.getLength(); ++i)
-		result(i, 0) = k * m(i, col);
-	return result;
+	/// <summary>
+	/// Matrices take part in expressions through a non-owning leaf over their storage.
+	/// </summary>
+	template<typename scalarType, typename Allocator>
+	struct ExpressionNesting<MatrixX<scalarType, Allocator>>
+	{
+		using type = MatrixLeaf<scalarType>;
+	};
 }
 
-
 /// <summary>
 /// ``MatrixX`` is a templated class that implements dynamic matrices.
+/// A MatrixX is also the terminal of the expression templates in MatrixExpression.h: arithmetic
+/// on matrices builds an unevaluated expression, which is computed in one pass when it is used to
+/// construct or assigned to a MatrixX.
+/// Products, element-wise operations and reductions on large matrices run on the library thread
+/// pool; see ``setThreadCount()`` and ``setGrainSize()`` in ThreadPool.h.
+/// The coefficients are stored in a ``std::vector`` that obtains its memory from ``Allocator``: by
+/// default 64-byte aligned heap storage, or ``ArenaAllocator`` for scratch matrices (see Allocators.h).
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-template <typename scalarType>
-class MatrixX
+/// <typeparam name="Allocator"></typeparam>
+template <typename scalarType, typename Allocator>
+class MatrixX : public MatrixExpression<MatrixX<scalarType, Allocator>>
 {
 private:
-	std::vector<scalarType> A;
+	std::vector<scalarType, Allocator> A;
 	int _rows;
 	int _cols;
 	int _size;
-	typename std::vector<scalarType>::iterator currentPosition;
+	typename std::vector<scalarType, Allocator>::iterator currentPosition;
 public:
+	using value_type = scalarType;
+	using allocator_type = Allocator;
+	static constexpr bool isLinear = true;
+
 	MatrixX();
 	MatrixX(int n);
 	MatrixX(int m, int n);
 	MatrixX(const MatrixX& m);
+	MatrixX(MatrixX&& m) noexcept;
 	MatrixX(std::initializer_list<std::initializer_list<scalarType>>);
+	template<typename Derived>
+	MatrixX(const MatrixExpression<Derived>& expr);
 
 	std::vector<scalarType> getRawData() const;
+	scalarType* data();
+	const scalarType* data() const;
 	int rows() const;
 	int cols() const;
 	int size() const;
+	int capacity() const;
+
+	//Storage management
+	void resize(int m, int n);
+	void reserve(int n);
 
 	//Overloaded operators
 	scalarType operator()(const int i, const int j) const;
 	scalarType& operator()(const int i, const int j);
-	MatrixX operator+(const MatrixX& m) const;
-	MatrixX operator-(const MatrixX& m) const;
+	scalarType coeff(const int i, const int j) const;
+	scalarType coeff(const int index) const;
+	scalarType& coeffRef(const int i, const int j);
+	scalarType& coeffRef(const int index);
 	MatrixX& operator<<(const scalarType x);
 	MatrixX& operator,(const scalarType x);
 	MatrixX& operator=(const MatrixX& right_hand_side);
-	MatrixX& operator=(const MatrixRowSlice<scalarType>& rhs);
-	MatrixX& operator=(const MatrixColSlice<scalarType>& rhs);
-	bool operator==(const MatrixX& right_hand_side);
-	MatrixX& operator+=(const MatrixX& m);
-	MatrixX& operator-=(const MatrixX& m);
+	MatrixX& operator=(MatrixX&& right_hand_side) noexcept(false);
+	template<typename Derived>
+	MatrixX& operator=(const MatrixExpression<Derived>& expr);
+	bool operator==(const MatrixX& right_hand_side) const;
+	template<typename Derived>
+	MatrixX& operator+=(const MatrixExpression<Derived>& m);
+	template<typename Derived>
+	MatrixX& operator-=(const MatrixExpression<Derived>& m);
+	MatrixX& operator*=(const scalarType k);
+
+	//Reductions
+	scalarType sum() const;
+	scalarType dot(const MatrixX& m) const;
+	scalarType squaredNorm() const;
+	decltype(std::sqrt(scalarType{})) norm() const;
+	scalarType norm1() const;
+	scalarType normInf() const;
 
 	//Submatrices and sub-vectors
-	MatrixRowSlice<scalarType> MatrixX<scalarType>::row(int i);
-	MatrixColSlice<scalarType> MatrixX<scalarType>::col(int j);
-
-	MatrixX<scalarType> transpose() const;
+	MatrixView<scalarType> row(int i);
+	MatrixView<const scalarType> row(int i) const;
+	MatrixView<scalarType> col(int j);
+	MatrixView<const scalarType> col(int j) const;
+	MatrixView<scalarType> block(int i, int j, int p, int q);
+	MatrixView<const scalarType> block(int i, int j, int p, int q) const;
+	MatrixView<scalarType> diagonal();
+	MatrixView<const scalarType> diagonal() const;
+	MatrixView<scalarType> operator()(slice rows, slice cols);
+	MatrixView<const scalarType> operator()(slice rows, slice cols) const;
+
+	MatrixTranspose<MatrixX> transpose() const;
+	MatrixX& transposeInPlace();
 };
 
 // ===========================================================================================
 //                                   Global Operators
 // -------------------------------------------------------------------------------------------
-template<typename scalarType>
-MatrixX<scalarType> operator*(const MatrixX<scalarType>& A, const MatrixX<scalarType>& B);
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator> operator*(const MatrixX<scalarType, Allocator>& A, const MatrixX<scalarType, Allocator>& B);
+
+template<typename TA, typename AllocatorA, typename TB, typename AllocatorB>
+MatrixX<internal::promoted_t<TA, TB>> operator*(const MatrixX<TA, AllocatorA>& A, const MatrixX<TB, AllocatorB>& B);
 
-template<typename scalarType>
-MatrixX<scalarType> operator*(const scalarType k, MatrixX<scalarType>& m);
+template<typename Lhs, typename Rhs>
+MatrixX<internal::promoted_t<typename Lhs::value_type, typename Rhs::value_type>> operator*(const MatrixExpression<Lhs>& A, const MatrixExpression<Rhs>& B);
 
-template<typename scalarType>
-MatrixX<scalarType>& operator*=(MatrixX<scalarType>& A, const MatrixX<scalarType>& B);
+template<typename TA, typename TB>
+MatrixX<typename MatrixView<TA>::value_type> operator*(const MatrixView<TA>& A, const MatrixView<TB>& B);
 
-template<typename scalarType>
-MatrixX<scalarType>& operator*=(const scalarType k, MatrixX<scalarType>& m);
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>& operator*=(MatrixX<scalarType, Allocator>& A, const MatrixX<scalarType, Allocator>& B);
+
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>& operator*=(const scalarType k, MatrixX<scalarType, Allocator>& m);
 
 // ===========================================================================================
 
@@ -298,8 +158,8 @@ MatrixX<scalarType>& operator*=(const scalarType k, MatrixX<scalarType>& m);
 /// No memory allocations are performed here.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-template<typename scalarType>
-MatrixX<typename scalarType>::MatrixX() :_rows{ 0 }, _cols{ 0 }, _size{ 0 }
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>::MatrixX() :_rows{ 0 }, _cols{ 0 }, _size{ 0 }
 {
 	currentPosition = A.begin();
 }
@@ -309,9 +169,25 @@ MatrixX<typename scalarType>::MatrixX() :_rows{ 0 }, _cols{ 0 }, _size{ 0 }
 /// Creates a deep copy of the MatrixX object passed.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-template<typename scalarType>
-MatrixX<typename scalarType>::MatrixX<typename scalarType>(const MatrixX& m) : A{ m.A }, _rows{ m.rows() }, _cols{ m.cols() }, currentPosition{ m.currentPosition }, _size{ m.size() }
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>::MatrixX(const MatrixX& m) : A{ m.A }, _rows{ m.rows() }, _cols{ m.cols() }, _size{ m.size() }, currentPosition{ A.begin() + (m.currentPosition - m.A.begin()) }
+{
+}
+
+/// <summary>
+/// Move constructor.
+/// Takes over the storage of the MatrixX object passed, without copying any coefficients.
+/// The moved-from matrix is left empty (0-by-0).
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>::MatrixX(MatrixX&& m) noexcept : _rows{ m._rows }, _cols{ m._cols }, _size{ m._size }
 {
+	const auto offset{ m.currentPosition - m.A.begin() };
+	A.swap(m.A);
+	currentPosition = A.begin() + offset;
+	m._rows = m._cols = m._size = 0;
+	m.currentPosition = m.A.begin();
 }
 
 /// <summary>
@@ -320,8 +196,8 @@ MatrixX<typename scalarType>::MatrixX<typename scalarType>(const MatrixX& m) : A
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="m"></param>
 /// <param name="n"></param>
-template<typename scalarType>
-MatrixX<typename scalarType>::MatrixX(int m, int n) : _rows{ m }, _cols{ n }, _size{ m * n }, A(m * n)
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>::MatrixX(int m, int n) : _rows{ m }, _cols{ n }, _size{ m * n }, A(m * n)
 {
 	currentPosition = A.begin();
 }
@@ -332,8 +208,8 @@ MatrixX<typename scalarType>::MatrixX(int m, int n) : _rows{ m }, _cols{ n }, _s
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="m"></param>
 /// <param name="n"></param>
-template<typename scalarType>
-MatrixX<typename scalarType>::MatrixX(int n) : MatrixX(n, 1)
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>::MatrixX(int n) : MatrixX(n, 1)
 {
 	currentPosition = A.begin();
 }
@@ -344,8 +220,8 @@ MatrixX<typename scalarType>::MatrixX(int n) : MatrixX(n, 1)
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="list"></param>
-template<typename scalarType>
-MatrixX<typename scalarType>::MatrixX(std::initializer_list<std::initializer_list<scalarType>> list) :MatrixX<scalarType>{}	//Delegate to the default constructor to set up the initial array
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>::MatrixX(std::initializer_list<std::initializer_list<scalarType>> list) :MatrixX<scalarType, Allocator>{}	//Delegate to the default constructor to set up the initial array
 {
 	typename std::initializer_list<std::initializer_list<scalarType>>::iterator i{};
 	_rows = list.size();
@@ -363,13 +239,26 @@ MatrixX<typename scalarType>::MatrixX(std::initializer_list<std::initializer_lis
 	currentPosition = A.begin();
 }
 
+/// <summary>
+/// Construct a matrix by evaluating an expression such as ``m1 + m2 + m3``.
+/// The expression is computed in a single pass directly into the new matrix' storage.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="expr"></param>
+template<typename scalarType, typename Allocator>
+template<typename Derived>
+MatrixX<scalarType, Allocator>::MatrixX(const MatrixExpression<Derived>& expr) : MatrixX(expr.rows(), expr.cols())
+{
+	internal::assignExpression(A.data(), expr.derived());
+}
+
 /// <summary>
 /// Getter method for the number of rows of a matrix.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <returns></returns>
-template<typename scalarType>
-int MatrixX<scalarType>::rows() const
+template<typename scalarType, typename Allocator>
+int MatrixX<scalarType, Allocator>::rows() const
 {
 	return _rows;
 }
@@ -379,8 +268,8 @@ int MatrixX<scalarType>::rows() const
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <returns></returns>
-template<typename scalarType>
-int MatrixX<scalarType>::cols() const
+template<typename scalarType, typename Allocator>
+int MatrixX<scalarType, Allocator>::cols() const
 {
 	return _cols;
 }
@@ -390,16 +279,86 @@ int MatrixX<scalarType>::cols() const
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <returns></returns>
-template<typename scalarType>
-int MatrixX<scalarType>::size() const
+template<typename scalarType, typename Allocator>
+int MatrixX<scalarType, Allocator>::size() const
 {
 	return A.size();
 }
 
-template<typename scalarType>
-std::vector<scalarType> MatrixX<scalarType>::getRawData() const
+/// <summary>
+/// The number of coefficients the matrix can hold without reallocating its storage.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, typename Allocator>
+int MatrixX<scalarType, Allocator>::capacity() const
 {
-	return A;
+	return static_cast<int>(A.capacity());
+}
+
+/// <summary>
+/// Change the dimensions of the matrix to \f$m \times n\f$.
+/// The storage is only reallocated if \f$mn\f$ exceeds ``capacity()``, so a matrix can be
+/// resized back and forth without any heap traffic. Existing coefficients keep their position
+/// in storage order; coefficients added at the end are zero.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="m"></param>
+/// <param name="n"></param>
+template<typename scalarType, typename Allocator>
+void MatrixX<scalarType, Allocator>::resize(int m, int n)
+{
+	if (m < 0 || n < 0)
+		throw std::logic_error("Error: Matrix dimensions must be non-negative!");
+
+	A.resize(static_cast<std::size_t>(m) * n);
+	_rows = m;
+	_cols = n;
+	_size = m * n;
+	currentPosition = A.begin();
+}
+
+/// <summary>
+/// Make sure the matrix can hold at least n coefficients without reallocating.
+/// The dimensions and the coefficients are unchanged.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="n"></param>
+template<typename scalarType, typename Allocator>
+void MatrixX<scalarType, Allocator>::reserve(int n)
+{
+	const auto offset{ currentPosition - A.begin() };
+	A.reserve(n);
+	currentPosition = A.begin() + offset;
+}
+
+template<typename scalarType, typename Allocator>
+std::vector<scalarType> MatrixX<scalarType, Allocator>::getRawData() const
+{
+	return std::vector<scalarType>(A.begin(), A.end());
+}
+
+/// <summary>
+/// Pointer to the underlying row-major storage. The coefficient \f$a_{ij}\f$ lives at
+/// ``data()[i * cols() + j]``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, typename Allocator>
+scalarType* MatrixX<scalarType, Allocator>::data()
+{
+	return A.data();
+}
+
+/// <summary>
+/// Pointer to the underlying row-major storage of a const MatrixX object.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, typename Allocator>
+const scalarType* MatrixX<scalarType, Allocator>::data() const
+{
+	return A.data();
 }
 
 /// <summary>
@@ -407,82 +366,92 @@ std::vector<scalarType> MatrixX<scalarType>::getRawData() const
 /// This routine overloads the parentheses operator ``()``. ``A(i,j)`` is used the retrieve
 /// the element \f$a_{ij}\f$ belonging to the matrix \f$A\f$. This is const-version of the method,
 /// that works on const MatrixX objects.
+/// Throws ``std::out_of_range`` unless \f$0 \le i < rows\f$ and \f$0 \le j < cols\f$. Defining
+/// ``MATHLIB_NO_BOUNDS_CHECK`` removes the check, making ``A(i,j)`` the same as ``A.coeff(i,j)``.
 /// </summary>
-template<typename scalarType>
-scalarType MatrixX<typename scalarType>::operator()(const int i, const int j) const
+template<typename scalarType, typename Allocator>
+scalarType MatrixX<scalarType, Allocator>::operator()(const int i, const int j) const
 {
-	if (i * cols() + j < A.size())
-		return A[i * cols() + j];
-	else
+#ifndef MATHLIB_NO_BOUNDS_CHECK
+	if (i < 0 || i >= _rows || j < 0 || j >= _cols)
 		throw std::out_of_range("\nError accessing an element beyond matrix bounds");
+#endif
+	return A[i * _cols + j];
 }
 
 /// <summary>
 /// Coefficient accessor.
 /// This routine retrieves the element in the (i,j) place of the matrix. This works on non-const MatrixX
-/// objects.
+/// objects. Bounds are checked as in the const version.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="i"></param>
 /// <param name="j"></param>
 /// <returns></returns>
-template<typename scalarType>
-scalarType& MatrixX<typename scalarType>::operator()(const int i, const int j)
+template<typename scalarType, typename Allocator>
+scalarType& MatrixX<scalarType, Allocator>::operator()(const int i, const int j)
 {
-	if (i * cols() + j < A.size())
-		return A[i * cols() + j];
-	else
+#ifndef MATHLIB_NO_BOUNDS_CHECK
+	if (i < 0 || i >= _rows || j < 0 || j >= _cols)
 		throw std::out_of_range("\nError accessing an element beyond matrix bounds");
+#endif
+	return A[i * _cols + j];
 }
 
 /// <summary>
-/// Matrix addition.
-/// This routine overloads the binary addition operator ``+`` and is used to add two matrices.
+/// Coefficient accessor without bounds checking. This is the accessor used by expression evaluation
+/// and by the kernels of the library. Out-of-range indices are caught by an assertion in debug builds.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-/// <param name="m"></param>
+/// <param name="i"></param>
+/// <param name="j"></param>
 /// <returns></returns>
-template<typename scalarType>
-MatrixX<typename scalarType> MatrixX<typename scalarType>::operator+(const MatrixX& m) const
+template<typename scalarType, typename Allocator>
+scalarType MatrixX<scalarType, Allocator>::coeff(const int i, const int j) const
 {
-	if (this->rows() == m.rows() && this->cols() == m.cols())
-	{
-		MatrixX<scalarType> result{ m.rows(),m.cols() };
-		for (int i{}; i < A.size(); ++i)
-		{
-			result.A[i] = A[i] + m.A[i];
-		}
-		return result;
-	}
-	else
-	{
-		throw std::logic_error("Matrices have different dimensions; therefore cannot be added!");
-	}
+	assert(i >= 0 && i < _rows && j >= 0 && j < _cols);
+	return A[i * _cols + j];
 }
 
 /// <summary>
-/// Matrix subtraction.
-/// This routine overloads the binary subtraction operator ``-`` and is used to subtract two matrices.
+/// Linear coefficient accessor without bounds checking; ``index`` runs over the storage in row-major order.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-/// <param name="m"></param>
+/// <param name="index"></param>
 /// <returns></returns>
-template<typename scalarType>
-MatrixX<typename scalarType> MatrixX<typename scalarType>::operator-(const MatrixX& m) const
+template<typename scalarType, typename Allocator>
+scalarType MatrixX<scalarType, Allocator>::coeff(const int index) const
 {
-	if (this->rows() == m.rows() && this->cols() == m.cols())
-	{
-		MatrixX<scalarType> result{ m.rows(),m.cols() };
-		for (int i{}; i < A.size(); ++i)
-		{
-			result.A[i] = A[i] - m.A[i];
-		}
-		return result;
-	}
-	else
-	{
-		throw std::logic_error("Matrices have different dimensions; therefore cannot be added!");
-	}
+	assert(index >= 0 && index < _size);
+	return A[index];
+}
+
+/// <summary>
+/// Writable coefficient accessor without bounds checking, the counterpart of ``coeff(i,j)``.
+/// Out-of-range indices are caught by an assertion in debug builds.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType, typename Allocator>
+scalarType& MatrixX<scalarType, Allocator>::coeffRef(const int i, const int j)
+{
+	assert(i >= 0 && i < _rows && j >= 0 && j < _cols);
+	return A[i * _cols + j];
+}
+
+/// <summary>
+/// Writable linear coefficient accessor without bounds checking, the counterpart of ``coeff(index)``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="index"></param>
+/// <returns></returns>
+template<typename scalarType, typename Allocator>
+scalarType& MatrixX<scalarType, Allocator>::coeffRef(const int index)
+{
+	assert(index >= 0 && index < _size);
+	return A[index];
 }
 
 /// <summary>
@@ -491,8 +460,8 @@ MatrixX<typename scalarType> MatrixX<typename scalarType>::operator-(const Matri
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="x"></param>
 /// <returns></returns>
-template<typename scalarType>
-MatrixX<typename scalarType>& MatrixX<typename scalarType>::operator<<(const scalarType x)
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>& MatrixX<scalarType, Allocator>::operator<<(const scalarType x)
 {
 	if (currentPosition < A.end())
 	{
@@ -512,8 +481,8 @@ MatrixX<typename scalarType>& MatrixX<typename scalarType>::operator<<(const sca
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="x"></param>
 /// <returns></returns>
-template<typename scalarType>
-MatrixX<typename scalarType>& MatrixX<typename scalarType>::operator,(const scalarType x)
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>& MatrixX<scalarType, Allocator>::operator,(const scalarType x)
 {
 	if (currentPosition < A.end())
 	{
@@ -529,14 +498,16 @@ MatrixX<typename scalarType>& MatrixX<typename scalarType>::operator,(const scal
 
 /// <summary>
 /// Copy assignment operator.
+/// The matrices must have the same dimensions, unless this matrix is empty (default-constructed
+/// or moved-from), in which case it takes the dimensions of the right hand side.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="right_hand_side"></param>
 /// <returns></returns>
-template<typename scalarType>
-MatrixX<typename scalarType>& MatrixX<typename scalarType>::operator=(const MatrixX& rhs)
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>& MatrixX<scalarType, Allocator>::operator=(const MatrixX& rhs)
 {
-	if (this->rows() != rhs.rows() || this->cols() != rhs.cols())
+	if (this->size() != 0 && (this->rows() != rhs.rows() || this->cols() != rhs.cols()))
 		throw std::logic_error("Assignment failed, matrices have different dimensions");
 
 	if (this == &rhs)
@@ -545,75 +516,189 @@ MatrixX<typename scalarType>& MatrixX<typename scalarType>::operator=(const Matr
 	this->A = rhs.A;
 	this->_rows = rhs._rows;
 	this->_cols = rhs._cols;
-	this->currentPosition = rhs.currentPosition;
+	this->_size = rhs._size;
+	this->currentPosition = A.begin() + (rhs.currentPosition - rhs.A.begin());
 	return *this;
 }
 
-template<typename scalarType>
-MatrixX<scalarType>& MatrixX<scalarType>::operator=(const MatrixRowSlice<scalarType>& rhs)
+/// <summary>
+/// Move assignment operator.
+/// The storage of the two matrices is exchanged, so no coefficients are copied and no memory is
+/// allocated or released. The moved-from matrix is left empty (0-by-0), but keeps the capacity of
+/// this matrix' old storage for reuse. The dimension rules are those of copy assignment.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="right_hand_side"></param>
+/// <returns></returns>
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>& MatrixX<scalarType, Allocator>::operator=(MatrixX&& rhs) noexcept(false)
 {
-	slice s{ rhs.getMatrixSlice() };
-	MatrixX<scalarType>& mat = rhs.getMatrixRef();
-	this->_rows = 1;
-	this->_cols = s.getLength();
-	this->_size = this->_cols;
-	this->A = std::vector<scalarType>(_cols);
-	for (int j{}; j < s.getLength(); ++j)
-	{
-		A[j] = mat(rhs.getRow(), s(j));
-	}
-	this->currentPosition = mat.currentPosition;
+	if (this->size() != 0 && (this->rows() != rhs.rows() || this->cols() != rhs.cols()))
+		throw std::logic_error("Assignment failed, matrices have different dimensions");
+
+	if (this == &rhs)
+		return *this;
+
+	const auto offset{ rhs.currentPosition - rhs.A.begin() };
+	this->A.swap(rhs.A);
+	this->_rows = rhs._rows;
+	this->_cols = rhs._cols;
+	this->_size = rhs._size;
+	this->currentPosition = A.begin() + offset;
+
+	rhs.A.clear();
+	rhs._rows = rhs._cols = rhs._size = 0;
+	rhs.currentPosition = rhs.A.begin();
 	return *this;
 }
 
-template<typename scalarType>
-MatrixX<scalarType>& MatrixX<scalarType>::operator=(const MatrixColSlice<scalarType>& rhs)
+/// <summary>
+/// Expression assignment operator.
+/// Evaluates an expression such as ``m1 + m2 + m3`` into this matrix in a single pass, without
+/// allocating. Element-wise expressions may safely refer to the matrix being assigned. Expressions
+/// that reorder coefficients, such as transposes and views, are evaluated directly when they do not
+/// refer to this matrix and into a temporary otherwise; ``m = m.transpose()`` is done in place, and
+/// changes the dimensions of a matrix that is not square.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="expr"></param>
+/// <returns></returns>
+template<typename scalarType, typename Allocator>
+template<typename Derived>
+MatrixX<scalarType, Allocator>& MatrixX<scalarType, Allocator>::operator=(const MatrixExpression<Derived>& expr)
 {
-	slice s{ rhs.getMatrixSlice() };
-	MatrixX<scalarType>& mat = rhs.getMatrixRef();
-	this->_rows =  s.getLength();
-	this->_size = this->rows();
-	this->_cols = 1;
-	this->A = std::vector<scalarType>(_rows);
-	for (int i{}; i < s.getLength(); ++i)
+	// The transpose of this matrix takes its place whatever its shape.
+	if constexpr (std::is_same<Derived, MatrixTranspose<MatrixX>>::value)
 	{
-		A[i] = mat(s(i), rhs.getCol());
+		if (this->size() != 0 && expr.derived().transpose().data() == A.data())
+			return transposeInPlace();
 	}
-	this->currentPosition = mat.currentPosition;
+
+	if (this->size() != 0 && (this->rows() != expr.rows() || this->cols() != expr.cols()))
+		throw std::logic_error("Assignment failed, matrices have different dimensions");
+
+	if constexpr (Derived::isLinear)
+	{
+		if (this->size() == 0)
+			resize(expr.rows(), expr.cols());
+		internal::assignExpression(A.data(), expr.derived());
+	}
+	else
+	{
+		if (internal::disjointFrom(expr.derived(), A.data(), A.data() + A.size()))
+		{
+			if (this->size() == 0)
+				resize(expr.rows(), expr.cols());
+			internal::assignExpression(A.data(), expr.derived());
+			this->currentPosition = A.begin();
+			return *this;
+		}
+
+		MatrixX<scalarType, Allocator> result{ expr };
+		this->A.swap(result.A);
+		this->_rows = result._rows;
+		this->_cols = result._cols;
+		this->_size = result._size;
+	}
+	this->currentPosition = A.begin();
 	return *this;
 }
 
 /// <summary>
 /// Matrix multiplication.
+/// The product is computed by the cache-blocked ``gemm`` kernel (see Gemm.h).
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="A"></param>
 /// <param name="B"></param>
 /// <returns></returns>
-template<typename scalarType>
-MatrixX<scalarType> operator*(const MatrixX<scalarType>& A, const MatrixX<scalarType>& B)
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator> operator*(const MatrixX<scalarType, Allocator>& A, const MatrixX<scalarType, Allocator>& B)
+{
+	if (A.cols() != B.rows())
+		throw std::logic_error("Error multiplying the matrices; the number of cols(A) must equal the number of rows(B)!");
+
+	MatrixX<scalarType, Allocator> result{ A.rows(), B.cols() };
+	gemm(A.rows(), B.cols(), A.cols(), scalarType{ 1 }, A.data(), A.cols(), B.data(), B.cols(), scalarType{}, result.data(), result.cols());
+
+	return result;
+}
+
+/// <summary>
+/// Matrix multiplication of matrices with different scalar types, as in ``MatrixXf * MatrixXd`` or
+/// ``MatrixXi * MatrixXd``. The product has the promoted scalar type and is accumulated in it; ``gemm``
+/// converts the coefficients of the other operand as it packs them, without a converted copy.
+/// </summary>
+/// <typeparam name="TA"></typeparam>
+/// <typeparam name="TB"></typeparam>
+/// <param name="A"></param>
+/// <param name="B"></param>
+/// <returns></returns>
+template<typename TA, typename AllocatorA, typename TB, typename AllocatorB>
+MatrixX<internal::promoted_t<TA, TB>> operator*(const MatrixX<TA, AllocatorA>& A, const MatrixX<TB, AllocatorB>& B)
 {
+	using scalarType = internal::promoted_t<TA, TB>;
 	if (A.cols() != B.rows())
 		throw std::logic_error("Error multiplying the matrices; the number of cols(A) must equal the number of rows(B)!");
 
 	MatrixX<scalarType> result{ A.rows(), B.cols() };
+	gemm(A.rows(), B.cols(), A.cols(), scalarType{ 1 }, A.data(), A.cols(), B.data(), B.cols(), scalarType{}, result.data(), result.cols());
+	return result;
+}
 
-	for (int i{}; i < A.rows(); ++i)
-	{
-		for (int k{}; k < B.cols(); ++k)
-		{
-			scalarType sum{};
-			for (int j{}; j < A.cols(); ++j)
-			{
-				sum += A(i, j) * B(j, k);
-			}
-			result(i, k) = sum;
-		}
-	}
+/// <summary>
+/// Matrix multiplication of two views, as in ``A.block(0, 0, m, k) * B.block(0, 0, k, n)``. Views with
+/// contiguous rows (rows and blocks) are multiplied in place by ``gemm``, without being copied.
+/// </summary>
+/// <typeparam name="TA"></typeparam>
+/// <typeparam name="TB"></typeparam>
+/// <param name="A"></param>
+/// <param name="B"></param>
+/// <returns></returns>
+template<typename TA, typename TB>
+MatrixX<typename MatrixView<TA>::value_type> operator*(const MatrixView<TA>& A, const MatrixView<TB>& B)
+{
+	using scalarType = typename MatrixView<TA>::value_type;
+	if (A.cols() != B.rows())
+		throw std::logic_error("Error multiplying the matrices; the number of cols(A) must equal the number of rows(B)!");
+
+	MatrixX<scalarType> result{ A.rows(), B.cols() };
+	gemm(scalarType{ 1 }, A, B, scalarType{}, result.block(0, 0, result.rows(), result.cols()));
+	return result;
+}
+
+template<typename scalarType, typename Allocator, typename TB>
+MatrixX<scalarType, Allocator> operator*(const MatrixX<scalarType, Allocator>& A, const MatrixView<TB>& B)
+{
+	MatrixX<scalarType, Allocator> result{ A.rows(), B.cols() };
+	gemm(scalarType{ 1 }, A.block(0, 0, A.rows(), A.cols()), B, scalarType{}, result.block(0, 0, result.rows(), result.cols()));
+	return result;
+}
 
+template<typename TA, typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator> operator*(const MatrixView<TA>& A, const MatrixX<scalarType, Allocator>& B)
+{
+	MatrixX<scalarType, Allocator> result{ A.rows(), B.cols() };
+	gemm(scalarType{ 1 }, A, B.block(0, 0, B.rows(), B.cols()), scalarType{}, result.block(0, 0, result.rows(), result.cols()));
 	return result;
 }
 
+/// <summary>
+/// Matrix multiplication of two expressions, as in ``(A + B) * C.transpose()``.
+/// The operands are evaluated first, in their promoted scalar type, and then multiplied by the ``gemm`` kernel.
+/// </summary>
+/// <typeparam name="Lhs"></typeparam>
+/// <typeparam name="Rhs"></typeparam>
+/// <param name="A"></param>
+/// <param name="B"></param>
+/// <returns></returns>
+template<typename Lhs, typename Rhs>
+MatrixX<internal::promoted_t<typename Lhs::value_type, typename Rhs::value_type>> operator*(const MatrixExpression<Lhs>& A, const MatrixExpression<Rhs>& B)
+{
+	using scalarType = internal::promoted_t<typename Lhs::value_type, typename Rhs::value_type>;
+	return MatrixX<scalarType>{ A } * MatrixX<scalarType>{ B };
+}
+
 /// <summary>
 /// Pretty print a given matrix to the console.
 /// </summary>
@@ -621,8 +706,8 @@ MatrixX<scalarType> operator*(const MatrixX<scalarType>& A, const MatrixX<scalar
 /// <param name="os"></param>
 /// <param name="m"></param>
 /// <returns></returns>
-template<typename scalarType>
-std::ostream& operator<<(std::ostream& os, MatrixX<scalarType>& m)
+template<typename scalarType, typename Allocator>
+std::ostream& operator<<(std::ostream& os, MatrixX<scalarType, Allocator>& m)
 {
 	for (int i{}; i < m.rows(); ++i)
 	{
@@ -630,9 +715,9 @@ std::ostream& operator<<(std::ostream& os, MatrixX<scalarType>& m)
 		for (int j{}; j < m.cols(); ++j)
 		{
 			if (j != m.cols() - 1)
-				os << m(i, j) << std::setw(5);
+				os << m.coeff(i, j) << std::setw(5);
 			else
-				os << m(i, j);
+				os << m.coeff(i, j);
 			if (j % 10 == 0 && j > 0)
 				os << std::endl;
 		}
@@ -644,84 +729,165 @@ std::ostream& operator<<(std::ostream& os, MatrixX<scalarType>& m)
 }
 
 /// <summary>
-/// Scalar multiplication of a matrix with a constant.
+/// Boolean comparision operator.
+/// Compares if \f$A = B\f$.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="right_hand_side"></param>
+/// <returns></returns>
+template<typename scalarType, typename Allocator>
+bool MatrixX<scalarType, Allocator>::operator==(const MatrixX& right_hand_side) const
+{
+	return (this->A == right_hand_side.A);
+}
+
+/// <summary>
+/// Addition assignment operator. The right hand side may be any expression; it is fused with the
+/// addition and evaluated in place. ``C += A`` and ``C += k * A`` use the SIMD kernels.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-/// <param name="k"></param>
 /// <param name="m"></param>
 /// <returns></returns>
-template<typename scalarType>
-MatrixX<scalarType> operator*(const scalarType k, MatrixX<scalarType>& m)
+template<class scalarType, typename Allocator>
+template<typename Derived>
+MatrixX<scalarType, Allocator>& MatrixX<scalarType, Allocator>::operator+=(const MatrixExpression<Derived>& m)
 {
-	MatrixX<scalarType> result{ m };
-	for (int i{}; i < m.rows(); ++i)
-		for (int j{}; j < m.cols(); ++j)
-			result(i, j) *= k;
+	if (this->rows() != m.rows() || this->cols() != m.cols())
+		throw std::logic_error("Matrices have different dimensions; therefore cannot be added!");
 
-	return result;
+	if constexpr (Derived::isLinear)
+		internal::accumulateExpression(A.data(), m.derived(), false);
+	else if (internal::disjointFrom(m.derived(), A.data(), A.data() + A.size()))
+		internal::accumulateToView(MatrixView<scalarType>{ A.data(), _rows, _cols }, m.derived(), false);
+	else
+		(*this) += MatrixX<scalarType, Allocator>{ m };
+	return (*this);
 }
 
 /// <summary>
-/// Boolean comparision operator.
-/// Compares if \f$A = B\f$.
+/// Subtraction assignment operator. The right hand side may be any expression; it is fused with the
+/// subtraction and evaluated in place. ``C -= A`` and ``C -= k * A`` use the SIMD kernels.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-/// <param name="right_hand_side"></param>
+/// <param name="m"></param>
 /// <returns></returns>
-template<typename scalarType>
-bool MatrixX<scalarType>::operator==(const MatrixX& right_hand_side)
+template<class scalarType, typename Allocator>
+template<typename Derived>
+MatrixX<scalarType, Allocator>& MatrixX<scalarType, Allocator>::operator-=(const MatrixExpression<Derived>& m)
 {
-	return (this->A == right_hand_side.A);
+	if (this->rows() != m.rows() || this->cols() != m.cols())
+		throw std::logic_error("Matrices have different dimensions; therefore cannot be added!");
+
+	if constexpr (Derived::isLinear)
+		internal::accumulateExpression(A.data(), m.derived(), true);
+	else if (internal::disjointFrom(m.derived(), A.data(), A.data() + A.size()))
+		internal::accumulateToView(MatrixView<scalarType>{ A.data(), _rows, _cols }, m.derived(), true);
+	else
+		(*this) -= MatrixX<scalarType, Allocator>{ m };
+	return (*this);
 }
 
 /// <summary>
-/// Unary plus operator.
+/// Scalar multiplication assignment operator, as in ``A *= k``. Scales the matrix in place.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-/// <param name="right_hand_side"></param>
+/// <param name="k"></param>
 /// <returns></returns>
-template<typename scalarType>
-MatrixX<scalarType>& operator+(MatrixX<scalarType>& right_hand_side)
+template<class scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>& MatrixX<scalarType, Allocator>::operator*=(const scalarType k)
 {
-	return right_hand_side;
+	scalarType* a{ A.data() };
+	parallelFor(0, this->size(), grainSize(), [a, k](int first, int last) {
+		if constexpr (hasSimdKernels<scalarType>)
+			simdKernels<scalarType>().scale(a + first, k, a + first, last - first);
+		else
+			for (int index{ first }; index < last; ++index)
+				a[index] *= k;
+	});
+	return (*this);
 }
 
 /// <summary>
-/// Unary minus operator
+/// Sum of all coefficients, \f$\sum_{i,j} a_{ij}\f$.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-/// <param name="right_hand_side"></param>
 /// <returns></returns>
-template<typename scalarType>
-MatrixX<scalarType> operator-(MatrixX<scalarType>& right_hand_side)
+template<class scalarType, typename Allocator>
+scalarType MatrixX<scalarType, Allocator>::sum() const
 {
-	return operator*<scalarType>(-1, right_hand_side);
+	const scalarType* a{ A.data() };
+	return parallelReduce(0, size(), grainSize(), scalarType{},
+		[a](int first, int last) { return simdKernels<scalarType>().sum(a + first, last - first); },
+		[](scalarType x, scalarType y) { return x + y; });
 }
 
 /// <summary>
-/// Addition assignment operator
+/// Inner product \f$\sum_{i,j} a_{ij} b_{ij}\f$ of two matrices (or vectors) of the same dimensions.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="m"></param>
 /// <returns></returns>
-template<class scalarType>
-MatrixX<scalarType>& MatrixX<scalarType>::operator+=(const MatrixX<scalarType>& m)
+template<class scalarType, typename Allocator>
+scalarType MatrixX<scalarType, Allocator>::dot(const MatrixX& m) const
 {
-	(*this) = (*this) + m;
-	return (*this);
+	if (this->rows() != m.rows() || this->cols() != m.cols())
+		throw std::logic_error("Matrices have different dimensions; therefore the dot product is undefined!");
+
+	const scalarType* a{ A.data() };
+	const scalarType* b{ m.A.data() };
+	return parallelReduce(0, size(), grainSize(), scalarType{},
+		[a, b](int first, int last) { return simdKernels<scalarType>().dot(a + first, b + first, last - first); },
+		[](scalarType x, scalarType y) { return x + y; });
 }
 
 /// <summary>
-/// Subtraction assignment operator
+/// Squared Frobenius norm \f$\sum_{i,j} a_{ij}^2\f$.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
-/// <param name="m"></param>
 /// <returns></returns>
-template<class scalarType>
-MatrixX<scalarType>& MatrixX<scalarType>::operator-=(const MatrixX<scalarType>& m)
+template<class scalarType, typename Allocator>
+scalarType MatrixX<scalarType, Allocator>::squaredNorm() const
 {
-	(*this) = (*this) - m;
-	return (*this);
+	return dot(*this);
+}
+
+/// <summary>
+/// Frobenius norm \f$\sqrt{\sum_{i,j} a_{ij}^2}\f$; the Euclidean norm for vectors.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<class scalarType, typename Allocator>
+decltype(std::sqrt(scalarType{})) MatrixX<scalarType, Allocator>::norm() const
+{
+	return std::sqrt(squaredNorm());
+}
+
+/// <summary>
+/// Entry-wise 1-norm \f$\sum_{i,j} |a_{ij}|\f$.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<class scalarType, typename Allocator>
+scalarType MatrixX<scalarType, Allocator>::norm1() const
+{
+	const scalarType* a{ A.data() };
+	return parallelReduce(0, size(), grainSize(), scalarType{},
+		[a](int first, int last) { return simdKernels<scalarType>().norm1(a + first, last - first); },
+		[](scalarType x, scalarType y) { return x + y; });
+}
+
+/// <summary>
+/// Entry-wise infinity norm \f$\max_{i,j} |a_{ij}|\f$, zero for an empty matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<class scalarType, typename Allocator>
+scalarType MatrixX<scalarType, Allocator>::normInf() const
+{
+	const scalarType* a{ A.data() };
+	return parallelReduce(0, size(), grainSize(), scalarType{},
+		[a](int first, int last) { return simdKernels<scalarType>().normInf(a + first, last - first); },
+		[](scalarType x, scalarType y) { return x > y ? x : y; });
 }
 
 /// <summary>
@@ -731,8 +897,8 @@ MatrixX<scalarType>& MatrixX<scalarType>::operator-=(const MatrixX<scalarType>&
 /// <param name="A"></param>
 /// <param name="B"></param>
 /// <returns></returns>
-template<typename scalarType>
-MatrixX<scalarType>& operator*=(MatrixX<scalarType>& A, const MatrixX<scalarType>& B)
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>& operator*=(MatrixX<scalarType, Allocator>& A, const MatrixX<scalarType, Allocator>& B)
 {
 	A = A * B;
 	return A;
@@ -745,53 +911,141 @@ MatrixX<scalarType>& operator*=(MatrixX<scalarType>& A, const MatrixX<scalarType
 /// <param name="k"></param>
 /// <param name="A"></param>
 /// <returns></returns>
-template<typename scalarType>
-MatrixX<scalarType>& operator*=(const scalarType k, MatrixX<scalarType>& A)
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>& operator*=(const scalarType k, MatrixX<scalarType, Allocator>& A)
 {
-	A = k * A;
-	return A;
+	return A *= k;
 }
 
 /// <summary>
-/// Get the ith row vector.
+/// View of the ith row. Assigning to the view writes to the matrix, as in ``m.row(1) = m.row(2);``.
+/// Throws ``std::out_of_range`` unless \f$0 \le i < rows\f$.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="i"></param>
 /// <returns></returns>
-template<class scalarType>
-MatrixRowSlice<scalarType> MatrixX<scalarType>::row(int i)
+template<class scalarType, typename Allocator>
+MatrixView<scalarType> MatrixX<scalarType, Allocator>::row(int i)
 {
-	slice s{ 0,cols(),1 };
-	return MatrixRowSlice<scalarType>{*this,s,i};
+	return MatrixView<scalarType>{ A.data(), _rows, _cols }.row(i);
+}
+
+template<class scalarType, typename Allocator>
+MatrixView<const scalarType> MatrixX<scalarType, Allocator>::row(int i) const
+{
+	return MatrixView<const scalarType>{ A.data(), _rows, _cols }.row(i);
 }
 
 /// <summary>
-/// Get the jth column vector.
+/// View of the jth column.
+/// Throws ``std::out_of_range`` unless \f$0 \le j < cols\f$.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <param name="j"></param>
 /// <returns></returns>
-template<class scalarType>
-MatrixColSlice<scalarType> MatrixX<scalarType>::col(int j)
+template<class scalarType, typename Allocator>
+MatrixView<scalarType> MatrixX<scalarType, Allocator>::col(int j)
+{
+	return MatrixView<scalarType>{ A.data(), _rows, _cols }.col(j);
+}
+
+template<class scalarType, typename Allocator>
+MatrixView<const scalarType> MatrixX<scalarType, Allocator>::col(int j) const
 {
-	slice s{ 0,rows(),1 };
-	return MatrixRowSlice<scalarType>{*this, s, j};
+	return MatrixView<const scalarType>{ A.data(), _rows, _cols }.col(j);
+}
+
+/// <summary>
+/// View of the \f$p \times q\f$ sub-matrix whose top left coefficient is \f$a_{ij}\f$.
+/// Throws ``std::out_of_range`` if the block extends beyond the matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <param name="p"></param>
+/// <param name="q"></param>
+/// <returns></returns>
+template<class scalarType, typename Allocator>
+MatrixView<scalarType> MatrixX<scalarType, Allocator>::block(int i, int j, int p, int q)
+{
+	return MatrixView<scalarType>{ A.data(), _rows, _cols }.block(i, j, p, q);
+}
+
+template<class scalarType, typename Allocator>
+MatrixView<const scalarType> MatrixX<scalarType, Allocator>::block(int i, int j, int p, int q) const
+{
+	return MatrixView<const scalarType>{ A.data(), _rows, _cols }.block(i, j, p, q);
+}
+
+/// <summary>
+/// View of the main diagonal \f$(a_{00}, a_{11}, \ldots)\f$, as a column vector.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<class scalarType, typename Allocator>
+MatrixView<scalarType> MatrixX<scalarType, Allocator>::diagonal()
+{
+	return MatrixView<scalarType>{ A.data(), _rows, _cols }.diagonal();
+}
+
+template<class scalarType, typename Allocator>
+MatrixView<const scalarType> MatrixX<scalarType, Allocator>::diagonal() const
+{
+	return MatrixView<const scalarType>{ A.data(), _rows, _cols }.diagonal();
+}
+
+/// <summary>
+/// View of the rows and columns selected by two slices, for instance every other row with
+/// ``m(slice{ 0, m.rows() / 2, 2 }, slice{})``. ``slice{}`` selects all rows (or columns), and
+/// ``slice{ s }`` those from s to the end.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="rows"></param>
+/// <param name="cols"></param>
+/// <returns></returns>
+template<class scalarType, typename Allocator>
+MatrixView<scalarType> MatrixX<scalarType, Allocator>::operator()(slice rows, slice cols)
+{
+	return MatrixView<scalarType>{ A.data(), _rows, _cols }(rows, cols);
+}
+
+template<class scalarType, typename Allocator>
+MatrixView<const scalarType> MatrixX<scalarType, Allocator>::operator()(slice rows, slice cols) const
+{
+	return MatrixView<const scalarType>{ A.data(), _rows, _cols }(rows, cols);
 }
 
 /// <summary>
 /// Transpose the matrix.
+/// Returns a view of the transpose; the coefficients are only moved when the view is assigned to a matrix.
 /// </summary>
 /// <typeparam name="scalarType"></typeparam>
 /// <returns></returns>
-template<class scalarType>
-MatrixX<scalarType> MatrixX<scalarType>::transpose() const
+template<class scalarType, typename Allocator>
+MatrixTranspose<MatrixX<scalarType, Allocator>> MatrixX<scalarType, Allocator>::transpose() const
 {
-	MatrixX<scalarType> result{ cols(),rows() };
-	for (int i{}; i < rows(); ++i)
-		for (int j{}; j < cols(); ++j)
-			result(j, i) = (*this) (i, j);
-	
-	result._rows = cols();
-	result._cols = rows();
-	return result;
+	return MatrixTranspose<MatrixX<scalarType, Allocator>>{ *this };
+}
+
+/// <summary>
+/// Transpose the matrix in place. Square matrices are transposed without allocating, by the blocked
+/// kernel of Transpose.h; other matrices are transposed into new storage.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<class scalarType, typename Allocator>
+MatrixX<scalarType, Allocator>& MatrixX<scalarType, Allocator>::transposeInPlace()
+{
+	if (_rows == _cols)
+	{
+		transposeSquareInPlace(_rows, A.data(), _cols);
+	}
+	else
+	{
+		MatrixX<scalarType, Allocator> result{ transpose() };
+		this->A.swap(result.A);
+		std::swap(_rows, _cols);
+	}
+	this->currentPosition = A.begin();
+	return *this;
 }
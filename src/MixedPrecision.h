@@ -0,0 +1,336 @@
+#pragma once
+#ifndef MixedPrecision_H
+#define MixedPrecision_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "Float16.h"
+#include "Gemm.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "MatrixX.h"
+
+/// Products accumulated in a wider type than their operands are stored in.
+//
+/// Products of large matrices stream their operands from memory, so storing them in a narrower type, ``float``
+/// instead of ``double`` or ``half`` and ``bfloat16`` (see Float16.h) instead of ``float``, makes them faster.
+/// The rounding errors of a long sum, however, grow with its length: a dot product of n ``float`` terms
+/// accumulated in ``float`` is only accurate to about \f$n \cdot 6 \cdot 10^{-8}\f$, and one accumulated in
+/// ``half`` is useless beyond a few hundred terms. The functions here keep the storage and change the
+/// accumulation: the coefficients are converted to ``Accumulator`` on the fly, as ``gemm`` packs them or
+/// in chunks that stay in the L1 cache, and the arithmetic runs on the SIMD kernels of ``Accumulator``.
+/// The chunks are widened with SIMD conversions, ``float`` to ``double``, ``half`` to ``float`` (F16C, which
+/// every AVX2 processor has) and ``bfloat16`` to ``float``, selected at runtime like those of Simd.h.
+///
+/// - ``multiply<Accumulator>(A, B)`` is the product \f$AB\f$ as a ``MatrixX<Accumulator>``; a product with a
+///   vector (one column) is computed as dot products of the rows of A.
+/// - ``dot<Accumulator>(a, b)`` is the inner product \f$\sum_{i,j} a_{ij} b_{ij}\f$.
+///
+/// ```
+/// MatrixXf a{ n, n }, b{ n, n };
+/// MatrixXd c{ multiply<double>(a, b) };		// float storage, double accumulation
+/// ```
+///
+/// Products of matrices with different scalar types, ``MatrixXf * MatrixXd``, are accumulated in the promoted
+/// type, like element-wise expressions (see MatrixExpression.h).
+
+namespace internal
+{
+	/// <summary>
+	/// Number of coefficients converted at a time by ``mixedDot``: two such chunks fit in the L1 cache.
+	/// </summary>
+	constexpr int mixedChunk{ 512 };
+
+	/// <summary>
+	/// Portable conversion of n coefficients to a wider type.
+	/// </summary>
+	namespace scalar
+	{
+		template<typename Accumulator, typename T>
+		void widen(const T* source, int n, Accumulator* destination)
+		{
+			for (int i{}; i < n; ++i)
+				destination[i] = static_cast<Accumulator>(source[i]);
+		}
+	}
+
+#ifdef MATHLIB_X86
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+	namespace sse2
+	{
+		template<typename Accumulator, typename T>
+		void widen(const T* source, int n, Accumulator* destination)
+		{
+			scalar::widen(source, n, destination);
+		}
+
+		template<>
+		inline void widen<double, float>(const float* source, int n, double* destination)
+		{
+			int i{};
+			for (; i + 4 <= n; i += 4)
+			{
+				const __m128 x{ _mm_loadu_ps(source + i) };
+				_mm_storeu_pd(destination + i, _mm_cvtps_pd(x));
+				_mm_storeu_pd(destination + i + 2, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+			}
+			scalar::widen(source + i, n - i, destination + i);
+		}
+
+		template<>
+		inline void widen<float, bfloat16>(const bfloat16* source, int n, float* destination)
+		{
+			int i{};
+			for (; i + 8 <= n; i += 8)
+			{
+				const __m128i x{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)) };
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_unpacklo_epi16(_mm_setzero_si128(), x));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 4), _mm_unpackhi_epi16(_mm_setzero_si128(), x));
+			}
+			scalar::widen(source + i, n - i, destination + i);
+		}
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,f16c"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,f16c")
+#endif
+	namespace avx2
+	{
+		template<typename Accumulator, typename T>
+		void widen(const T* source, int n, Accumulator* destination)
+		{
+			scalar::widen(source, n, destination);
+		}
+
+		template<>
+		inline void widen<double, float>(const float* source, int n, double* destination)
+		{
+			int i{};
+			for (; i + 4 <= n; i += 4)
+				_mm256_storeu_pd(destination + i, _mm256_cvtps_pd(_mm_loadu_ps(source + i)));
+			scalar::widen(source + i, n - i, destination + i);
+		}
+
+		template<>
+		inline void widen<float, half>(const half* source, int n, float* destination)
+		{
+			int i{};
+			for (; i + 8 <= n; i += 8)
+				_mm256_storeu_ps(destination + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i))));
+			scalar::widen(source + i, n - i, destination + i);
+		}
+
+		template<>
+		inline void widen<float, bfloat16>(const bfloat16* source, int n, float* destination)
+		{
+			int i{};
+			for (; i + 8 <= n; i += 8)
+			{
+				const __m256i x{ _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i))) };
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_slli_epi32(x, 16));
+			}
+			scalar::widen(source + i, n - i, destination + i);
+		}
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+	namespace avx512
+	{
+		template<typename Accumulator, typename T>
+		void widen(const T* source, int n, Accumulator* destination)
+		{
+			avx2::widen(source, n, destination);
+		}
+
+		template<>
+		inline void widen<double, float>(const float* source, int n, double* destination)
+		{
+			int i{};
+			for (; i + 8 <= n; i += 8)
+				_mm512_storeu_pd(destination + i, _mm512_cvtps_pd(_mm256_loadu_ps(source + i)));
+			scalar::widen(source + i, n - i, destination + i);
+		}
+
+		template<>
+		inline void widen<float, half>(const half* source, int n, float* destination)
+		{
+			int i{};
+			for (; i + 16 <= n; i += 16)
+				_mm512_storeu_ps(destination + i, _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i))));
+			scalar::widen(source + i, n - i, destination + i);
+		}
+
+		template<>
+		inline void widen<float, bfloat16>(const bfloat16* source, int n, float* destination)
+		{
+			int i{};
+			for (; i + 16 <= n; i += 16)
+			{
+				const __m512i x{ _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i))) };
+				_mm512_storeu_si512(destination + i, _mm512_slli_epi32(x, 16));
+			}
+			scalar::widen(source + i, n - i, destination + i);
+		}
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif // MATHLIB_X86
+
+	template<typename Accumulator, typename T>
+	using WidenKernel = void (*)(const T* source, int n, Accumulator* destination);
+
+	/// <summary>
+	/// The conversion kernel from T to Accumulator at the current instruction set level.
+	/// </summary>
+	template<typename Accumulator, typename T>
+	WidenKernel<Accumulator, T> widenKernel()
+	{
+#ifdef MATHLIB_X86
+		switch (simdLevel())
+		{
+		case SimdLevel::AVX512:
+			return &avx512::widen<Accumulator, T>;
+		case SimdLevel::AVX2:
+			return &avx2::widen<Accumulator, T>;
+		case SimdLevel::SSE2:
+			return &sse2::widen<Accumulator, T>;
+		default:
+			break;
+		}
+#endif
+		return &scalar::widen<Accumulator, T>;
+	}
+
+	/// <summary>
+	/// The coefficients ``[0, n)`` of ``source`` as an array of ``Accumulator``: ``source`` itself if it has this
+	/// type, otherwise ``buffer`` filled with the converted coefficients.
+	/// </summary>
+	template<typename Accumulator, typename T>
+	const Accumulator* convertChunk(const T* source, int n, Accumulator* buffer)
+	{
+		if constexpr (std::is_same<T, Accumulator>::value)
+			return source;
+		else
+		{
+			widenKernel<Accumulator, T>()(source, n, buffer);
+			return buffer;
+		}
+	}
+
+	/// <summary>
+	/// \f$\sum_i a_i b_i\f$ over n coefficients stored as ``TA`` and ``TB``, accumulated in ``Accumulator``.
+	/// </summary>
+	template<typename Accumulator, typename TA, typename TB>
+	Accumulator mixedDot(const TA* a, const TB* b, int n)
+	{
+		if constexpr (hasSimdKernels<Accumulator>)
+		{
+			alignas(64) Accumulator x[mixedChunk];
+			alignas(64) Accumulator y[mixedChunk];
+			Accumulator result{};
+			for (int i{}; i < n; i += mixedChunk)
+			{
+				const int m{ std::min(mixedChunk, n - i) };
+				result += simdKernels<Accumulator>().dot(convertChunk(a + i, m, x), convertChunk(b + i, m, y), m);
+			}
+			return result;
+		}
+		else
+		{
+			Accumulator result{};
+			for (int i{}; i < n; ++i)
+				result += static_cast<Accumulator>(a[i]) * static_cast<Accumulator>(b[i]);
+			return result;
+		}
+	}
+}
+
+/// <summary>
+/// The matrix product \f$AB\f$, accumulated and returned in ``Accumulator``, whatever the scalar types A and B
+/// are stored in: ``multiply<double>(a, b)`` with ``float`` matrices, or ``multiply<float>(a, b)`` with ``half``
+/// or ``bfloat16`` ones.
+/// </summary>
+/// <typeparam name="Accumulator"></typeparam>
+/// <typeparam name="TA"></typeparam>
+/// <typeparam name="TB"></typeparam>
+/// <param name="A"></param>
+/// <param name="B"></param>
+/// <returns></returns>
+template<typename Accumulator, typename TA, typename AllocatorA, typename TB, typename AllocatorB>
+MatrixX<Accumulator> multiply(const MatrixX<TA, AllocatorA>& A, const MatrixX<TB, AllocatorB>& B)
+{
+	if (A.cols() != B.rows())
+		throw std::logic_error("Error multiplying the matrices; the number of cols(A) must equal the number of rows(B)!");
+
+	MatrixX<Accumulator> result{ A.rows(), B.cols() };
+	if (B.cols() != 1)
+	{
+		gemm(A.rows(), B.cols(), A.cols(), Accumulator{ 1 }, A.data(), A.cols(), B.data(), B.cols(), Accumulator{}, result.data(), result.cols());
+		return result;
+	}
+
+	// A matrix-vector product reads every coefficient of A once; the vector is converted once up front.
+	const int n{ A.cols() };
+	std::vector<Accumulator> converted(std::is_same<TB, Accumulator>::value ? 0 : n);
+	const Accumulator* x{ internal::convertChunk(B.data(), n, converted.data()) };
+	const TA* a{ A.data() };
+	Accumulator* y{ result.data() };
+	parallelFor(0, A.rows(), std::max(1, grainSize() / std::max(n, 1)), [&](int first, int last) {
+		for (int i{ first }; i < last; ++i)
+			y[i] = internal::mixedDot<Accumulator>(a + static_cast<std::size_t>(i) * n, x, n);
+	});
+	return result;
+}
+
+/// <summary>
+/// Inner product \f$\sum_{i,j} a_{ij} b_{ij}\f$ of two matrices (or vectors) of the same dimensions, accumulated
+/// in ``Accumulator`` whatever the scalar types a and b are stored in.
+/// </summary>
+/// <typeparam name="Accumulator"></typeparam>
+/// <typeparam name="TA"></typeparam>
+/// <typeparam name="TB"></typeparam>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns></returns>
+template<typename Accumulator, typename TA, typename AllocatorA, typename TB, typename AllocatorB>
+Accumulator dot(const MatrixX<TA, AllocatorA>& a, const MatrixX<TB, AllocatorB>& b)
+{
+	if (a.rows() != b.rows() || a.cols() != b.cols())
+		throw std::logic_error("Matrices have different dimensions; therefore the dot product is undefined!");
+
+	const TA* x{ a.data() };
+	const TB* y{ b.data() };
+	return parallelReduce(0, a.size(), grainSize(), Accumulator{},
+		[x, y](int first, int last) { return internal::mixedDot<Accumulator>(x + first, y + first, last - first); },
+		[](Accumulator u, Accumulator v) { return u + v; });
+}
+
+#endif // !MixedPrecision_H
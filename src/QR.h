@@ -0,0 +1,785 @@
+#pragma once
+#ifndef QR_H
+#define QR_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Householder.h"
+#include "LU.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "Transpose.h"
+#include "MatrixX.h"
+
+/// QR decompositions and linear least squares.
+//
+/// ``HouseholderQR`` factors an m x n matrix as \f$A = QR\f$, with Q orthogonal and R upper trapezoidal, by
+/// Householder reflectors. R overwrites the upper triangle of a copy of A and the reflectors the part below
+/// the diagonal, as in LAPACK's ``geqrf``. The factorization is blocked: each panel of ``qrBlockSize``
+/// columns is factored column by column, and its reflectors are gathered into the compact WY form
+/// \f$I - VTV^T\f$ (see Householder.h) to update the trailing columns through ``gemm``.
+///
+/// ``ColPivHouseholderQR`` factors \f$AP = QR\f$, bringing at every step the remaining column of largest norm
+/// to the pivot. The magnitudes of the diagonal of R then decrease, and the numerical rank is the number
+/// of them above a threshold relative to the first: this handles rank-deficient designs, such as a
+/// regression on collinear basis functions, for which ``solve()`` returns the basic solution.
+///
+/// ``leastSquares(A, b)`` minimizes \f$\|Ax - b\|_2\f$ for the tall matrices of curve fitting and of the
+/// regressions of Longstaff-Schwartz, say 1e6 x 10. It never forms the orthogonal factor: the rows of A
+/// and b are streamed through in blocks that fit in cache, each block stacked under the current n x n
+/// triangle R (and the first n entries of \f$Q^Tb\f$) and reduced back to a triangle, so that A is read
+/// exactly once. Blocks of rows are reduced in parallel and their triangles merged the same way. The
+/// remaining n x n problem is solved by ``ColPivHouseholderQR``, so a rank-deficient A gives the basic
+/// solution instead of an error. A matrix that is not much taller than wide is factored whole instead, by
+/// ``HouseholderQR``, or by ``ColPivHouseholderQR`` if it is wide or rank deficient:
+///
+/// ```
+/// MatrixXd basis{ paths, 4 };		// 1, S, S^2, S^3 on the in-the-money paths
+/// MatrixXd payoff{ paths, 1 };	// discounted continuation values
+/// MatrixXd beta{ leastSquares(basis, payoff) };
+/// ```
+
+namespace internal
+{
+	/// <summary>
+	/// Width of the column panels of the blocked Householder QR factorization.
+	/// </summary>
+	constexpr int qrBlockSize{ 32 };
+
+	/// <summary>
+	/// ``leastSquares()`` streams the rows of A when it has at least this many times more rows than columns;
+	/// below that the blocked factorization of the whole of A is faster and needs no more memory.
+	/// </summary>
+	constexpr int leastSquaresStreamingRatio{ 16 };
+
+	/// <summary>
+	/// Householder QR factorization of the first k columns of the m x n matrix ``a``, in place, with the
+	/// reflectors also applied to the other n - k columns: R is left in the upper triangle and the reflector
+	/// \f$H_j = I - \tau_jv_jv_j^T\f$ in column j below the diagonal. Each panel of ``qrBlockSize`` columns is
+	/// transposed, so that its columns are contiguous, factored by ``householderQRColumns()`` and transposed
+	/// back; the columns right of it are then updated by a block reflector.
+	/// </summary>
+	template<typename scalarType>
+	void householderQR(int m, int n, int k, scalarType* a, int lda, scalarType* tau)
+	{
+		const int steps{ std::min(m, k) };
+		std::vector<scalarType> panel;
+		BlockReflector<scalarType> reflector;
+		for (int j0{}; j0 < steps; j0 += qrBlockSize)
+		{
+			const int jb{ std::min(qrBlockSize, steps - j0) };
+			const int rows{ m - j0 };
+			scalarType* block{ a + static_cast<std::size_t>(j0) * lda + j0 };
+			panel.resize(static_cast<std::size_t>(jb) * rows);
+			transposeCopy(rows, jb, block, lda, panel.data(), rows);
+			householderQRColumns(rows, jb, jb, panel.data(), rows, tau + j0);
+			transposeCopy(jb, rows, panel.data(), rows, block, lda);
+			const int rest{ n - j0 - jb };
+			if (rest > 0)
+			{
+				reflector.compute(rows, jb, block, lda, tau + j0);
+				reflector.apply(true, rest, block + jb, lda);
+			}
+		}
+	}
+
+	/// <summary>
+	/// \f$C := Q^TC\f$, or \f$C := QC\f$ if ``transpose`` is false, for the m x p matrix C, where Q is the
+	/// product of the ``steps`` reflectors left in ``a`` by ``householderQR()``, taken ``qrBlockSize`` at a time.
+	/// </summary>
+	template<typename scalarType>
+	void applyQ(bool transpose, int m, int steps, const scalarType* a, int lda, const scalarType* tau, scalarType* c, int ldc, int p)
+	{
+		if (steps <= 0 || p <= 0)
+			return;
+		BlockReflector<scalarType> reflector;
+		const int last{ ((steps - 1) / qrBlockSize) * qrBlockSize };
+		for (int block{}; block <= last; block += qrBlockSize)
+		{
+			const int j0{ transpose ? block : last - block };
+			const int jb{ std::min(qrBlockSize, steps - j0) };
+			reflector.compute(m - j0, jb, a + static_cast<std::size_t>(j0) * lda + j0, lda, tau + j0);
+			reflector.apply(transpose, p, c + static_cast<std::size_t>(j0) * ldc, ldc);
+		}
+	}
+
+	/// <summary>
+	/// ``LeastSquaresAccumulator`` reduces a stream of rows \f$[A_i \; b_i]\f$ of a least-squares problem with n
+	/// unknowns and p right-hand sides to the triangle R and the vector \f$c = Q^Tb\f$ (its first n entries),
+	/// with \f$\|Ax - b\|^2 = \|Rx - c\|^2 + \rho\f$, where \f$\rho\f$ accumulates the squares of the rest of
+	/// \f$Q^Tb\f$. The rows are stacked under ``[R c]`` in blocks small enough to stay in cache, stored by
+	/// columns so that the reflectors work on contiguous coefficients.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	template<typename scalarType>
+	class LeastSquaresAccumulator
+	{
+	private:
+		int _n;
+		int _p;
+		int _top;					// rows of [R c] at the top of each column of _work
+		int _blockRows;
+		std::vector<scalarType> _work;	// n + p columns of _n + _blockRows coefficients
+		std::vector<scalarType> _tau;
+		std::vector<scalarType> _residual;
+
+		int stride() const;
+		void reduce(int rows);
+	public:
+		LeastSquaresAccumulator();
+		LeastSquaresAccumulator(int n, int p);
+
+		void add(int rows, const scalarType* a, int lda, const scalarType* b, int ldb);
+		void merge(const LeastSquaresAccumulator& other);
+
+		int rows() const;
+		scalarType coeff(int i, int j) const;
+		const std::vector<scalarType>& residualSquares() const;
+	};
+
+	/// <summary>
+	/// An empty stream without unknowns, to be assigned.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	template<typename scalarType>
+	LeastSquaresAccumulator<scalarType>::LeastSquaresAccumulator() : LeastSquaresAccumulator{ 0, 0 }
+	{
+	}
+
+	/// <summary>
+	/// An empty stream for n unknowns and p right-hand sides.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	/// <param name="n"></param>
+	/// <param name="p"></param>
+	template<typename scalarType>
+	LeastSquaresAccumulator<scalarType>::LeastSquaresAccumulator(int n, int p)
+		: _n{ n }, _p{ p }, _top{}, _blockRows{ std::max(std::max(n, 1), 32768 / std::max(1, n + p)) },
+		_work(static_cast<std::size_t>(n + _blockRows) * (n + p)), _tau(n), _residual(p)
+	{
+	}
+
+	/// <summary>
+	/// The distance between consecutive columns of the workspace.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	/// <returns></returns>
+	template<typename scalarType>
+	inline int LeastSquaresAccumulator<scalarType>::stride() const
+	{
+		return _n + _blockRows;
+	}
+
+	/// <summary>
+	/// Factor the first ``rows`` rows of the workspace and keep the triangle at the top, adding the squares of
+	/// the rows of \f$Q^Tb\f$ below it to the residual.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	/// <param name="rows"></param>
+	template<typename scalarType>
+	void LeastSquaresAccumulator<scalarType>::reduce(int rows)
+	{
+		const int ld{ stride() };
+		scalarType* w{ _work.data() };
+		householderQRColumns(rows, _n + _p, _n, w, ld, _tau.data());
+		_top = std::min(rows, _n);
+		for (int q{}; q < _p; ++q)
+		{
+			const scalarType* tail{ w + static_cast<std::size_t>(_n + q) * ld + _top };
+			_residual[q] += simdKernels<scalarType>().dot(tail, tail, rows - _top);
+		}
+		for (int j{}; j < _top; ++j)
+			std::fill(w + static_cast<std::size_t>(j) * ld + j + 1, w + static_cast<std::size_t>(j) * ld + _top, scalarType{});
+	}
+
+	/// <summary>
+	/// Add ``rows`` rows of A (``lda`` apart) and of b (``ldb`` apart) to the stream.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	template<typename scalarType>
+	void LeastSquaresAccumulator<scalarType>::add(int rows, const scalarType* a, int lda, const scalarType* b, int ldb)
+	{
+		const int ld{ stride() };
+		for (int first{}; first < rows; first += _blockRows)
+		{
+			const int count{ std::min(_blockRows, rows - first) };
+			transposeCopy(count, _n, a + static_cast<std::size_t>(first) * lda, lda, _work.data() + _top, ld);
+			transposeCopy(count, _p, b + static_cast<std::size_t>(first) * ldb, ldb, _work.data() + static_cast<std::size_t>(_n) * ld + _top, ld);
+			reduce(_top + count);
+		}
+	}
+
+	/// <summary>
+	/// Add the rows reduced by another accumulator of the same problem, by stacking its triangle under this one.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	/// <param name="other"></param>
+	template<typename scalarType>
+	void LeastSquaresAccumulator<scalarType>::merge(const LeastSquaresAccumulator& other)
+	{
+		const int ld{ stride() };
+		for (int q{}; q < _p; ++q)
+			_residual[q] += other._residual[q];
+		if (other._top == 0)
+			return;
+		for (int j{}; j < _n + _p; ++j)
+			std::copy(other._work.begin() + static_cast<std::size_t>(j) * ld, other._work.begin() + static_cast<std::size_t>(j) * ld + other._top,
+				_work.begin() + static_cast<std::size_t>(j) * ld + _top);
+		reduce(_top + other._top);
+	}
+
+	/// <summary>
+	/// The number of rows of ``[R c]``: n, or the number of rows added if fewer.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	/// <returns></returns>
+	template<typename scalarType>
+	inline int LeastSquaresAccumulator<scalarType>::rows() const
+	{
+		return _top;
+	}
+
+	/// <summary>
+	/// The coefficient (i, j) of ``[R c]``, for i < ``rows()`` and j < n + p.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	/// <param name="i"></param>
+	/// <param name="j"></param>
+	/// <returns></returns>
+	template<typename scalarType>
+	inline scalarType LeastSquaresAccumulator<scalarType>::coeff(int i, int j) const
+	{
+		return _work[static_cast<std::size_t>(j) * stride() + i];
+	}
+
+	/// <summary>
+	/// The squared norms of the parts of \f$Q^Tb\f$ below c, one per right-hand side: the residual sums of squares.
+	/// </summary>
+	/// <typeparam name="scalarType"></typeparam>
+	/// <returns></returns>
+	template<typename scalarType>
+	inline const std::vector<scalarType>& LeastSquaresAccumulator<scalarType>::residualSquares() const
+	{
+		return _residual;
+	}
+}
+
+/// <summary>
+/// Householder QR decomposition \f$A = QR\f$ of an m x n matrix.
+/// </summary>
+/// <typeparam name="scalarType">``float`` or ``double``</typeparam>
+template<typename scalarType>
+class HouseholderQR
+{
+	static_assert(std::is_floating_point<scalarType>::value, "HouseholderQR requires a floating-point scalar type");
+private:
+	MatrixX<scalarType> _qr;
+	std::vector<scalarType> _tau;
+public:
+	HouseholderQR();
+	template<typename Allocator>
+	explicit HouseholderQR(const MatrixX<scalarType, Allocator>& a);
+
+	template<typename Allocator>
+	HouseholderQR& compute(const MatrixX<scalarType, Allocator>& a);
+
+	int rows() const;
+	int cols() const;
+	const MatrixX<scalarType>& matrixQR() const;
+	MatrixX<scalarType> matrixR() const;
+	MatrixX<scalarType> householderQ() const;
+	template<typename Allocator>
+	void applyQTranspose(MatrixX<scalarType, Allocator>& b) const;
+	template<typename Allocator>
+	MatrixX<scalarType> solve(const MatrixX<scalarType, Allocator>& b) const;
+};
+
+/// <summary>
+/// An empty decomposition, to be filled by ``compute()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+HouseholderQR<scalarType>::HouseholderQR() : _qr{}, _tau{}
+{
+}
+
+/// <summary>
+/// Factor the matrix ``a``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+template<typename scalarType>
+template<typename Allocator>
+HouseholderQR<scalarType>::HouseholderQR(const MatrixX<scalarType, Allocator>& a) : HouseholderQR{}
+{
+	compute(a);
+}
+
+/// <summary>
+/// Factor the matrix ``a``, of any shape, replacing the previous factorization.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Allocator>
+HouseholderQR<scalarType>& HouseholderQR<scalarType>::compute(const MatrixX<scalarType, Allocator>& a)
+{
+	const int m{ a.rows() };
+	const int n{ a.cols() };
+	_qr.resize(m, n);
+	std::copy(a.data(), a.data() + a.size(), _qr.data());
+	_tau.assign(std::min(m, n), scalarType{});
+	internal::householderQR(m, n, n, _qr.data(), n, _tau.data());
+	return *this;
+}
+
+/// <summary>
+/// The number of rows of the factored matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int HouseholderQR<scalarType>::rows() const
+{
+	return _qr.rows();
+}
+
+/// <summary>
+/// The number of columns of the factored matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int HouseholderQR<scalarType>::cols() const
+{
+	return _qr.cols();
+}
+
+/// <summary>
+/// The factorization in the layout of LAPACK: R in the upper triangle, and below the diagonal the reflectors
+/// without their unit first entries.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const MatrixX<scalarType>& HouseholderQR<scalarType>::matrixQR() const
+{
+	return _qr;
+}
+
+/// <summary>
+/// The min(m, n) x n upper trapezoidal factor R.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+MatrixX<scalarType> HouseholderQR<scalarType>::matrixR() const
+{
+	const int n{ cols() };
+	const int k{ static_cast<int>(_tau.size()) };
+	MatrixX<scalarType> r{ k, n };
+	for (int i{}; i < k; ++i)
+		std::copy(_qr.data() + static_cast<std::size_t>(i) * n + i, _qr.data() + static_cast<std::size_t>(i + 1) * n,
+			r.data() + static_cast<std::size_t>(i) * n + i);
+	return r;
+}
+
+/// <summary>
+/// The m x min(m, n) matrix of the first columns of Q, with \f$A = QR\f$ for the R of ``matrixR()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+MatrixX<scalarType> HouseholderQR<scalarType>::householderQ() const
+{
+	const int m{ rows() };
+	const int k{ static_cast<int>(_tau.size()) };
+	MatrixX<scalarType> q{ m, k };
+	for (int i{}; i < k; ++i)
+		q.coeffRef(i * k + i) = scalarType{ 1 };
+	internal::applyQ(false, m, k, _qr.data(), cols(), _tau.data(), q.data(), k, k);
+	return q;
+}
+
+/// <summary>
+/// \f$B := Q^TB\f$ in place, for B with m rows.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="b"></param>
+template<typename scalarType>
+template<typename Allocator>
+void HouseholderQR<scalarType>::applyQTranspose(MatrixX<scalarType, Allocator>& b) const
+{
+	if (b.rows() != rows())
+		throw std::logic_error("Error applying Q; the number of rows(b) must equal the number of rows(A)!");
+	internal::applyQ(true, rows(), static_cast<int>(_tau.size()), _qr.data(), cols(), _tau.data(), b.data(), b.cols(), b.cols());
+}
+
+/// <summary>
+/// The least-squares solution X of \f$AX = B\f$, minimizing \f$\|AX - B\|_2\f$ column by column, for A with at
+/// least as many rows as columns: \f$X = R^{-1}(Q^TB)_{1..n}\f$. Throws ``std::logic_error`` if A has fewer
+/// rows than columns or a zero on the diagonal of R; ``ColPivHouseholderQR`` handles rank-deficient matrices.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="b"></param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Allocator>
+MatrixX<scalarType> HouseholderQR<scalarType>::solve(const MatrixX<scalarType, Allocator>& b) const
+{
+	const int m{ rows() };
+	const int n{ cols() };
+	if (m < n)
+		throw std::logic_error("HouseholderQR::solve requires at least as many rows as columns!");
+	for (int i{}; i < n; ++i)
+		if (_qr.coeff(i * n + i) == scalarType{})
+			throw std::logic_error("The matrix is rank deficient; use ColPivHouseholderQR!");
+
+	MatrixX<scalarType> c{ b.rows(), b.cols() };
+	std::copy(b.data(), b.data() + b.size(), c.data());
+	applyQTranspose(c);
+	const int p{ b.cols() };
+	MatrixX<scalarType> x{ n, p };
+	std::copy(c.data(), c.data() + static_cast<std::size_t>(n) * p, x.data());
+	internal::solveUpper(n, p, _qr.data(), n, x.data(), p);
+	return x;
+}
+
+/// <summary>
+/// Householder QR decomposition with column pivoting \f$AP = QR\f$ of an m x n matrix, revealing its rank.
+/// </summary>
+/// <typeparam name="scalarType">``float`` or ``double``</typeparam>
+template<typename scalarType>
+class ColPivHouseholderQR
+{
+	static_assert(std::is_floating_point<scalarType>::value, "ColPivHouseholderQR requires a floating-point scalar type");
+private:
+	MatrixX<scalarType> _qr;
+	std::vector<scalarType> _tau;
+	std::vector<int> _permutation;	// column j of AP is column _permutation[j] of A
+	int _rank;
+public:
+	ColPivHouseholderQR();
+	template<typename Allocator>
+	explicit ColPivHouseholderQR(const MatrixX<scalarType, Allocator>& a, scalarType threshold = scalarType{ -1 });
+
+	template<typename Allocator>
+	ColPivHouseholderQR& compute(const MatrixX<scalarType, Allocator>& a, scalarType threshold = scalarType{ -1 });
+
+	int rows() const;
+	int cols() const;
+	int rank() const;
+	const std::vector<int>& permutation() const;
+	const MatrixX<scalarType>& matrixQR() const;
+	MatrixX<scalarType> matrixR() const;
+	MatrixX<scalarType> householderQ() const;
+	template<typename Allocator>
+	void applyQTranspose(MatrixX<scalarType, Allocator>& b) const;
+	template<typename Allocator>
+	MatrixX<scalarType> solve(const MatrixX<scalarType, Allocator>& b) const;
+};
+
+/// <summary>
+/// An empty decomposition, to be filled by ``compute()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+ColPivHouseholderQR<scalarType>::ColPivHouseholderQR() : _qr{}, _tau{}, _permutation{}, _rank{}
+{
+}
+
+/// <summary>
+/// Factor the matrix ``a``; see ``compute()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="threshold"></param>
+template<typename scalarType>
+template<typename Allocator>
+ColPivHouseholderQR<scalarType>::ColPivHouseholderQR(const MatrixX<scalarType, Allocator>& a, scalarType threshold)
+	: ColPivHouseholderQR{}
+{
+	compute(a, threshold);
+}
+
+/// <summary>
+/// Factor the matrix ``a``, of any shape, replacing the previous factorization. The pivoting makes every
+/// step depend on the previous one, so the factorization is unblocked; it works on the transpose of ``a``,
+/// where the columns are contiguous. The norms of the remaining columns are downdated after each step and recomputed when cancellation makes the downdate inaccurate,
+/// as in LAPACK's ``geqp3``. The rank is the number of diagonal coefficients of R larger in magnitude than
+/// ``threshold`` times the first; a negative threshold selects max(m, n) times the machine epsilon.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="threshold"></param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Allocator>
+ColPivHouseholderQR<scalarType>& ColPivHouseholderQR<scalarType>::compute(const MatrixX<scalarType, Allocator>& a, scalarType threshold)
+{
+	const int m{ a.rows() };
+	const int n{ a.cols() };
+	const int k{ std::min(m, n) };
+	_qr.resize(m, n);
+	std::copy(a.data(), a.data() + a.size(), _qr.data());
+	_tau.assign(k, scalarType{});
+	_permutation.resize(n);
+	std::iota(_permutation.begin(), _permutation.end(), 0);
+
+	// The columns are factored transposed, so that each is contiguous and a column exchange is a row swap.
+	const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+	std::vector<scalarType> at(static_cast<std::size_t>(n) * m);
+	transposeCopy(m, n, _qr.data(), n, at.data(), m);
+	auto column = [&](int j) { return at.data() + static_cast<std::size_t>(j) * m; };
+	std::vector<scalarType> norms(n), original(n);
+	for (int j{}; j < n; ++j)
+		original[j] = norms[j] = std::sqrt(kernels.dot(column(j), column(j), m));
+
+	const scalarType tolerance{ std::sqrt(std::numeric_limits<scalarType>::epsilon()) };
+	for (int j{}; j < k; ++j)
+	{
+		const int p{ static_cast<int>(std::max_element(norms.begin() + j, norms.end()) - norms.begin()) };
+		if (p != j)
+		{
+			std::swap_ranges(column(j), column(j) + m, column(p));
+			std::swap(norms[j], norms[p]);
+			std::swap(original[j], original[p]);
+			std::swap(_permutation[j], _permutation[p]);
+		}
+
+		scalarType* x{ column(j) + j };
+		internal::householder(m - j, x, 1, _tau[j]);
+		internal::applyHouseholderToColumns(m - j, n - j - 1, x, _tau[j], x + m, m);
+
+		for (int c{ j + 1 }; c < n; ++c)
+		{
+			if (norms[c] == scalarType{})
+				continue;
+			const scalarType ratio{ std::abs(column(c)[j]) / norms[c] };
+			const scalarType remaining{ std::max(scalarType{}, (scalarType{ 1 } - ratio) * (scalarType{ 1 } + ratio)) };
+			const scalarType relative{ norms[c] / original[c] };
+			if (remaining * relative * relative <= tolerance)
+				original[c] = norms[c] = std::sqrt(kernels.dot(column(c) + j + 1, column(c) + j + 1, m - j - 1));
+			else
+				norms[c] *= std::sqrt(remaining);
+		}
+	}
+	transposeCopy(n, m, at.data(), m, _qr.data(), n);
+	const scalarType* qr{ _qr.data() };
+
+	if (threshold < scalarType{})
+		threshold = static_cast<scalarType>(std::max(m, n)) * std::numeric_limits<scalarType>::epsilon();
+	_rank = 0;
+	const scalarType largest{ k > 0 ? std::abs(qr[0]) : scalarType{} };
+	while (_rank < k && std::abs(qr[static_cast<std::size_t>(_rank) * n + _rank]) > threshold * largest)
+		++_rank;
+	return *this;
+}
+
+/// <summary>
+/// The number of rows of the factored matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int ColPivHouseholderQR<scalarType>::rows() const
+{
+	return _qr.rows();
+}
+
+/// <summary>
+/// The number of columns of the factored matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int ColPivHouseholderQR<scalarType>::cols() const
+{
+	return _qr.cols();
+}
+
+/// <summary>
+/// The numerical rank of the factored matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int ColPivHouseholderQR<scalarType>::rank() const
+{
+	return _rank;
+}
+
+/// <summary>
+/// The column permutation P: column j of AP is column ``permutation()[j]`` of A.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const std::vector<int>& ColPivHouseholderQR<scalarType>::permutation() const
+{
+	return _permutation;
+}
+
+/// <summary>
+/// The factorization in the layout of LAPACK: R in the upper triangle, and below the diagonal the reflectors
+/// without their unit first entries.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const MatrixX<scalarType>& ColPivHouseholderQR<scalarType>::matrixQR() const
+{
+	return _qr;
+}
+
+/// <summary>
+/// The min(m, n) x n upper trapezoidal factor R, whose diagonal decreases in magnitude.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+MatrixX<scalarType> ColPivHouseholderQR<scalarType>::matrixR() const
+{
+	const int n{ cols() };
+	const int k{ static_cast<int>(_tau.size()) };
+	MatrixX<scalarType> r{ k, n };
+	for (int i{}; i < k; ++i)
+		std::copy(_qr.data() + static_cast<std::size_t>(i) * n + i, _qr.data() + static_cast<std::size_t>(i + 1) * n,
+			r.data() + static_cast<std::size_t>(i) * n + i);
+	return r;
+}
+
+/// <summary>
+/// The m x min(m, n) matrix of the first columns of Q, with \f$AP = QR\f$ for the R of ``matrixR()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+MatrixX<scalarType> ColPivHouseholderQR<scalarType>::householderQ() const
+{
+	const int m{ rows() };
+	const int k{ static_cast<int>(_tau.size()) };
+	MatrixX<scalarType> q{ m, k };
+	for (int i{}; i < k; ++i)
+		q.coeffRef(i * k + i) = scalarType{ 1 };
+	internal::applyQ(false, m, k, _qr.data(), cols(), _tau.data(), q.data(), k, k);
+	return q;
+}
+
+/// <summary>
+/// \f$B := Q^TB\f$ in place, for B with m rows.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="b"></param>
+template<typename scalarType>
+template<typename Allocator>
+void ColPivHouseholderQR<scalarType>::applyQTranspose(MatrixX<scalarType, Allocator>& b) const
+{
+	if (b.rows() != rows())
+		throw std::logic_error("Error applying Q; the number of rows(b) must equal the number of rows(A)!");
+	internal::applyQ(true, rows(), static_cast<int>(_tau.size()), _qr.data(), cols(), _tau.data(), b.data(), b.cols(), b.cols());
+}
+
+/// <summary>
+/// The basic least-squares solution X of \f$AX = B\f$: with r the rank, the unknowns of the last n - r pivot
+/// columns are set to zero and the others solve the leading r x r triangle of R. For a matrix of full column
+/// rank, this is the least-squares solution; for a consistent underdetermined system, an exact one.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="b"></param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Allocator>
+MatrixX<scalarType> ColPivHouseholderQR<scalarType>::solve(const MatrixX<scalarType, Allocator>& b) const
+{
+	const int n{ cols() };
+	const int p{ b.cols() };
+	MatrixX<scalarType> c{ b.rows(), p };
+	std::copy(b.data(), b.data() + b.size(), c.data());
+	applyQTranspose(c);
+	internal::solveUpper(_rank, p, _qr.data(), n, c.data(), p);
+
+	MatrixX<scalarType> x{ n, p };
+	for (int i{}; i < _rank; ++i)
+		std::copy(c.data() + static_cast<std::size_t>(i) * p, c.data() + static_cast<std::size_t>(i + 1) * p,
+			x.data() + static_cast<std::size_t>(_permutation[i]) * p);
+	return x;
+}
+
+/// <summary>
+/// The least-squares solution X of \f$AX = B\f$, minimizing \f$\|AX - B\|_2\f$ column by column, for any shape
+/// of A; a rank-deficient A gives the basic solution. For tall and skinny A, with at least
+/// ``leastSquaresStreamingRatio`` times more rows than columns, the rows of A and B are read once, in blocks of
+/// rows reduced in parallel to an n x n triangle (see the introduction of QR.h), and the triangular problem is
+/// solved by ``ColPivHouseholderQR``. Otherwise A is factored by the blocked ``HouseholderQR``, unless it is
+/// wide or the diagonal of R reveals a rank deficiency, in which case ``ColPivHouseholderQR`` factors A.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns></returns>
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType> leastSquares(const MatrixX<scalarType, Allocator>& a, const MatrixX<scalarType, Allocator>& b)
+{
+	if (a.rows() != b.rows())
+		throw std::logic_error("Error solving the least-squares problem; the number of rows(b) must equal the number of rows(A)!");
+
+	const int m{ a.rows() };
+	const int n{ a.cols() };
+	if (m < internal::leastSquaresStreamingRatio * n)
+	{
+		if (m >= n)
+		{
+			// The rank threshold of ColPivHouseholderQR, relative to the largest diagonal coefficient of R.
+			const HouseholderQR<scalarType> qr{ a };
+			const MatrixX<scalarType>& r{ qr.matrixQR() };
+			scalarType largest{};
+			for (int i{}; i < n; ++i)
+				largest = std::max(largest, std::abs(r.coeff(i * n + i)));
+			const scalarType threshold{ largest * m * std::numeric_limits<scalarType>::epsilon() };
+			bool fullRank{ largest > scalarType{} };
+			for (int i{}; i < n && fullRank; ++i)
+				fullRank = std::abs(r.coeff(i * n + i)) > threshold;
+			if (fullRank)
+				return qr.solve(b);
+		}
+		return ColPivHouseholderQR<scalarType>{ a }.solve(b);
+	}
+
+	using Accumulator = internal::LeastSquaresAccumulator<scalarType>;
+	const int p{ b.cols() };
+	const scalarType* pa{ a.data() };
+	const scalarType* pb{ b.data() };
+	const int grain{ std::max(1, 64 * (grainSize() / std::max(1, n + p))) };
+	const Accumulator reduced{ parallelReduce(0, m, grain, Accumulator{ n, p },
+		[&](int first, int last) {
+			Accumulator part{ n, p };
+			part.add(last - first, pa + static_cast<std::size_t>(first) * n, n, pb + static_cast<std::size_t>(first) * p, p);
+			return part;
+		},
+		[](Accumulator x, const Accumulator& y) {
+			x.merge(y);
+			return x;
+		}) };
+
+	const int top{ reduced.rows() };
+	MatrixX<scalarType> r{ top, n };
+	MatrixX<scalarType> c{ top, p };
+	for (int i{}; i < top; ++i)
+	{
+		for (int j{}; j < n; ++j)
+			r.coeffRef(i * n + j) = reduced.coeff(i, j);
+		for (int q{}; q < p; ++q)
+			c.coeffRef(i * p + q) = reduced.coeff(i, n + q);
+	}
+	return ColPivHouseholderQR<scalarType>{ r }.solve(c);
+}
+
+#endif // !QR_H
@@ -0,0 +1,575 @@
+#pragma once
+#ifndef Simd_H
+#define Simd_H
+
+#include <atomic>
+#include <cmath>
+#include <type_traits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MATHLIB_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+/// SIMD kernels with runtime instruction set dispatch.
+//
+/// Element-wise operations (add, subtract, scale, AXPY) and reductions (sum, dot product, 1-norm and
+/// infinity-norm) over contiguous arrays of ``float``, ``double`` and ``int`` are implemented with
+/// explicit SSE2, AVX2 and AVX-512 intrinsics, plus a portable scalar fallback. All four variants
+/// are compiled into every binary; the best one supported by the processor and the operating system
+/// is selected at runtime using CPUID, so a single build runs everywhere and still uses the widest
+/// vector registers available.
+///
+/// ```
+/// const SimdKernelTable<double>& kernels{ simdKernels<double>() };
+/// kernels.axpy(2.0, x, y, n);		// y = 2x + y
+/// ```
+///
+/// ``setSimdLevel()`` can restrict the dispatch to a lower tier, e.g. to compare tiers in a benchmark.
+/// Scalar types other than ``float``, ``double`` and ``int`` always use the scalar kernels.
+
+enum class SimdLevel
+{
+	Scalar,	// Portable C++
+	SSE2,	// 128-bit registers
+	AVX2,	// 256-bit registers, with FMA and F16C
+	AVX512	// 512-bit registers (AVX-512F)
+};
+
+/// <summary>
+/// Function pointers to the kernels of one instruction set, for one scalar type.
+/// Array lengths are passed as ``n``; arrays may overlap only if they are identical.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+template<typename T>
+struct SimdKernelTable
+{
+	void (*add)(const T* a, const T* b, T* result, int n);			// result = a + b
+	void (*subtract)(const T* a, const T* b, T* result, int n);		// result = a - b
+	void (*scale)(const T* a, T k, T* result, int n);				// result = k * a
+	void (*axpy)(T k, const T* x, T* y, int n);						// y = k * x + y
+	T (*sum)(const T* a, int n);									// sum of a[i]
+	T (*dot)(const T* a, const T* b, int n);						// sum of a[i] * b[i]
+	T (*norm1)(const T* a, int n);									// sum of |a[i]|
+	T (*normInf)(const T* a, int n);								// max of |a[i]|
+};
+
+namespace internal
+{
+	// ===========================================================================================
+	//                                   Scalar fallback
+	// -------------------------------------------------------------------------------------------
+	namespace scalar
+	{
+		template<typename T>
+		struct Vec
+		{
+			using reg = T;
+			using mask = bool;
+			static constexpr int width = 1;
+			static reg load(const T* p) { return *p; }
+			static void store(T* p, reg a) { *p = a; }
+			static reg set1(T x) { return x; }
+			static reg zero() { return T{}; }
+			static reg add(reg a, reg b) { return a + b; }
+			static reg sub(reg a, reg b) { return a - b; }
+			static reg mul(reg a, reg b) { return a * b; }
+			static reg fmadd(reg a, reg b, reg c) { return a * b + c; }
+			static reg abs(reg a) { return a < T{} ? -a : a; }
+			static reg max(reg a, reg b) { return a > b ? a : b; }
+			static reg div(reg a, reg b) { return a / b; }
+			static mask greater(reg a, reg b) { return a > b; }
+			static reg select(mask m, reg a, reg b) { return m ? a : b; }
+			static bool any(mask m) { return m; }
+			static T hsum(reg a) { return a; }
+			static T hmax(reg a) { return a; }
+		};
+
+#include "SimdKernels.inl"
+	}
+
+#ifdef MATHLIB_X86
+	// ===========================================================================================
+	//                                   SSE2
+	// -------------------------------------------------------------------------------------------
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+	namespace sse2
+	{
+		template<typename T>
+		struct Vec;
+
+		template<>
+		struct Vec<float>
+		{
+			using reg = __m128;
+			using mask = __m128;
+			static constexpr int width = 4;
+			static reg load(const float* p) { return _mm_loadu_ps(p); }
+			static void store(float* p, reg a) { _mm_storeu_ps(p, a); }
+			static reg set1(float x) { return _mm_set1_ps(x); }
+			static reg zero() { return _mm_setzero_ps(); }
+			static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+			static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+			static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+			static reg fmadd(reg a, reg b, reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+			static reg abs(reg a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+			static reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+			static reg div(reg a, reg b) { return _mm_div_ps(a, b); }
+			static mask greater(reg a, reg b) { return _mm_cmpgt_ps(a, b); }
+			static reg select(mask m, reg a, reg b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+			static bool any(mask m) { return _mm_movemask_ps(m) != 0; }
+			static float hsum(reg a)
+			{
+				const reg shuffled{ _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)) };
+				const reg sums{ _mm_add_ps(a, shuffled) };
+				return _mm_cvtss_f32(_mm_add_ss(sums, _mm_movehl_ps(shuffled, sums)));
+			}
+			static float hmax(reg a)
+			{
+				const reg shuffled{ _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)) };
+				const reg maxima{ _mm_max_ps(a, shuffled) };
+				return _mm_cvtss_f32(_mm_max_ss(maxima, _mm_movehl_ps(shuffled, maxima)));
+			}
+		};
+
+		template<>
+		struct Vec<double>
+		{
+			using reg = __m128d;
+			using mask = __m128d;
+			static constexpr int width = 2;
+			static reg load(const double* p) { return _mm_loadu_pd(p); }
+			static void store(double* p, reg a) { _mm_storeu_pd(p, a); }
+			static reg set1(double x) { return _mm_set1_pd(x); }
+			static reg zero() { return _mm_setzero_pd(); }
+			static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+			static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+			static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+			static reg fmadd(reg a, reg b, reg c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+			static reg abs(reg a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+			static reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+			static reg div(reg a, reg b) { return _mm_div_pd(a, b); }
+			static mask greater(reg a, reg b) { return _mm_cmpgt_pd(a, b); }
+			static reg select(mask m, reg a, reg b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+			static bool any(mask m) { return _mm_movemask_pd(m) != 0; }
+			static double hsum(reg a) { return _mm_cvtsd_f64(_mm_add_sd(a, _mm_unpackhi_pd(a, a))); }
+			static double hmax(reg a) { return _mm_cvtsd_f64(_mm_max_sd(a, _mm_unpackhi_pd(a, a))); }
+		};
+
+		template<>
+		struct Vec<int>
+		{
+			using reg = __m128i;
+			static constexpr int width = 4;
+			static reg load(const int* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+			static void store(int* p, reg a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a); }
+			static reg set1(int x) { return _mm_set1_epi32(x); }
+			static reg zero() { return _mm_setzero_si128(); }
+			static reg add(reg a, reg b) { return _mm_add_epi32(a, b); }
+			static reg sub(reg a, reg b) { return _mm_sub_epi32(a, b); }
+			static reg mul(reg a, reg b)
+			{
+				// SSE2 has no 32-bit low multiply; multiply the even and the odd lanes separately.
+				const reg even{ _mm_mul_epu32(a, b) };
+				const reg odd{ _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4)) };
+				return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+			}
+			static reg fmadd(reg a, reg b, reg c) { return _mm_add_epi32(mul(a, b), c); }
+			static reg abs(reg a)
+			{
+				const reg sign{ _mm_srai_epi32(a, 31) };
+				return _mm_sub_epi32(_mm_xor_si128(a, sign), sign);
+			}
+			static reg max(reg a, reg b)
+			{
+				const reg greater{ _mm_cmpgt_epi32(a, b) };
+				return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+			}
+			static int hsum(reg a)
+			{
+				a = _mm_add_epi32(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)));
+				a = _mm_add_epi32(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(2, 3, 0, 1)));
+				return _mm_cvtsi128_si32(a);
+			}
+			static int hmax(reg a)
+			{
+				a = max(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)));
+				a = max(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(2, 3, 0, 1)));
+				return _mm_cvtsi128_si32(a);
+			}
+		};
+
+#include "SimdKernels.inl"
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+	// ===========================================================================================
+	//                                   AVX2
+	// -------------------------------------------------------------------------------------------
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+	namespace avx2
+	{
+		template<typename T>
+		struct Vec;
+
+		template<>
+		struct Vec<float>
+		{
+			using reg = __m256;
+			using mask = __m256;
+			static constexpr int width = 8;
+			static reg load(const float* p) { return _mm256_loadu_ps(p); }
+			static void store(float* p, reg a) { _mm256_storeu_ps(p, a); }
+			static reg set1(float x) { return _mm256_set1_ps(x); }
+			static reg zero() { return _mm256_setzero_ps(); }
+			static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+			static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+			static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+			static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+			static reg abs(reg a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+			static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+			static reg div(reg a, reg b) { return _mm256_div_ps(a, b); }
+			static mask greater(reg a, reg b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+			static reg select(mask m, reg a, reg b) { return _mm256_blendv_ps(b, a, m); }
+			static bool any(mask m) { return _mm256_movemask_ps(m) != 0; }
+			static float hsum(reg a)
+			{
+				const __m128 halves{ _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)) };
+				const __m128 shuffled{ _mm_movehdup_ps(halves) };
+				const __m128 sums{ _mm_add_ps(halves, shuffled) };
+				return _mm_cvtss_f32(_mm_add_ss(sums, _mm_movehl_ps(shuffled, sums)));
+			}
+			static float hmax(reg a)
+			{
+				const __m128 halves{ _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)) };
+				const __m128 shuffled{ _mm_movehdup_ps(halves) };
+				const __m128 maxima{ _mm_max_ps(halves, shuffled) };
+				return _mm_cvtss_f32(_mm_max_ss(maxima, _mm_movehl_ps(shuffled, maxima)));
+			}
+		};
+
+		template<>
+		struct Vec<double>
+		{
+			using reg = __m256d;
+			using mask = __m256d;
+			static constexpr int width = 4;
+			static reg load(const double* p) { return _mm256_loadu_pd(p); }
+			static void store(double* p, reg a) { _mm256_storeu_pd(p, a); }
+			static reg set1(double x) { return _mm256_set1_pd(x); }
+			static reg zero() { return _mm256_setzero_pd(); }
+			static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+			static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+			static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+			static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+			static reg abs(reg a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+			static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+			static reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+			static mask greater(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+			static reg select(mask m, reg a, reg b) { return _mm256_blendv_pd(b, a, m); }
+			static bool any(mask m) { return _mm256_movemask_pd(m) != 0; }
+			static double hsum(reg a)
+			{
+				const __m128d halves{ _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1)) };
+				return _mm_cvtsd_f64(_mm_add_sd(halves, _mm_unpackhi_pd(halves, halves)));
+			}
+			static double hmax(reg a)
+			{
+				const __m128d halves{ _mm_max_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1)) };
+				return _mm_cvtsd_f64(_mm_max_sd(halves, _mm_unpackhi_pd(halves, halves)));
+			}
+		};
+
+		template<>
+		struct Vec<int>
+		{
+			using reg = __m256i;
+			static constexpr int width = 8;
+			static reg load(const int* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+			static void store(int* p, reg a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a); }
+			static reg set1(int x) { return _mm256_set1_epi32(x); }
+			static reg zero() { return _mm256_setzero_si256(); }
+			static reg add(reg a, reg b) { return _mm256_add_epi32(a, b); }
+			static reg sub(reg a, reg b) { return _mm256_sub_epi32(a, b); }
+			static reg mul(reg a, reg b) { return _mm256_mullo_epi32(a, b); }
+			static reg fmadd(reg a, reg b, reg c) { return _mm256_add_epi32(_mm256_mullo_epi32(a, b), c); }
+			static reg abs(reg a) { return _mm256_abs_epi32(a); }
+			static reg max(reg a, reg b) { return _mm256_max_epi32(a, b); }
+			static int hsum(reg a)
+			{
+				__m128i halves{ _mm_add_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1)) };
+				halves = _mm_add_epi32(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(1, 0, 3, 2)));
+				halves = _mm_add_epi32(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+				return _mm_cvtsi128_si32(halves);
+			}
+			static int hmax(reg a)
+			{
+				__m128i halves{ _mm_max_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1)) };
+				halves = _mm_max_epi32(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(1, 0, 3, 2)));
+				halves = _mm_max_epi32(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+				return _mm_cvtsi128_si32(halves);
+			}
+		};
+
+#include "SimdKernels.inl"
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+	// ===========================================================================================
+	//                                   AVX-512
+	// -------------------------------------------------------------------------------------------
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+	namespace avx512
+	{
+		template<typename T>
+		struct Vec;
+
+		template<>
+		struct Vec<float>
+		{
+			using reg = __m512;
+			using mask = __mmask16;
+			static constexpr int width = 16;
+			static reg load(const float* p) { return _mm512_loadu_ps(p); }
+			static void store(float* p, reg a) { _mm512_storeu_ps(p, a); }
+			static reg set1(float x) { return _mm512_set1_ps(x); }
+			static reg zero() { return _mm512_setzero_ps(); }
+			static reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+			static reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+			static reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+			static reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_ps(a, b, c); }
+			static reg abs(reg a) { return _mm512_abs_ps(a); }
+			static reg max(reg a, reg b) { return _mm512_max_ps(a, b); }
+			static reg div(reg a, reg b) { return _mm512_div_ps(a, b); }
+			static mask greater(reg a, reg b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+			static reg select(mask m, reg a, reg b) { return _mm512_mask_blend_ps(m, b, a); }
+			static bool any(mask m) { return m != 0; }
+			static float hsum(reg a) { return _mm512_reduce_add_ps(a); }
+			static float hmax(reg a) { return _mm512_reduce_max_ps(a); }
+		};
+
+		template<>
+		struct Vec<double>
+		{
+			using reg = __m512d;
+			using mask = __mmask8;
+			static constexpr int width = 8;
+			static reg load(const double* p) { return _mm512_loadu_pd(p); }
+			static void store(double* p, reg a) { _mm512_storeu_pd(p, a); }
+			static reg set1(double x) { return _mm512_set1_pd(x); }
+			static reg zero() { return _mm512_setzero_pd(); }
+			static reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+			static reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+			static reg mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+			static reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_pd(a, b, c); }
+			static reg abs(reg a) { return _mm512_abs_pd(a); }
+			static reg max(reg a, reg b) { return _mm512_max_pd(a, b); }
+			static reg div(reg a, reg b) { return _mm512_div_pd(a, b); }
+			static mask greater(reg a, reg b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+			static reg select(mask m, reg a, reg b) { return _mm512_mask_blend_pd(m, b, a); }
+			static bool any(mask m) { return m != 0; }
+			static double hsum(reg a) { return _mm512_reduce_add_pd(a); }
+			static double hmax(reg a) { return _mm512_reduce_max_pd(a); }
+		};
+
+		template<>
+		struct Vec<int>
+		{
+			using reg = __m512i;
+			static constexpr int width = 16;
+			static reg load(const int* p) { return _mm512_loadu_si512(p); }
+			static void store(int* p, reg a) { _mm512_storeu_si512(p, a); }
+			static reg set1(int x) { return _mm512_set1_epi32(x); }
+			static reg zero() { return _mm512_setzero_si512(); }
+			static reg add(reg a, reg b) { return _mm512_add_epi32(a, b); }
+			static reg sub(reg a, reg b) { return _mm512_sub_epi32(a, b); }
+			static reg mul(reg a, reg b) { return _mm512_mullo_epi32(a, b); }
+			static reg fmadd(reg a, reg b, reg c) { return _mm512_add_epi32(_mm512_mullo_epi32(a, b), c); }
+			static reg abs(reg a) { return _mm512_abs_epi32(a); }
+			static reg max(reg a, reg b) { return _mm512_max_epi32(a, b); }
+			static int hsum(reg a) { return _mm512_reduce_add_epi32(a); }
+			static int hmax(reg a) { return _mm512_reduce_max_epi32(a); }
+		};
+
+#include "SimdKernels.inl"
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+	/// <summary>
+	/// Execute CPUID for the given leaf and sub-leaf; ``info`` receives EAX, EBX, ECX and EDX.
+	/// </summary>
+	inline void cpuid(int info[4], int leaf, int subleaf)
+	{
+#if defined(_MSC_VER)
+		__cpuidex(info, leaf, subleaf);
+#else
+		unsigned int a{}, b{}, c{}, d{};
+		__cpuid_count(leaf, subleaf, a, b, c, d);
+		info[0] = static_cast<int>(a);
+		info[1] = static_cast<int>(b);
+		info[2] = static_cast<int>(c);
+		info[3] = static_cast<int>(d);
+#endif
+	}
+
+	/// <summary>
+	/// Read the XCR0 register, which tells which register files the operating system saves on
+	/// context switches.
+	/// </summary>
+	inline unsigned long long xgetbv0()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int eax{}, edx{};
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+	}
+#endif // MATHLIB_X86
+
+	/// <summary>
+	/// Probe the processor and the operating system for the widest supported instruction set.
+	/// </summary>
+	inline SimdLevel detectSimdLevel()
+	{
+#ifdef MATHLIB_X86
+		int info[4]{};
+		cpuid(info, 0, 0);
+		const int maxLeaf{ info[0] };
+
+		cpuid(info, 1, 0);
+		const bool sse2{ (info[3] & (1 << 26)) != 0 };
+		const bool fma{ (info[2] & (1 << 12)) != 0 };
+		const bool osxsave{ (info[2] & (1 << 27)) != 0 };
+		const bool avx{ (info[2] & (1 << 28)) != 0 };
+		const bool f16c{ (info[2] & (1 << 29)) != 0 };
+
+		bool avx2{ false };
+		bool avx512f{ false };
+		if (maxLeaf >= 7)
+		{
+			cpuid(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+			avx512f = (info[1] & (1 << 16)) != 0;
+		}
+
+		const unsigned long long xcr0{ osxsave ? xgetbv0() : 0 };
+		const bool ymmEnabled{ (xcr0 & 0x6) == 0x6 };		// SSE and AVX state
+		const bool zmmEnabled{ (xcr0 & 0xE6) == 0xE6 };	// ... plus opmask and upper ZMM state
+
+		// The AVX2 tier includes the half precision conversions of F16C, which some virtual machines mask.
+		if (avx512f && avx2 && fma && f16c && zmmEnabled)
+			return SimdLevel::AVX512;
+		if (avx && avx2 && fma && f16c && ymmEnabled)
+			return SimdLevel::AVX2;
+		if (sse2)
+			return SimdLevel::SSE2;
+#endif
+		return SimdLevel::Scalar;
+	}
+
+	/// <summary>
+	/// The instruction set currently used by ``simdKernels()``.
+	/// </summary>
+	inline std::atomic<SimdLevel>& activeSimdLevel()
+	{
+		static std::atomic<SimdLevel> level{ detectSimdLevel() };
+		return level;
+	}
+}
+
+/// <summary>
+/// The widest instruction set supported by this machine.
+/// </summary>
+/// <returns></returns>
+inline SimdLevel maxSimdLevel()
+{
+	static const SimdLevel level{ internal::detectSimdLevel() };
+	return level;
+}
+
+/// <summary>
+/// The instruction set used for dispatch. Defaults to ``maxSimdLevel()``.
+/// </summary>
+/// <returns></returns>
+inline SimdLevel simdLevel()
+{
+	return internal::activeSimdLevel().load(std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Restrict dispatch to the given instruction set. Requests beyond ``maxSimdLevel()`` are capped.
+/// </summary>
+/// <param name="level"></param>
+inline void setSimdLevel(SimdLevel level)
+{
+	internal::activeSimdLevel().store(level < maxSimdLevel() ? level : maxSimdLevel(), std::memory_order_relaxed);
+}
+
+/// <summary>
+/// True for the scalar types that have vectorized kernels.
+/// </summary>
+template<typename T>
+constexpr bool hasSimdKernels = std::is_same<T, float>::value || std::is_same<T, double>::value || std::is_same<T, int>::value;
+
+/// <summary>
+/// The kernel table for scalar type T at the current instruction set level.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+/// <returns></returns>
+template<typename T>
+const SimdKernelTable<T>& simdKernels()
+{
+#ifdef MATHLIB_X86
+	if constexpr (hasSimdKernels<T>)
+	{
+		switch (simdLevel())
+		{
+		case SimdLevel::AVX512:
+			return internal::avx512::kernelTable<T>();
+		case SimdLevel::AVX2:
+			return internal::avx2::kernelTable<T>();
+		case SimdLevel::SSE2:
+			return internal::sse2::kernelTable<T>();
+		default:
+			break;
+		}
+	}
+#endif
+	return internal::scalar::kernelTable<T>();
+}
+
+#endif // !Simd_H
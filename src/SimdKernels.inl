@@ -0,0 +1,175 @@
+// SimdKernels.inl : Element-wise kernels and reductions over contiguous arrays.
+//
+// The kernels are written once, against the ``Vec<T>`` register abstraction, and compiled once per
+// instruction set: Simd.h includes this file inside a namespace that defines ``Vec<T>`` for one
+// instruction set (scalar, SSE2, AVX2 or AVX-512). For that reason this file has no include guard.
+//
+// ``Vec<T>`` provides the register type ``reg``, the number of lanes ``width`` and the operations
+// load, store, set1, zero, add, sub, mul, fmadd (a * b + c), abs, max, hsum and hmax.
+
+/// <summary>
+/// result[i] = a[i] + b[i]
+/// </summary>
+template<typename T>
+void add(const T* a, const T* b, T* result, int n)
+{
+	using V = Vec<T>;
+	int i{};
+	for (; i + V::width <= n; i += V::width)
+		V::store(result + i, V::add(V::load(a + i), V::load(b + i)));
+	for (; i < n; ++i)
+		result[i] = a[i] + b[i];
+}
+
+/// <summary>
+/// result[i] = a[i] - b[i]
+/// </summary>
+template<typename T>
+void subtract(const T* a, const T* b, T* result, int n)
+{
+	using V = Vec<T>;
+	int i{};
+	for (; i + V::width <= n; i += V::width)
+		V::store(result + i, V::sub(V::load(a + i), V::load(b + i)));
+	for (; i < n; ++i)
+		result[i] = a[i] - b[i];
+}
+
+/// <summary>
+/// result[i] = k * a[i]
+/// </summary>
+template<typename T>
+void scale(const T* a, T k, T* result, int n)
+{
+	using V = Vec<T>;
+	const typename V::reg vk{ V::set1(k) };
+	int i{};
+	for (; i + V::width <= n; i += V::width)
+		V::store(result + i, V::mul(vk, V::load(a + i)));
+	for (; i < n; ++i)
+		result[i] = k * a[i];
+}
+
+/// <summary>
+/// y[i] = k * x[i] + y[i]
+/// </summary>
+template<typename T>
+void axpy(T k, const T* x, T* y, int n)
+{
+	using V = Vec<T>;
+	const typename V::reg vk{ V::set1(k) };
+	int i{};
+	for (; i + V::width <= n; i += V::width)
+		V::store(y + i, V::fmadd(vk, V::load(x + i), V::load(y + i)));
+	for (; i < n; ++i)
+		y[i] += k * x[i];
+}
+
+/// <summary>
+/// Sum of a[i]. Four independent accumulators hide the latency of the vector additions.
+/// </summary>
+template<typename T>
+T sum(const T* a, int n)
+{
+	using V = Vec<T>;
+	typename V::reg s0{ V::zero() }, s1{ V::zero() }, s2{ V::zero() }, s3{ V::zero() };
+	int i{};
+	for (; i + 4 * V::width <= n; i += 4 * V::width)
+	{
+		s0 = V::add(s0, V::load(a + i));
+		s1 = V::add(s1, V::load(a + i + V::width));
+		s2 = V::add(s2, V::load(a + i + 2 * V::width));
+		s3 = V::add(s3, V::load(a + i + 3 * V::width));
+	}
+	for (; i + V::width <= n; i += V::width)
+		s0 = V::add(s0, V::load(a + i));
+
+	T result{ V::hsum(V::add(V::add(s0, s1), V::add(s2, s3))) };
+	for (; i < n; ++i)
+		result += a[i];
+	return result;
+}
+
+/// <summary>
+/// Inner product of a and b.
+/// </summary>
+template<typename T>
+T dot(const T* a, const T* b, int n)
+{
+	using V = Vec<T>;
+	typename V::reg s0{ V::zero() }, s1{ V::zero() }, s2{ V::zero() }, s3{ V::zero() };
+	int i{};
+	for (; i + 4 * V::width <= n; i += 4 * V::width)
+	{
+		s0 = V::fmadd(V::load(a + i), V::load(b + i), s0);
+		s1 = V::fmadd(V::load(a + i + V::width), V::load(b + i + V::width), s1);
+		s2 = V::fmadd(V::load(a + i + 2 * V::width), V::load(b + i + 2 * V::width), s2);
+		s3 = V::fmadd(V::load(a + i + 3 * V::width), V::load(b + i + 3 * V::width), s3);
+	}
+	for (; i + V::width <= n; i += V::width)
+		s0 = V::fmadd(V::load(a + i), V::load(b + i), s0);
+
+	T result{ V::hsum(V::add(V::add(s0, s1), V::add(s2, s3))) };
+	for (; i < n; ++i)
+		result += a[i] * b[i];
+	return result;
+}
+
+/// <summary>
+/// Sum of |a[i]|.
+/// </summary>
+template<typename T>
+T norm1(const T* a, int n)
+{
+	using V = Vec<T>;
+	typename V::reg s0{ V::zero() }, s1{ V::zero() };
+	int i{};
+	for (; i + 2 * V::width <= n; i += 2 * V::width)
+	{
+		s0 = V::add(s0, V::abs(V::load(a + i)));
+		s1 = V::add(s1, V::abs(V::load(a + i + V::width)));
+	}
+	for (; i + V::width <= n; i += V::width)
+		s0 = V::add(s0, V::abs(V::load(a + i)));
+
+	T result{ V::hsum(V::add(s0, s1)) };
+	for (; i < n; ++i)
+		result += a[i] < T{} ? -a[i] : a[i];
+	return result;
+}
+
+/// <summary>
+/// Largest |a[i]|, or zero for an empty array.
+/// </summary>
+template<typename T>
+T normInf(const T* a, int n)
+{
+	using V = Vec<T>;
+	typename V::reg m0{ V::zero() }, m1{ V::zero() };
+	int i{};
+	for (; i + 2 * V::width <= n; i += 2 * V::width)
+	{
+		m0 = V::max(m0, V::abs(V::load(a + i)));
+		m1 = V::max(m1, V::abs(V::load(a + i + V::width)));
+	}
+	for (; i + V::width <= n; i += V::width)
+		m0 = V::max(m0, V::abs(V::load(a + i)));
+
+	T result{ V::hmax(V::max(m0, m1)) };
+	for (; i < n; ++i)
+	{
+		const T x{ a[i] < T{} ? -a[i] : a[i] };
+		result = x > result ? x : result;
+	}
+	return result;
+}
+
+/// <summary>
+/// The kernels of this instruction set, gathered into a dispatch table.
+/// </summary>
+template<typename T>
+const SimdKernelTable<T>& kernelTable()
+{
+	static const SimdKernelTable<T> table{ &add<T>, &subtract<T>, &scale<T>, &axpy<T>, &sum<T>, &dot<T>, &norm1<T>, &normInf<T> };
+	return table;
+}
@@ -0,0 +1,624 @@
+#pragma once
+#ifndef SPARSE_MATRIX_X_H
+#define SPARSE_MATRIX_X_H
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "MatrixX.h"
+
+/// Sparse matrices in compressed row (CSR) and compressed column (CSC) storage.
+//
+/// A ``SparseMatrixX`` stores only its non-zero coefficients. The matrix is cut into outer slices, the rows
+/// of a ``StorageOrder::RowMajor`` (CSR) matrix or the columns of a ``StorageOrder::ColumnMajor`` (CSC) one.
+/// Slice k holds the non-zeros ``outerStart()[k]`` to ``outerStart()[k + 1] - 1`` of ``values()``, with their
+/// inner indices (columns for CSR, rows for CSC) in ``innerIndices()``, in increasing order.
+///
+/// Sparse matrices are assembled from (row, column, value) triplets in any order; coefficients given more than
+/// once are summed, as in a finite-element or finite-difference assembly:
+///
+/// ```
+/// std::vector<Triplet<double>> triplets;
+/// for (int i{}; i < n; ++i)
+/// {
+///     triplets.push_back({ i, i, 2.0 });
+///     if (i > 0)
+///         triplets.push_back({ i, i - 1, -1.0 });
+///     if (i + 1 < n)
+///         triplets.push_back({ i, i + 1, -1.0 });
+/// }
+/// SparseMatrixXd a{ n, n, triplets };
+/// MatrixXd y{ a * x };                     // sparse x dense
+/// ```
+///
+/// The product by a vector, ``multiply(x, y)``, and the products with dense matrices cost O(nnz) per dense
+/// column and are split across threads by rows (or by dense columns, for a CSC matrix times a dense matrix).
+/// ``transpose()`` reinterprets the compressed arrays in the other storage order, and ``toRowMajor()`` and
+/// ``toColumnMajor()`` convert between the two in O(nnz).
+
+enum class StorageOrder
+{
+	RowMajor,		// compressed sparse rows (CSR)
+	ColumnMajor		// compressed sparse columns (CSC)
+};
+
+/// <summary>
+/// A coefficient ``value`` at (``row``, ``col``), to assemble a sparse matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+struct Triplet
+{
+	int row;
+	int col;
+	scalarType value;
+};
+
+/// <summary>
+/// ``SparseMatrixX`` is a dynamic matrix that stores its non-zero coefficients in compressed rows (CSR) or
+/// compressed columns (CSC).
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <typeparam name="order">``StorageOrder::RowMajor`` (CSR) or ``StorageOrder::ColumnMajor`` (CSC)</typeparam>
+template<typename scalarType, StorageOrder order = StorageOrder::RowMajor>
+class SparseMatrixX
+{
+private:
+	int _rows;
+	int _cols;
+	std::vector<int> _outerStart;		// outerSize() + 1 offsets into _inner and _values
+	std::vector<int> _inner;			// column (CSR) or row (CSC) of each non-zero
+	std::vector<scalarType> _values;
+public:
+	using value_type = scalarType;
+	static constexpr bool isRowMajor{ order == StorageOrder::RowMajor };
+	static constexpr StorageOrder transposedOrder{ isRowMajor ? StorageOrder::ColumnMajor : StorageOrder::RowMajor };
+
+	SparseMatrixX();
+	SparseMatrixX(int m, int n);
+	SparseMatrixX(int m, int n, const std::vector<Triplet<scalarType>>& triplets);
+	SparseMatrixX(int m, int n, std::vector<int> outerStart, std::vector<int> innerIndices, std::vector<scalarType> values);
+	template<typename Allocator>
+	explicit SparseMatrixX(const MatrixX<scalarType, Allocator>& dense);
+
+	SparseMatrixX& setFromTriplets(int m, int n, const std::vector<Triplet<scalarType>>& triplets);
+
+	int rows() const;
+	int cols() const;
+	int outerSize() const;
+	int nonZeros() const;
+	const int* outerStart() const;
+	const int* innerIndices() const;
+	const scalarType* values() const;
+	scalarType* values();
+
+	scalarType coeff(int i, int j) const;
+	scalarType operator()(int i, int j) const;
+
+	void multiply(const scalarType* x, scalarType* y) const;
+	MatrixX<scalarType> toDense() const;
+	SparseMatrixX<scalarType, transposedOrder> transpose() const;
+	SparseMatrixX<scalarType, StorageOrder::RowMajor> toRowMajor() const;
+	SparseMatrixX<scalarType, StorageOrder::ColumnMajor> toColumnMajor() const;
+};
+
+using SparseMatrixXd = SparseMatrixX<double>;
+using SparseMatrixXf = SparseMatrixX<float>;
+
+namespace internal
+{
+	/// <summary>
+	/// Rows per task of a loop over the rows of a product with a sparse matrix, when every row costs
+	/// about ``work`` multiply-adds.
+	/// </summary>
+	inline int sparseGrain(long long work)
+	{
+		return static_cast<int>(std::max(1LL, grainSize() / std::max(1LL, work)));
+	}
+}
+
+/// <summary>
+/// An empty 0 x 0 matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType, StorageOrder order>
+SparseMatrixX<scalarType, order>::SparseMatrixX() : _rows{}, _cols{}, _outerStart{ 0 }, _inner{}, _values{}
+{
+}
+
+/// <summary>
+/// The m x n zero matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="m"></param>
+/// <param name="n"></param>
+template<typename scalarType, StorageOrder order>
+SparseMatrixX<scalarType, order>::SparseMatrixX(int m, int n)
+	: _rows{ m }, _cols{ n }, _outerStart(static_cast<std::size_t>(isRowMajor ? m : n) + 1, 0), _inner{}, _values{}
+{
+	if (m < 0 || n < 0)
+		throw std::logic_error("The dimensions of a matrix cannot be negative!");
+}
+
+/// <summary>
+/// The m x n matrix assembled from ``triplets``; see ``setFromTriplets()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="m"></param>
+/// <param name="n"></param>
+/// <param name="triplets"></param>
+template<typename scalarType, StorageOrder order>
+SparseMatrixX<scalarType, order>::SparseMatrixX(int m, int n, const std::vector<Triplet<scalarType>>& triplets) : SparseMatrixX{}
+{
+	setFromTriplets(m, n, triplets);
+}
+
+/// <summary>
+/// The m x n matrix with the given compressed arrays, which are taken over without copying.
+/// Throws ``std::logic_error`` if they are inconsistent: ``outerStart`` must have one more element than
+/// there are outer slices, be non-decreasing from zero to the number of non-zeros, and the inner indices
+/// of every slice must be increasing and within the matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="m"></param>
+/// <param name="n"></param>
+/// <param name="outerStart"></param>
+/// <param name="innerIndices"></param>
+/// <param name="values"></param>
+template<typename scalarType, StorageOrder order>
+SparseMatrixX<scalarType, order>::SparseMatrixX(int m, int n, std::vector<int> outerStart, std::vector<int> innerIndices, std::vector<scalarType> values)
+	: _rows{ m }, _cols{ n }, _outerStart{ std::move(outerStart) }, _inner{ std::move(innerIndices) }, _values{ std::move(values) }
+{
+	const int outer{ isRowMajor ? m : n };
+	const int inner{ isRowMajor ? n : m };
+	if (m < 0 || n < 0 || static_cast<int>(_outerStart.size()) != outer + 1 || _inner.size() != _values.size()
+		|| _outerStart.front() != 0 || _outerStart.back() != static_cast<int>(_values.size()))
+		throw std::logic_error("Inconsistent compressed arrays of a sparse matrix!");
+	for (int k{}; k < outer; ++k)
+	{
+		if (_outerStart[k] > _outerStart[k + 1])
+			throw std::logic_error("Inconsistent compressed arrays of a sparse matrix!");
+		for (int p{ _outerStart[k] }; p < _outerStart[k + 1]; ++p)
+			if (_inner[p] < 0 || _inner[p] >= inner || (p > _outerStart[k] && _inner[p] <= _inner[p - 1]))
+				throw std::logic_error("Inconsistent compressed arrays of a sparse matrix!");
+	}
+}
+
+/// <summary>
+/// The non-zero coefficients of the dense matrix ``dense``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="dense"></param>
+template<typename scalarType, StorageOrder order>
+template<typename Allocator>
+SparseMatrixX<scalarType, order>::SparseMatrixX(const MatrixX<scalarType, Allocator>& dense) : SparseMatrixX{ dense.rows(), dense.cols() }
+{
+	const int outer{ outerSize() };
+	const int inner{ isRowMajor ? _cols : _rows };
+	for (int k{}; k < outer; ++k)
+	{
+		for (int l{}; l < inner; ++l)
+		{
+			const scalarType x{ isRowMajor ? dense.coeff(k * _cols + l) : dense.coeff(l * _cols + k) };
+			if (x != scalarType{})
+			{
+				_inner.push_back(l);
+				_values.push_back(x);
+			}
+		}
+		_outerStart[k + 1] = static_cast<int>(_values.size());
+	}
+}
+
+/// <summary>
+/// Replace the matrix by the m x n matrix with the coefficients ``triplets``, given in any order.
+/// Coefficients at the same position are summed. The triplets are sorted by two stable counting sorts,
+/// by inner then outer index, so that assembly costs O(nnz + m + n).
+/// Throws ``std::out_of_range`` if a triplet lies outside the matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="m"></param>
+/// <param name="n"></param>
+/// <param name="triplets"></param>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+SparseMatrixX<scalarType, order>& SparseMatrixX<scalarType, order>::setFromTriplets(int m, int n, const std::vector<Triplet<scalarType>>& triplets)
+{
+	if (m < 0 || n < 0)
+		throw std::logic_error("The dimensions of a matrix cannot be negative!");
+	for (const Triplet<scalarType>& t : triplets)
+		if (t.row < 0 || t.row >= m || t.col < 0 || t.col >= n)
+			throw std::out_of_range("Triplet outside the sparse matrix!");
+
+	_rows = m;
+	_cols = n;
+	const int outer{ outerSize() };
+	const int inner{ isRowMajor ? n : m };
+	const int count{ static_cast<int>(triplets.size()) };
+	auto outerOf{ [](const Triplet<scalarType>& t) { return isRowMajor ? t.row : t.col; } };
+	auto innerOf{ [](const Triplet<scalarType>& t) { return isRowMajor ? t.col : t.row; } };
+
+	std::vector<int> position(static_cast<std::size_t>(inner) + 1, 0);
+	for (const Triplet<scalarType>& t : triplets)
+		++position[innerOf(t) + 1];
+	std::partial_sum(position.begin(), position.end(), position.begin());
+	std::vector<int> byInner(count);
+	for (int p{}; p < count; ++p)
+		byInner[position[innerOf(triplets[p])]++] = p;
+
+	position.assign(static_cast<std::size_t>(outer) + 1, 0);
+	for (const Triplet<scalarType>& t : triplets)
+		++position[outerOf(t) + 1];
+	std::partial_sum(position.begin(), position.end(), position.begin());
+	std::vector<int> sorted(count);
+	std::vector<int> next(position.begin(), position.end() - 1);
+	for (int p : byInner)
+		sorted[next[outerOf(triplets[p])]++] = p;
+
+	_outerStart.assign(static_cast<std::size_t>(outer) + 1, 0);
+	_inner.clear();
+	_values.clear();
+	_inner.reserve(count);
+	_values.reserve(count);
+	for (int k{}; k < outer; ++k)
+	{
+		for (int p{ position[k] }; p < position[k + 1]; ++p)
+		{
+			const Triplet<scalarType>& t{ triplets[sorted[p]] };
+			if (static_cast<int>(_inner.size()) > _outerStart[k] && _inner.back() == innerOf(t))
+				_values.back() += t.value;
+			else
+			{
+				_inner.push_back(innerOf(t));
+				_values.push_back(t.value);
+			}
+		}
+		_outerStart[k + 1] = static_cast<int>(_values.size());
+	}
+	return *this;
+}
+
+/// <summary>
+/// The number of rows.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+inline int SparseMatrixX<scalarType, order>::rows() const
+{
+	return _rows;
+}
+
+/// <summary>
+/// The number of columns.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+inline int SparseMatrixX<scalarType, order>::cols() const
+{
+	return _cols;
+}
+
+/// <summary>
+/// The number of outer slices: rows for CSR, columns for CSC.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+inline int SparseMatrixX<scalarType, order>::outerSize() const
+{
+	return isRowMajor ? _rows : _cols;
+}
+
+/// <summary>
+/// The number of stored coefficients.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+inline int SparseMatrixX<scalarType, order>::nonZeros() const
+{
+	return static_cast<int>(_values.size());
+}
+
+/// <summary>
+/// The ``outerSize() + 1`` offsets of the outer slices into ``innerIndices()`` and ``values()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+inline const int* SparseMatrixX<scalarType, order>::outerStart() const
+{
+	return _outerStart.data();
+}
+
+/// <summary>
+/// The column (CSR) or row (CSC) of each stored coefficient.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+inline const int* SparseMatrixX<scalarType, order>::innerIndices() const
+{
+	return _inner.data();
+}
+
+/// <summary>
+/// The stored coefficients, slice by slice.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+inline const scalarType* SparseMatrixX<scalarType, order>::values() const
+{
+	return _values.data();
+}
+
+/// <summary>
+/// The stored coefficients, which can be changed in place without changing the sparsity pattern.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+inline scalarType* SparseMatrixX<scalarType, order>::values()
+{
+	return _values.data();
+}
+
+/// <summary>
+/// The coefficient (i, j), zero if it is not stored; found by binary search in its slice. Indices are
+/// only checked by an assertion in debug builds.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+scalarType SparseMatrixX<scalarType, order>::coeff(int i, int j) const
+{
+	assert(i >= 0 && i < _rows && j >= 0 && j < _cols);
+	const int k{ isRowMajor ? i : j };
+	const int l{ isRowMajor ? j : i };
+	const int* first{ _inner.data() + _outerStart[k] };
+	const int* last{ _inner.data() + _outerStart[k + 1] };
+	const int* p{ std::lower_bound(first, last, l) };
+	return p != last && *p == l ? _values[p - _inner.data()] : scalarType{};
+}
+
+/// <summary>
+/// The coefficient (i, j), zero if it is not stored. Throws ``std::out_of_range`` on indices outside the matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+scalarType SparseMatrixX<scalarType, order>::operator()(int i, int j) const
+{
+	if (i < 0 || i >= _rows || j < 0 || j >= _cols)
+		throw std::out_of_range("Index out of bounds!");
+	return coeff(i, j);
+}
+
+/// <summary>
+/// The product \f$y = Ax\f$ by a vector of length ``cols()``, into ``y`` of length ``rows()``. A CSR matrix
+/// computes one sparse dot product per row, split across threads; a CSC matrix adds its columns scaled by
+/// the coefficients of x. ``x`` and ``y`` must not overlap.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="x"></param>
+/// <param name="y"></param>
+template<typename scalarType, StorageOrder order>
+void SparseMatrixX<scalarType, order>::multiply(const scalarType* x, scalarType* y) const
+{
+	const int* outerStart{ _outerStart.data() };
+	const int* inner{ _inner.data() };
+	const scalarType* values{ _values.data() };
+	if constexpr (isRowMajor)
+	{
+		const long long perRow{ _rows > 0 ? nonZeros() / _rows + 1 : 1 };
+		parallelFor(0, _rows, internal::sparseGrain(perRow), [&](int first, int last) {
+			for (int i{ first }; i < last; ++i)
+			{
+				scalarType sum{};
+				for (int p{ outerStart[i] }; p < outerStart[i + 1]; ++p)
+					sum += values[p] * x[inner[p]];
+				y[i] = sum;
+			}
+		});
+	}
+	else
+	{
+		std::fill(y, y + _rows, scalarType{});
+		for (int j{}; j < _cols; ++j)
+		{
+			const scalarType xj{ x[j] };
+			if (xj != scalarType{})
+				for (int p{ outerStart[j] }; p < outerStart[j + 1]; ++p)
+					y[inner[p]] += values[p] * xj;
+		}
+	}
+}
+
+/// <summary>
+/// The dense matrix with the same coefficients.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+MatrixX<scalarType> SparseMatrixX<scalarType, order>::toDense() const
+{
+	MatrixX<scalarType> dense{ _rows, _cols };
+	for (int k{}; k < outerSize(); ++k)
+		for (int p{ _outerStart[k] }; p < _outerStart[k + 1]; ++p)
+		{
+			if constexpr (isRowMajor)
+				dense.coeffRef(k * _cols + _inner[p]) = _values[p];
+			else
+				dense.coeffRef(_inner[p] * _cols + k) = _values[p];
+		}
+	return dense;
+}
+
+/// <summary>
+/// The transpose. The compressed rows of a matrix are the compressed columns of its transpose, so the
+/// arrays are copied as they are into a matrix of the other storage order.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+SparseMatrixX<scalarType, SparseMatrixX<scalarType, order>::transposedOrder> SparseMatrixX<scalarType, order>::transpose() const
+{
+	return SparseMatrixX<scalarType, transposedOrder>{ _cols, _rows, _outerStart, _inner, _values };
+}
+
+/// <summary>
+/// The same matrix in CSR storage. Converting from CSC scatters the non-zeros to their rows by a counting
+/// sort, which leaves the columns of every row in increasing order.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+SparseMatrixX<scalarType, StorageOrder::RowMajor> SparseMatrixX<scalarType, order>::toRowMajor() const
+{
+	if constexpr (isRowMajor)
+		return *this;
+	else
+		return transpose().toColumnMajor().transpose();
+}
+
+/// <summary>
+/// The same matrix in CSC storage, by a counting sort of the non-zeros by column when converting from CSR.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order>
+SparseMatrixX<scalarType, StorageOrder::ColumnMajor> SparseMatrixX<scalarType, order>::toColumnMajor() const
+{
+	if constexpr (!isRowMajor)
+		return *this;
+	else
+	{
+		std::vector<int> colStart(static_cast<std::size_t>(_cols) + 1, 0);
+		for (int j : _inner)
+			++colStart[j + 1];
+		std::partial_sum(colStart.begin(), colStart.end(), colStart.begin());
+		std::vector<int> rowIndices(_inner.size());
+		std::vector<scalarType> values(_values.size());
+		std::vector<int> next(colStart.begin(), colStart.end() - 1);
+		for (int i{}; i < _rows; ++i)
+			for (int p{ _outerStart[i] }; p < _outerStart[i + 1]; ++p)
+			{
+				const int q{ next[_inner[p]]++ };
+				rowIndices[q] = i;
+				values[q] = _values[p];
+			}
+		return SparseMatrixX<scalarType, StorageOrder::ColumnMajor>{ _rows, _cols, std::move(colStart), std::move(rowIndices), std::move(values) };
+	}
+}
+
+/// <summary>
+/// Sparse times dense, \f$AX\f$. A CSR matrix computes the rows of the product in parallel, each as a sum
+/// of rows of X; a CSC matrix splits the columns of X across threads and adds the rows of X into the rows
+/// of the product column by column. Either way the product costs O(nnz) per column of X.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="A"></param>
+/// <param name="X"></param>
+/// <returns></returns>
+template<typename scalarType, StorageOrder order, typename Allocator>
+MatrixX<scalarType, Allocator> operator*(const SparseMatrixX<scalarType, order>& A, const MatrixX<scalarType, Allocator>& X)
+{
+	if (A.cols() != X.rows())
+		throw std::logic_error("Error multiplying the matrices; the number of cols(A) must equal the number of rows(B)!");
+
+	const int k{ X.cols() };
+	MatrixX<scalarType, Allocator> result{ A.rows(), k };
+	if (k == 1)
+	{
+		A.multiply(X.data(), result.data());
+		return result;
+	}
+
+	const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+	const int* outerStart{ A.outerStart() };
+	const int* inner{ A.innerIndices() };
+	const scalarType* values{ A.values() };
+	const scalarType* x{ X.data() };
+	scalarType* r{ result.data() };
+	if constexpr (SparseMatrixX<scalarType, order>::isRowMajor)
+	{
+		const long long perRow{ (A.rows() > 0 ? A.nonZeros() / A.rows() + 1 : 1) * static_cast<long long>(k) };
+		parallelFor(0, A.rows(), internal::sparseGrain(perRow), [&](int first, int last) {
+			for (int i{ first }; i < last; ++i)
+				for (int p{ outerStart[i] }; p < outerStart[i + 1]; ++p)
+					kernels.axpy(values[p], x + static_cast<long long>(inner[p]) * k, r + static_cast<long long>(i) * k, k);
+		});
+	}
+	else
+	{
+		parallelFor(0, k, internal::sparseGrain(A.nonZeros()), [&](int first, int last) {
+			for (int j{}; j < A.cols(); ++j)
+				for (int p{ outerStart[j] }; p < outerStart[j + 1]; ++p)
+					kernels.axpy(values[p], x + static_cast<long long>(j) * k + first, r + static_cast<long long>(inner[p]) * k + first, last - first);
+		});
+	}
+	return result;
+}
+
+/// <summary>
+/// Dense times sparse, \f$XA\f$, computed row by row of X in parallel. With a CSR matrix each row of the
+/// product is a sum of rows of A; with a CSC matrix each coefficient is a sparse dot product.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="X"></param>
+/// <param name="A"></param>
+/// <returns></returns>
+template<typename scalarType, typename Allocator, StorageOrder order>
+MatrixX<scalarType, Allocator> operator*(const MatrixX<scalarType, Allocator>& X, const SparseMatrixX<scalarType, order>& A)
+{
+	if (X.cols() != A.rows())
+		throw std::logic_error("Error multiplying the matrices; the number of cols(A) must equal the number of rows(B)!");
+
+	const int n{ X.cols() };
+	const int p{ A.cols() };
+	MatrixX<scalarType, Allocator> result{ X.rows(), p };
+	const int* outerStart{ A.outerStart() };
+	const int* inner{ A.innerIndices() };
+	const scalarType* values{ A.values() };
+	const scalarType* x{ X.data() };
+	scalarType* r{ result.data() };
+	parallelFor(0, X.rows(), internal::sparseGrain(A.nonZeros() + n), [&](int first, int last) {
+		for (int i{ first }; i < last; ++i)
+		{
+			const scalarType* xi{ x + static_cast<long long>(i) * n };
+			scalarType* ri{ r + static_cast<long long>(i) * p };
+			if constexpr (SparseMatrixX<scalarType, order>::isRowMajor)
+			{
+				for (int l{}; l < n; ++l)
+					if (xi[l] != scalarType{})
+						for (int q{ outerStart[l] }; q < outerStart[l + 1]; ++q)
+							ri[inner[q]] += xi[l] * values[q];
+			}
+			else
+			{
+				for (int j{}; j < p; ++j)
+				{
+					scalarType sum{};
+					for (int q{ outerStart[j] }; q < outerStart[j + 1]; ++q)
+						sum += xi[inner[q]] * values[q];
+					ri[j] = sum;
+				}
+			}
+		}
+	});
+	return result;
+}
+
+#endif // !SPARSE_MATRIX_X_H
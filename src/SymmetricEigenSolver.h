@@ -0,0 +1,633 @@
+#pragma once
+#ifndef SYMMETRIC_EIGEN_SOLVER_H
+#define SYMMETRIC_EIGEN_SOLVER_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "Gemm.h"
+#include "Householder.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "Transpose.h"
+#include "MatrixX.h"
+
+/// Eigenvalues and eigenvectors of symmetric matrices.
+//
+/// ``SymmetricEigenSolver`` computes the decomposition \f$A = Z\Lambda Z^T\f$ of a symmetric matrix, with
+/// \f$\Lambda\f$ the diagonal matrix of the (real) eigenvalues and Z the orthogonal matrix whose columns are
+/// the eigenvectors, as needed for principal component analysis of covariance matrices. It proceeds in
+/// three steps:
+///
+/// - Householder reflectors reduce A to a symmetric tridiagonal matrix, \f$A = QTQ^T\f$. The reduction is
+///   blocked: the reflectors of a panel of ``eigenBlockSize`` columns are computed against the trailing
+///   matrix updated only implicitly, and the trailing matrix then receives the rank-2k update
+///   \f$A_{22} := A_{22} - VW^T - WV^T\f$ through ``gemm``. The other half of the work is one symmetric
+///   matrix-vector product per column. Only the lower triangle is read and updated, which halves both.
+/// - The implicit QL algorithm with Wilkinson shifts diagonalizes T, \f$T = S\Lambda S^T\f$. The plane
+///   rotations of each sweep are applied to the rows of \f$S^T\f$, which are contiguous, split across threads
+///   by columns. Without eigenvectors this step costs \f$O(n^2)\f$.
+/// - The eigenvectors \f$Z = QS\f$ are formed by applying the reflectors to S in blocks, in compact WY form.
+///
+/// ``computeLargest()`` finds only the k largest eigenpairs, which is what PCA of a yield curve needs (the
+/// level, slope and curvature factors): all the eigenvalues of T cost \f$O(n^2)\f$ without the rotations,
+/// the k eigenvectors of T follow by inverse iteration at \f$O(n)\f$ each (reorthogonalized within clusters of
+/// close eigenvalues), and only those k vectors are transformed back by Q. Beyond the reduction to
+/// tridiagonal form, the cost is then \f$O(n^2k)\f$ rather than \f$O(n^3)\f$.
+///
+/// ```
+/// SymmetricEigenSolver<double> pca;
+/// pca.computeLargest(covariance, 3);
+/// const MatrixXd& variances{ pca.eigenvalues() };	// 3 x 1, decreasing
+/// const MatrixXd& factors{ pca.eigenvectors() };	// n x 3, one loading vector per column
+/// ```
+
+namespace internal
+{
+	/// <summary>
+	/// Width of the column panels of the blocked tridiagonal reduction, and number of reflectors per block
+	/// when forming the eigenvectors.
+	/// </summary>
+	constexpr int eigenBlockSize{ 32 };
+
+	/// <summary>
+	/// \f$y = Ax\f$ for the symmetric m x m matrix whose lower triangle is ``a``, reading each coefficient once:
+	/// row r contributes a dot product to \f$y_r\f$ and an axpy to \f$y_0, \ldots, y_{r-1}\f$. With several
+	/// threads, the rows are split into bands of equal area, each accumulating into its own part of ``work``.
+	/// </summary>
+	template<typename scalarType>
+	void symmetricLowerProduct(int m, const scalarType* a, int lda, const scalarType* x, scalarType* y, std::vector<scalarType>& work)
+	{
+		const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+		auto band = [&](int first, int last, scalarType* out) {
+			std::fill(out, out + last, scalarType{});
+			for (int r{ first }; r < last; ++r)
+			{
+				const scalarType* row{ a + static_cast<std::size_t>(r) * lda };
+				out[r] += kernels.dot(row, x, r) + row[r] * x[r];
+				kernels.axpy(x[r], row, out, r);
+			}
+		};
+		const long long area{ static_cast<long long>(m) * m / 2 };
+		const int parts{ static_cast<int>(std::max(1LL, std::min(static_cast<long long>(threadCount()), area / std::max(1, grainSize())))) };
+		if (parts == 1)
+		{
+			band(0, m, y);
+			return;
+		}
+
+		work.resize(static_cast<std::size_t>(parts) * m);
+		auto boundary = [&](int part) { return static_cast<int>(m * std::sqrt(static_cast<double>(part) / parts)); };
+		parallelFor(0, parts, 1, [&](int first, int last) {
+			for (int part{ first }; part < last; ++part)
+				band(boundary(part), boundary(part + 1), work.data() + static_cast<std::size_t>(part) * m);
+		});
+		std::fill(y, y + m, scalarType{});
+		for (int part{}; part < parts; ++part)
+			kernels.axpy(scalarType{ 1 }, work.data() + static_cast<std::size_t>(part) * m, y, boundary(part + 1));
+	}
+
+	/// <summary>
+	/// Reduce the symmetric n x n matrix whose lower triangle is ``a`` to the tridiagonal matrix with diagonal
+	/// ``d`` and sub-diagonal ``e`` (``e[i]`` couples i and i + 1), \f$A = QTQ^T\f$. The reflector
+	/// \f$H_j = I - \tau_j v_jv_j^T\f$, j < n - 2, acts on the coordinates j + 1 to n - 1; its vector is left
+	/// in column j of ``a`` below the sub-diagonal, with an implicit unit entry on the sub-diagonal. The upper
+	/// triangle is neither read nor kept up to date.
+	/// </summary>
+	template<typename scalarType>
+	void tridiagonalize(int n, scalarType* a, int lda, scalarType* d, scalarType* e, scalarType* tau)
+	{
+		const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+		const int nb{ eigenBlockSize };
+		std::vector<scalarType> vt(static_cast<std::size_t>(nb) * n);	// row l: v of the l-th panel column, rows k + 1 to n - 1
+		std::vector<scalarType> wt(static_cast<std::size_t>(nb) * n);
+		std::vector<scalarType> v(static_cast<std::size_t>(n) * nb);
+		std::vector<scalarType> w(static_cast<std::size_t>(n) * nb);
+		std::vector<scalarType> work;
+		for (int k{}; k < n; k += nb)
+		{
+			const int jb{ std::min(nb, n - k) };
+			const int mp{ n - k - 1 };
+			for (int i{}; i < jb; ++i)
+			{
+				const int j{ k + i };
+
+				// Column j of the trailing matrix, updated by the previous reflectors of the panel.
+				if (i > 0)
+				{
+					const int q{ j - k - 1 };
+					for (int r{ j }; r < n; ++r)
+					{
+						scalarType sum{};
+						for (int l{}; l < i; ++l)
+							sum += vt[l * mp + r - k - 1] * wt[l * mp + q] + wt[l * mp + r - k - 1] * vt[l * mp + q];
+						a[static_cast<std::size_t>(r) * lda + j] -= sum;
+					}
+				}
+				d[j] = a[static_cast<std::size_t>(j) * lda + j];
+				const int m{ n - j - 1 };
+				if (m == 0)
+					break;
+
+				scalarType* x{ a + static_cast<std::size_t>(j + 1) * lda + j };
+				e[j] = householder(m, x, lda, tau[j]);
+				scalarType* vi{ vt.data() + static_cast<std::size_t>(i) * mp };
+				scalarType* wi{ wt.data() + static_cast<std::size_t>(i) * mp };
+				std::fill(vi, vi + i, scalarType{});
+				std::fill(wi, wi + i, scalarType{});
+				vi += i;
+				wi += i;
+				vi[0] = scalarType{ 1 };
+				for (int r{ 1 }; r < m; ++r)
+					vi[r] = x[static_cast<std::size_t>(r) * lda];
+				if (tau[j] == scalarType{})
+				{
+					std::fill(wi, wi + m, scalarType{});
+					continue;
+				}
+
+				// w = tau (A22 v - V W^T v - W V^T v), with A22 not yet updated by the panel.
+				symmetricLowerProduct(m, a + static_cast<std::size_t>(j + 1) * lda + j + 1, lda, vi, wi, work);
+				for (int l{}; l < i; ++l)
+				{
+					const scalarType* vl{ vt.data() + static_cast<std::size_t>(l) * mp + i };
+					const scalarType* wl{ wt.data() + static_cast<std::size_t>(l) * mp + i };
+					const scalarType wv{ kernels.dot(wl, vi, m) };
+					const scalarType vv{ kernels.dot(vl, vi, m) };
+					kernels.axpy(-wv, vl, wi, m);
+					kernels.axpy(-vv, wl, wi, m);
+				}
+				kernels.scale(wi, tau[j], wi, m);
+				kernels.axpy(-scalarType{ 0.5 } * tau[j] * kernels.dot(wi, vi, m), vi, wi, m);
+			}
+
+			// A22 := A22 - V W^T - W V^T on the lower triangle past the panel, in block rows up to the diagonal.
+			const int m2{ n - k - jb };
+			if (m2 > 0)
+			{
+				const int offset{ jb - 1 };
+				transposeCopy(jb, m2, vt.data() + offset, mp, v.data(), jb);
+				transposeCopy(jb, m2, wt.data() + offset, mp, w.data(), jb);
+				scalarType* a22{ a + static_cast<std::size_t>(k + jb) * lda + k + jb };
+				for (int r0{}; r0 < m2; r0 += 2 * nb)
+				{
+					const int r1{ std::min(m2, r0 + 2 * nb) };
+					scalarType* c{ a22 + static_cast<std::size_t>(r0) * lda };
+					gemm(r1 - r0, r1, jb, scalarType{ -1 }, v.data() + r0 * jb, jb, wt.data() + offset, mp, scalarType{ 1 }, c, lda);
+					gemm(r1 - r0, r1, jb, scalarType{ -1 }, w.data() + r0 * jb, jb, vt.data() + offset, mp, scalarType{ 1 }, c, lda);
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Apply the rotations of one QL sweep, \f$(c_i, s_i)\f$ for i from ``first`` down to ``last``, to the rows
+	/// i and i + 1 of the n-column matrix ``zt``, in parallel over blocks of columns.
+	/// </summary>
+	template<typename scalarType>
+	void applyRotations(int n, const scalarType* c, const scalarType* s, int first, int last, scalarType* zt, int ldz)
+	{
+		const int rotations{ first - last + 1 };
+		parallelFor(0, n, std::max(64, grainSize() / std::max(1, 6 * rotations)), [&](int begin, int end) {
+			for (int i{ first }; i >= last; --i)
+			{
+				scalarType* zi{ zt + static_cast<std::size_t>(i) * ldz };
+				scalarType* zi1{ zi + ldz };
+				const scalarType ci{ c[i] };
+				const scalarType si{ s[i] };
+				for (int q{ begin }; q < end; ++q)
+				{
+					const scalarType f{ zi1[q] };
+					zi1[q] = si * zi[q] + ci * f;
+					zi[q] = ci * zi[q] - si * f;
+				}
+			}
+		});
+	}
+
+	/// <summary>
+	/// Diagonalize the symmetric tridiagonal matrix with diagonal ``d`` and sub-diagonal ``e`` (both of length n,
+	/// ``e[n - 1]`` unused) by the implicit QL algorithm with Wilkinson shifts, overwriting ``d`` with the
+	/// eigenvalues, unordered, and ``e`` with zeros. If ``zt`` is not null, the rotations are applied to the rows
+	/// of the n x n matrix ``zt``, so that starting from the identity row i ends as the eigenvector of ``d[i]``.
+	/// Returns false if an eigenvalue fails to converge in 30 iterations.
+	/// </summary>
+	template<typename scalarType>
+	bool tridiagonalQL(int n, scalarType* d, scalarType* e, scalarType* zt, int ldz)
+	{
+		const scalarType eps{ std::numeric_limits<scalarType>::epsilon() };
+		std::vector<scalarType> cs(zt ? n : 0);
+		std::vector<scalarType> sn(zt ? n : 0);
+		if (n > 0)
+			e[n - 1] = scalarType{};
+		for (int l{}; l < n; ++l)
+		{
+			int iterations{};
+			int m{};
+			do
+			{
+				for (m = l; m < n - 1; ++m)
+				{
+					const scalarType dd{ std::abs(d[m]) + std::abs(d[m + 1]) };
+					if (std::abs(e[m]) <= eps * dd)
+						break;
+				}
+				if (m == l)
+					break;
+				if (iterations++ == 30)
+					return false;
+
+				scalarType g{ (d[l + 1] - d[l]) / (scalarType{ 2 } * e[l]) };
+				scalarType r{ std::hypot(g, scalarType{ 1 }) };
+				g = d[m] - d[l] + e[l] / (g + std::copysign(r, g));
+				scalarType s{ 1 };
+				scalarType c{ 1 };
+				scalarType p{};
+				int i{ m - 1 };
+				for (; i >= l; --i)
+				{
+					const scalarType f{ s * e[i] };
+					const scalarType b{ c * e[i] };
+					r = std::hypot(f, g);
+					e[i + 1] = r;
+					if (r == scalarType{})
+					{
+						d[i + 1] -= p;
+						e[m] = scalarType{};
+						break;
+					}
+					s = f / r;
+					c = g / r;
+					g = d[i + 1] - p;
+					r = (d[i] - g) * s + scalarType{ 2 } * c * b;
+					p = s * r;
+					d[i + 1] = g + p;
+					g = c * r - b;
+					if (zt)
+					{
+						cs[i] = c;
+						sn[i] = s;
+					}
+				}
+				if (zt && i < m - 1)
+					applyRotations(n, cs.data(), sn.data(), m - 1, i + 1, zt, ldz);
+				if (r == scalarType{} && i >= l)
+					continue;
+				d[l] -= p;
+				e[l] = g;
+				e[m] = scalarType{};
+			} while (m != l);
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Eigenvectors of the symmetric tridiagonal matrix with diagonal ``d`` and sub-diagonal ``e`` for the k
+	/// eigenvalues ``lambda``, sorted in decreasing order, by inverse iteration: row j of the k x n matrix
+	/// ``zt`` receives the eigenvector of ``lambda[j]``. Each iteration solves \f$(T - \lambda I)y = x\f$ by
+	/// Gaussian elimination with partial pivoting. Eigenvalues closer than ``1e-3`` \f$\|T\|\f$ form a cluster,
+	/// whose vectors are orthogonalized against each other, and coincident ones are moved apart slightly.
+	/// </summary>
+	template<typename scalarType>
+	void tridiagonalInverseIteration(int n, const scalarType* d, const scalarType* e, const scalarType* lambda, int k,
+		scalarType* zt, int ldz)
+	{
+		const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+		scalarType norm{};
+		for (int i{}; i < n; ++i)
+			norm = std::max(norm, std::abs(d[i]) + (i > 0 ? std::abs(e[i - 1]) : scalarType{}) + (i + 1 < n ? std::abs(e[i]) : scalarType{}));
+		const scalarType tiny{ std::max(std::numeric_limits<scalarType>::epsilon() * norm, std::numeric_limits<scalarType>::min()) };
+		const scalarType cluster{ scalarType{ 1e-3 } * norm };
+
+		std::vector<scalarType> u0(n), u1(n), u2(n), multiplier(n);
+		std::vector<char> swapped(n);
+		int clusterStart{};
+		scalarType previous{};
+		unsigned int seed{ 12345u };
+		for (int j{}; j < k; ++j)
+		{
+			scalarType mu{ lambda[j] };
+			if (j > 0)
+			{
+				if (previous - mu > cluster)
+					clusterStart = j;
+				else if (previous - mu < scalarType{ 10 } * tiny)
+					mu = previous - scalarType{ 10 } * tiny;
+			}
+			previous = mu;
+
+			// T - mu I = PLU, with U upper triangular with two super-diagonals.
+			for (int i{}; i < n; ++i)
+			{
+				u0[i] = d[i] - mu;
+				u1[i] = i + 1 < n ? e[i] : scalarType{};
+				u2[i] = scalarType{};
+			}
+			for (int i{}; i + 1 < n; ++i)
+			{
+				const scalarType sub{ e[i] };
+				if (std::abs(u0[i]) >= std::abs(sub))
+				{
+					if (std::abs(u0[i]) < tiny)
+						u0[i] = u0[i] < scalarType{} ? -tiny : tiny;
+					multiplier[i] = sub / u0[i];
+					u0[i + 1] -= multiplier[i] * u1[i];
+					swapped[i] = 0;
+				}
+				else
+				{
+					const scalarType pivot{ u0[i] };
+					const scalarType super{ u1[i] };
+					const scalarType next{ u1[i + 1] };
+					multiplier[i] = pivot / sub;
+					u0[i] = sub;
+					u1[i] = u0[i + 1];
+					u2[i] = next;
+					u0[i + 1] = super - multiplier[i] * u1[i];
+					u1[i + 1] = -multiplier[i] * next;
+					swapped[i] = 1;
+				}
+			}
+			if (n > 0 && std::abs(u0[n - 1]) < tiny)
+				u0[n - 1] = u0[n - 1] < scalarType{} ? -tiny : tiny;
+
+			scalarType* y{ zt + static_cast<std::size_t>(j) * ldz };
+			for (int i{}; i < n; ++i)
+			{
+				seed = seed * 1103515245u + 12345u;
+				y[i] = static_cast<scalarType>((seed >> 8) & 0xFFFF) / scalarType{ 32768 } - scalarType{ 1 };
+			}
+			for (int iteration{}; iteration < 3; ++iteration)
+			{
+				for (int i{}; i + 1 < n; ++i)
+				{
+					if (swapped[i])
+						std::swap(y[i], y[i + 1]);
+					y[i + 1] -= multiplier[i] * y[i];
+				}
+				for (int i{ n - 1 }; i >= 0; --i)
+				{
+					scalarType sum{ y[i] };
+					if (i + 1 < n)
+						sum -= u1[i] * y[i + 1];
+					if (i + 2 < n)
+						sum -= u2[i] * y[i + 2];
+					y[i] = sum / u0[i];
+				}
+				for (int q{ clusterStart }; q < j; ++q)
+				{
+					const scalarType* zq{ zt + static_cast<std::size_t>(q) * ldz };
+					kernels.axpy(-kernels.dot(zq, y, n), zq, y, n);
+				}
+				const scalarType length{ std::sqrt(kernels.dot(y, y, n)) };
+				kernels.scale(y, scalarType{ 1 } / length, y, n);
+			}
+		}
+	}
+
+	/// <summary>
+	/// \f$C := QC\f$ for the n x p matrix C (rows ``p`` apart), where Q is the product of the reflectors left in
+	/// ``a`` by ``tridiagonalize()``, applied ``eigenBlockSize`` at a time from the last block to the first.
+	/// </summary>
+	template<typename scalarType>
+	void applyTridiagonalQ(int n, const scalarType* a, int lda, const scalarType* tau, scalarType* c, int p)
+	{
+		const int count{ n - 2 };
+		if (count <= 0)
+			return;
+		BlockReflector<scalarType> reflector;
+		for (int j0{ ((count - 1) / eigenBlockSize) * eigenBlockSize }; j0 >= 0; j0 -= eigenBlockSize)
+		{
+			const int jb{ std::min(eigenBlockSize, count - j0) };
+			const int m{ n - j0 - 1 };
+			reflector.compute(m, jb, a + static_cast<std::size_t>(j0 + 1) * lda + j0, lda, tau + j0);
+			reflector.apply(false, p, c + static_cast<std::size_t>(j0 + 1) * p, p);
+		}
+	}
+}
+
+/// <summary>
+/// ``SymmetricEigenSolver`` computes the eigenvalues and eigenvectors of a symmetric matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+class SymmetricEigenSolver
+{
+	static_assert(std::is_floating_point<scalarType>::value, "SymmetricEigenSolver requires a floating-point scalar type");
+private:
+	int _rows;
+	MatrixX<scalarType> _values;
+	MatrixX<scalarType> _vectors;
+	MatrixX<scalarType> _work;
+	std::vector<scalarType> _d;
+	std::vector<scalarType> _e;
+	std::vector<scalarType> _tau;
+
+	template<typename Allocator>
+	void reduce(const MatrixX<scalarType, Allocator>& a);
+public:
+	SymmetricEigenSolver();
+	template<typename Allocator>
+	explicit SymmetricEigenSolver(const MatrixX<scalarType, Allocator>& a, bool computeEigenvectors = true);
+
+	template<typename Allocator>
+	SymmetricEigenSolver& compute(const MatrixX<scalarType, Allocator>& a, bool computeEigenvectors = true);
+	template<typename Allocator>
+	SymmetricEigenSolver& computeLargest(const MatrixX<scalarType, Allocator>& a, int k);
+
+	int rows() const;
+	const MatrixX<scalarType>& eigenvalues() const;
+	const MatrixX<scalarType>& eigenvectors() const;
+};
+
+/// <summary>
+/// An empty solver, to be filled by ``compute()`` or ``computeLargest()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+SymmetricEigenSolver<scalarType>::SymmetricEigenSolver()
+	: _rows{}, _values{}, _vectors{}, _work{}, _d{}, _e{}, _tau{}
+{
+}
+
+/// <summary>
+/// The eigenvalues, and unless ``computeEigenvectors`` is false the eigenvectors, of the symmetric matrix ``a``,
+/// of which only the lower triangle is read.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="computeEigenvectors"></param>
+template<typename scalarType>
+template<typename Allocator>
+SymmetricEigenSolver<scalarType>::SymmetricEigenSolver(const MatrixX<scalarType, Allocator>& a, bool computeEigenvectors)
+	: SymmetricEigenSolver{}
+{
+	compute(a, computeEigenvectors);
+}
+
+/// <summary>
+/// Copy ``a`` to the workspace and reduce its lower triangle to tridiagonal form.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+template<typename scalarType>
+template<typename Allocator>
+void SymmetricEigenSolver<scalarType>::reduce(const MatrixX<scalarType, Allocator>& a)
+{
+	if (a.rows() != a.cols())
+		throw std::logic_error("The eigenvalue decomposition requires a square matrix!");
+
+	const int n{ a.rows() };
+	_rows = n;
+	_work.resize(n, n);
+	std::copy(a.data(), a.data() + a.size(), _work.data());
+	_d.assign(n, scalarType{});
+	_e.assign(n, scalarType{});
+	_tau.assign(n, scalarType{});
+	internal::tridiagonalize(n, _work.data(), n, _d.data(), _e.data(), _tau.data());
+}
+
+/// <summary>
+/// Decompose the symmetric matrix ``a``, of which only the lower triangle is read, replacing the previous
+/// decomposition. The eigenvalues are sorted in increasing order and column j of ``eigenvectors()`` is the
+/// unit eigenvector of the j-th. Throws ``std::logic_error`` if ``a`` is not square or if the QL iteration
+/// does not converge, which only happens for matrices with non-finite coefficients.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="computeEigenvectors">if false, only the eigenvalues are computed</param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Allocator>
+SymmetricEigenSolver<scalarType>& SymmetricEigenSolver<scalarType>::compute(const MatrixX<scalarType, Allocator>& a, bool computeEigenvectors)
+{
+	reduce(a);
+	const int n{ _rows };
+	MatrixX<scalarType> zt{};
+	if (computeEigenvectors)
+	{
+		zt.resize(n, n);
+		std::fill(zt.data(), zt.data() + zt.size(), scalarType{});
+		for (int i{}; i < n; ++i)
+			zt.coeffRef(i * n + i) = scalarType{ 1 };
+	}
+	if (!internal::tridiagonalQL(n, _d.data(), _e.data(), computeEigenvectors ? zt.data() : nullptr, n))
+		throw std::logic_error("The eigenvalue iteration did not converge!");
+
+	std::vector<int> order(n);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](int i, int j) { return _d[i] < _d[j]; });
+	_values.resize(n, 1);
+	for (int i{}; i < n; ++i)
+		_values.coeffRef(i) = _d[order[i]];
+
+	if (!computeEigenvectors)
+	{
+		_vectors.resize(0, 0);
+		return *this;
+	}
+
+	// Z = Q S, with the columns of S the rows of zt in increasing order of the eigenvalues.
+	MatrixX<scalarType> sorted{ n, n };
+	for (int i{}; i < n; ++i)
+		std::copy(zt.data() + static_cast<std::size_t>(order[i]) * n, zt.data() + static_cast<std::size_t>(order[i] + 1) * n,
+			sorted.data() + static_cast<std::size_t>(i) * n);
+	_vectors.resize(n, n);
+	transposeCopy(n, n, sorted.data(), n, _vectors.data(), n);
+	internal::applyTridiagonalQ(n, _work.data(), n, _tau.data(), _vectors.data(), n);
+	return *this;
+}
+
+/// <summary>
+/// The k largest eigenvalues of the symmetric matrix ``a`` (of which only the lower triangle is read), in
+/// decreasing order, and their eigenvectors, column j of ``eigenvectors()`` for the j-th. All the eigenvalues
+/// of the tridiagonal form are found without eigenvectors, and the k eigenvectors by inverse iteration;
+/// when k exceeds a quarter of the order, the complete decomposition is cheaper and is used instead.
+/// Throws ``std::logic_error`` if ``a`` is not square or k is not between 0 and its order.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <param name="k"></param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Allocator>
+SymmetricEigenSolver<scalarType>& SymmetricEigenSolver<scalarType>::computeLargest(const MatrixX<scalarType, Allocator>& a, int k)
+{
+	if (k < 0 || k > a.rows())
+		throw std::logic_error("The number of eigenpairs must be between 0 and the order of the matrix!");
+
+	const int n{ a.rows() };
+	if (4 * k > n)
+	{
+		compute(a, true);
+		MatrixX<scalarType> values{ k, 1 };
+		MatrixX<scalarType> vectors{ n, k };
+		for (int j{}; j < k; ++j)
+			values.coeffRef(j) = _values.coeff(n - 1 - j);
+		for (int i{}; i < n; ++i)
+			for (int j{}; j < k; ++j)
+				vectors.coeffRef(i * k + j) = _vectors.coeff(i * n + n - 1 - j);
+		_values.resize(0, 0);
+		_vectors.resize(0, 0);
+		_values = std::move(values);
+		_vectors = std::move(vectors);
+		return *this;
+	}
+
+	reduce(a);
+	std::vector<scalarType> lambda{ _d };
+	std::vector<scalarType> e{ _e };
+	if (!internal::tridiagonalQL(n, lambda.data(), e.data(), static_cast<scalarType*>(nullptr), n))
+		throw std::logic_error("The eigenvalue iteration did not converge!");
+	std::partial_sort(lambda.begin(), lambda.begin() + k, lambda.end(), [](scalarType x, scalarType y) { return x > y; });
+	_values.resize(k, 1);
+	std::copy(lambda.begin(), lambda.begin() + k, _values.data());
+
+	MatrixX<scalarType> zt{ k, n };
+	internal::tridiagonalInverseIteration(n, _d.data(), _e.data(), lambda.data(), k, zt.data(), n);
+	_vectors.resize(n, k);
+	transposeCopy(k, n, zt.data(), n, _vectors.data(), k);
+	internal::applyTridiagonalQ(n, _work.data(), n, _tau.data(), _vectors.data(), k);
+	return *this;
+}
+
+/// <summary>
+/// The order of the decomposed matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int SymmetricEigenSolver<scalarType>::rows() const
+{
+	return _rows;
+}
+
+/// <summary>
+/// The eigenvalues as a column vector: all of them in increasing order after ``compute()``, the k largest in
+/// decreasing order after ``computeLargest()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const MatrixX<scalarType>& SymmetricEigenSolver<scalarType>::eigenvalues() const
+{
+	return _values;
+}
+
+/// <summary>
+/// The unit eigenvectors, one column per eigenvalue in the order of ``eigenvalues()``; empty if
+/// ``compute()`` was asked for the eigenvalues only.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const MatrixX<scalarType>& SymmetricEigenSolver<scalarType>::eigenvectors() const
+{
+	return _vectors;
+}
+
+#endif // !SYMMETRIC_EIGEN_SOLVER_H
@@ -0,0 +1,438 @@
+#pragma once
+#ifndef ThreadPool_H
+#define ThreadPool_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// A work-stealing thread pool for data-parallel loops.
+//
+/// ``parallelFor(begin, end, grain, fn)`` splits the index range ``[begin, end)`` into chunks of
+/// ``grain`` indices and calls ``fn(chunkBegin, chunkEnd)`` for each chunk, on the calling thread and
+/// on the worker threads of the pool. Every worker owns a double-ended queue of chunks: it takes
+/// work from the back of its own queue and, once that is empty, steals from the front of the
+/// queues of the other workers. The calling thread works on chunks too while it waits, so loops may
+/// be nested (a parallel GEMM inside a parallel loop) without deadlocking the pool. The queues are
+/// rings of fixed capacity allocated with the pool, so that a parallel loop never allocates; a chunk
+/// that finds its queue full runs on the calling thread instead.
+///
+/// The library-wide pool is sized with ``setThreadCount()`` and defaults to the number of hardware
+/// threads. With a single thread, ``parallelFor`` runs the loop inline and never touches the pool.
+///
+/// ```
+/// setThreadCount(8);
+/// parallelFor(0, m.rows(), 64, [&](int first, int last) {
+///		for (int i{ first }; i < last; ++i)
+///			process(i);
+/// });
+/// ```
+
+class ThreadPool
+{
+private:
+	/// <summary>
+	/// A chunk of a parallel loop. ``run`` is a type-erased trampoline into the loop body held by ``context``.
+	/// </summary>
+	struct Task
+	{
+		void (*run)(void* context, int begin, int end);
+		void* context;
+		int begin;
+		int end;
+	};
+
+	/// <summary>
+	/// A double-ended ring of tasks, guarded by ``mutex``.
+	/// </summary>
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::array<Task, 1024> tasks;
+		std::size_t head{};		// index of the front task
+		std::size_t count{};
+
+		bool pushBack(const Task& task)
+		{
+			if (count == tasks.size())
+				return false;
+			tasks[(head + count) % tasks.size()] = task;
+			++count;
+			return true;
+		}
+
+		bool popBack(Task& task)
+		{
+			if (count == 0)
+				return false;
+			--count;
+			task = tasks[(head + count) % tasks.size()];
+			return true;
+		}
+
+		bool popFront(Task& task)
+		{
+			if (count == 0)
+				return false;
+			task = tasks[head];
+			head = (head + 1) % tasks.size();
+			--count;
+			return true;
+		}
+	};
+
+	/// <summary>
+	/// Shared state of one ``parallelFor`` call. Lives on the stack of the calling thread, which does
+	/// not return before ``remaining`` has dropped to zero.
+	/// </summary>
+	template<typename F>
+	struct Job
+	{
+		F& body;
+		std::atomic<int> remaining;
+		std::atomic<bool> failed{ false };
+		std::exception_ptr error;
+		std::mutex errorMutex;
+
+		Job(F& f, int chunks) : body{ f }, remaining{ chunks } {}
+
+		static void run(void* context, int begin, int end)
+		{
+			Job& job{ *static_cast<Job*>(context) };
+			try
+			{
+				if (!job.failed.load(std::memory_order_relaxed))
+					job.body(begin, end);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock{ job.errorMutex };
+				if (!job.error)
+					job.error = std::current_exception();
+				job.failed.store(true, std::memory_order_relaxed);
+			}
+			// Last access to the job: the owner may return as soon as this reaches zero.
+			job.remaining.fetch_sub(1, std::memory_order_acq_rel);
+		}
+	};
+
+	std::vector<std::unique_ptr<WorkQueue>> _queues;
+	std::vector<std::thread> _workers;
+	std::atomic<int> _pending{ 0 };
+	std::atomic<unsigned> _nextQueue{ 0 };
+	std::mutex _sleepMutex;
+	std::condition_variable _wake;
+	bool _stop{ false };
+
+	/// <summary>
+	/// The pool whose worker runs on this thread, and its index there. A thread is the worker of at most one
+	/// pool: ``workerLoop`` sets the slot once, and the loops of other pools that the worker runs leave it alone.
+	/// </summary>
+	struct WorkerSlot
+	{
+		const ThreadPool* pool;
+		int index;
+	};
+
+	static WorkerSlot& workerSlot()
+	{
+		thread_local WorkerSlot slot{ nullptr, -1 };
+		return slot;
+	}
+
+	/// <summary>
+	/// Queue a task, or return false if the queue is full.
+	/// </summary>
+	bool push(const Task& task, int queue)
+	{
+		WorkQueue& q{ *_queues[queue] };
+		std::lock_guard<std::mutex> lock{ q.mutex };
+		if (!q.pushBack(task))
+			return false;
+		_pending.fetch_add(1, std::memory_order_release);
+		return true;
+	}
+
+	/// <summary>
+	/// Take a task: from the back of queue ``own`` first (the most recently pushed, still hot in cache),
+	/// then from the front of every other queue.
+	/// </summary>
+	bool tryPop(int own, Task& task)
+	{
+		const int queues{ static_cast<int>(_queues.size()) };
+		if (own >= 0)
+		{
+			WorkQueue& q{ *_queues[own] };
+			std::lock_guard<std::mutex> lock{ q.mutex };
+			if (q.popBack(task))
+			{
+				_pending.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		const int start{ own >= 0 ? own + 1 : 0 };
+		for (int offset{}; offset < queues; ++offset)
+		{
+			const int victim{ (start + offset) % queues };
+			if (victim == own)
+				continue;
+			WorkQueue& q{ *_queues[victim] };
+			std::lock_guard<std::mutex> lock{ q.mutex };
+			if (q.popFront(task))
+			{
+				_pending.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void workerLoop(int index)
+	{
+		workerSlot() = WorkerSlot{ this, index };
+		Task task{};
+		for (;;)
+		{
+			if (tryPop(index, task))
+			{
+				task.run(task.context, task.begin, task.end);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock{ _sleepMutex };
+			_wake.wait(lock, [this] { return _stop || _pending.load(std::memory_order_acquire) > 0; });
+			if (_stop && _pending.load(std::memory_order_acquire) == 0)
+				return;
+		}
+	}
+
+public:
+	/// <summary>
+	/// Create a pool that runs parallel loops on ``threads`` threads: the calling thread plus
+	/// ``threads - 1`` workers. A non-positive count selects the number of hardware threads.
+	/// </summary>
+	/// <param name="threads"></param>
+	explicit ThreadPool(int threads)
+	{
+		if (threads <= 0)
+			threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+		for (int i{}; i < threads - 1; ++i)
+			_queues.push_back(std::make_unique<WorkQueue>());
+		for (int i{}; i < threads - 1; ++i)
+			_workers.emplace_back([this, i] { workerLoop(i); });
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ _sleepMutex };
+			_stop = true;
+		}
+		_wake.notify_all();
+		for (std::thread& worker : _workers)
+			worker.join();
+	}
+
+	/// <summary>
+	/// Number of threads that execute parallel loops, including the calling thread.
+	/// </summary>
+	/// <returns></returns>
+	int threadCount() const
+	{
+		return static_cast<int>(_workers.size()) + 1;
+	}
+
+	/// <summary>
+	/// Index of the calling thread among the workers of this pool, or -1 for any other thread.
+	/// </summary>
+	/// <returns></returns>
+	int workerIndex() const
+	{
+		const WorkerSlot& slot{ workerSlot() };
+		return slot.pool == this ? slot.index : -1;
+	}
+
+	/// <summary>
+	/// Call ``fn(chunkBegin, chunkEnd)`` for consecutive chunks of at most ``grain`` indices covering
+	/// ``[begin, end)``, in parallel, and return once all of them have completed. Chunks must not
+	/// depend on each other. If any chunk throws, the chunks that have not started yet are skipped
+	/// and the first exception is rethrown on the calling thread.
+	/// </summary>
+	/// <param name="begin"></param>
+	/// <param name="end"></param>
+	/// <param name="grain">Smallest number of indices worth running as a separate task</param>
+	/// <param name="fn"></param>
+	template<typename F>
+	void parallelFor(int begin, int end, int grain, F&& fn)
+	{
+		if (end <= begin)
+			return;
+		grain = std::max(grain, 1);
+		const int chunks{ (end - begin - 1) / grain + 1 };
+		if (_workers.empty() || chunks == 1)
+		{
+			fn(begin, end);
+			return;
+		}
+
+		Job<F> job{ fn, chunks };
+		const int own{ workerIndex() };
+		const int queues{ static_cast<int>(_queues.size()) };
+		unsigned next{ _nextQueue.fetch_add(1, std::memory_order_relaxed) };
+		for (int c{ 1 }; c < chunks; ++c)
+		{
+			const int chunkBegin{ begin + c * grain };
+			const int chunkEnd{ std::min(end, chunkBegin + grain) };
+			// Workers keep nested loops local; other threads deal their chunks out round-robin.
+			const int queue{ own >= 0 ? own : static_cast<int>(next++ % queues) };
+			if (!push(Task{ &Job<F>::run, &job, chunkBegin, chunkEnd }, queue))
+				Job<F>::run(&job, chunkBegin, chunkEnd);
+		}
+		{
+			std::lock_guard<std::mutex> lock{ _sleepMutex };
+		}
+		_wake.notify_all();
+
+		Job<F>::run(&job, begin, std::min(end, begin + grain));
+
+		Task task{};
+		while (job.remaining.load(std::memory_order_acquire) > 0)
+		{
+			if (tryPop(own, task))
+				task.run(task.context, task.begin, task.end);
+			else
+				std::this_thread::yield();
+		}
+
+		if (job.error)
+			std::rethrow_exception(job.error);
+	}
+};
+
+namespace internal
+{
+	inline std::unique_ptr<ThreadPool>& globalThreadPool()
+	{
+		static std::unique_ptr<ThreadPool> pool{ std::make_unique<ThreadPool>(0) };
+		return pool;
+	}
+
+	inline std::atomic<int>& globalGrainSize()
+	{
+		static std::atomic<int> grain{ 1 << 15 };
+		return grain;
+	}
+}
+
+/// <summary>
+/// The library-wide pool used by the parallel matrix operations.
+/// </summary>
+/// <returns></returns>
+inline ThreadPool& threadPool()
+{
+	return *internal::globalThreadPool();
+}
+
+/// <summary>
+/// Number of threads used by the parallel matrix operations.
+/// </summary>
+/// <returns></returns>
+inline int threadCount()
+{
+	return threadPool().threadCount();
+}
+
+/// <summary>
+/// Resize the library-wide pool to ``threads`` threads; a non-positive count selects the number of
+/// hardware threads and 1 disables multithreading. Must not be called while a parallel operation is running.
+/// </summary>
+/// <param name="threads"></param>
+inline void setThreadCount(int threads)
+{
+	std::unique_ptr<ThreadPool>& pool{ internal::globalThreadPool() };
+	pool.reset();
+	pool = std::make_unique<ThreadPool>(threads);
+}
+
+/// <summary>
+/// Number of coefficients per task in the parallel element-wise operations and reductions.
+/// Smaller operations run on the calling thread alone.
+/// </summary>
+/// <returns></returns>
+inline int grainSize()
+{
+	return internal::globalGrainSize().load(std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Set the number of coefficients per task in the parallel element-wise operations and reductions.
+/// </summary>
+/// <param name="grain"></param>
+inline void setGrainSize(int grain)
+{
+	internal::globalGrainSize().store(std::max(grain, 1), std::memory_order_relaxed);
+}
+
+/// <summary>
+/// ``parallelFor`` on the library-wide pool.
+/// </summary>
+template<typename F>
+void parallelFor(int begin, int end, int grain, F&& fn)
+{
+	threadPool().parallelFor(begin, end, grain, std::forward<F>(fn));
+}
+
+/// <summary>
+/// Parallel reduction over ``[begin, end)``. ``map(chunkBegin, chunkEnd)`` reduces one chunk of at most
+/// ``grain`` indices, and the partial results are folded with ``combine`` in index order, starting from
+/// ``identity``. Chunk boundaries depend on ``grain`` only, so the result is the same bit for bit
+/// whatever the number of threads. The chunks are reduced in batches of a few per thread, whose partial
+/// results are kept on the stack, so that a reduction does not allocate.
+/// </summary>
+template<typename T, typename Map, typename Combine>
+T parallelReduce(int begin, int end, int grain, T identity, Map map, Combine combine)
+{
+	if (end <= begin)
+		return identity;
+	grain = std::max(grain, 1);
+	const int chunks{ (end - begin - 1) / grain + 1 };
+
+	T result{ identity };
+	if (chunks == 1 || threadCount() == 1)
+	{
+		for (int c{}; c < chunks; ++c)
+			result = combine(result, map(begin + c * grain, std::min(end, begin + (c + 1) * grain)));
+		return result;
+	}
+
+	std::array<T, 64> partial{};
+	const int batch{ std::min(static_cast<int>(partial.size()), 4 * threadCount()) };
+	for (int first{}; first < chunks; first += batch)
+	{
+		const int count{ std::min(batch, chunks - first) };
+		parallelFor(0, count, 1, [&](int batchFirst, int batchLast) {
+			for (int c{ batchFirst }; c < batchLast; ++c)
+			{
+				const int chunk{ first + c };
+				partial[c] = map(begin + chunk * grain, std::min(end, begin + (chunk + 1) * grain));
+			}
+		});
+		for (int c{}; c < count; ++c)
+			result = combine(result, partial[c]);
+	}
+	return result;
+}
+
+#endif // !ThreadPool_H
@@ -0,0 +1,334 @@
+#pragma once
+#ifndef Transpose_H
+#define Transpose_H
+
+#include <algorithm>
+#include <type_traits>
+#include "Simd.h"
+#include "ThreadPool.h"
+
+/// Cache-friendly matrix transposition.
+//
+/// A naive transpose reads one matrix along its rows and writes the other along its columns, so every
+/// store of a large matrix touches a different cache line and, every few rows, a different page.
+/// ``transposeCopy`` instead splits the matrix recursively along its longer dimension until a tile fits
+/// in the L1 cache (a cache-oblivious traversal, so no tuning for a particular cache size is needed),
+/// and transposes each tile with in-register micro-transposes: 4x4 blocks with SSE2 and 8x8 (float,
+/// int) or 4x4 (double) blocks with AVX2, selected at runtime like the kernels of Simd.h.
+///
+/// ``transposeSquareInPlace`` transposes a square matrix without a second buffer by exchanging
+/// mirrored pairs of tiles through a small stack buffer.
+///
+/// Both routines address the matrices through raw pointers and leading dimensions, like ``gemm``.
+
+namespace internal
+{
+	/// <summary>
+	/// Portable micro-transpose: a single coefficient.
+	/// </summary>
+	namespace scalar
+	{
+		template<typename T>
+		struct TransposeMicro
+		{
+			static constexpr int size = 1;
+			static void transpose(const T* src, int, T* dst, int) { *dst = *src; }
+		};
+
+#include "TransposeKernels.inl"
+	}
+
+#ifdef MATHLIB_X86
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+	namespace sse2
+	{
+		template<typename T>
+		struct TransposeMicro;
+
+		template<>
+		struct TransposeMicro<float>
+		{
+			static constexpr int size = 4;
+			static void transpose(const float* src, int lds, float* dst, int ldd)
+			{
+				__m128 r0{ _mm_loadu_ps(src) };
+				__m128 r1{ _mm_loadu_ps(src + lds) };
+				__m128 r2{ _mm_loadu_ps(src + 2 * lds) };
+				__m128 r3{ _mm_loadu_ps(src + 3 * lds) };
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+				_mm_storeu_ps(dst, r0);
+				_mm_storeu_ps(dst + ldd, r1);
+				_mm_storeu_ps(dst + 2 * ldd, r2);
+				_mm_storeu_ps(dst + 3 * ldd, r3);
+			}
+		};
+
+		template<>
+		struct TransposeMicro<double>
+		{
+			static constexpr int size = 2;
+			static void transpose(const double* src, int lds, double* dst, int ldd)
+			{
+				const __m128d r0{ _mm_loadu_pd(src) };
+				const __m128d r1{ _mm_loadu_pd(src + lds) };
+				_mm_storeu_pd(dst, _mm_unpacklo_pd(r0, r1));
+				_mm_storeu_pd(dst + ldd, _mm_unpackhi_pd(r0, r1));
+			}
+		};
+
+		template<>
+		struct TransposeMicro<int>
+		{
+			static constexpr int size = 4;
+			static void transpose(const int* src, int lds, int* dst, int ldd)
+			{
+				// The shuffles only move bits, so 32-bit integers are transposed as floats.
+				__m128 r0{ _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))) };
+				__m128 r1{ _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + lds))) };
+				__m128 r2{ _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * lds))) };
+				__m128 r3{ _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * lds))) };
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_castps_si128(r0));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + ldd), _mm_castps_si128(r1));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * ldd), _mm_castps_si128(r2));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3 * ldd), _mm_castps_si128(r3));
+			}
+		};
+
+#include "TransposeKernels.inl"
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+	namespace avx2
+	{
+		/// <summary>
+		/// In-register transpose of eight rows of eight floats.
+		/// </summary>
+		inline void transpose8x8(__m256& r0, __m256& r1, __m256& r2, __m256& r3, __m256& r4, __m256& r5, __m256& r6, __m256& r7)
+		{
+			const __m256 t0{ _mm256_unpacklo_ps(r0, r1) };
+			const __m256 t1{ _mm256_unpackhi_ps(r0, r1) };
+			const __m256 t2{ _mm256_unpacklo_ps(r2, r3) };
+			const __m256 t3{ _mm256_unpackhi_ps(r2, r3) };
+			const __m256 t4{ _mm256_unpacklo_ps(r4, r5) };
+			const __m256 t5{ _mm256_unpackhi_ps(r4, r5) };
+			const __m256 t6{ _mm256_unpacklo_ps(r6, r7) };
+			const __m256 t7{ _mm256_unpackhi_ps(r6, r7) };
+			const __m256 s0{ _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)) };
+			const __m256 s1{ _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)) };
+			const __m256 s2{ _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)) };
+			const __m256 s3{ _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2)) };
+			const __m256 s4{ _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0)) };
+			const __m256 s5{ _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2)) };
+			const __m256 s6{ _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0)) };
+			const __m256 s7{ _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2)) };
+			r0 = _mm256_permute2f128_ps(s0, s4, 0x20);
+			r1 = _mm256_permute2f128_ps(s1, s5, 0x20);
+			r2 = _mm256_permute2f128_ps(s2, s6, 0x20);
+			r3 = _mm256_permute2f128_ps(s3, s7, 0x20);
+			r4 = _mm256_permute2f128_ps(s0, s4, 0x31);
+			r5 = _mm256_permute2f128_ps(s1, s5, 0x31);
+			r6 = _mm256_permute2f128_ps(s2, s6, 0x31);
+			r7 = _mm256_permute2f128_ps(s3, s7, 0x31);
+		}
+
+		template<typename T>
+		struct TransposeMicro;
+
+		template<>
+		struct TransposeMicro<float>
+		{
+			static constexpr int size = 8;
+			static void transpose(const float* src, int lds, float* dst, int ldd)
+			{
+				__m256 r[8];
+				for (int k{}; k < 8; ++k)
+					r[k] = _mm256_loadu_ps(src + k * lds);
+				transpose8x8(r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7]);
+				for (int k{}; k < 8; ++k)
+					_mm256_storeu_ps(dst + k * ldd, r[k]);
+			}
+		};
+
+		template<>
+		struct TransposeMicro<double>
+		{
+			static constexpr int size = 4;
+			static void transpose(const double* src, int lds, double* dst, int ldd)
+			{
+				const __m256d r0{ _mm256_loadu_pd(src) };
+				const __m256d r1{ _mm256_loadu_pd(src + lds) };
+				const __m256d r2{ _mm256_loadu_pd(src + 2 * lds) };
+				const __m256d r3{ _mm256_loadu_pd(src + 3 * lds) };
+				const __m256d t0{ _mm256_unpacklo_pd(r0, r1) };
+				const __m256d t1{ _mm256_unpackhi_pd(r0, r1) };
+				const __m256d t2{ _mm256_unpacklo_pd(r2, r3) };
+				const __m256d t3{ _mm256_unpackhi_pd(r2, r3) };
+				_mm256_storeu_pd(dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+				_mm256_storeu_pd(dst + ldd, _mm256_permute2f128_pd(t1, t3, 0x20));
+				_mm256_storeu_pd(dst + 2 * ldd, _mm256_permute2f128_pd(t0, t2, 0x31));
+				_mm256_storeu_pd(dst + 3 * ldd, _mm256_permute2f128_pd(t1, t3, 0x31));
+			}
+		};
+
+		template<>
+		struct TransposeMicro<int>
+		{
+			static constexpr int size = 8;
+			static void transpose(const int* src, int lds, int* dst, int ldd)
+			{
+				__m256 r[8];
+				for (int k{}; k < 8; ++k)
+					r[k] = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + k * lds)));
+				transpose8x8(r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7]);
+				for (int k{}; k < 8; ++k)
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + k * ldd), _mm256_castps_si256(r[k]));
+			}
+		};
+
+#include "TransposeKernels.inl"
+	}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif // MATHLIB_X86
+
+	template<typename T>
+	using TransposeTileKernel = void (*)(int rows, int cols, const T* src, int lds, T* dst, int ldd);
+
+	/// <summary>
+	/// The tile kernel for scalar type T at the current instruction set level. AVX-512 machines use the
+	/// AVX2 kernels: an 8x8 tile of doubles gains little over two 4x4 ones, since the stores dominate.
+	/// </summary>
+	template<typename T>
+	TransposeTileKernel<T> transposeTileKernel()
+	{
+#ifdef MATHLIB_X86
+		if constexpr (hasSimdKernels<T>)
+		{
+			switch (simdLevel())
+			{
+			case SimdLevel::AVX512:
+			case SimdLevel::AVX2:
+				return &avx2::transposeTile<T>;
+			case SimdLevel::SSE2:
+				return &sse2::transposeTile<T>;
+			default:
+				break;
+			}
+		}
+#endif
+		return &scalar::transposeTile<T>;
+	}
+
+	/// <summary>
+	/// Edge of the tiles handed to the tile kernel: two 32x32 tiles of doubles fill 16 KB of L1 cache.
+	/// </summary>
+	constexpr int transposeTileSize{ 32 };
+
+	/// <summary>
+	/// Cache-oblivious transpose: halve the longer dimension, at a multiple of the largest micro-block,
+	/// until the block fits in a tile.
+	/// </summary>
+	template<typename T>
+	void transposeRecursive(int rows, int cols, const T* src, int lds, T* dst, int ldd, TransposeTileKernel<T> tile)
+	{
+		if (rows <= transposeTileSize && cols <= transposeTileSize)
+		{
+			tile(rows, cols, src, lds, dst, ldd);
+		}
+		else if (rows >= cols)
+		{
+			const int half{ (rows / 2 + 7) / 8 * 8 };
+			transposeRecursive(half, cols, src, lds, dst, ldd, tile);
+			transposeRecursive(rows - half, cols, src + half * lds, lds, dst + half, ldd, tile);
+		}
+		else
+		{
+			const int half{ (cols / 2 + 7) / 8 * 8 };
+			transposeRecursive(rows, half, src, lds, dst, ldd, tile);
+			transposeRecursive(rows, cols - half, src + half, lds, dst + half * ldd, ldd, tile);
+		}
+	}
+}
+
+/// <summary>
+/// Out-of-place transpose: the ``cols x rows`` matrix dst receives the transpose of the ``rows x cols``
+/// matrix src. Both are row-major, with consecutive rows ``lds`` and ``ldd`` elements apart, and must not overlap.
+/// Large matrices are transposed in strips of rows on the library thread pool.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+template<typename T>
+void transposeCopy(int rows, int cols, const T* src, int lds, T* dst, int ldd)
+{
+	if (rows <= 0 || cols <= 0)
+		return;
+
+	const internal::TransposeTileKernel<T> tile{ internal::transposeTileKernel<T>() };
+	const int tileSize{ internal::transposeTileSize };
+	const int strip{ std::max(tileSize, (grainSize() / cols + tileSize - 1) / tileSize * tileSize) };
+	parallelFor(0, rows, strip, [&](int first, int last) {
+		internal::transposeRecursive(last - first, cols, src + first * lds, lds, dst + first, ldd, tile);
+	});
+}
+
+/// <summary>
+/// In-place transpose of the square ``n x n`` matrix a, with consecutive rows ``lda`` elements apart.
+/// Each pair of mirrored tiles \f$(I, J)\f$, \f$(J, I)\f$ is exchanged through a stack buffer of one tile.
+/// </summary>
+/// <typeparam name="T"></typeparam>
+template<typename T>
+void transposeSquareInPlace(int n, T* a, int lda)
+{
+	if (n <= 1)
+		return;
+
+	const internal::TransposeTileKernel<T> tile{ internal::transposeTileKernel<T>() };
+	constexpr int B{ internal::transposeTileSize };
+	const int blocks{ (n + B - 1) / B };
+
+	// Block row I owns the tiles (I, J) and (J, I) for J >= I, so the block rows are independent.
+	parallelFor(0, blocks, 1, [&](int first, int last) {
+		T buffer[B * B];
+		for (int bi{ first }; bi < last; ++bi)
+		{
+			const int i0{ bi * B };
+			const int height{ std::min(B, n - i0) };
+			T* diagonal{ a + i0 * lda + i0 };
+			tile(height, height, diagonal, lda, buffer, B);
+			for (int r{}; r < height; ++r)
+				std::copy(buffer + r * B, buffer + r * B + height, diagonal + r * lda);
+
+			for (int bj{ bi + 1 }; bj < blocks; ++bj)
+			{
+				const int j0{ bj * B };
+				const int width{ std::min(B, n - j0) };
+				T* upper{ a + i0 * lda + j0 };
+				T* lower{ a + j0 * lda + i0 };
+				tile(height, width, upper, lda, buffer, B);
+				tile(width, height, lower, lda, upper, lda);
+				for (int r{}; r < width; ++r)
+					std::copy(buffer + r * B, buffer + r * B + height, lower + r * lda);
+			}
+		}
+	});
+}
+
+#endif // !Transpose_H
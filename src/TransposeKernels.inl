@@ -0,0 +1,29 @@
+// TransposeKernels.inl : Transpose of one cache-resident tile, built from in-register micro-transposes.
+//
+// Like SimdKernels.inl, this file is compiled once per instruction set: Transpose.h includes it inside
+// a namespace that defines ``TransposeMicro<T>`` for that instruction set. ``TransposeMicro<T>::size``
+// is the edge of the square block that ``TransposeMicro<T>::transpose`` transposes in registers.
+// For that reason this file has no include guard.
+
+/// <summary>
+/// Transpose the ``rows x cols`` tile at src into dst: ``dst[j * ldd + i] = src[i * lds + j]``.
+/// The tile is covered with micro-blocks; the ragged right and bottom edges are copied one coefficient at a time.
+/// </summary>
+template<typename T>
+void transposeTile(int rows, int cols, const T* src, int lds, T* dst, int ldd)
+{
+	constexpr int B{ TransposeMicro<T>::size };
+	int i{};
+	for (; i + B <= rows; i += B)
+	{
+		int j{};
+		for (; j + B <= cols; j += B)
+			TransposeMicro<T>::transpose(src + i * lds + j, lds, dst + j * ldd + i, ldd);
+		for (; j < cols; ++j)
+			for (int r{}; r < B; ++r)
+				dst[j * ldd + i + r] = src[(i + r) * lds + j];
+	}
+	for (; i < rows; ++i)
+		for (int j{}; j < cols; ++j)
+			dst[j * ldd + i] = src[i * lds + j];
+}
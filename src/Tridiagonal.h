@@ -0,0 +1,728 @@
+#pragma once
+#ifndef TRIDIAGONAL_H
+#define TRIDIAGONAL_H
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "MatrixX.h"
+
+/// Tridiagonal matrices and the Thomas algorithm.
+//
+/// The implicit finite-difference schemes of one-dimensional pricing PDEs, Crank-Nicolson and the line
+/// sweeps of ADI schemes, solve a tridiagonal system \f$Ax = d\f$ at every time step. Gaussian elimination
+/// restricted to the three diagonals, the Thomas algorithm, solves it in O(n) without pivoting. It is stable
+/// for the diagonally dominant or symmetric positive definite matrices of these schemes.
+///
+/// - ``TridiagonalMatrixX`` stores the three diagonals of a matrix.
+/// - ``TridiagonalDecomposition`` eliminates a matrix once and solves for any number of right-hand sides,
+///   the columns of an n x k ``MatrixX``: every elimination step is a SIMD ``axpy`` across the k columns.
+///   This suits a scheme with constant coefficients, which solves the same system at every time step.
+/// - ``TridiagonalBatch`` solves many independent systems, each with its own coefficients, at once. The
+///   coefficients are stored structure-of-arrays: coefficient i of system s is entry (i, s) of an n x batch
+///   matrix, so each step of the algorithm runs across the systems in the lanes of SIMD registers, and the
+///   systems are split across threads. This suits ADI sweeps, with one system per grid line.
+///
+/// ```
+/// TridiagonalBatch<double> lines{ n, lineCount };
+/// for (int s{}; s < lineCount; ++s)
+///     for (int i{}; i < n; ++i)
+///     {
+///         lines.lower()(i, s) = -alpha(i, s);
+///         lines.diagonal()(i, s) = 1 + 2 * alpha(i, s);
+///         lines.upper()(i, s) = -alpha(i, s);
+///     }
+/// lines.solve(rhs);                    // rhs is n x lineCount, column s is solved for system s
+/// ```
+
+/// <summary>
+/// ``TridiagonalMatrixX`` is a dynamic square matrix whose non-zero coefficients lie on the diagonal and the
+/// first sub- and super-diagonals. Row i holds ``lower()[i]``, ``diagonal()[i]`` and ``upper()[i]`` in columns
+/// i - 1, i and i + 1; ``lower()[0]`` and ``upper()[n - 1]`` are outside the matrix and stay zero.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+class TridiagonalMatrixX
+{
+private:
+	std::vector<scalarType> _lower;
+	std::vector<scalarType> _diagonal;
+	std::vector<scalarType> _upper;
+public:
+	using value_type = scalarType;
+
+	TridiagonalMatrixX();
+	explicit TridiagonalMatrixX(int n);
+	TridiagonalMatrixX(int n, scalarType lower, scalarType diagonal, scalarType upper);
+
+	int rows() const;
+	int cols() const;
+	scalarType* lower();
+	const scalarType* lower() const;
+	scalarType* diagonal();
+	const scalarType* diagonal() const;
+	scalarType* upper();
+	const scalarType* upper() const;
+
+	scalarType coeff(int i, int j) const;
+	scalarType operator()(int i, int j) const;
+	scalarType& operator()(int i, int j);
+
+	void multiply(const scalarType* x, scalarType* y) const;
+	MatrixX<scalarType> toDense() const;
+};
+
+/// <summary>
+/// The Thomas algorithm for a tridiagonal matrix, factored once and applied to any number of right-hand sides.
+/// </summary>
+/// <typeparam name="scalarType">``float`` or ``double``</typeparam>
+template<typename scalarType>
+class TridiagonalDecomposition
+{
+	static_assert(std::is_floating_point<scalarType>::value, "TridiagonalDecomposition requires a floating-point scalar type");
+private:
+	std::vector<scalarType> _lower;			// a_i, the multipliers of the forward sweep
+	std::vector<scalarType> _inverse;		// 1 / (b_i - a_i c'_{i-1}), the inverse pivots
+	std::vector<scalarType> _upper;			// c'_i = c_i / (b_i - a_i c'_{i-1})
+public:
+	TridiagonalDecomposition();
+	explicit TridiagonalDecomposition(const TridiagonalMatrixX<scalarType>& a);
+
+	TridiagonalDecomposition& compute(const TridiagonalMatrixX<scalarType>& a);
+
+	int rows() const;
+	template<typename Allocator>
+	MatrixX<scalarType, Allocator> solve(const MatrixX<scalarType, Allocator>& b) const;
+	template<typename Allocator>
+	void solveInPlace(MatrixX<scalarType, Allocator>& b) const;
+};
+
+/// <summary>
+/// A batch of independent tridiagonal systems of order n, stored structure-of-arrays and solved together.
+/// </summary>
+/// <typeparam name="scalarType">``float`` or ``double``</typeparam>
+template<typename scalarType>
+class TridiagonalBatch
+{
+	static_assert(std::is_floating_point<scalarType>::value, "TridiagonalBatch requires a floating-point scalar type");
+private:
+	MatrixX<scalarType> _lower;
+	MatrixX<scalarType> _diagonal;
+	MatrixX<scalarType> _upper;
+	MatrixX<scalarType> _scratch;		// c'_i of every system
+public:
+	TridiagonalBatch();
+	TridiagonalBatch(int n, int batch);
+
+	void resize(int n, int batch);
+	int rows() const;
+	int batchSize() const;
+	MatrixX<scalarType>& lower();
+	const MatrixX<scalarType>& lower() const;
+	MatrixX<scalarType>& diagonal();
+	const MatrixX<scalarType>& diagonal() const;
+	MatrixX<scalarType>& upper();
+	const MatrixX<scalarType>& upper() const;
+
+	template<typename Allocator>
+	void solve(MatrixX<scalarType, Allocator>& rhs);
+};
+
+namespace internal
+{
+	/// <summary>
+	/// Lanes per task of a batched tridiagonal solve: a multiple of 16 lanes, so that tasks start on whole
+	/// SIMD registers, and about ``grainSize()`` coefficients per task.
+	/// </summary>
+	inline int tridiagonalGrain(int n)
+	{
+		return std::max(16, grainSize() / std::max(1, n) / 16 * 16);
+	}
+}
+
+/// <summary>
+/// An empty 0 x 0 matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+TridiagonalMatrixX<scalarType>::TridiagonalMatrixX() : _lower{}, _diagonal{}, _upper{}
+{
+}
+
+/// <summary>
+/// The n x n zero matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="n"></param>
+template<typename scalarType>
+TridiagonalMatrixX<scalarType>::TridiagonalMatrixX(int n) : TridiagonalMatrixX{ n, scalarType{}, scalarType{}, scalarType{} }
+{
+}
+
+/// <summary>
+/// The n x n matrix with constant diagonals, as the finite-difference stencil of a PDE with constant coefficients.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="n"></param>
+/// <param name="lower">coefficient (i, i - 1)</param>
+/// <param name="diagonal">coefficient (i, i)</param>
+/// <param name="upper">coefficient (i, i + 1)</param>
+template<typename scalarType>
+TridiagonalMatrixX<scalarType>::TridiagonalMatrixX(int n, scalarType lower, scalarType diagonal, scalarType upper)
+	: _lower{}, _diagonal{}, _upper{}
+{
+	if (n < 0)
+		throw std::logic_error("The order of a matrix cannot be negative!");
+	_lower.assign(n, lower);
+	_diagonal.assign(n, diagonal);
+	_upper.assign(n, upper);
+	if (n > 0)
+	{
+		_lower.front() = scalarType{};
+		_upper.back() = scalarType{};
+	}
+}
+
+/// <summary>
+/// The number of rows.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int TridiagonalMatrixX<scalarType>::rows() const
+{
+	return static_cast<int>(_diagonal.size());
+}
+
+/// <summary>
+/// The number of columns, equal to the number of rows.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int TridiagonalMatrixX<scalarType>::cols() const
+{
+	return rows();
+}
+
+/// <summary>
+/// The sub-diagonal: ``lower()[i]`` is the coefficient (i, i - 1), for i from 1.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline scalarType* TridiagonalMatrixX<scalarType>::lower()
+{
+	return _lower.data();
+}
+
+/// <summary>
+/// The sub-diagonal: ``lower()[i]`` is the coefficient (i, i - 1), for i from 1.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const scalarType* TridiagonalMatrixX<scalarType>::lower() const
+{
+	return _lower.data();
+}
+
+/// <summary>
+/// The diagonal.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline scalarType* TridiagonalMatrixX<scalarType>::diagonal()
+{
+	return _diagonal.data();
+}
+
+/// <summary>
+/// The diagonal.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const scalarType* TridiagonalMatrixX<scalarType>::diagonal() const
+{
+	return _diagonal.data();
+}
+
+/// <summary>
+/// The super-diagonal: ``upper()[i]`` is the coefficient (i, i + 1), for i up to n - 2.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline scalarType* TridiagonalMatrixX<scalarType>::upper()
+{
+	return _upper.data();
+}
+
+/// <summary>
+/// The super-diagonal: ``upper()[i]`` is the coefficient (i, i + 1), for i up to n - 2.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const scalarType* TridiagonalMatrixX<scalarType>::upper() const
+{
+	return _upper.data();
+}
+
+/// <summary>
+/// The coefficient (i, j), zero off the three diagonals. The indices are only checked by an assertion in debug builds.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType>
+scalarType TridiagonalMatrixX<scalarType>::coeff(int i, int j) const
+{
+	assert(i >= 0 && i < rows() && j >= 0 && j < rows());
+	if (j == i)
+		return _diagonal[i];
+	if (j == i - 1)
+		return _lower[i];
+	if (j == i + 1)
+		return _upper[i];
+	return scalarType{};
+}
+
+/// <summary>
+/// The coefficient (i, j), zero off the three diagonals. Throws ``std::out_of_range`` on indices outside the matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType>
+scalarType TridiagonalMatrixX<scalarType>::operator()(int i, int j) const
+{
+	if (i < 0 || i >= rows() || j < 0 || j >= rows())
+		throw std::out_of_range("Index out of bounds!");
+	return coeff(i, j);
+}
+
+/// <summary>
+/// A reference to the coefficient (i, j). Throws ``std::out_of_range`` if (i, j) is not on one of the three
+/// diagonals, since coefficients there are not stored.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="i"></param>
+/// <param name="j"></param>
+/// <returns></returns>
+template<typename scalarType>
+scalarType& TridiagonalMatrixX<scalarType>::operator()(int i, int j)
+{
+	if (i < 0 || i >= rows() || j < 0 || j >= rows() || j < i - 1 || j > i + 1)
+		throw std::out_of_range("Index outside the three diagonals of the matrix!");
+	if (j == i)
+		return _diagonal[i];
+	return j < i ? _lower[i] : _upper[i];
+}
+
+/// <summary>
+/// The product \f$y = Ax\f$ by a vector of length n. ``x`` and ``y`` must not overlap.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="x"></param>
+/// <param name="y"></param>
+template<typename scalarType>
+void TridiagonalMatrixX<scalarType>::multiply(const scalarType* x, scalarType* y) const
+{
+	const int n{ rows() };
+	if (n == 0)
+		return;
+	if (n == 1)
+	{
+		y[0] = _diagonal[0] * x[0];
+		return;
+	}
+	y[0] = _diagonal[0] * x[0] + _upper[0] * x[1];
+	for (int i{ 1 }; i < n - 1; ++i)
+		y[i] = _lower[i] * x[i - 1] + _diagonal[i] * x[i] + _upper[i] * x[i + 1];
+	y[n - 1] = _lower[n - 1] * x[n - 2] + _diagonal[n - 1] * x[n - 1];
+}
+
+/// <summary>
+/// The dense matrix with the same coefficients.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+MatrixX<scalarType> TridiagonalMatrixX<scalarType>::toDense() const
+{
+	const int n{ rows() };
+	MatrixX<scalarType> dense{ n, n };
+	for (int i{}; i < n; ++i)
+	{
+		if (i > 0)
+			dense.coeffRef(i, i - 1) = _lower[i];
+		dense.coeffRef(i, i) = _diagonal[i];
+		if (i + 1 < n)
+			dense.coeffRef(i, i + 1) = _upper[i];
+	}
+	return dense;
+}
+
+/// <summary>
+/// Tridiagonal times dense, \f$AX\f$, as three row operations per row of the product.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="A"></param>
+/// <param name="X"></param>
+/// <returns></returns>
+template<typename scalarType, typename Allocator>
+MatrixX<scalarType, Allocator> operator*(const TridiagonalMatrixX<scalarType>& A, const MatrixX<scalarType, Allocator>& X)
+{
+	if (A.cols() != X.rows())
+		throw std::logic_error("Error multiplying the matrices; the number of cols(A) must equal the number of rows(B)!");
+
+	const int n{ A.rows() };
+	const int k{ X.cols() };
+	MatrixX<scalarType, Allocator> result{ n, k };
+	if (k == 1)
+	{
+		A.multiply(X.data(), result.data());
+		return result;
+	}
+
+	const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+	const scalarType* x{ X.data() };
+	scalarType* r{ result.data() };
+	for (int i{}; i < n; ++i)
+	{
+		scalarType* ri{ r + static_cast<long long>(i) * k };
+		if (i > 0)
+			kernels.axpy(A.lower()[i], x + static_cast<long long>(i - 1) * k, ri, k);
+		kernels.axpy(A.diagonal()[i], x + static_cast<long long>(i) * k, ri, k);
+		if (i + 1 < n)
+			kernels.axpy(A.upper()[i], x + static_cast<long long>(i + 1) * k, ri, k);
+	}
+	return result;
+}
+
+/// <summary>
+/// An empty decomposition, to be filled by ``compute()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+TridiagonalDecomposition<scalarType>::TridiagonalDecomposition() : _lower{}, _inverse{}, _upper{}
+{
+}
+
+/// <summary>
+/// Factor the tridiagonal matrix ``a``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+template<typename scalarType>
+TridiagonalDecomposition<scalarType>::TridiagonalDecomposition(const TridiagonalMatrixX<scalarType>& a) : TridiagonalDecomposition{}
+{
+	compute(a);
+}
+
+/// <summary>
+/// The forward sweep of the Thomas algorithm on the matrix alone:
+/// \f$c'_i = c_i / (b_i - a_i c'_{i-1})\f$, keeping the inverse pivots for the right-hand sides.
+/// Throws ``std::logic_error`` on a zero pivot: the matrix is singular, or needs pivoting, which the Thomas
+/// algorithm does not do; ``LUDecomposition`` solves such systems.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="a"></param>
+/// <returns></returns>
+template<typename scalarType>
+TridiagonalDecomposition<scalarType>& TridiagonalDecomposition<scalarType>::compute(const TridiagonalMatrixX<scalarType>& a)
+{
+	const int n{ a.rows() };
+	_lower.assign(a.lower(), a.lower() + n);
+	_inverse.resize(n);
+	_upper.resize(n);
+	scalarType previous{};
+	for (int i{}; i < n; ++i)
+	{
+		const scalarType pivot{ a.diagonal()[i] - _lower[i] * previous };
+		if (pivot == scalarType{})
+			throw std::logic_error("Zero pivot in the Thomas algorithm!");
+		_inverse[i] = scalarType{ 1 } / pivot;
+		_upper[i] = a.upper()[i] * _inverse[i];
+		previous = _upper[i];
+	}
+	return *this;
+}
+
+/// <summary>
+/// The order of the factored matrix.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int TridiagonalDecomposition<scalarType>::rows() const
+{
+	return static_cast<int>(_inverse.size());
+}
+
+/// <summary>
+/// Solve \f$AX = B\f$, where B has one column per right-hand side.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="b"></param>
+/// <returns></returns>
+template<typename scalarType>
+template<typename Allocator>
+MatrixX<scalarType, Allocator> TridiagonalDecomposition<scalarType>::solve(const MatrixX<scalarType, Allocator>& b) const
+{
+	MatrixX<scalarType, Allocator> x{ b };
+	solveInPlace(x);
+	return x;
+}
+
+/// <summary>
+/// Solve \f$AX = B\f$ in place: on return ``b`` holds X. Each step of the forward and backward sweeps updates a
+/// whole row of B, so with k right-hand sides it runs on k SIMD lanes, and large k is split across threads.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="b"></param>
+template<typename scalarType>
+template<typename Allocator>
+void TridiagonalDecomposition<scalarType>::solveInPlace(MatrixX<scalarType, Allocator>& b) const
+{
+	const int n{ rows() };
+	if (b.rows() != n)
+		throw std::logic_error("The right-hand side must have as many rows as the matrix!");
+
+	const int k{ b.cols() };
+	scalarType* d{ b.data() };
+	if (k == 1)
+	{
+		if (n == 0)
+			return;
+		d[0] *= _inverse[0];
+		for (int i{ 1 }; i < n; ++i)
+			d[i] = (d[i] - _lower[i] * d[i - 1]) * _inverse[i];
+		for (int i{ n - 2 }; i >= 0; --i)
+			d[i] -= _upper[i] * d[i + 1];
+		return;
+	}
+
+	const SimdKernelTable<scalarType>& kernels{ simdKernels<scalarType>() };
+	parallelFor(0, k, internal::tridiagonalGrain(n), [&](int first, int last) {
+		const int width{ last - first };
+		for (int i{}; i < n; ++i)
+		{
+			scalarType* row{ d + static_cast<long long>(i) * k + first };
+			if (i > 0)
+				kernels.axpy(-_lower[i], row - k, row, width);
+			kernels.scale(row, _inverse[i], row, width);
+		}
+		for (int i{ n - 2 }; i >= 0; --i)
+		{
+			scalarType* row{ d + static_cast<long long>(i) * k + first };
+			kernels.axpy(-_upper[i], row + k, row, width);
+		}
+	});
+}
+
+/// <summary>
+/// An empty batch, to be sized by ``resize()``.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+template<typename scalarType>
+TridiagonalBatch<scalarType>::TridiagonalBatch() : _lower{}, _diagonal{}, _upper{}, _scratch{}
+{
+}
+
+/// <summary>
+/// ``batch`` systems of order n with zero coefficients.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="n"></param>
+/// <param name="batch"></param>
+template<typename scalarType>
+TridiagonalBatch<scalarType>::TridiagonalBatch(int n, int batch) : TridiagonalBatch{}
+{
+	resize(n, batch);
+}
+
+/// <summary>
+/// Change the order and the number of systems. The coefficients are left unspecified, and storage is only
+/// reallocated when the batch grows.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="n"></param>
+/// <param name="batch"></param>
+template<typename scalarType>
+void TridiagonalBatch<scalarType>::resize(int n, int batch)
+{
+	_lower.resize(n, batch);
+	_diagonal.resize(n, batch);
+	_upper.resize(n, batch);
+	_scratch.resize(n, batch);
+}
+
+/// <summary>
+/// The order of the systems.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int TridiagonalBatch<scalarType>::rows() const
+{
+	return _diagonal.rows();
+}
+
+/// <summary>
+/// The number of systems.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline int TridiagonalBatch<scalarType>::batchSize() const
+{
+	return _diagonal.cols();
+}
+
+/// <summary>
+/// The sub-diagonals: entry (i, s) is the coefficient (i, i - 1) of system s. Row 0 is not used.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline MatrixX<scalarType>& TridiagonalBatch<scalarType>::lower()
+{
+	return _lower;
+}
+
+/// <summary>
+/// The sub-diagonals: entry (i, s) is the coefficient (i, i - 1) of system s. Row 0 is not used.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const MatrixX<scalarType>& TridiagonalBatch<scalarType>::lower() const
+{
+	return _lower;
+}
+
+/// <summary>
+/// The diagonals: entry (i, s) is the coefficient (i, i) of system s.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline MatrixX<scalarType>& TridiagonalBatch<scalarType>::diagonal()
+{
+	return _diagonal;
+}
+
+/// <summary>
+/// The diagonals: entry (i, s) is the coefficient (i, i) of system s.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const MatrixX<scalarType>& TridiagonalBatch<scalarType>::diagonal() const
+{
+	return _diagonal;
+}
+
+/// <summary>
+/// The super-diagonals: entry (i, s) is the coefficient (i, i + 1) of system s. Row n - 1 is not used.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline MatrixX<scalarType>& TridiagonalBatch<scalarType>::upper()
+{
+	return _upper;
+}
+
+/// <summary>
+/// The super-diagonals: entry (i, s) is the coefficient (i, i + 1) of system s. Row n - 1 is not used.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <returns></returns>
+template<typename scalarType>
+inline const MatrixX<scalarType>& TridiagonalBatch<scalarType>::upper() const
+{
+	return _upper;
+}
+
+/// <summary>
+/// Solve every system in place: column s of the n x batch matrix ``rhs`` is the right-hand side of system s
+/// on entry and its solution on return. The Thomas algorithm runs on all the systems of a task at once, with
+/// innermost loops across systems that the compiler vectorizes; tasks of whole SIMD registers of systems run
+/// on the thread pool. There is no pivoting and no check for zero pivots, which show up as infinite or NaN
+/// solutions; the coefficients are not modified, so the batch can be solved again with new right-hand sides.
+/// </summary>
+/// <typeparam name="scalarType"></typeparam>
+/// <param name="rhs"></param>
+template<typename scalarType>
+template<typename Allocator>
+void TridiagonalBatch<scalarType>::solve(MatrixX<scalarType, Allocator>& rhs)
+{
+	const int n{ rows() };
+	const int batch{ batchSize() };
+	if (rhs.rows() != n || rhs.cols() != batch)
+		throw std::logic_error("The right-hand sides must be an n x batch matrix!");
+	if (n == 0)
+		return;
+
+	const scalarType* lower{ _lower.data() };
+	const scalarType* diagonal{ _diagonal.data() };
+	const scalarType* upper{ _upper.data() };
+	scalarType* scratch{ _scratch.data() };
+	scalarType* d{ rhs.data() };
+	parallelFor(0, batch, internal::tridiagonalGrain(n), [&](int first, int last) {
+		// Forward sweep: c'_i = c_i / (b_i - a_i c'_{i-1}), d'_i = (d_i - a_i d'_{i-1}) / (b_i - a_i c'_{i-1}).
+		{
+			const scalarType* b{ diagonal + first };
+			const scalarType* c{ upper + first };
+			scalarType* cp{ scratch + first };
+			scalarType* di{ d + first };
+			for (int s{}; s < last - first; ++s)
+			{
+				const scalarType inverse{ scalarType{ 1 } / b[s] };
+				cp[s] = c[s] * inverse;
+				di[s] *= inverse;
+			}
+		}
+		for (int i{ 1 }; i < n; ++i)
+		{
+			const long long offset{ static_cast<long long>(i) * batch + first };
+			const scalarType* a{ lower + offset };
+			const scalarType* b{ diagonal + offset };
+			const scalarType* c{ upper + offset };
+			const scalarType* cpPrevious{ scratch + offset - batch };
+			const scalarType* dPrevious{ d + offset - batch };
+			scalarType* cp{ scratch + offset };
+			scalarType* di{ d + offset };
+			for (int s{}; s < last - first; ++s)
+			{
+				const scalarType inverse{ scalarType{ 1 } / (b[s] - a[s] * cpPrevious[s]) };
+				cp[s] = c[s] * inverse;
+				di[s] = (di[s] - a[s] * dPrevious[s]) * inverse;
+			}
+		}
+
+		// Back substitution: x_i = d'_i - c'_i x_{i+1}.
+		for (int i{ n - 2 }; i >= 0; --i)
+		{
+			const long long offset{ static_cast<long long>(i) * batch + first };
+			const scalarType* cp{ scratch + offset };
+			const scalarType* next{ d + offset + batch };
+			scalarType* di{ d + offset };
+			for (int s{}; s < last - first; ++s)
+				di[s] -= cp[s] * next[s];
+		}
+	});
+}
+
+#endif // !TRIDIAGONAL_H
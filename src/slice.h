@@ -1,3 +1,4 @@
+#pragma once
 #include <cstddef>
 
 /// <summary>
@@ -33,8 +34,18 @@ public:
 		return (start + stride * i);
 	}
 
+	int getStart() const
+	{
+		return start;
+	}
+
 	int getLength() const
 	{
 		return length;
 	}
-};
\ No newline at end of file
+
+	int getStride() const
+	{
+		return stride;
+	}
+};
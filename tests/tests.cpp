@@ -2,9 +2,162 @@
 #include "CppUnitTest.h"
 #include "Matrix.h"
 #include "MatrixX.h"
+#include "LU.h"
+#include "Cholesky.h"
+#include "IterativeSolvers.h"
+#include "SparseMatrixX.h"
+#include "BandedMatrixX.h"
+#include "Tridiagonal.h"
+#include "SymmetricEigenSolver.h"
+#include "QR.h"
+#include "MatrixBatch.h"
+#include "MixedPrecision.h"
+#include "MatrixIO.h"
+#include "HolidayCalendar.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
+// Count heap allocations made by the test module, so that tests can assert that a code path
+// does not allocate. Every form of new and delete is replaced, so that each pointer is released by
+// the function matching its allocation. GCC still pairs the std::malloc of an inlined operator new
+// with the operator delete that releases it (-Wmismatched-new-delete), so the replacements are kept
+// out of line.
+static std::atomic<std::size_t> allocationCount{};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define ALLOCATION_COUNTER_NOINLINE __attribute__((noinline))
+#else
+#define ALLOCATION_COUNTER_NOINLINE
+#endif
+
+ALLOCATION_COUNTER_NOINLINE void* operator new(std::size_t size)
+{
+	++allocationCount;
+	if (void* p = std::malloc(size == 0 ? 1 : size))
+		return p;
+	throw std::bad_alloc{};
+}
+
+ALLOCATION_COUNTER_NOINLINE void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+ALLOCATION_COUNTER_NOINLINE void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	++allocationCount;
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+ALLOCATION_COUNTER_NOINLINE void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete(void* p, std::size_t) noexcept
+{
+	operator delete(p);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete[](void* p, std::size_t) noexcept
+{
+	operator delete[](p);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	operator delete(p);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	operator delete[](p);
+}
+
+// Matrix storage is allocated with the aligned forms of new and delete.
+ALLOCATION_COUNTER_NOINLINE void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	++allocationCount;
+	const std::size_t a{ static_cast<std::size_t>(alignment) };
+#ifdef _MSC_VER
+	return _aligned_malloc(size == 0 ? 1 : size, a);
+#else
+	return std::aligned_alloc(a, (size + a) / a * a);
+#endif
+}
+
+ALLOCATION_COUNTER_NOINLINE void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	if (void* p = operator new(size, alignment, std::nothrow))
+		return p;
+	throw std::bad_alloc{};
+}
+
+ALLOCATION_COUNTER_NOINLINE void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+ALLOCATION_COUNTER_NOINLINE void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, alignment, tag);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete(void* p, std::align_val_t) noexcept
+{
+#ifdef _MSC_VER
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete[](void* p, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete[](p, alignment);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete(void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	operator delete(p, alignment);
+}
+
+ALLOCATION_COUNTER_NOINLINE void operator delete[](void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	operator delete[](p, alignment);
+}
+
 namespace tests
 {
 	TEST_CLASS(tests)
@@ -249,6 +402,81 @@ namespace tests
 			Assert::IsTrue(actual == expected);
 		}
 
+		/// <summary>
+		/// \f$ A \times B \f$ for a product large enough to go through the packed GEMM kernel,
+		/// with dimensions that are not multiples of the register tile.
+		/// </summary>
+		TEST_METHOD(UnitTest9b_BlockedMatrixMultiplication)
+		{
+			const int m{ 67 }, k{ 301 }, n{ 45 };
+			MatrixXd a{ m, k };
+			MatrixXd b{ k, n };
+			for (int i{}; i < m; ++i)
+				for (int j{}; j < k; ++j)
+					a(i, j) = (i * 7 + j * 3) % 11 - 5;
+			for (int i{}; i < k; ++i)
+				for (int j{}; j < n; ++j)
+					b(i, j) = (i * 5 + j * 2) % 13 - 6;
+
+			MatrixXd actual = a * b;
+			MatrixXd expected{ m, n };
+			for (int i{}; i < m; ++i)
+				for (int j{}; j < n; ++j)
+				{
+					double sum{};
+					for (int p{}; p < k; ++p)
+						sum += a(i, p) * b(p, j);
+					expected(i, j) = sum;
+				}
+			Assert::IsTrue(actual == expected);
+		}
+
+		/// <summary>
+		/// \f$ C := \alpha A B + \beta C \f$ with the micro-kernel of every instruction set, in ``float`` and
+		/// ``double``. The dimensions leave partial tiles on both edges of C at every register tile, and the
+		/// integer coefficients keep every product exact.
+		/// </summary>
+		TEST_METHOD(UnitTest9c_GemmMicroKernels)
+		{
+			const SimdLevel levels[]{ SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+			const int m{ 67 }, k{ 301 }, n{ 45 };
+
+			auto check{ [&](auto zero) {
+				using scalarType = decltype(zero);
+				std::vector<scalarType> a(m * k), b(k * n), c0(m * n), expected(m * n);
+				for (int i{}; i < m * k; ++i)
+					a[i] = static_cast<scalarType>((i * 7) % 11 - 5);
+				for (int i{}; i < k * n; ++i)
+					b[i] = static_cast<scalarType>((i * 5) % 13 - 6);
+				for (int i{}; i < m * n; ++i)
+					c0[i] = static_cast<scalarType>(i % 9 - 4);
+				for (int i{}; i < m; ++i)
+					for (int j{}; j < n; ++j)
+					{
+						scalarType sum{};
+						for (int p{}; p < k; ++p)
+							sum += a[i * k + p] * b[p * n + j];
+						expected[i * n + j] = 2 * sum + c0[i * n + j] / 2;
+					}
+
+				for (SimdLevel level : levels)
+				{
+					setSimdLevel(level);
+					std::vector<scalarType> c{ c0 };
+					gemm(m, n, k, scalarType{ 2 }, a.data(), k, b.data(), n, scalarType{ 0.5 }, c.data(), n);
+					Assert::IsTrue(c == expected);
+
+					std::fill(c.begin(), c.end(), std::numeric_limits<scalarType>::quiet_NaN());
+					gemm(m, n, k, scalarType{ 1 }, a.data(), k, b.data(), n, scalarType{}, c.data(), n);
+					for (int i{}; i < m * n; ++i)
+						Assert::AreEqual(expected[i] - c0[i] / 2, 2 * c[i]);
+				}
+				setSimdLevel(maxSimdLevel());
+			} };
+			check(0.0f);
+			check(0.0);
+		}
+
 		TEST_METHOD(UnitTest10_rowVectori)
 		{
 			MatrixXd m1{
@@ -318,5 +546,1792 @@ namespace tests
 			};
 			Assert::IsTrue(actual == expected);
 		}
+
+		/// <summary>
+		/// A fused element-wise expression, \f$ 2(A + B) - (-C) \f$, evaluated in one pass.
+		/// </summary>
+		TEST_METHOD(UnitTest13_FusedExpression)
+		{
+			MatrixXd m1{
+				{1, 2},
+				{3, 4}
+			};
+
+			MatrixXd m2{
+				{1, 1},
+				{1, 1}
+			};
+
+			MatrixXd m3{
+				{0, 1},
+				{2, 3}
+			};
+
+			MatrixXd actual = 2.0 * (m1 + m2) - (-m3);
+			MatrixXd expected{
+				{4, 7},
+				{10, 13}
+			};
+			Assert::IsTrue(actual == expected);
+		}
+
+		/// <summary>
+		/// Expressions that refer to the matrix being assigned: \f$ A = A^T + A \f$.
+		/// </summary>
+		TEST_METHOD(UnitTest14_ExpressionAliasing)
+		{
+			MatrixXd actual{
+				{1, 2},
+				{3, 4}
+			};
+
+			actual = actual.transpose() + actual;
+			MatrixXd expected{
+				{2, 5},
+				{5, 8}
+			};
+			Assert::IsTrue(actual == expected);
+
+			actual -= actual * 0.5;
+			MatrixXd halved{
+				{1, 2.5},
+				{2.5, 4}
+			};
+			Assert::IsTrue(actual == halved);
+		}
+
+		/// <summary>
+		/// Moving a matrix transfers its storage instead of copying it.
+		/// </summary>
+		TEST_METHOD(UnitTest15_MoveSemantics)
+		{
+			MatrixXd m1{
+				{1, 2},
+				{3, 4}
+			};
+			const double* storage{ m1.data() };
+
+			MatrixXd m2{ std::move(m1) };
+			Assert::IsTrue(m2.data() == storage);
+			Assert::IsTrue(m1.rows() == 0 && m1.cols() == 0);
+
+			m1 = std::move(m2);
+			Assert::IsTrue(m1.data() == storage);
+			MatrixXd expected{
+				{1, 2},
+				{3, 4}
+			};
+			Assert::IsTrue(m1 == expected);
+		}
+
+		/// <summary>
+		/// A per-tick update loop on pre-sized buffers performs no heap allocations, on one thread and split
+		/// into many parallel tasks.
+		/// </summary>
+		TEST_METHOD(UnitTest16_SteadyStateAllocations)
+		{
+			const int n{ 32 };
+			setGrainSize(64);
+			for (int threads : { 1, 8 })
+			{
+				setThreadCount(threads);
+				MatrixXd position{ n, n };
+				MatrixXd delta{ n, n };
+				MatrixXd buffer;
+				buffer.reserve(n * n);
+				for (int i{}; i < n; ++i)
+					for (int j{}; j < n; ++j)
+						delta(i, j) = i - j;
+
+				const std::size_t allocationsBefore{ allocationCount };
+				double checksum{};
+				for (int tick{}; tick < 100; ++tick)
+				{
+					position += delta;
+					position -= 0.5 * delta;
+					position *= 0.99;
+
+					buffer.resize(n, n);
+					buffer = position + delta;
+					MatrixXd result{ std::move(buffer) };
+					result -= position;
+					buffer = std::move(result);
+					buffer.resize(0, 0);
+					checksum += position.dot(delta);
+				}
+				Assert::IsTrue(allocationCount == allocationsBefore);
+				Assert::IsTrue(buffer.capacity() >= n * n);
+				Assert::IsTrue(checksum != 0);
+			}
+			setGrainSize(1 << 15);
+			setThreadCount(0);
+		}
+
+		TEST_METHOD(UnitTest17_Reductions)
+		{
+			VectorXd v{ { 3.0 }, { -4.0 }, { 0.0 }, { 1.5 }, { -2.5 } };
+			VectorXd w{ { 1.0 }, { 2.0 }, { 3.0 }, { 4.0 }, { 5.0 } };
+			MatrixXi m{ {1, -2, 3}, {-4, 5, -6} };
+
+			Assert::AreEqual(-2.0, v.sum());
+			Assert::AreEqual(-11.5, v.dot(w));
+			Assert::AreEqual(33.5, v.squaredNorm());
+			Assert::AreEqual(std::sqrt(33.5), v.norm());
+			Assert::AreEqual(11.0, v.norm1());
+			Assert::AreEqual(4.0, v.normInf());
+			Assert::AreEqual(-3, m.sum());
+			Assert::AreEqual(21, m.norm1());
+			Assert::AreEqual(6, m.normInf());
+			Assert::AreEqual(91, m.squaredNorm());
+		}
+
+		TEST_METHOD(UnitTest18_SimdDispatch)
+		{
+			// Sizes that exercise the vector body and the scalar tail of every instruction set.
+			const SimdLevel levels[]{ SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+			const int n{ 67 };
+			MatrixXf a{ n, 1 };
+			MatrixXf b{ n, 1 };
+			MatrixXi c{ n, 1 };
+			for (int i{}; i < n; ++i)
+			{
+				a(i, 0) = 0.25f * (i % 11) - 1.0f;
+				b(i, 0) = 2.0f - 0.125f * i;
+				c(i, 0) = (i % 2 == 0) ? i : -i;
+			}
+
+			MatrixXf expected{ n, 1 };
+			for (int i{}; i < n; ++i)
+				expected(i, 0) = 3.0f * a(i, 0) - b(i, 0) + (a(i, 0) + b(i, 0));
+
+			for (SimdLevel level : levels)
+			{
+				setSimdLevel(level);
+				Assert::IsTrue(simdLevel() <= maxSimdLevel());
+
+				MatrixXf actual{ 3.0f * a };
+				actual -= b;
+				MatrixXf sum{ a + b };
+				actual += 1.0f * sum;
+				Assert::IsTrue(actual == expected);
+
+				Assert::AreEqual(33, c.sum());
+				Assert::AreEqual(2211, c.norm1());
+				Assert::AreEqual(66, c.normInf());
+			}
+			setSimdLevel(maxSimdLevel());
+		}
+
+		TEST_METHOD(UnitTest19_ParallelOperations)
+		{
+			const int m{ 150 };
+			const int n{ 170 };
+			MatrixXd a{ m, n };
+			MatrixXd b{ n, m };
+			for (int i{}; i < m; ++i)
+				for (int j{}; j < n; ++j)
+				{
+					a(i, j) = (i * 7 + j * 3) % 11 - 5.0;
+					b(j, i) = (i + 2 * j) % 5 - 2.0;
+				}
+
+			setThreadCount(1);
+			const MatrixXd product{ a * b };
+			const MatrixXd tallProduct{ b * a };
+			const MatrixXd wideProduct{ a * tallProduct };
+			MatrixXd sum{ a + 2.0 * b.transpose() };
+			sum -= a;
+			const double norm{ sum.norm1() };
+			const double dot{ a.dot(a) };
+
+			// Tiny grains force every operation to be split into many tasks.
+			setThreadCount(4);
+			setGrainSize(64);
+			Assert::AreEqual(4, threadCount());
+			Assert::IsTrue(a * b == product);
+			Assert::IsTrue(b * a == tallProduct);
+			Assert::IsTrue(a * tallProduct == wideProduct);
+			MatrixXd parallelSum{ a + 2.0 * b.transpose() };
+			parallelSum -= a;
+			Assert::IsTrue(parallelSum == sum);
+			Assert::AreEqual(norm, parallelSum.norm1());
+			Assert::AreEqual(dot, a.dot(a));
+
+			setGrainSize(1 << 15);
+			setThreadCount(0);
+		}
+
+		TEST_METHOD(UnitTest20_ThreadPoolNestingAndExceptions)
+		{
+			ThreadPool pool{ 3 };
+			std::atomic<int> visits{};
+			pool.parallelFor(0, 16, 1, [&](int, int) {
+				pool.parallelFor(0, 100, 7, [&](int innerFirst, int innerLast) { visits += innerLast - innerFirst; });
+			});
+			Assert::AreEqual(1600, visits.load());
+
+			// A worker that runs a loop of another pool is still a worker of its own pool, and its nested
+			// loops stay on its own queue.
+			ThreadPool other{ 3 };
+			std::atomic<int> mismatches{};
+			std::atomic<int> nestedVisits{};
+			pool.parallelFor(0, 16, 1, [&](int, int) {
+				const int worker{ pool.workerIndex() };
+				const std::thread::id thread{ std::this_thread::get_id() };
+				other.parallelFor(0, 8, 1, [&](int, int) {
+					if (std::this_thread::get_id() == thread && pool.workerIndex() != worker)
+						++mismatches;
+					pool.parallelFor(0, 100, 7, [&](int innerFirst, int innerLast) { nestedVisits += innerLast - innerFirst; });
+				});
+				if (pool.workerIndex() != worker)
+					++mismatches;
+			});
+			Assert::AreEqual(0, mismatches.load());
+			Assert::AreEqual(12800, nestedVisits.load());
+			Assert::AreEqual(-1, pool.workerIndex());
+
+			bool thrown{ false };
+			try
+			{
+				pool.parallelFor(0, 1000, 10, [](int first, int last) {
+					if (first <= 500 && 500 < last)
+						throw std::runtime_error("chunk failed");
+				});
+			}
+			catch (const std::runtime_error&)
+			{
+				thrown = true;
+			}
+			Assert::IsTrue(thrown);
+		}
+
+		TEST_METHOD(UnitTest21_CoefficientAccess)
+		{
+			MatrixXi m{ {1, 2, 3}, {4, 5, 6} };
+			m.coeffRef(1, 2) = 60;
+			m.coeffRef(0) = 10;
+			Assert::AreEqual(60, m.coeff(1, 2));
+			Assert::AreEqual(10, m(0, 0));
+			Assert::AreEqual(4, m.coeff(3));
+
+#ifndef MATHLIB_NO_BOUNDS_CHECK
+			// (0, 3) lies inside the storage, but outside the matrix.
+			Assert::ExpectException<std::out_of_range>([&] { m(0, 3); });
+			Assert::ExpectException<std::out_of_range>([&] { m(2, 0); });
+			Assert::ExpectException<std::out_of_range>([&] { m(-1, 2); });
+#endif
+		}
+
+		TEST_METHOD(UnitTest22_BlockedTranspose)
+		{
+			const SimdLevel levels[]{ SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+			// Odd sizes leave ragged edges at every level of the recursion and in every micro-block.
+			const int m{ 45 };
+			const int n{ 70 };
+			MatrixXd a{ m, n };
+			MatrixXf b{ n, m };
+			MatrixXi c{ n, n };
+			for (int i{}; i < m; ++i)
+				for (int j{}; j < n; ++j)
+				{
+					a(i, j) = i * 1000.0 + j;
+					b(j, i) = j * 1000.0f - i;
+				}
+			for (int i{}; i < n; ++i)
+				for (int j{}; j < n; ++j)
+					c(i, j) = i * n + j;
+
+			for (SimdLevel level : levels)
+			{
+				setSimdLevel(level);
+				MatrixXd at{ a.transpose() };
+				MatrixXf bt{ b.transpose() };
+				MatrixXi ct{ c };
+				const std::size_t allocationsBefore{ allocationCount };
+				ct = ct.transpose();
+				Assert::IsTrue(allocationCount == allocationsBefore);
+
+				Assert::AreEqual(n, at.rows());
+				Assert::AreEqual(m, at.cols());
+				for (int i{}; i < n; ++i)
+					for (int j{}; j < m; ++j)
+					{
+						Assert::AreEqual(a(j, i), at(i, j));
+						Assert::AreEqual(b(i, j), bt(j, i));
+					}
+				for (int i{}; i < n; ++i)
+					for (int j{}; j < n; ++j)
+						Assert::AreEqual(c(j, i), ct(i, j));
+
+				at.transposeInPlace();
+				Assert::IsTrue(at == a);
+				at = at.transpose();
+				Assert::AreEqual(n, at.rows());
+				Assert::AreEqual(m, at.cols());
+				Assert::IsTrue(at == MatrixXd{ a.transpose() });
+			}
+			setSimdLevel(maxSimdLevel());
+		}
+
+		TEST_METHOD(UnitTest23_StridedViews)
+		{
+			const int n{ 7 };
+			MatrixXd m{ n, n };
+			for (int i{}; i < n; ++i)
+				for (int j{}; j < n; ++j)
+					m(i, j) = 10.0 * i + j;
+			const MatrixXd original{ m };
+
+			MatrixXd c;
+			c = m.col(2);
+			Assert::AreEqual(n, c.rows());
+			Assert::AreEqual(1, c.cols());
+			Assert::AreEqual(32.0, c(3, 0));
+
+			MatrixXd d{ m.diagonal() };
+			Assert::AreEqual(n, d.rows());
+			Assert::AreEqual(44.0, d(4, 0));
+
+			// Every other row, columns 1 to the end, then a view of that view.
+			const MatrixView<const double> evenRows{ original(slice{ 0, 4, 2 }, slice{ 1 }) };
+			Assert::AreEqual(4, evenRows.rows());
+			Assert::AreEqual(n - 1, evenRows.cols());
+			Assert::AreEqual(43.0, evenRows(2, 2));
+			Assert::AreEqual(65.0, evenRows.col(4)(3));
+#ifndef MATHLIB_NO_BOUNDS_CHECK
+			Assert::ExpectException<std::out_of_range>([&]() { m.block(5, 5, 3, 1); });
+#endif
+
+			// Assignment and arithmetic write through to the matrix.
+			m.row(0) = m.row(6);
+			m.col(1) += 2.0 * m.col(3);
+			m.block(4, 4, 2, 2) = { {-1, -2}, {-3, -4} };
+			m(slice{ 1, 3, 2 }, slice{}) *= -1.0;
+			m.diagonal().setConstant(0.5);
+			for (int i{}; i < n; ++i)
+				for (int j{}; j < n; ++j)
+				{
+					double expected{ original(i == 0 ? 6 : i, j) };
+					if (j == 1)
+						expected += 2.0 * original(i == 0 ? 6 : i, 3);
+					if (i >= 4 && i < 6 && j >= 4 && j < 6)
+						expected = -1.0 - 2 * (i - 4) - (j - 4);
+					if (i == 1 || i == 3 || i == 5)
+						expected = -expected;
+					if (i == j)
+						expected = 0.5;
+					Assert::AreEqual(expected, m(i, j));
+				}
+
+			// Products of blocks, in place and with strided (packed) operands.
+			const MatrixXd a{ original.block(1, 0, 5, 3) };
+			const MatrixXd b{ original.block(2, 3, 3, 4) };
+			MatrixXd expected{ a * b };
+			MatrixXd product{ original.block(1, 0, 5, 3) * original.block(2, 3, 3, 4) };
+			Assert::IsTrue(product == expected);
+			MatrixXd wide{ 3, 8 };
+			wide(slice{}, slice{ 0, 4, 2 }) = b;
+			MatrixXd stridedProduct{ a * wide(slice{}, slice{ 0, 4, 2 }) };
+			Assert::IsTrue(stridedProduct == expected);
+
+			MatrixXd e{ n, n };
+			gemm(1.0, a.block(0, 0, 5, 3), b.block(0, 0, 3, 4), 0.0, e.block(2, 1, 5, 4));
+			Assert::IsTrue(MatrixXd{ e.block(2, 1, 5, 4) } == expected);
+			Assert::AreEqual(0.0, MatrixXd{ e.block(0, 0, 2, n) }.norm1());
+			MatrixXd f{ 5, 8 };
+			gemm(1.0, a.block(0, 0, 5, 3), b.block(0, 0, 3, 4), 0.0, f(slice{}, slice{ 1, 4, 2 }));
+			Assert::IsTrue(MatrixXd{ f(slice{}, slice{ 1, 4, 2 }) } == expected);
+			Assert::AreEqual(0.0, MatrixXd{ f(slice{}, slice{ 0, 4, 2 }) }.norm1());
+
+			// Assignments from views that overlap the destination read the coefficients before any is written.
+			MatrixXd g{ 4, 4 };
+			for (int i{}; i < 4; ++i)
+				for (int j{}; j < 4; ++j)
+					g(i, j) = 10.0 * i + j;
+			const MatrixXd h{ g };
+			g.block(1, 1, 3, 3) = g.block(0, 0, 3, 3);
+			for (int i{}; i < 4; ++i)
+				for (int j{}; j < 4; ++j)
+					Assert::AreEqual(i > 0 && j > 0 ? h(i - 1, j - 1) : h(i, j), g(i, j));
+			g = h;
+			g.block(0, 0, 3, 3) = transpose(g.block(0, 0, 3, 3));
+			for (int i{}; i < 4; ++i)
+				for (int j{}; j < 4; ++j)
+					Assert::AreEqual(i < 3 && j < 3 ? h(j, i) : h(i, j), g(i, j));
+			g = h;
+			g.block(0, 0, 3, 3) += transpose(g.block(1, 1, 3, 3));
+			g.col(3) -= g.col(2);
+			for (int i{}; i < 4; ++i)
+				for (int j{}; j < 4; ++j)
+				{
+					double expected{ i < 3 && j < 3 ? h(i, j) + h(j + 1, i + 1) : h(i, j) };
+					if (j == 3)
+						expected -= i < 3 ? h(i, 2) + h(3, i + 1) : h(i, 2);
+					Assert::AreEqual(expected, g(i, j));
+				}
+		}
+
+		TEST_METHOD(UnitTest24_Allocators)
+		{
+			using MatrixA = MatrixX<double, ArenaAllocator<double>>;
+			const int n{ 33 };
+			MatrixXd a{ n, n };
+			MatrixXd b{ n, n };
+			for (int i{}; i < n; ++i)
+				for (int j{}; j < n; ++j)
+				{
+					a(i, j) = i + 0.5 * j;
+					b(i, j) = i == j ? 2.0 : 0.0;
+				}
+			Assert::IsTrue(reinterpret_cast<std::uintptr_t>(a.data()) % 64 == 0);
+			const MatrixXd expected{ a * b + a };
+
+			// After the first iteration has sized the arena, scratch matrices no longer touch the heap.
+			Arena& arena{ Arena::local() };
+			const double* firstData{ nullptr };
+			std::size_t allocationsBefore{};
+			for (int iteration{}; iteration < 10; ++iteration)
+			{
+				if (iteration == 1)
+					allocationsBefore = allocationCount;
+
+				ArenaScope scope;
+				MatrixA scratch{ a };
+				MatrixA product{ scratch * MatrixA{ b } };
+				product += scratch;
+				Assert::IsTrue(reinterpret_cast<std::uintptr_t>(product.data()) % 64 == 0);
+				for (int i{}; i < n; ++i)
+					for (int j{}; j < n; ++j)
+						Assert::AreEqual(expected(i, j), product(i, j));
+
+				// Every iteration reuses the same storage.
+				if (iteration == 0)
+					firstData = scratch.data();
+				Assert::IsTrue(scratch.data() == firstData);
+			}
+			Assert::IsTrue(allocationCount == allocationsBefore);
+
+			// Scopes nest: closing the inner one releases only what was allocated inside it.
+			ArenaScope outer;
+			MatrixA kept{ a };
+			const std::size_t capacity{ arena.capacity() };
+			const double* innerData{ nullptr };
+			{
+				ArenaScope inner;
+				MatrixA temporary{ n, n };
+				innerData = temporary.data();
+			}
+			MatrixA reused{ n, n };
+			Assert::IsTrue(reused.data() == innerData);
+			Assert::IsTrue(reused.data() != kept.data());
+			Assert::AreEqual(capacity, arena.capacity());
+			Assert::IsTrue(MatrixXd{ kept } == a);
+		}
+
+		TEST_METHOD(UnitTest25_FixedSizeMatrix)
+		{
+			// Fixed-size matrices carry nothing but their coefficients, and work in constant expressions.
+			static_assert(sizeof(Matrix4d) == 16 * sizeof(double), "a fixed-size matrix stores only its coefficients");
+			static_assert(std::is_trivially_copyable<Matrix3f>::value, "fixed-size matrices are trivially copyable");
+			constexpr Matrix2i a{ {1, 2}, {3, 4} };
+			constexpr Matrix2i b{ {0, 1}, {1, 0} };
+			constexpr Matrix2i ab{ a * b };
+			static_assert(ab.coeff(0, 0) == 2 && ab.coeff(0, 1) == 1 && ab.coeff(1, 0) == 4 && ab.coeff(1, 1) == 3, "constexpr product");
+			static_assert(a.determinant() == -2, "constexpr determinant");
+			static_assert(Matrix<int, 2, 3>::rows() == 2 && Matrix<int, 2, 3>::size() == 6, "compile-time dimensions");
+
+			// Matrix-vector and rectangular products.
+			const Matrix<double, 2, 3> m{ {1, 2, 3}, {4, 5, 6} };
+			Matrix<double, 3, 1> x;
+			x << 1, 0, -1;
+			const Matrix<double, 2, 1> y{ m * x };
+			Assert::AreEqual(-2.0, y(0, 0));
+			Assert::AreEqual(-2.0, y(1, 0));
+			const Vector3d v{ { 1, 1, 1 } };
+			Assert::IsTrue(Vector2d{ { 6, 15 } } == v * Matrix<double, 3, 2>{ {1, 4}, {2, 5}, {3, 6} });
+			Assert::ExpectException<std::logic_error>([&] { x << 1, 2, 3, 4; });
+
+			// Determinants and inverses: A * inverse(A) = I for 2x2, 3x3 and 4x4.
+			const Matrix3d c{ {2, -1, 0}, {-1, 2, -1}, {0, -1, 2} };
+			Assert::AreEqual(4.0, c.determinant(), 1e-12);
+			const Matrix4d d{ {4, 1, 0, 2}, {1, 3, -1, 0}, {0, -1, 5, 1}, {2, 0, 1, 6} };
+			Assert::AreEqual(243.0, d.determinant(), 1e-9);
+			const Matrix2d e{ {3, 1}, {4, 2} };
+
+			const Matrix2d ei{ e * e.inverse() };
+			const Matrix3d ci{ c * c.inverse() };
+			const Matrix4d di{ d.inverse() * d };
+			for (int i{}; i < 4; ++i)
+				for (int j{}; j < 4; ++j)
+				{
+					const double identity{ i == j ? 1.0 : 0.0 };
+					if (i < 2 && j < 2)
+						Assert::AreEqual(identity, ei(i, j), 1e-12);
+					if (i < 3 && j < 3)
+						Assert::AreEqual(identity, ci(i, j), 1e-12);
+					Assert::AreEqual(identity, di(i, j), 1e-12);
+				}
+			Assert::ExpectException<std::logic_error>([] { Matrix2d{ {1, 2}, {2, 4} }.inverse(); });
+
+			// Larger products take the looped path.
+			Matrix<double, 5, 5> f;
+			for (int i{}; i < 5; ++i)
+				f(i, i) = i + 1.0;
+			Matrix<double, 5, 5> g{ f };
+			g *= f;
+			Assert::AreEqual(25.0, g(4, 4));
+			Assert::AreEqual(0.0, g(4, 3));
+		}
+
+		TEST_METHOD(UnitTest26_LUDecomposition)
+		{
+			// A zero leading coefficient needs pivoting.
+			const MatrixXd small{ {0, 2, 1}, {1, 1, 1}, {2, 1, 0} };
+			Assert::AreEqual(3.0, determinant(small), 1e-12);
+			const MatrixXd smallInverse{ inverse(small) * small };
+			for (int i{}; i < 3; ++i)
+				for (int j{}; j < 3; ++j)
+					Assert::AreEqual(i == j ? 1.0 : 0.0, smallInverse(i, j), 1e-12);
+
+			// Several panels and a blocked trailing update; one and many right-hand sides.
+			const int n{ 150 };
+			MatrixXd a{ n, n };
+			for (int i{}; i < n; ++i)
+				for (int j{}; j < n; ++j)
+					a(i, j) = std::sin(0.37 * i * j + i) + (i == j ? 1.0 : 0.0);
+			const LUDecomposition<double> lu{ a };
+			Assert::IsFalse(lu.isSingular());
+			for (int k : { 1, 7 })
+			{
+				MatrixXd b{ n, k };
+				for (int i{}; i < n; ++i)
+					for (int j{}; j < k; ++j)
+						b(i, j) = std::cos(i + 3.0 * j);
+				const MatrixXd x{ lu.solve(b) };
+				const MatrixXd residual{ a * x - b };
+				Assert::IsTrue(residual.normInf() < 1e-9);
+			}
+
+			// P A = L U, with the interchanges applied in order.
+			const MatrixXd& factors{ lu.matrixLU() };
+			MatrixXd pa{ a };
+			for (int j{}; j < n; ++j)
+				for (int c{}; c < n; ++c)
+					std::swap(pa(j, c), pa(lu.pivots()[j], c));
+			for (int i : { 0, 63, 64, 149 })
+				for (int j : { 0, 70, 149 })
+				{
+					double sum{};
+					for (int k{}; k <= std::min(i, j); ++k)
+						sum += (k == i ? 1.0 : factors(i, k)) * factors(k, j);
+					Assert::AreEqual(pa(i, j), sum, 1e-10);
+				}
+
+			// The single precision path.
+			const MatrixXf f{ {4, 3}, {6, 3} };
+			Assert::AreEqual(-6.0f, determinant(f), 1e-5f);
+
+			// Singular matrices factor, have a zero determinant and cannot be solved.
+			const LUDecomposition<double> singular{ MatrixXd{ {1, 2}, {2, 4} } };
+			Assert::IsTrue(singular.isSingular());
+			Assert::AreEqual(0.0, singular.determinant());
+			Assert::ExpectException<std::logic_error>([&] { singular.inverse(); });
+			Assert::ExpectException<std::logic_error>([&] { LUDecomposition<double>{ MatrixXd{ 2, 3 } }; });
+		}
+
+		TEST_METHOD(UnitTest27_Cholesky)
+		{
+			// A = B B^T + I is positive definite; n spans several panels.
+			const int n{ 150 };
+			MatrixXd b{ n, n };
+			for (int i{}; i < n; ++i)
+				for (int j{}; j < n; ++j)
+					b(i, j) = std::sin(0.7 * i + 1.3 * j) / n;
+			MatrixXd a{ b * b.transpose() };
+			for (int i{}; i < n; ++i)
+				a(i, i) += 1.0;
+
+			const LLTDecomposition<double> llt{ a };
+			Assert::IsTrue(llt.isPositiveDefinite());
+			const MatrixXd& l{ llt.matrixL() };
+			Assert::AreEqual(0.0, l(3, 100));
+			const MatrixXd llT{ l * l.transpose() - a };
+			Assert::IsTrue(llT.normInf() < 1e-12);
+
+			MatrixXd rhs{ n, 3 };
+			for (int i{}; i < n; ++i)
+				for (int j{}; j < 3; ++j)
+					rhs(i, j) = std::cos(i - 2.0 * j);
+			const MatrixXd lltResidual{ a * llt.solve(rhs) - rhs };
+			Assert::IsTrue(lltResidual.normInf() < 1e-12);
+
+			const LDLTDecomposition<double> ldlt{ a };
+			Assert::IsTrue(ldlt.isPositiveSemidefinite());
+			Assert::AreEqual(n, ldlt.rank());
+			const MatrixXd ldltResidual{ a * ldlt.solve(rhs) - rhs };
+			Assert::IsTrue(ldltResidual.normInf() < 1e-12);
+
+			// A correlation matrix of rank 2: LLT fails, LDLT zeroes the vanishing pivots.
+			const int f{ 100 };
+			MatrixXd loadings{ f, 2 };
+			for (int i{}; i < f; ++i)
+			{
+				const double angle{ 0.05 * i };
+				loadings(i, 0) = std::cos(angle);
+				loadings(i, 1) = std::sin(angle);
+			}
+			const MatrixXd correlation{ loadings * loadings.transpose() };
+			Assert::IsFalse(LLTDecomposition<double>{ correlation }.isPositiveDefinite());
+			const LDLTDecomposition<double> semidefinite{ correlation };
+			Assert::IsTrue(semidefinite.isPositiveSemidefinite());
+			Assert::AreEqual(2, semidefinite.rank());
+			const CholeskyFactor<double> c{ correlation };
+			Assert::IsTrue(c.isPivoted());
+			MatrixXd ccT{ c.matrixL() * c.matrixL().transpose() };
+			for (int i{}; i < f; ++i)
+				for (int j{}; j < f; ++j)
+					Assert::AreEqual(correlation(c.permutation()[i], c.permutation()[j]), ccT(i, j), 1e-12);
+
+			// Batched correlated draws: row p of x is C times row p of z, for a triangular and a pivoted factor.
+			const int paths{ 37 };
+			MatrixXd z{ paths, n };
+			for (int p{}; p < paths; ++p)
+				for (int i{}; i < n; ++i)
+					z(p, i) = std::sin(p * 0.3 + i * 1.7);
+			MatrixXd x;
+			applyLowerFactor(l, z, x);
+			Assert::AreEqual(paths, x.rows());
+			MatrixXd xPivoted;
+			const MatrixXd zf{ z.block(0, 0, paths, f) };
+			c.apply(zf, xPivoted);
+			for (int p : { 0, 36 })
+				for (int i : { 0, 63, 64, 99 })
+				{
+					double expected{};
+					double expectedPivoted{};
+					for (int k{}; k <= i; ++k)
+					{
+						expected += l(i, k) * z(p, k);
+						expectedPivoted += c.matrixL()(i, k) * z(p, k);
+					}
+					Assert::AreEqual(expected, x(p, i), 1e-12);
+					Assert::AreEqual(expectedPivoted, xPivoted(p, c.permutation()[i]), 1e-12);
+				}
+
+			const MatrixXd indefinite{ {1, 2}, {2, 1} };
+			Assert::IsFalse(LDLTDecomposition<double>{ indefinite }.isPositiveSemidefinite());
+			Assert::ExpectException<std::logic_error>([&] { CholeskyFactor<double>{ indefinite }; });
+		}
+		TEST_METHOD(UnitTest28_IterativeSolvers)
+		{
+			// -Laplacian on a k x k grid with Dirichlet boundaries, matrix-free, plus an optional upwind convection term.
+			const int k{ 20 };
+			const int n{ k * k };
+			double convection{};
+			auto grid{ [&](const double* u, double* y) {
+				for (int i{}; i < k; ++i)
+					for (int j{}; j < k; ++j)
+					{
+						const int p{ i * k + j };
+						const double west{ j > 0 ? u[p - 1] : 0.0 };
+						y[p] = (4 + convection) * u[p] - (1 + convection) * west - (j + 1 < k ? u[p + 1] : 0.0)
+							- (i > 0 ? u[p - k] : 0.0) - (i + 1 < k ? u[p + k] : 0.0);
+					}
+			} };
+			MatrixXd exact{ n, 1 };
+			for (int p{}; p < n; ++p)
+				exact(p, 0) = std::sin(0.1 * p) + 1;
+			MatrixXd b{ n, 1 };
+			grid(exact.data(), b.data());
+
+			// The same operator as a dense matrix.
+			MatrixXd a{ n, n };
+			MatrixXd unit{ n, 1 };
+			MatrixXd column{ n, 1 };
+			for (int q{}; q < n; ++q)
+			{
+				unit(q, 0) = 1;
+				grid(unit.data(), column.data());
+				unit(q, 0) = 0;
+				for (int p{}; p < n; ++p)
+					a(p, q) = column(p, 0);
+			}
+
+			ConjugateGradientSolver<double> cg;
+			cg.settings().tolerance = 1e-10;
+			MatrixXd x;
+			const IterativeSolverResult<double> plain{ cg.solve(grid, b, x) };
+			Assert::IsTrue(plain.converged);
+			Assert::IsTrue(plain.residual <= 1e-10);
+			Assert::IsTrue(MatrixXd{ x - exact }.normInf() < 1e-8);
+
+			// A second solve from zero reuses the workspace of the first and allocates nothing.
+			std::fill(x.data(), x.data() + x.size(), 0.0);
+			std::size_t allocationsBefore{ allocationCount };
+			const IterativeSolverResult<double> warm{ cg.solve(grid, b, x) };
+			Assert::IsTrue(allocationCount == allocationsBefore);
+			Assert::AreEqual(plain.iterations, warm.iterations);
+
+			const IncompleteCholeskyPreconditioner<double> ic{ a };
+			Assert::AreEqual(n + 2 * k * (k - 1), ic.nonZeros());
+			MatrixXd xIC;
+			const IterativeSolverResult<double> preconditioned{ cg.solve(a, b, xIC, ic) };
+			Assert::IsTrue(preconditioned.converged);
+			Assert::IsTrue(preconditioned.iterations < plain.iterations);
+			Assert::IsTrue(MatrixXd{ xIC - exact }.normInf() < 1e-8);
+
+			// Restarting from the solution converges at once.
+			Assert::AreEqual(0, cg.solve(grid, b, xIC, ic).iterations);
+
+			// The callback sees every iteration and can stop the solver.
+			int calls{};
+			cg.settings().callback = [&](int iteration, double) { ++calls; return iteration < 5; };
+			MatrixXd xStopped;
+			const IterativeSolverResult<double> stopped{ cg.solve(grid, b, xStopped) };
+			Assert::AreEqual(5, stopped.iterations);
+			Assert::AreEqual(5, calls);
+			Assert::IsFalse(stopped.converged);
+
+			// Stationary iterations; SOR beats Gauss-Seidel which beats Jacobi on the Poisson problem.
+			IterativeSolverSettings<double> stationary;
+			stationary.tolerance = 1e-8;
+			stationary.maxIterations = 5000;
+			JacobiSolver<double> jacobi{ stationary };
+			GaussSeidelSolver<double> gaussSeidel{ stationary };
+			MatrixXd xJacobi;
+			MatrixXd xGaussSeidel;
+			const IterativeSolverResult<double> jacobiResult{ jacobi.solve(a, b, xJacobi) };
+			const IterativeSolverResult<double> gaussSeidelResult{ gaussSeidel.solve(a, b, xGaussSeidel) };
+			gaussSeidel.settings().omega = 1.7;
+			MatrixXd xSOR;
+			const IterativeSolverResult<double> sorResult{ gaussSeidel.solve(a, b, xSOR) };
+			Assert::IsTrue(jacobiResult.converged && gaussSeidelResult.converged && sorResult.converged);
+			Assert::IsTrue(sorResult.iterations < gaussSeidelResult.iterations);
+			Assert::IsTrue(gaussSeidelResult.iterations < jacobiResult.iterations);
+			Assert::IsTrue(MatrixXd{ xSOR - exact }.normInf() < 1e-5);
+
+			// Matrix-free Jacobi needs the diagonal.
+			const std::vector<double> diagonal(n, 4.0);
+			MatrixXd xFree;
+			Assert::IsTrue(jacobi.solve(grid, DiagonalPreconditioner<double>{ diagonal.data(), n }, b, xFree).converged);
+
+			// GMRES on the non-symmetric convection-diffusion operator, with and without restarts.
+			convection = 2;
+			grid(exact.data(), b.data());
+			GMRESSolver<double> gmres;
+			gmres.settings().tolerance = 1e-10;
+			const std::vector<double> convectionDiagonal(n, 6.0);
+			const DiagonalPreconditioner<double> jacobiPreconditioner{ convectionDiagonal.data(), n };
+			for (int restart : { 400, 20 })
+			{
+				gmres.settings().restart = restart;
+				MatrixXd xGMRES;
+				const IterativeSolverResult<double> result{ gmres.solve(grid, b, xGMRES, jacobiPreconditioner) };
+				Assert::IsTrue(result.converged);
+				Assert::IsTrue(MatrixXd{ xGMRES - exact }.normInf() < 1e-7);
+
+				std::fill(xGMRES.data(), xGMRES.data() + xGMRES.size(), 0.0);
+				allocationsBefore = allocationCount;
+				const IterativeSolverResult<double> warmGMRES{ gmres.solve(grid, b, xGMRES, jacobiPreconditioner) };
+				Assert::IsTrue(allocationCount == allocationsBefore);
+				Assert::AreEqual(result.iterations, warmGMRES.iterations);
+			}
+
+			// The warm solves allocate nothing either when the products and vector operations run in parallel.
+			setThreadCount(4);
+			setGrainSize(64);
+			cg.settings().callback = nullptr;
+			MatrixXd xParallel;
+			const IterativeSolverResult<double> parallelCG{ cg.solve(a, b, xParallel) };
+			Assert::IsTrue(parallelCG.converged);
+			std::fill(xParallel.data(), xParallel.data() + xParallel.size(), 0.0);
+			allocationsBefore = allocationCount;
+			const IterativeSolverResult<double> warmParallelCG{ cg.solve(a, b, xParallel) };
+			Assert::IsTrue(allocationCount == allocationsBefore);
+			Assert::AreEqual(parallelCG.iterations, warmParallelCG.iterations);
+
+			gmres.settings().restart = 20;
+			std::fill(xParallel.data(), xParallel.data() + xParallel.size(), 0.0);
+			const IterativeSolverResult<double> parallelGMRES{ gmres.solve(grid, b, xParallel, jacobiPreconditioner) };
+			Assert::IsTrue(parallelGMRES.converged);
+			std::fill(xParallel.data(), xParallel.data() + xParallel.size(), 0.0);
+			allocationsBefore = allocationCount;
+			const IterativeSolverResult<double> warmParallelGMRES{ gmres.solve(grid, b, xParallel, jacobiPreconditioner) };
+			Assert::IsTrue(allocationCount == allocationsBefore);
+			Assert::AreEqual(parallelGMRES.iterations, warmParallelGMRES.iterations);
+			setGrainSize(1 << 15);
+			setThreadCount(0);
+
+			// A small dense non-symmetric system.
+			const MatrixXd small{ {4, 1, 0}, {2, 5, 1}, {0, -1, 3} };
+			const MatrixXd smallB{ {1}, {2}, {3} };
+			MatrixXd smallX;
+			Assert::IsTrue(gmres.solve(small, smallB, smallX).converged);
+			Assert::IsTrue(MatrixXd{ small * smallX - smallB }.normInf() < 1e-9);
+
+			Assert::ExpectException<std::logic_error>([&] { MatrixXd y; cg.solve(MatrixXd{ 2, 3 }, smallB, y); });
+			Assert::ExpectException<std::logic_error>([&] { MatrixXd y; cg.solve(small, MatrixXd{ 4, 1 }, y); });
+		}
+		TEST_METHOD(UnitTest29_SparseAndBandedMatrices)
+		{
+			// Assembly from unordered triplets, with a duplicate that is summed.
+			const std::vector<Triplet<double>> triplets{ {2, 1, 5}, {0, 0, 1}, {1, 3, -2}, {2, 1, 1}, {0, 2, 4}, {3, 0, 7} };
+			const SparseMatrixXd a{ 4, 5, triplets };
+			const SparseMatrixX<double, StorageOrder::ColumnMajor> c{ 4, 5, triplets };
+			Assert::AreEqual(5, a.nonZeros());
+			Assert::AreEqual(5, c.nonZeros());
+			Assert::AreEqual(6.0, a(2, 1));
+			Assert::AreEqual(0.0, a(2, 2));
+			Assert::AreEqual(6.0, c(2, 1));
+			Assert::AreEqual(0.0, c(3, 4));
+			const MatrixXd dense{ a.toDense() };
+			Assert::IsTrue(dense == c.toDense());
+			Assert::IsTrue(dense == SparseMatrixXd{ dense }.toDense());
+			Assert::IsTrue(a.toColumnMajor().toDense() == dense);
+			Assert::IsTrue(c.toRowMajor().toDense() == dense);
+			const MatrixXd transposed{ a.transpose().toDense() };
+			for (int i{}; i < 4; ++i)
+				for (int j{}; j < 5; ++j)
+					Assert::AreEqual(dense(i, j), transposed(j, i));
+
+			// Products agree with the dense path, in both storage orders and for vectors and matrices.
+			for (int k : { 1, 3 })
+			{
+				MatrixXd x{ 5, k };
+				MatrixXd w{ k, 4 };
+				for (int i{}; i < x.size(); ++i)
+					x.coeffRef(i) = std::sin(1.0 + i);
+				for (int i{}; i < w.size(); ++i)
+					w.coeffRef(i) = std::cos(1.0 + i);
+				const MatrixXd expected{ dense * x };
+				const MatrixXd expectedLeft{ w * dense };
+				Assert::IsTrue(MatrixXd{ a * x - expected }.normInf() < 1e-14);
+				Assert::IsTrue(MatrixXd{ c * x - expected }.normInf() < 1e-14);
+				Assert::IsTrue(MatrixXd{ w * a - expectedLeft }.normInf() < 1e-14);
+				Assert::IsTrue(MatrixXd{ w * c - expectedLeft }.normInf() < 1e-14);
+			}
+
+			Assert::ExpectException<std::out_of_range>([&] { SparseMatrixXd{ 2, 2, { {2, 0, 1.0} } }; });
+			Assert::ExpectException<std::out_of_range>([&] { a(4, 0); });
+			Assert::ExpectException<std::logic_error>([&] { SparseMatrixXd{ 2, 2, { 0, 1, 2 }, { 1 }, { 1.0 } }; });
+			Assert::ExpectException<std::logic_error>([&] { SparseMatrixXd{ 1, 2, { 0, 2 }, { 1, 0 }, { 1.0, 2.0 } }; });
+			Assert::ExpectException<std::logic_error>([&] { a * MatrixXd{ 4, 1 }; });
+
+			// Banded matrices, tridiagonal and with asymmetric bands, including the width 3 bands (2,0) and (0,2).
+			for (const std::pair<int, int>& shape : std::vector<std::pair<int, int>>{ { 1, 1 }, { 2, 1 }, { 2, 0 }, { 0, 2 } })
+			{
+				const int n{ 9 };
+				const int lower{ shape.first };
+				const int upper{ shape.second };
+				BandedMatrixX<double> band{ n, lower, upper };
+				for (int i{}; i < n; ++i)
+					for (int j{ std::max(0, i - lower) }; j <= std::min(n - 1, i + upper); ++j)
+						band(i, j) = 1 + i + 0.5 * j;
+				Assert::AreEqual(0.0, band.coeff(8, 0));
+				Assert::ExpectException<std::out_of_range>([&] { band(0, upper + 1) = 1; });
+				const MatrixXd bandDense{ band.toDense() };
+				for (int k : { 1, 4 })
+				{
+					MatrixXd x{ n, k };
+					for (int i{}; i < x.size(); ++i)
+						x.coeffRef(i) = std::sin(0.5 * i);
+					Assert::IsTrue(MatrixXd{ band * x - bandDense * x }.normInf() < 1e-13);
+				}
+			}
+
+			// A sparse 2D Poisson matrix in the iterative solvers: O(nnz) products, IC(0) and Gauss-Seidel sweeps.
+			const int g{ 30 };
+			const int n{ g * g };
+			std::vector<Triplet<double>> poisson;
+			for (int i{}; i < g; ++i)
+				for (int j{}; j < g; ++j)
+				{
+					const int p{ i * g + j };
+					poisson.push_back({ p, p, 4 });
+					if (j > 0)
+						poisson.push_back({ p, p - 1, -1 });
+					if (j + 1 < g)
+						poisson.push_back({ p, p + 1, -1 });
+					if (i > 0)
+						poisson.push_back({ p, p - g, -1 });
+					if (i + 1 < g)
+						poisson.push_back({ p, p + g, -1 });
+				}
+			const SparseMatrixXd laplacian{ n, n, poisson };
+			Assert::AreEqual(5 * n - 4 * g, laplacian.nonZeros());
+			MatrixXd exact{ n, 1 };
+			for (int p{}; p < n; ++p)
+				exact(p, 0) = std::cos(0.05 * p);
+			const MatrixXd rhs{ laplacian * exact };
+
+			ConjugateGradientSolver<double> cg;
+			cg.settings().tolerance = 1e-10;
+			const IncompleteCholeskyPreconditioner<double> ic{ laplacian };
+			Assert::AreEqual((laplacian.nonZeros() + n) / 2, ic.nonZeros());
+			MatrixXd x;
+			MatrixXd xIC;
+			const IterativeSolverResult<double> plain{ cg.solve(laplacian, rhs, x) };
+			const IterativeSolverResult<double> preconditioned{ cg.solve(laplacian.toColumnMajor(), rhs, xIC, ic) };
+			Assert::IsTrue(plain.converged && preconditioned.converged);
+			Assert::IsTrue(preconditioned.iterations < plain.iterations);
+			Assert::IsTrue(MatrixXd{ xIC - exact }.normInf() < 1e-8);
+
+			IterativeSolverSettings<double> sorSettings;
+			sorSettings.omega = 1.8;
+			sorSettings.tolerance = 1e-9;
+			GaussSeidelSolver<double> sor{ sorSettings };
+			MatrixXd xSOR;
+			Assert::IsTrue(sor.solve(laplacian, rhs, xSOR).converged);
+			Assert::IsTrue(MatrixXd{ xSOR - exact }.normInf() < 1e-6);
+
+			// The tridiagonal 1D Laplacian as a banded matrix.
+			BandedMatrixX<double> tridiagonal{ n, 1, 1 };
+			for (int i{}; i < n; ++i)
+			{
+				tridiagonal(i, i) = 2.5;
+				if (i > 0)
+					tridiagonal(i, i - 1) = -1;
+				if (i + 1 < n)
+					tridiagonal(i, i + 1) = -1;
+			}
+			const MatrixXd tridiagonalRhs{ tridiagonal * exact };
+			JacobiSolver<double> jacobi;
+			jacobi.settings().tolerance = 1e-10;
+			MatrixXd xBand;
+			Assert::IsTrue(jacobi.solve(tridiagonal, tridiagonalRhs, xBand).converged);
+			Assert::IsTrue(MatrixXd{ xBand - exact }.normInf() < 1e-8);
+		}
+		TEST_METHOD(UnitTest30_Tridiagonal)
+		{
+			// A Crank-Nicolson-like matrix with varying coefficients.
+			const int n{ 50 };
+			TridiagonalMatrixX<double> a{ n };
+			for (int i{}; i < n; ++i)
+			{
+				a(i, i) = 3 + std::sin(0.3 * i);
+				if (i > 0)
+					a(i, i - 1) = -1 - 0.01 * i;
+				if (i + 1 < n)
+					a(i, i + 1) = -0.5 + 0.02 * i;
+			}
+			Assert::AreEqual(0.0, a.coeff(0, 2));
+			Assert::ExpectException<std::out_of_range>([&] { a(0, 2) = 1; });
+			const MatrixXd dense{ a.toDense() };
+
+			// Products, for a vector and a block of vectors.
+			for (int k : { 1, 7, 40 })
+			{
+				MatrixXd x{ n, k };
+				for (int i{}; i < x.size(); ++i)
+					x.coeffRef(i) = std::cos(0.1 * i);
+				Assert::IsTrue(MatrixXd{ a * x - dense * x }.normInf() < 1e-13);
+
+				// The Thomas algorithm against LU, with the factorization reused for every column.
+				const TridiagonalDecomposition<double> thomas{ a };
+				const MatrixXd b{ dense * x };
+				Assert::IsTrue(MatrixXd{ thomas.solve(b) - x }.normInf() < 1e-12);
+				Assert::IsTrue(MatrixXd{ thomas.solve(b) - solve(dense, b) }.normInf() < 1e-12);
+			}
+
+			// A batch of systems with their own coefficients, against solving them one at a time.
+			for (int batch : { 1, 5, 64, 100 })
+			{
+				TridiagonalBatch<double> systems{ n, batch };
+				MatrixXd rhs{ n, batch };
+				for (int s{}; s < batch; ++s)
+					for (int i{}; i < n; ++i)
+					{
+						systems.lower()(i, s) = i > 0 ? -1 - 0.01 * s : 0;
+						systems.diagonal()(i, s) = 2.5 + 0.1 * std::sin(i + s);
+						systems.upper()(i, s) = i + 1 < n ? -1 + 0.005 * i : 0;
+						rhs(i, s) = std::cos(0.2 * i * (s + 1));
+					}
+				MatrixXd x{ rhs };
+				systems.solve(x);
+				for (int s : { 0, batch / 2, batch - 1 })
+				{
+					TridiagonalMatrixX<double> single{ n };
+					MatrixXd b{ n, 1 };
+					for (int i{}; i < n; ++i)
+					{
+						single.lower()[i] = systems.lower()(i, s);
+						single.diagonal()[i] = systems.diagonal()(i, s);
+						single.upper()[i] = systems.upper()(i, s);
+						b(i, 0) = rhs(i, s);
+					}
+					const MatrixXd expected{ TridiagonalDecomposition<double>{ single }.solve(b) };
+					for (int i{}; i < n; ++i)
+						Assert::AreEqual(expected(i, 0), x(i, s), 1e-12);
+				}
+			}
+
+			// Constant diagonals, and a zero pivot that the Thomas algorithm cannot handle without pivoting.
+			const TridiagonalMatrixX<double> laplacian{ 4, -1, 2, -1 };
+			Assert::AreEqual(0.0, laplacian.lower()[0]);
+			Assert::AreEqual(0.0, laplacian.upper()[3]);
+			const MatrixXd ones{ {1}, {1}, {1}, {1} };
+			const MatrixXd expected{ {2}, {3}, {3}, {2} };
+			Assert::IsTrue(MatrixXd{ TridiagonalDecomposition<double>{ laplacian }.solve(ones) - expected }.normInf() < 1e-14);
+			Assert::ExpectException<std::logic_error>([&] { TridiagonalDecomposition<double>{ TridiagonalMatrixX<double>{ 3, 1, 0, 1 } }; });
+			Assert::ExpectException<std::logic_error>([&] { TridiagonalDecomposition<double>{ laplacian }.solve(MatrixXd{ 3, 1 }); });
+		}
+
+		TEST_METHOD(UnitTest31_SymmetricEigenSolver)
+		{
+			const MatrixXd small{ { 2, 1 }, { 1, 2 } };
+			const SymmetricEigenSolver<double> twoByTwo{ small };
+			Assert::AreEqual(1.0, twoByTwo.eigenvalues()(0, 0), 1e-14);
+			Assert::AreEqual(3.0, twoByTwo.eigenvalues()(1, 0), 1e-14);
+			Assert::AreEqual(std::abs(twoByTwo.eigenvectors()(0, 1)), std::abs(twoByTwo.eigenvectors()(1, 1)), 1e-14);
+
+			// A V = V diag(lambda) and V^T V = I, over several panels of the reduction; only the lower
+			// triangle of the matrix is read.
+			auto check = [](const MatrixXd& a, const MatrixXd& values, const MatrixXd& vectors, double tolerance) {
+				const int n{ a.rows() };
+				MatrixXd scaled{ vectors };
+				for (int i{}; i < n; ++i)
+					for (int j{}; j < vectors.cols(); ++j)
+						scaled(i, j) *= values(j, 0);
+				Assert::IsTrue(MatrixXd{ a * vectors - scaled }.normInf() < tolerance);
+				MatrixXd gram{ vectors.transpose() * vectors };
+				for (int j{}; j < vectors.cols(); ++j)
+					gram(j, j) -= 1;
+				Assert::IsTrue(gram.normInf() < tolerance);
+			};
+			for (int n : { 1, 3, 33, 100 })
+			{
+				MatrixXd a{ n, n };
+				MatrixXd lower{ n, n };
+				for (int i{}; i < n; ++i)
+					for (int j{}; j <= i; ++j)
+					{
+						a(i, j) = a(j, i) = std::sin(1.0 + i * j + 0.5 * i) + (i == j ? 0.1 * i : 0);
+						lower(i, j) = a(i, j);
+					}
+				const SymmetricEigenSolver<double> solver{ lower };
+				Assert::AreEqual(n, solver.rows());
+				check(a, solver.eigenvalues(), solver.eigenvectors(), 1e-11 * n);
+				for (int i{ 1 }; i < n; ++i)
+					Assert::IsTrue(solver.eigenvalues()(i - 1, 0) <= solver.eigenvalues()(i, 0));
+
+				// The eigenvalues alone agree, and so do the largest ones with their eigenvectors.
+				const SymmetricEigenSolver<double> valuesOnly{ a, false };
+				Assert::AreEqual(0, valuesOnly.eigenvectors().size());
+				Assert::IsTrue(MatrixXd{ valuesOnly.eigenvalues() - solver.eigenvalues() }.normInf() < 1e-11 * n);
+				SymmetricEigenSolver<double> largest;
+				for (int k : { 0, 1, 3, n })
+				{
+					if (k > n)
+						continue;
+					largest.computeLargest(lower, k);
+					Assert::AreEqual(k, largest.eigenvalues().rows());
+					for (int j{}; j < k; ++j)
+						Assert::AreEqual(solver.eigenvalues()(n - 1 - j, 0), largest.eigenvalues()(j, 0), 1e-11 * n);
+					check(a, largest.eigenvalues(), largest.eigenvectors(), 1e-10 * n);
+				}
+			}
+
+			// A repeated eigenvalue: I + u u^T has eigenvalue 1 with multiplicity n - 1.
+			const int n{ 80 };
+			MatrixXd a{ n, n };
+			for (int i{}; i < n; ++i)
+				for (int j{}; j < n; ++j)
+					a(i, j) = (i == j ? 1.0 : 0.0) + std::cos(0.1 * i) * std::cos(0.1 * j);
+			SymmetricEigenSolver<double> degenerate{ a };
+			check(a, degenerate.eigenvalues(), degenerate.eigenvectors(), 1e-12 * n);
+			Assert::AreEqual(1.0, degenerate.eigenvalues()(n - 2, 0), 1e-12);
+			degenerate.computeLargest(a, 4);
+			check(a, degenerate.eigenvalues(), degenerate.eigenvectors(), 1e-10);
+
+			const MatrixX<float> af{ { 4, 1, 0 }, { 1, 3, 1 }, { 0, 1, 2 } };
+			const SymmetricEigenSolver<float> single{ af };
+			Assert::AreEqual(9.0f, single.eigenvalues()(0, 0) + single.eigenvalues()(1, 0) + single.eigenvalues()(2, 0), 1e-5f);
+
+			Assert::ExpectException<std::logic_error>([&] { SymmetricEigenSolver<double>{ MatrixXd{ 3, 2 } }; });
+			Assert::ExpectException<std::logic_error>([&] { SymmetricEigenSolver<double>{}.computeLargest(a, n + 1); });
+		}
+
+		TEST_METHOD(UnitTest32_QR)
+		{
+			auto fill = [](MatrixXd& a, double seed) {
+				for (int i{}; i < a.size(); ++i)
+					a.coeffRef(i) = std::sin(seed + 1.7 * i + 0.3 * i * i);
+			};
+
+			// A = QR with orthonormal columns of Q, for tall, square and wide matrices spanning several panels.
+			for (auto [m, n] : { std::pair<int, int>{ 1, 1 }, { 9, 4 }, { 200, 70 }, { 70, 70 }, { 20, 45 } })
+			{
+				MatrixXd a{ m, n };
+				fill(a, m + n);
+				const HouseholderQR<double> qr{ a };
+				const MatrixXd q{ qr.householderQ() };
+				const MatrixXd r{ qr.matrixR() };
+				Assert::IsTrue(MatrixXd{ q * r - a }.normInf() < 1e-13 * n);
+				MatrixXd gram{ q.transpose() * q };
+				for (int j{}; j < gram.rows(); ++j)
+					gram(j, j) -= 1;
+				Assert::IsTrue(gram.normInf() < 1e-13 * n);
+				for (int i{ 1 }; i < r.rows(); ++i)
+					for (int j{}; j < i; ++j)
+						Assert::AreEqual(0.0, r(i, j));
+
+				const ColPivHouseholderQR<double> pivoted{ a };
+				Assert::AreEqual(std::min(m, n), pivoted.rank());
+				MatrixXd ap{ m, n };
+				for (int i{}; i < m; ++i)
+					for (int j{}; j < n; ++j)
+						ap(i, j) = a(i, pivoted.permutation()[j]);
+				Assert::IsTrue(MatrixXd{ pivoted.householderQ() * pivoted.matrixR() - ap }.normInf() < 1e-13 * n);
+			}
+
+			// Least squares on a tall system against the normal equations, for the factorization and the streaming
+			// solver (several blocks of rows).
+			const int m{ 9000 };
+			const int n{ 6 };
+			MatrixXd a{ m, n };
+			MatrixXd b{ m, 2 };
+			for (int i{}; i < m; ++i)
+			{
+				const double t{ static_cast<double>(i) / m };
+				for (int j{}; j < n; ++j)
+					a(i, j) = std::pow(t, j);
+				b(i, 0) = std::exp(t);
+				b(i, 1) = std::sin(7 * t);
+			}
+			const MatrixXd normal{ a.transpose() * a };
+			const MatrixXd expected{ solve(normal, MatrixXd{ a.transpose() * b }) };
+			Assert::IsTrue(MatrixXd{ HouseholderQR<double>{ a }.solve(b) - expected }.normInf() < 1e-6);
+			const MatrixXd streamed{ leastSquares(a, b) };
+			Assert::IsTrue(MatrixXd{ streamed - HouseholderQR<double>{ a }.solve(b) }.normInf() < 1e-9);
+
+			// A rank-deficient design: the last column repeats a combination of the others. The basic solution
+			// reaches the residual of the full-rank problem without the repeated column.
+			MatrixXd collinear{ m, n + 1 };
+			for (int i{}; i < m; ++i)
+			{
+				for (int j{}; j < n; ++j)
+					collinear(i, j) = a(i, j);
+				collinear(i, n) = a(i, 1) - 2 * a(i, 3);
+			}
+			const ColPivHouseholderQR<double> deficient{ collinear };
+			Assert::AreEqual(n, deficient.rank());
+			const MatrixXd residual{ a * expected - b };
+			for (const MatrixXd& x : { deficient.solve(b), leastSquares(collinear, b) })
+			{
+				const MatrixXd r{ collinear * x - b };
+				for (int q{}; q < 2; ++q)
+				{
+					double fitted{}, best{};
+					for (int i{}; i < m; ++i)
+					{
+						fitted += r(i, q) * r(i, q);
+						best += residual(i, q) * residual(i, q);
+					}
+					Assert::AreEqual(best, fitted, 1e-8 * best);
+				}
+			}
+
+			// Matrices not much taller than wide are factored whole: by HouseholderQR if of full rank, otherwise
+			// by ColPivHouseholderQR, which gives the same basic solution.
+			MatrixXd square{ 90, 60 };
+			fill(square, 5);
+			const MatrixXd squareRhs{ b.block(0, 0, 90, 2) };
+			Assert::IsTrue(MatrixXd{ leastSquares(square, squareRhs) - HouseholderQR<double>{ square }.solve(squareRhs) }.normInf() < 1e-12);
+			MatrixXd shortCollinear{ 2 * (n + 1), n + 1 };
+			for (int i{}; i < shortCollinear.rows(); ++i)
+				for (int j{}; j <= n; ++j)
+					shortCollinear(i, j) = collinear(600 * i, j);
+			const MatrixXd shortRhs{ b.block(0, 0, shortCollinear.rows(), 2) };
+			Assert::IsTrue(MatrixXd{ leastSquares(shortCollinear, shortRhs)
+				- ColPivHouseholderQR<double>{ shortCollinear }.solve(shortRhs) }.normInf() < 1e-12);
+
+			// An underdetermined consistent system is solved exactly.
+			MatrixXd wide{ 3, 5 };
+			fill(wide, 2);
+			const MatrixXd rhs{ wide * MatrixXd{ { 1 }, { 2 }, { 3 }, { 4 }, { 5 } } };
+			Assert::IsTrue(MatrixXd{ wide * leastSquares(wide, rhs) - rhs }.normInf() < 1e-12);
+
+			Assert::ExpectException<std::logic_error>([&] { leastSquares(a, MatrixXd{ m - 1, 1 }); });
+			Assert::ExpectException<std::logic_error>([&] { HouseholderQR<double>{ wide }.solve(rhs); });
+			Assert::ExpectException<std::logic_error>([&] { HouseholderQR<double>{ a }.solve(MatrixXd{ 3, 1 }); });
+		}
+
+		/// <summary>
+		/// Batched products, determinants, inverses and solves of one batch checked against the same operations
+		/// on each matrix. The size is not a multiple of the block, so the last block is padded.
+		/// </summary>
+		template<int n>
+		static void checkMatrixBatch(int size)
+		{
+			MatrixBatch<double, n, n> a{ size };
+			MatrixBatch<double, n, 2> b{ size };
+			std::srand(n);
+			for (int t{}; t < size; ++t)
+				for (int i{}; i < n; ++i)
+				{
+					for (int j{}; j < n; ++j)
+						a.coeffRef(t, i, j) = static_cast<double>(std::rand()) / RAND_MAX - 0.5;
+					b(t, i, 0) = static_cast<double>(std::rand()) / RAND_MAX;
+					b(t, i, 1) = i;
+				}
+			// Matrix 0 needs row exchanges: a permutation of a diagonal.
+			for (int i{}; i < n; ++i)
+				for (int j{}; j < n; ++j)
+					a(0, i, j) = (i + 1) % n == j ? i + 2.0 : 0.0;
+
+			const MatrixBatch<double, n, n> product{ a * a };
+			const std::vector<double> det{ determinant(a) };
+			const MatrixBatch<double, n, n> inv{ inverse(a) };
+			const MatrixBatch<double, n, 2> x{ solve(a, b) };
+			Assert::AreEqual(size, x.size());
+			for (int t{}; t < size; ++t)
+			{
+				const Matrix<double, n, n> m{ a.matrix(t) };
+				const Matrix<double, n, n> mm{ m * m };
+				const Matrix<double, n, n> identity{ m * inv.matrix(t) };
+				const Matrix<double, n, 2> residual{ m * x.matrix(t) - b.matrix(t) };
+				for (int i{}; i < n; ++i)
+				{
+					for (int j{}; j < n; ++j)
+					{
+						Assert::AreEqual(mm(i, j), product(t, i, j), 1e-14);
+						Assert::AreEqual(i == j ? 1.0 : 0.0, identity(i, j), 1e-9);
+					}
+					Assert::AreEqual(0.0, residual(i, 0), 1e-9);
+					Assert::AreEqual(0.0, residual(i, 1), 1e-9);
+				}
+				if constexpr (n <= 4)
+					Assert::AreEqual(m.determinant(), det[t], 1e-12);
+			}
+			double expected{ n % 2 == 0 ? -1.0 : 1.0 };	// the sign of a cyclic permutation
+			for (int i{}; i < n; ++i)
+				expected *= i + 2;
+			Assert::AreEqual(expected, det[0], 1e-9 * std::abs(expected));
+		}
+
+		TEST_METHOD(UnitTest33_MatrixBatch)
+		{
+			const SimdLevel levels[]{ SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+			for (SimdLevel level : levels)
+			{
+				setSimdLevel(level);
+				checkMatrixBatch<2>(37);
+				checkMatrixBatch<3>(37);
+				checkMatrixBatch<4>(100);
+				checkMatrixBatch<5>(9);
+				checkMatrixBatch<8>(17);
+			}
+			setSimdLevel(maxSimdLevel());
+
+			MatrixBatch<float, 3, 3> single{ 20 };
+			Assert::AreEqual(16, MatrixBatch<float, 3, 3>::lanes);
+			Assert::AreEqual(2, single.blocks());
+			for (int t{}; t < single.size(); ++t)
+				single.setMatrix(t, Matrix<float, 3, 3>{ { 2, 0, 0 }, { 0, 3, 0 }, { 0, 0, 4 } });
+			Assert::AreEqual(24.0f, determinant(single)[19]);
+			Assert::AreEqual(0.25f, inverse(single)(19, 2, 2));
+
+			// A singular matrix anywhere in the batch makes inverse and solve throw, but not determinant.
+			single.coeffRef(17, 1, 1) = 0;
+			Assert::AreEqual(0.0f, determinant(single)[17]);
+			Assert::ExpectException<std::logic_error>([&] { inverse(single); });
+			Assert::ExpectException<std::logic_error>([&] { MatrixBatch<float, 2, 2>{ 3 } * MatrixBatch<float, 2, 2>{ 4 }; });
+			Assert::ExpectException<std::out_of_range>([&] { single(20, 0, 0); });
+		}
+
+		TEST_METHOD(UnitTest34_MixedPrecision)
+		{
+			// Element-wise expressions promote their scalar types like the scalars themselves.
+			const MatrixXi ai{ { 1, 2 }, { 3, 4 } };
+			const MatrixXd ad{ { 0.5, 0.5 }, { 0.5, 0.5 } };
+			static_assert(std::is_same<decltype(ai + ad)::value_type, double>::value, "int + double is double");
+			static_assert(std::is_same<decltype(0.5 * ai)::value_type, double>::value, "double * int is double");
+			const MatrixXd sum{ ai + ad };
+			const MatrixXd halves{ 0.5 * ai };
+			const MatrixXi truncated{ ai * 0.5 };
+			const MatrixXi doubled{ 2.0 * ai };
+			MatrixXd accumulated{ ad };
+			accumulated -= 0.25 * ai;
+			for (int i{}; i < 2; ++i)
+				for (int j{}; j < 2; ++j)
+				{
+					Assert::AreEqual(ai(i, j) + 0.5, sum(i, j));
+					Assert::AreEqual(ai(i, j) * 0.5, halves(i, j));
+					Assert::AreEqual(ai(i, j) / 2, truncated(i, j));
+					Assert::AreEqual(2 * ai(i, j), doubled(i, j));
+					Assert::AreEqual(0.5 - 0.25 * ai(i, j), accumulated(i, j));
+				}
+
+			// 0.1 is not a float: the product is computed in double and then rounded.
+			MatrixXf f{ 50, 50 };
+			for (int k{}; k < f.size(); ++k)
+				f.coeffRef(k) = 1.0f + k / 7.0f;
+			const MatrixXf scaled{ 0.1 * f };
+			const MatrixXf twice{ 2.0 * f };
+			for (int k{}; k < f.size(); ++k)
+			{
+				Assert::AreEqual(static_cast<float>(0.1 * f.coeff(k)), scaled.coeff(k));
+				Assert::AreEqual(2 * f.coeff(k), twice.coeff(k));
+			}
+
+			// Products of mixed scalar types are accumulated in the promoted type.
+			MatrixXf af{ 64, 300 };
+			MatrixXf bf{ 300, 40 };
+			MatrixXf xf{ 300, 1 };
+			for (int k{}; k < af.size(); ++k)
+				af.coeffRef(k) = static_cast<float>(std::sin(0.37 * k));
+			for (int k{}; k < bf.size(); ++k)
+				bf.coeffRef(k) = static_cast<float>(std::cos(0.11 * k));
+			for (int k{}; k < xf.size(); ++k)
+				xf.coeffRef(k) = static_cast<float>(std::cos(0.23 * k));
+			const MatrixXd bd{ bf };
+			const MatrixXd reference{ MatrixXd{ af } * bd };
+			const MatrixXd mixed{ af * bd };
+			const MatrixXd wide{ multiply<double>(af, bf) };
+			const MatrixXd wideVector{ multiply<double>(af, xf) };
+			const MatrixXd referenceVector{ MatrixXd{ af } * MatrixXd{ xf } };
+			for (int k{}; k < reference.size(); ++k)
+			{
+				Assert::AreEqual(reference.coeff(k), mixed.coeff(k));
+				Assert::AreEqual(reference.coeff(k), wide.coeff(k), 1e-12);
+			}
+			for (int k{}; k < referenceVector.size(); ++k)
+				Assert::AreEqual(referenceVector.coeff(k), wideVector.coeff(k), 1e-12);
+			const MatrixXd promoted{ ai * ad };
+			Assert::AreEqual(1.5, promoted(0, 1));
+
+			// A long float sum accumulated in double keeps the accuracy of double.
+			MatrixXf tenths{ 1, 1000000 };
+			MatrixXf ones{ 1, 1000000 };
+			for (int k{}; k < tenths.size(); ++k)
+			{
+				tenths.coeffRef(k) = 0.1f;
+				ones.coeffRef(k) = 1.0f;
+			}
+			const double exact{ 1e6 * static_cast<double>(0.1f) };
+			Assert::AreEqual(exact, dot<double>(tenths, ones), 1e-12 * exact);
+			Assert::ExpectException<std::logic_error>([&] { dot<double>(tenths, xf); });
+			Assert::ExpectException<std::logic_error>([&] { multiply<double>(bf, af); });
+
+			// half: IEEE binary16, rounding to nearest even.
+			Assert::AreEqual(std::uint16_t{ 0x3c00 }, half{ 1.0f }.bits());
+			Assert::AreEqual(std::uint16_t{ 0xc000 }, half{ -2 }.bits());
+			Assert::AreEqual(std::uint16_t{ 0x7bff }, half{ 65504.0 }.bits());
+			Assert::AreEqual(std::uint16_t{ 0x7c00 }, half{ 65520.0f }.bits());
+			Assert::AreEqual(std::uint16_t{ 0x0001 }, half{ std::ldexp(1.0f, -24) }.bits());
+			Assert::AreEqual(std::uint16_t{ 0x0000 }, half{ std::ldexp(1.0f, -26) }.bits());
+			Assert::AreEqual(std::uint16_t{ 0x3c00 }, half{ 1.0f + std::ldexp(1.0f, -11) }.bits());
+			Assert::AreEqual(std::uint16_t{ 0x3c02 }, half{ 1.0f + 3 * std::ldexp(1.0f, -11) }.bits());
+			Assert::IsTrue(std::isnan(float{ half{ std::nanf("") } }));
+			Assert::AreEqual(-1.5f, float{ -half{ 1.5f } });
+			for (int bits{}; bits < 0x10000; ++bits)
+			{
+				const half h{ half::fromBits(static_cast<std::uint16_t>(bits)) };
+				if (!std::isnan(float{ h }))
+					Assert::AreEqual(h.bits(), half{ float{ h } }.bits());
+				const bfloat16 b{ bfloat16::fromBits(static_cast<std::uint16_t>(bits)) };
+				if (!std::isnan(float{ b }))
+					Assert::AreEqual(b.bits(), bfloat16{ float{ b } }.bits());
+			}
+
+			// bfloat16: the upper half of a float, rounding to nearest even.
+			Assert::AreEqual(std::uint16_t{ 0x3f80 }, bfloat16{ 1.0 }.bits());
+			Assert::AreEqual(std::uint16_t{ 0x3f80 }, bfloat16{ 1.0f + std::ldexp(1.0f, -8) }.bits());
+			Assert::AreEqual(std::uint16_t{ 0x3f82 }, bfloat16{ 1.0f + 3 * std::ldexp(1.0f, -8) }.bits());
+			Assert::IsTrue(std::isnan(float{ bfloat16{ std::nan("") } }));
+
+			// 16-bit storage, converted on the fly and accumulated in float.
+			const MatrixX<half> ah{ af };
+			const MatrixX<bfloat16> ab{ bf };
+			const MatrixX<half> xh{ xf };
+			Assert::AreEqual(half{ af(3, 7) }.bits(), ah(3, 7).bits());
+			const MatrixXf productHalf{ multiply<float>(ah, ab) };
+			const MatrixXf productVector{ multiply<float>(ah, xh) };
+			const MatrixXd exactHalf{ MatrixXd{ ah } * MatrixXd{ ab } };
+			const MatrixXd exactVector{ MatrixXd{ ah } * MatrixXd{ xh } };
+			for (int k{}; k < exactHalf.size(); ++k)
+				Assert::AreEqual(exactHalf.coeff(k), static_cast<double>(productHalf.coeff(k)), 1e-4);
+			for (int k{}; k < exactVector.size(); ++k)
+				Assert::AreEqual(exactVector.coeff(k), static_cast<double>(productVector.coeff(k)), 1e-4);
+
+			// The conversion kernels of every instruction set, including their scalar tails, are exact.
+			MatrixX<half> hs{ 1, 1001 };
+			MatrixX<bfloat16> bs{ 1, 1001 };
+			MatrixXf fs{ 1, 1001 };
+			double expected{};
+			for (int k{}; k < fs.size(); ++k)
+			{
+				fs.coeffRef(k) = 0.5f * (k % 17 - 8);
+				hs.coeffRef(k) = half{ fs.coeff(k) };
+				bs.coeffRef(k) = bfloat16{ fs.coeff(k) };
+				expected += fs.coeff(k) * (k % 5);
+			}
+			MatrixXf weights{ 1, 1001 };
+			for (int k{}; k < weights.size(); ++k)
+				weights.coeffRef(k) = static_cast<float>(k % 5);
+			const SimdLevel levels[]{ SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+			for (SimdLevel level : levels)
+			{
+				setSimdLevel(level);
+				Assert::AreEqual(expected, dot<double>(fs, weights));
+				Assert::AreEqual(static_cast<float>(expected), dot<float>(hs, weights));
+				Assert::AreEqual(static_cast<float>(expected), dot<float>(bs, weights));
+			}
+			setSimdLevel(maxSimdLevel());
+		}
+		TEST_METHOD(UnitTest35_MatrixIO)
+		{
+			MatrixXd a{ 37, 53 };
+			for (int k{}; k < a.size(); ++k)
+				a.coeffRef(k) = std::sin(0.37 * k) * 1e3;
+			const char* path{ "UnitTest35.mlm" };
+
+			// Round trip, bit for bit.
+			save(path, a);
+			const MatrixXd loaded{ load<double>(path) };
+			Assert::AreEqual(a.rows(), loaded.rows());
+			Assert::AreEqual(a.cols(), loaded.cols());
+			for (int k{}; k < a.size(); ++k)
+				Assert::AreEqual(a.coeff(k), loaded.coeff(k));
+			const MatrixXd empty{ 0, 5 };
+			save("UnitTest35_empty.mlm", empty);
+			const MatrixXd emptyLoaded{ load<double>("UnitTest35_empty.mlm") };
+			Assert::AreEqual(0, emptyLoaded.rows());
+			Assert::AreEqual(5, emptyLoaded.cols());
+			Assert::IsTrue(MappedMatrix<double>{ "UnitTest35_empty.mlm" }.verify());
+
+			// Mapped read-only view: same coefficients, usable in expressions and products.
+			{
+				const MappedMatrix<double> mapped{ path };
+				Assert::AreEqual(a.rows(), mapped.rows());
+				Assert::AreEqual(a.cols(), mapped.cols());
+				Assert::IsTrue(mapped.verify());
+				Assert::AreEqual(a(36, 52), mapped(36, 52));
+				Assert::ExpectException<std::out_of_range>([&] { mapped(37, 0); });
+				const MatrixXd twice{ mapped + a };
+				Assert::AreEqual(2 * a(5, 7), twice(5, 7));
+				const MatrixXd x{ a.transpose() };
+				const MatrixXd expected{ a * x };
+				const MatrixXd product{ mapped * x };
+				for (int k{}; k < expected.size(); ++k)
+					Assert::AreEqual(expected.coeff(k), product.coeff(k), 1e-6 * std::abs(expected.coeff(k)) + 1e-9);
+				const MatrixView<const double> block{ mapped.block(2, 3, 4, 5) };
+				Assert::AreEqual(a(5, 7), block(3, 4));
+			}
+
+			// Streaming writer: rows written one at a time give the same file.
+			{
+				MatrixFileWriter<double> writer{ "UnitTest35_stream.mlm", a.rows(), a.cols() };
+				for (int i{}; i < a.rows(); ++i)
+					writer.write(a.data() + i * a.cols(), a.cols());
+				Assert::ExpectException<std::logic_error>([&] { writer.write(a.data(), 1); });
+				writer.close();
+			}
+			const MatrixXd streamed{ load<double>("UnitTest35_stream.mlm") };
+			for (int k{}; k < a.size(); ++k)
+				Assert::AreEqual(a.coeff(k), streamed.coeff(k));
+
+			// An unfinished file, another scalar type and a flipped bit are all rejected.
+			{
+				MatrixFileWriter<double> writer{ "UnitTest35_stream.mlm", 2, 2 };
+				writer.write(a.data(), 3);
+				Assert::ExpectException<std::logic_error>([&] { writer.close(); });
+			}
+			Assert::ExpectException<std::runtime_error>([] { load<double>("UnitTest35_stream.mlm"); });
+			Assert::ExpectException<std::runtime_error>([&] { load<float>(path); });
+			Assert::ExpectException<std::runtime_error>([&] { MappedMatrix<float>{ path }; });
+			Assert::ExpectException<std::runtime_error>([] { load<double>("UnitTest35_missing.mlm"); });
+			{
+				std::fstream file{ path, std::ios::binary | std::ios::in | std::ios::out };
+				file.seekp(64 + 8 * 100 + 3);
+				file.put('\x5a');
+			}
+			Assert::ExpectException<std::runtime_error>([&] { load<double>(path); });
+			Assert::IsFalse(MappedMatrix<double>{ path }.verify());
+
+			// Fixed-size matrices, and 16-bit storage.
+			Matrix<float, 2, 3> m{ { 1.0f, 2.0f, 3.0f }, { 4.0f, 5.0f, 6.0f } };
+			save(path, m);
+			Matrix<float, 2, 3> n;
+			load(path, n);
+			Assert::AreEqual(6.0f, n(1, 2));
+			Matrix<float, 3, 2> wrong;
+			Assert::ExpectException<std::logic_error>([&] { load(path, wrong); });
+			const MatrixX<half> h{ a };
+			save(path, h);
+			Assert::AreEqual(h(12, 34).bits(), load<half>(path)(12, 34).bits());
+
+			// NumPy files: round trip, and Fortran-ordered and 1-D arrays written as NumPy would.
+			const MatrixXf af{ a };
+			saveNpy("UnitTest35.npy", af);
+			const MatrixXf npy{ loadNpy<float>("UnitTest35.npy") };
+			Assert::AreEqual(af.rows(), npy.rows());
+			for (int k{}; k < af.size(); ++k)
+				Assert::AreEqual(af.coeff(k), npy.coeff(k));
+			Assert::ExpectException<std::runtime_error>([] { loadNpy<double>("UnitTest35.npy"); });
+			{
+				std::ifstream file{ "UnitTest35.npy", std::ios::binary };
+				std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+				Assert::AreEqual(std::size_t{ 0 }, (bytes.size() - af.size() * sizeof(float)) % 64);
+			}
+			const auto writeNpy{ [](const char* file, const std::string& dict, const double* data, int count) {
+				std::string header{ dict };
+				while ((10 + header.size() + 1) % 64 != 0)
+					header.push_back(' ');
+				header.push_back('\n');
+				std::ofstream out{ file, std::ios::binary };
+				out.write("\x93NUMPY\x01\x00", 8);
+				out.put(static_cast<char>(header.size() & 0xff));
+				out.put(static_cast<char>(header.size() >> 8));
+				out.write(header.data(), header.size());
+				out.write(reinterpret_cast<const char*>(data), count * sizeof(double));
+			} };
+			const double columnMajor[]{ 1.0, 4.0, 2.0, 5.0, 3.0, 6.0 };
+			writeNpy("UnitTest35.npy", "{'descr': '<f8', 'fortran_order': True, 'shape': (2, 3), }", columnMajor, 6);
+			const MatrixXd fortran{ loadNpy<double>("UnitTest35.npy") };
+			Assert::AreEqual(2, fortran.rows());
+			Assert::AreEqual(3, fortran.cols());
+			Assert::AreEqual(2.0, fortran(0, 1));
+			Assert::AreEqual(4.0, fortran(1, 0));
+			writeNpy("UnitTest35.npy", "{'descr': '<f8', 'fortran_order': False, 'shape': (6,), }", columnMajor, 6);
+			const MatrixXd vector{ loadNpy<double>("UnitTest35.npy") };
+			Assert::AreEqual(6, vector.rows());
+			Assert::AreEqual(1, vector.cols());
+			Assert::AreEqual(5.0, vector(3, 0));
+
+			std::remove(path);
+			std::remove("UnitTest35_stream.mlm");
+			std::remove("UnitTest35_empty.mlm");
+			std::remove("UnitTest35.npy");
+		}
+		TEST_METHOD(UnitTest36_HolidayCalendar)
+		{
+			const HolidayCalendar london{ HolidayCalendarId::GBLO };
+
+			// Weekends and holidays of the London calendar.
+			Assert::IsTrue(london.isHoliday(date{ 2023, 12, 25 }));
+			Assert::IsTrue(london.isHoliday(date{ 2023, 12, 26 }));
+			Assert::IsTrue(london.isHoliday(date{ 2023, 5, 1 }));
+			Assert::IsTrue(london.isHoliday(date{ 2022, 6, 2 }));
+			Assert::IsTrue(london.isHoliday(date{ 2011, 4, 29 }));
+			Assert::IsTrue(london.isHoliday(date{ 2023, 12, 23 }));
+			Assert::IsFalse(london.isHoliday(date{ 2023, 5, 2 }));
+			Assert::IsTrue(london.isBusinessDay(date{ 2023, 12, 27 }));
+
+			// The bitmap agrees with a scan of the holidays on every day it covers, and outside it only weekends
+			// are holidays.
+			const vector<date> holidays{ london.getHolidays() };
+			for (date d{ 1950, 1, 1 }; d <= date{ 2099, 12, 31 }; d += days(1))
+			{
+				const bool weekend{ d.day_of_week() == Saturday || d.day_of_week() == Sunday };
+				const bool expected{ weekend || std::find(holidays.begin(), holidays.end(), d) != holidays.end() };
+				Assert::AreEqual(expected, london.isHoliday(d));
+			}
+			Assert::IsFalse(london.isHoliday(date{ 2150, 12, 25 }));
+			Assert::IsTrue(london.isHoliday(date{ 1900, 1, 6 }));
+
+			// Custom calendars cover the years of their holidays, with their own weekend days.
+			const HolidayCalendar custom{ { date{ 1900, 1, 2 }, date{ 2200, 1, 2 } }, Friday, Saturday, HolidayCalendarId::CUST };
+			Assert::IsTrue(custom.isHoliday(date{ 1900, 1, 2 }));
+			Assert::IsTrue(custom.isHoliday(date{ 2200, 1, 2 }));
+			Assert::IsTrue(custom.isHoliday(date{ 2024, 1, 5 }));
+			Assert::IsFalse(custom.isHoliday(date{ 2024, 1, 7 }));
+
+			// Copies share nothing with the original.
+			HolidayCalendar copy{ london };
+			Assert::IsTrue(copy.isHoliday(date{ 2023, 12, 25 }));
+			copy = custom;
+			Assert::IsFalse(copy.isHoliday(date{ 2023, 12, 25 }));
+			Assert::IsTrue(london.isHoliday(date{ 2023, 12, 25 }));
+
+			// Following adjustment skips the Christmas weekend and both bank holidays.
+			Assert::IsTrue(date{ 2023, 12, 27 } == london.adjust(date{ 2023, 12, 23 }, BusinessDayConventions{ "Following" }));
+			Assert::IsTrue(date{ 2023, 12, 22 } == london.adjust(date{ 2023, 12, 26 }, BusinessDayConventions{ "Preceding" }));
+		}
+		TEST_METHOD(UnitTest37_BusinessDayArithmetic)
+		{
+			const HolidayCalendar london{ HolidayCalendarId::GBLO };
+
+			// Christmas 2023: Saturday 23 to Tuesday 26 December are holidays.
+			Assert::IsTrue(date{ 2023, 12, 27 } == london.nextBusinessDay(date{ 2023, 12, 22 }));
+			Assert::IsTrue(date{ 2023, 12, 27 } == london.nextBusinessDay(date{ 2023, 12, 24 }));
+			Assert::IsTrue(date{ 2023, 12, 22 } == london.previousBusinessDay(date{ 2023, 12, 27 }));
+			Assert::IsTrue(date{ 2023, 12, 28 } == london.addBusinessDays(date{ 2023, 12, 21 }, 3));
+			Assert::IsTrue(date{ 2023, 12, 21 } == london.addBusinessDays(date{ 2023, 12, 28 }, -3));
+			Assert::IsTrue(date{ 2023, 12, 24 } == london.addBusinessDays(date{ 2023, 12, 24 }, 0));
+			Assert::AreEqual(1, london.businessDaysBetween(date{ 2023, 12, 22 }, date{ 2023, 12, 27 }));
+			Assert::AreEqual(-1, london.businessDaysBetween(date{ 2023, 12, 27 }, date{ 2023, 12, 22 }));
+			Assert::AreEqual(0, london.businessDaysBetween(date{ 2023, 12, 23 }, date{ 2023, 12, 27 }));
+
+			// Against stepping through the days one by one, including dates beyond the bitmap on both sides and
+			// a calendar with other weekend days.
+			const HolidayCalendar custom{ { date{ 2024, 1, 1 } }, Friday, Saturday, HolidayCalendarId::CUST };
+			const auto stepped{ [](const HolidayCalendar& calendar, date d, int n) {
+				for (; n > 0; --n)
+					for (d += days(1); calendar.isHoliday(d); d += days(1)) {}
+				for (; n < 0; ++n)
+					for (d -= days(1); calendar.isHoliday(d); d -= days(1)) {}
+				return d;
+			} };
+			const auto counted{ [](const HolidayCalendar& calendar, date start, date end) {
+				int count{};
+				for (date d{ start }; d < end; d += days(1))
+					count += calendar.isBusinessDay(d);
+				return count;
+			} };
+			for (const HolidayCalendar* calendar : { &london, &custom })
+			{
+				for (date d{ 1947, 1, 1 }; d < date{ 2103, 1, 1 }; d += days(37))
+				{
+					for (int n : { 1, 2, 7, 40, 400, -1, -3, -9, -64, -700 })
+						Assert::IsTrue(stepped(*calendar, d, n) == calendar->addBusinessDays(d, n));
+					const date end{ d + days(d.day_number() % 997) };
+					Assert::AreEqual(counted(*calendar, d, end), calendar->businessDaysBetween(d, end));
+					Assert::AreEqual(-counted(*calendar, d, end), calendar->businessDaysBetween(end, d));
+				}
+			}
+		}
+		TEST_METHOD(UnitTest38_BulkAdjustment)
+		{
+			const HolidayCalendar london{ HolidayCalendarId::GBLO };
+			const BusinessDayConventions following{ "Following" };
+			const BusinessDayConventions modifiedFollowing{ "Modified Following" };
+			const BusinessDayConventions preceding{ "Preceding" };
+			const BusinessDayConventions modifiedPreceding{ "Modified Preceding" };
+
+			// Saturday 30 December 2023 follows to Tuesday 2 January 2024, in the next month: modified following
+			// precedes to Friday 29 December instead. Sunday 1 September 2024 precedes to Friday 30 August.
+			Assert::IsTrue(date{ 2024, 1, 2 } == london.adjust(date{ 2023, 12, 30 }, following));
+			Assert::IsTrue(date{ 2023, 12, 29 } == london.adjust(date{ 2023, 12, 30 }, modifiedFollowing));
+			Assert::IsTrue(date{ 2024, 8, 30 } == london.adjust(date{ 2024, 9, 1 }, preceding));
+			Assert::IsTrue(date{ 2024, 9, 2 } == london.adjust(date{ 2024, 9, 1 }, modifiedPreceding));
+			Assert::IsTrue(date{ 2024, 9, 1 } == london.adjust(date{ 2024, 9, 1 }, BusinessDayConventions{ "No Adjustment" }));
+
+			// Bulk adjustment of every day, as dates and as day numbers, against stepping through the days.
+			const auto stepped{ [&london](const date& d, const BusinessDayConventions& c) {
+				const businessDayConventions convention{ c.getBusDayConvention() };
+				const bool forward{ convention == businessDayConventions::FOLLOWING || convention == businessDayConventions::MODIFIED_FOLLOWING };
+				date result{ d };
+				while (london.isHoliday(result))
+					result += days(forward ? 1 : -1);
+				if ((convention == businessDayConventions::MODIFIED_FOLLOWING || convention == businessDayConventions::MODIFIED_PRECEDING)
+					&& result.month() != d.month())
+					for (result = d; london.isHoliday(result); result += days(forward ? -1 : 1)) {}
+				return result;
+			} };
+			vector<date> dates;
+			for (date d{ 1948, 1, 1 }; d < date{ 2102, 1, 1 }; d += days(1))
+				dates.push_back(d);
+			vector<std::uint32_t> dayNumbers;
+			for (const date& d : dates)
+				dayNumbers.push_back(d.day_number());
+
+			for (const BusinessDayConventions& c : { following, modifiedFollowing, preceding, modifiedPreceding })
+			{
+				vector<date> adjusted(dates.size());
+				london.adjust(dates.data(), adjusted.data(), static_cast<int>(dates.size()), c);
+				vector<std::uint32_t> adjustedNumbers{ dayNumbers };
+				london.adjust(adjustedNumbers.data(), adjustedNumbers.data(), static_cast<int>(adjustedNumbers.size()), c);
+				vector<date> inPlace{ dates };
+				london.adjust(inPlace, c);
+				for (std::size_t i{}; i < dates.size(); ++i)
+				{
+					const date expected{ stepped(dates[i], c) };
+					Assert::IsTrue(expected == adjusted[i]);
+					Assert::IsTrue(expected == inPlace[i]);
+					Assert::AreEqual(expected.day_number(), adjustedNumbers[i]);
+				}
+			}
+		}
+		TEST_METHOD(UnitTest39_JointCalendars)
+		{
+			const HolidayCalendar london{ HolidayCalendarId::GBLO };
+			const HolidayCalendar newYork{ { date{ 2024, 7, 4 }, date{ 2024, 11, 28 }, date{ 2024, 12, 25 } }, Saturday, Sunday, HolidayCalendarId::CUST };
+			const HolidayCalendar gulf{ { date{ 2024, 4, 10 }, date{ 2120, 6, 2 } }, Friday, Saturday, HolidayCalendarId::CUST };
+
+			const HolidayCalendar both{ london + newYork };
+			Assert::IsTrue(both.isHoliday(date{ 2024, 7, 4 }));
+			Assert::IsTrue(both.isHoliday(date{ 2024, 12, 26 }));
+			Assert::IsTrue(both.isBusinessDay(date{ 2024, 7, 5 }));
+			Assert::IsTrue(date{ 2024, 12, 27 } == both.nextBusinessDay(date{ 2024, 12, 24 }));
+			Assert::IsTrue(date{ 2024, 7, 5 } == both.adjust(date{ 2024, 7, 4 }, BusinessDayConventions{ "Following" }));
+			const HolidayCalendar either{ london | newYork };
+			Assert::IsTrue(either.isBusinessDay(date{ 2024, 7, 4 }));
+			Assert::IsTrue(either.isBusinessDay(date{ 2024, 12, 26 }));
+			Assert::IsTrue(either.isHoliday(date{ 2024, 12, 25 }));
+			Assert::IsTrue("GBLO+CUST" == both.getName());
+			Assert::IsTrue("(GBLO|CUST)+CUST" == ((london | newYork) + gulf).getName());
+
+			Assert::AreEqual((1 << Friday) | (1 << Saturday) | (1 << Sunday), int{ (london + gulf).getWeekendDays() });
+			Assert::AreEqual(1 << Saturday, int{ (london | gulf).getWeekendDays() });
+
+			// Weekends that cover the whole week leave no business days.
+			const HolidayCalendar monTue{ {}, Monday, Tuesday, HolidayCalendarId::CUST };
+			const HolidayCalendar wedThu{ {}, Wednesday, Thursday, HolidayCalendarId::CUST };
+			const HolidayCalendar friSat{ {}, Friday, Saturday, HolidayCalendarId::CUST };
+			const HolidayCalendar sun{ {}, Sunday, Sunday, HolidayCalendarId::CUST };
+			const HolidayCalendar sixDays{ monTue + wedThu + friSat };
+			Assert::IsTrue(date{ 2024, 7, 14 } == sixDays.addBusinessDays(date{ 2024, 7, 7 }, 1));
+			Assert::ExpectException<std::logic_error>([&] { sixDays + sun; });
+
+			// Against the calendars themselves, over calendars with the same days and with different days and
+			// weekends, and beyond their bitmaps on both sides.
+			for (const HolidayCalendar* other : { &newYork, &gulf })
+			{
+				const HolidayCalendar combined{ london.combinedWith(*other) };
+				const HolidayCalendar linked{ london.linkedWith(*other) };
+				for (date d{ 1940, 1, 1 }; d < date{ 2130, 1, 1 }; d += days(1))
+				{
+					Assert::AreEqual(london.isHoliday(d) || other->isHoliday(d), combined.isHoliday(d));
+					Assert::AreEqual(london.isHoliday(d) && other->isHoliday(d), linked.isHoliday(d));
+				}
+				for (date d{ 1945, 1, 1 }; d < date{ 2125, 1, 1 }; d += days(101))
+				{
+					date stepped{ d };
+					for (int k{}; k < 10; ++k)
+						for (stepped += days(1); combined.isHoliday(stepped); stepped += days(1)) {}
+					Assert::IsTrue(stepped == combined.addBusinessDays(d, 10));
+					int count{};
+					for (date day{ d }; day < d + days(90); day += days(1))
+						count += linked.isBusinessDay(day);
+					Assert::AreEqual(count, linked.businessDaysBetween(d, d + days(90)));
+				}
+			}
+		}
+		TEST_METHOD(UnitTest40_CalendarRegistry)
+		{
+			// Every request for a calendar gets the same immutable calendar.
+			const HolidayCalendarHandle& london{ holidayCalendar(HolidayCalendarId::GBLO) };
+			Assert::IsTrue(london == holidayCalendar(HolidayCalendarId::GBLO));
+			Assert::IsTrue(london == holidayCalendar("GBLO"));
+			Assert::IsTrue(london->getHolidays() == HolidayCalendar{ HolidayCalendarId::GBLO }.getHolidays());
+			Assert::IsTrue(holidayCalendar(HolidayCalendarId::NYSE) != london);
+
+			const HolidayCalendarHandle joint{ holidayCalendar("GBLO+NYSE") };
+			Assert::IsTrue(joint == holidayCalendar("GBLO+NYSE"));
+			Assert::IsTrue(joint == holidayCalendar("(GBLO+NYSE)"));
+			Assert::IsTrue(&holidayCalendar("(GBLO+NYSE)") == &holidayCalendar("(GBLO+NYSE)"));
+			Assert::IsTrue(&holidayCalendar("GBLO") == &holidayCalendar("GBLO"));
+			Assert::IsTrue("GBLO+NYSE" == joint->getName());
+			Assert::IsTrue(joint->getHolidays() == (*london + *holidayCalendar(HolidayCalendarId::NYSE)).getHolidays());
+			Assert::IsTrue("(GBLO|EUTA)+NYSE" == holidayCalendar("(GBLO|EUTA)+NYSE")->getName());
+			Assert::IsTrue("GBLO+NYSE+EUTA" == holidayCalendar("GBLO+NYSE+EUTA")->getName());
+
+			Assert::ExpectException<std::invalid_argument>([] { holidayCalendar("XXXX"); });
+			Assert::ExpectException<std::invalid_argument>([] { holidayCalendar("GBLO+"); });
+			Assert::ExpectException<std::invalid_argument>([] { holidayCalendar("GBLO+NYSE|EUTA"); });
+			Assert::ExpectException<std::invalid_argument>([] { holidayCalendar("(GBLO+NYSE"); });
+			Assert::ExpectException<std::invalid_argument>([] { holidayCalendar("GBLO)+(NYSE"); });
+
+			// Threads racing for a new joint calendar all get the one that was built.
+			ThreadPool pool{ 8 };
+			vector<const HolidayCalendar*> calendars(64);
+			pool.parallelFor(0, 64, 1, [&](int first, int last) {
+				for (int i{ first }; i < last; ++i)
+					calendars[i] = holidayCalendar("EUTA|GBLO").get();
+			});
+			for (const HolidayCalendar* calendar : calendars)
+				Assert::IsTrue(calendar == holidayCalendar("EUTA|GBLO").get());
+		}
 	};
 }